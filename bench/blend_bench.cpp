@@ -0,0 +1,354 @@
+/*
+ * Copyright 2026 Toni500
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ * disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ * following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ * products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+// oshot_blend_bench: checks blend_span() and composite_span() on every instruction set this CPU runs against
+// their scalar reference and the exact rounding formulas in composite.hpp, then reports the time per megapixel
+// of each as JSON.
+//
+//   oshot_blend_bench
+//   oshot_blend_bench --width 3840 --height 2160 --iterations 20 --out blend.json
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "composite.hpp"
+#include "fmt/format.h"
+#include "util.hpp"
+
+using ms_t = std::chrono::duration<double, std::milli>;
+
+struct bench_options_t
+{
+    std::string out;
+    int         width      = 1920;
+    int         height     = 1080;
+    int         iterations = 10;
+};
+
+static double median(std::vector<double> v)
+{
+    if (v.empty())
+        return 0;
+    std::sort(v.begin(), v.end());
+    const size_t n = v.size();
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+// The formula of composite.hpp, in doubles
+static uint8_t reference_channel(uint32_t src, uint32_t a, uint32_t dst)
+{
+    return uint8_t(std::floor((double(src) * a + double(dst) * (255 - a)) / 255.0 + 0.5));
+}
+
+static bool matches_reference(const uint8_t* before, const uint8_t* after, size_t n, rgba_t c, const uint8_t* cov)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        const uint32_t a = uint32_t(std::floor(double(c.a) * cov[i] / 255.0 + 0.5));
+        const uint8_t* d = before + i * 4;
+        const uint8_t* o = after + i * 4;
+        if (o[0] != reference_channel(c.r, a, d[0]) || o[1] != reference_channel(c.g, a, d[1]) ||
+            o[2] != reference_channel(c.b, a, d[2]) || o[3] != reference_channel(255, a, d[3]))
+            return false;
+    }
+    return true;
+}
+
+// Every color alpha and coverage pair, over random pixels and span lengths that leave SIMD tails
+static bool verify()
+{
+    std::mt19937                            rng(42);
+    std::uniform_int_distribution<uint32_t> byte(0, 255);
+
+    std::vector<uint8_t> pixels, simd, scalar;
+    std::vector<uint8_t> cov;
+    for (uint32_t ca = 0; ca < 256; ++ca)
+    {
+        for (uint32_t cv = 0; cv < 256; ++cv)
+        {
+            const rgba_t c(uint8_t(byte(rng)), uint8_t(byte(rng)), uint8_t(byte(rng)), uint8_t(ca));
+            const size_t n = 1 + (ca * 256 + cv) % 37;
+
+            pixels.resize(n * 4);
+            for (uint8_t& v : pixels)
+                v = uint8_t(byte(rng));
+            cov.assign(n, uint8_t(cv));
+            cov[n / 2] = uint8_t(byte(rng));  // not all the same
+
+            simd = scalar = pixels;
+            blend_span(simd.data(), n, c, cov.data());
+            blend_span_scalar(scalar.data(), n, c, cov.data());
+            if (simd != scalar || !matches_reference(pixels.data(), scalar.data(), n, c, cov.data()))
+            {
+                fmt::println(stderr, "per-pixel coverage mismatch: color alpha {}, coverage {}", ca, cv);
+                return false;
+            }
+
+            cov.assign(n, uint8_t(cv));
+            simd = scalar = pixels;
+            blend_span(simd.data(), n, c, uint8_t(cv));
+            blend_span_scalar(scalar.data(), n, c, uint8_t(cv));
+            if (simd != scalar || !matches_reference(pixels.data(), scalar.data(), n, c, cov.data()))
+            {
+                fmt::println(stderr, "uniform coverage mismatch: color alpha {}, coverage {}", ca, cv);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Premultiplied layers over random pixels, transparent runs included
+static bool verify_composite()
+{
+    std::mt19937                            rng(43);
+    std::uniform_int_distribution<uint32_t> byte(0, 255);
+
+    std::vector<uint8_t> pixels, layer, simd, scalar;
+    for (int run = 0; run < 4096; ++run)
+    {
+        const size_t n = 1 + size_t(run) % 37;
+        pixels.resize(n * 4);
+        layer.resize(n * 4);
+        for (uint8_t& v : pixels)
+            v = uint8_t(byte(rng));
+        for (size_t i = 0; i < n; ++i)
+        {
+            const uint32_t a = (run + i) % 3 ? byte(rng) : 0;
+            layer[i * 4 + 0] = uint8_t(byte(rng) * a / 255);
+            layer[i * 4 + 1] = uint8_t(byte(rng) * a / 255);
+            layer[i * 4 + 2] = uint8_t(byte(rng) * a / 255);
+            layer[i * 4 + 3] = uint8_t(a);
+        }
+
+        simd = scalar = pixels;
+        composite_span(simd.data(), layer.data(), n);
+        composite_span_scalar(scalar.data(), layer.data(), n);
+        for (size_t i = 0; i < n * 4; ++i)
+        {
+            const uint32_t ia = 255 - layer[i - i % 4 + 3];
+            const uint8_t  ref =
+                uint8_t(layer[i] + uint32_t(std::floor(double(pixels[i]) * ia / 255.0 + 0.5)));
+            if (simd[i] != scalar[i] || scalar[i] != ref)
+            {
+                fmt::println(stderr, "composite mismatch: run {}, byte {}", run, i);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void usage()
+{
+    fmt::print(R"(Usage: oshot_blend_bench [OPTIONS]...
+Check the annotation compositor against its reference, then time it per megapixel and report JSON.
+
+OPTIONS:
+    --width <N>                 Width of the image blended over (default: 1920)
+    --height <N>                Height of the image blended over (default: 1080)
+    --iterations <N>            Timed runs per case, after one warm-up run (default: 10)
+    --out <PATH>                Write the JSON there instead of stdout
+)");
+}
+
+static bool parse_args(int argc, char* argv[], bench_options_t& opts)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view arg = argv[i];
+        if (arg == "-h" || arg == "--help")
+        {
+            usage();
+            std::exit(EXIT_SUCCESS);
+        }
+
+        if (i + 1 >= argc)
+        {
+            fmt::println(stderr, "Unknown option or missing value: '{}'", arg);
+            return false;
+        }
+
+        const char* value = argv[++i];
+        // clang-format off
+        if      (arg == "--out")        opts.out        = value;
+        else if (arg == "--width")      opts.width      = std::max(1, std::atoi(value));
+        else if (arg == "--height")     opts.height     = std::max(1, std::atoi(value));
+        else if (arg == "--iterations") opts.iterations = std::max(1, std::atoi(value));
+        else
+        {
+            fmt::println(stderr, "Unknown option '{}'", arg);
+            return false;
+        }
+        // clang-format on
+    }
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    bench_options_t opts;
+    if (!parse_args(argc, argv, opts))
+    {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    // Every kernel, not only the one blend_span() would pick here
+    const std::string        best = blend_span_isa();
+    std::vector<const char*> isas = blend_span_isas();
+    bool                     exact = true;
+    for (const char* isa : isas)
+    {
+        blend_span_set_isa(isa);
+        const bool ok = verify() && verify_composite();
+        fmt::println(stderr, "{}: {}", isa, ok ? "matches the reference" : "MISMATCH");
+        exact = exact && ok;
+    }
+    // "scalar" through blend_span() is the reference itself, it's timed as that below
+    isas.pop_back();
+
+    const size_t w = size_t(opts.width), h = size_t(opts.height);
+    const double mpx = double(w * h) / 1e6;
+
+    std::mt19937         rng(7);
+    std::vector<uint8_t> image(w * h * 4);
+    for (size_t i = 0; i < image.size(); ++i)
+        image[i] = (i % 4 == 3) ? 0xFF : uint8_t(rng());
+
+    // Coverage like a rasterized shape's: mostly empty or full, partial along the edges
+    std::vector<uint8_t> cov(w);
+    for (size_t x = 0; x < w; ++x)
+    {
+        const size_t m = x % 64;
+        cov[x]         = m < 24 ? 0 : m < 28 || m >= 60 ? uint8_t(rng()) : 0xFF;
+    }
+
+    // An annotation layer row: the same shape edges, premultiplied
+    std::vector<uint8_t> layer(w * 4, 0);
+    blend_span_scalar(layer.data(), w, rgba_t(0xE0, 0x40, 0x30, 0xC0), cov.data());
+
+    using span_fn = std::function<void(uint8_t* row, const rgba_t& c)>;
+    struct case_t
+    {
+        std::string name;
+        rgba_t      color;
+        span_fn     simd, scalar;
+    };
+    const rgba_t              translucent(0xE0, 0x40, 0x30, 0x80);
+    const rgba_t              opaque(0xE0, 0x40, 0x30, 0xFF);
+    const std::vector<case_t> cases = {
+        { "uniform-translucent",
+          translucent,
+          [&](uint8_t* row, const rgba_t& c) { blend_span(row, w, c); },
+          [&](uint8_t* row, const rgba_t& c) { blend_span_scalar(row, w, c); } },
+        { "uniform-opaque",
+          opaque,
+          [&](uint8_t* row, const rgba_t& c) { blend_span(row, w, c); },
+          [&](uint8_t* row, const rgba_t& c) { blend_span_scalar(row, w, c); } },
+        { "coverage-translucent",
+          translucent,
+          [&](uint8_t* row, const rgba_t& c) { blend_span(row, w, c, cov.data()); },
+          [&](uint8_t* row, const rgba_t& c) { blend_span_scalar(row, w, c, cov.data()); } },
+        { "coverage-opaque",
+          opaque,
+          [&](uint8_t* row, const rgba_t& c) { blend_span(row, w, c, cov.data()); },
+          [&](uint8_t* row, const rgba_t& c) { blend_span_scalar(row, w, c, cov.data()); } },
+        { "layer-over",
+          translucent,
+          [&](uint8_t* row, const rgba_t&) { composite_span(row, layer.data(), w); },
+          [&](uint8_t* row, const rgba_t&) { composite_span_scalar(row, layer.data(), w); } },
+    };
+
+    std::vector<const char*> paths = isas;
+    paths.push_back("scalar");
+
+    std::string results_json;
+    for (const case_t& bc : cases)
+    {
+        for (const char* path : paths)
+        {
+            const bool simd = std::string_view(path) != "scalar";
+            if (simd)
+                blend_span_set_isa(path);
+
+            const span_fn&      fn = simd ? bc.simd : bc.scalar;
+            std::vector<double> times;
+            for (int i = 0; i <= opts.iterations; ++i)
+            {
+                std::vector<uint8_t> img   = image;
+                const auto           start = std::chrono::steady_clock::now();
+                for (size_t y = 0; y < h; ++y)
+                    fn(img.data() + y * w * 4, bc.color);
+                if (i > 0)  // the first run only warms up caches and allocations
+                    times.push_back(ms_t(std::chrono::steady_clock::now() - start).count());
+            }
+
+            const double ms = median(times);
+            fmt::println(stderr, "{:<21} {:<6} {:8.3f} ms/MP", bc.name, path, ms / mpx);
+
+            if (!results_json.empty())
+                results_json += ",\n";
+            results_json += fmt::format("    {{\"case\":\"{}\",\"path\":\"{}\",\"ms\":{:.3f},\"ms_per_mp\":{:.4f},"
+                                        "\"mp_per_s\":{:.1f}}}",
+                                        bc.name,
+                                        path,
+                                        ms,
+                                        ms / mpx,
+                                        ms > 0 ? mpx / (ms / 1000.0) : 0.0);
+        }
+    }
+
+    const std::string json =
+        fmt::format("{{\n  \"w\":{},\n  \"h\":{},\n  \"iterations\":{},\n  \"isa\":\"{}\",\n  \"exact\":{},\n"
+                    "  \"results\":[\n{}\n  ]\n}}\n",
+                    w,
+                    h,
+                    opts.iterations,
+                    best,
+                    exact,
+                    results_json);
+    if (opts.out.empty())
+    {
+        fmt::print("{}", json);
+    }
+    else
+    {
+        std::ofstream out(opts.out, std::ios::binary);
+        if (!out.write(json.data(), std::streamsize(json.size())))
+            die("Failed to write '{}'", opts.out);
+    }
+
+    return exact ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,690 @@
+/*
+ * Copyright 2026 Toni500
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ * disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ * following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ * products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+// oshot_ocr_bench: renders a fixed corpus of synthetic screen-text images with known ground truth,
+// runs them through OcrAPI and reports per-stage latency, throughput, peak memory and
+// character error rate as JSON. Optionally compares against a previous run.
+//
+//   oshot_ocr_bench --out bench.json
+//   oshot_ocr_bench --baseline bench.json   # exits non-zero on a regression
+
+#define STB_TRUETYPE_IMPLEMENTATION
+#define STBTT_STATIC
+#include "imstb_truetype.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "config.hpp"
+#include "fmt/format.h"
+#include "fmt/ranges.h"
+#include "json.hpp"
+#include "platform.hpp"
+#include "screen_capture.hpp"
+#include "spdlog/sinks/stdout_color_sinks.h"
+#include "text_extraction.hpp"
+#include "util.hpp"
+
+#if OSHOT_WINDOWS
+#  include <windows.h>
+#  include <psapi.h>
+#else
+#  include <sys/resource.h>
+#endif
+
+using ms_t = std::chrono::duration<double, std::milli>;
+
+enum class FontRole
+{
+    Sans,
+    Mono,
+    Cjk
+};
+
+struct bench_case_t
+{
+    std::string_view name;
+    FontRole         font;
+    float            px;
+    bool             dark;
+    std::string_view model;  // empty = --model
+    std::string_view text;
+};
+
+// clang-format off
+// Typical things people select on screen: UI labels, prose, code, terminals, numbers, CJK.
+// Keep names stable, baselines are matched by them.
+static constexpr bench_case_t corpus[] = {
+    { "ui_sans_14_light",      FontRole::Sans, 14, false, "", "File  Edit  View  Selection  Help" },
+    { "ui_sans_14_dark",       FontRole::Sans, 14, true,  "", "File  Edit  View  Selection  Help" },
+    { "small_sans_11_light",   FontRole::Sans, 11, false, "", "Last modified 2026-03-10 17:24 by toni" },
+    { "body_sans_16_light",    FontRole::Sans, 16, false, "",
+      "The quick brown fox jumps over the lazy dog.\n"
+      "Screenshots are saved to your Pictures folder\n"
+      "unless a different path is set in the config." },
+    { "body_sans_16_dark",     FontRole::Sans, 16, true,  "",
+      "The quick brown fox jumps over the lazy dog.\n"
+      "Screenshots are saved to your Pictures folder\n"
+      "unless a different path is set in the config." },
+    { "heading_sans_32_light", FontRole::Sans, 32, false, "", "Screenshot copied to clipboard" },
+    { "code_mono_14_dark",     FontRole::Mono, 14, true,  "",
+      "for (size_t i = 0; i < items.size(); ++i)\n"
+      "    total += items[i].w * items[i].h;\n"
+      "return Ok(std::move(ret));" },
+    { "code_mono_14_light",    FontRole::Mono, 14, false, "",
+      "for (size_t i = 0; i < items.size(); ++i)\n"
+      "    total += items[i].w * items[i].h;\n"
+      "return Ok(std::move(ret));" },
+    { "terminal_mono_13_dark", FontRole::Mono, 13, true,  "",
+      "$ ls -la /usr/share/fonts\n"
+      "total 48\n"
+      "drwxr-xr-x 6 root root 4096 Mar 10 17:24 truetype" },
+    { "numbers_mono_16_light", FontRole::Mono, 16, false, "", "0123456789 +-*/ = 42.00 $1,337.50" },
+    { "cjk_chi_sim_20_light",  FontRole::Cjk,  20, false, "chi_sim", "截图已保存到剪贴板" },
+    { "cjk_jpn_20_dark",       FontRole::Cjk,  20, true,  "jpn",     "スクリーンショットを保存しました" },
+    // Combined models, for default.ocr-script-routing: its cost on single-script text, its gain on mixed text
+    { "body_sans_16_light_eng_jpn", FontRole::Sans, 16, false, "eng+jpn",
+      "The quick brown fox jumps over the lazy dog.\n"
+      "Screenshots are saved to your Pictures folder\n"
+      "unless a different path is set in the config." },
+    { "mixed_cjk_20_light_eng_jpn", FontRole::Cjk, 20, false, "eng+jpn",
+      "Screenshot saved to Pictures\n"
+      "スクリーンショットを保存しました" },
+    { "mixed_cjk_20_dark_eng_chi_sim", FontRole::Cjk, 20, true, "eng+chi_sim",
+      "Copied to clipboard\n"
+      "截图已保存到剪贴板" },
+};
+// clang-format on
+
+// First one found wins, see get_font_path()
+static const std::vector<std::string> default_fonts[] = {
+    { "DejaVuSans.ttf", "LiberationSans-Regular.ttf", "NotoSans-Regular.ttf", "arial.ttf", "Arial.ttf" },
+    { "DejaVuSansMono.ttf", "LiberationMono-Regular.ttf", "NotoSansMono-Regular.ttf", "consola.ttf", "Menlo.ttc" },
+    { "NotoSansCJK-Regular.ttc", "NotoSansCJKsc-Regular.otf", "wqy-microhei.ttc", "msyh.ttc", "PingFang.ttc" },
+};
+
+struct font_t
+{
+    std::string          path;
+    std::vector<uint8_t> data;
+    stbtt_fontinfo       info{};
+};
+
+struct bench_options_t
+{
+    std::string model;
+    std::string tessdata;
+    std::string config;
+    std::string out;
+    std::string baseline;
+    std::string filter;
+    std::string script_routing;  // "on"/"off", empty = config's
+    std::string fonts[3];
+    int         iterations       = 5;
+    double      max_slowdown     = 10.0;  // %
+    double      max_cer_increase = 0.01;
+};
+
+static size_t peak_rss_kib()
+{
+#if OSHOT_WINDOWS
+    PROCESS_MEMORY_COUNTERS pmc{};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        return pmc.PeakWorkingSetSize / 1024;
+    return 0;
+#else
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#  if OSHOT_MACOS
+    return size_t(usage.ru_maxrss) / 1024;  // bytes
+#  else
+    return size_t(usage.ru_maxrss);  // already KiB
+#  endif
+#endif
+}
+
+static std::u32string utf8_to_u32(std::string_view s)
+{
+    std::u32string out;
+    for (size_t i = 0; i < s.size();)
+    {
+        const uint8_t c   = uint8_t(s[i]);
+        const int     len = c < 0x80 ? 1 : (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xE ? 3 : (c >> 3) == 0x1E ? 4 : 1;
+        char32_t      cp  = len == 1 ? c : len == 2 ? (c & 0x1F) : len == 3 ? (c & 0x0F) : (c & 0x07);
+        for (int k = 1; k < len && i + k < s.size(); ++k)
+            cp = (cp << 6) | (uint8_t(s[i + k]) & 0x3F);
+        out += cp;
+        i += len;
+    }
+    return out;
+}
+
+// Whitespace runs become a single space, leading/trailing ones go.
+// CJK has no word spaces but Tesseract likes to insert them, so drop them altogether there.
+static std::u32string normalize(std::string_view s, bool drop_spaces)
+{
+    std::u32string out;
+    bool           in_space = false;
+    for (const char32_t c : utf8_to_u32(s))
+    {
+        if (c == U' ' || c == U'\t' || c == U'\n' || c == U'\r')
+        {
+            in_space = true;
+            continue;
+        }
+        if (in_space && !drop_spaces && !out.empty())
+            out += U' ';
+        in_space = false;
+        out += c;
+    }
+    return out;
+}
+
+// Levenshtein distance over code points / reference length
+static double char_error_rate(const std::u32string& ref, const std::u32string& hyp)
+{
+    if (ref.empty())
+        return hyp.empty() ? 0.0 : 1.0;
+
+    std::vector<size_t> prev(hyp.size() + 1), cur(hyp.size() + 1);
+    std::iota(prev.begin(), prev.end(), 0);
+    for (size_t i = 1; i <= ref.size(); ++i)
+    {
+        cur[0] = i;
+        for (size_t j = 1; j <= hyp.size(); ++j)
+            cur[j] = std::min({ prev[j] + 1, cur[j - 1] + 1, prev[j - 1] + (ref[i - 1] != hyp[j - 1]) });
+        std::swap(prev, cur);
+    }
+    return double(prev[hyp.size()]) / double(ref.size());
+}
+
+static Result<font_t> load_font(const std::vector<std::string>& candidates)
+{
+    for (const std::string& name : candidates)
+    {
+        const fs::path& path = get_font_path(name);
+        if (path.empty())
+            continue;
+
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            continue;
+
+        font_t font;
+        font.path = path.string();
+        font.data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+        const int offset = stbtt_GetFontOffsetForIndex(font.data.data(), 0);
+        if (offset < 0 || !stbtt_InitFont(&font.info, font.data.data(), offset))
+            continue;
+        return Ok(std::move(font));
+    }
+    return Err("none of {} found", fmt::join(candidates, ", "));
+}
+
+// Render `text` the way a desktop would show it: antialiased, light or dark theme, some padding.
+static capture_result_t render_text(const font_t& font, float px, bool dark, std::string_view text)
+{
+    const stbtt_fontinfo* info  = &font.info;
+    const float           scale = stbtt_ScaleForPixelHeight(info, px);
+
+    int ascent = 0, descent = 0, line_gap = 0;
+    stbtt_GetFontVMetrics(info, &ascent, &descent, &line_gap);
+    const int baseline = int(std::ceil(ascent * scale));
+    const int line_h   = int(std::ceil((ascent - descent + line_gap) * scale));
+
+    std::vector<std::u32string> lines;
+    for (size_t start = 0; start <= text.size();)
+    {
+        const size_t nl = std::min(text.find('\n', start), text.size());
+        lines.push_back(utf8_to_u32(text.substr(start, nl - start)));
+        start = nl + 1;
+    }
+
+    auto line_width = [&](const std::u32string& line) {
+        float x = 0;
+        for (size_t i = 0; i < line.size(); ++i)
+        {
+            int advance = 0, lsb = 0;
+            stbtt_GetCodepointHMetrics(info, int(line[i]), &advance, &lsb);
+            x += advance * scale;
+            if (i + 1 < line.size())
+                x += stbtt_GetCodepointKernAdvance(info, int(line[i]), int(line[i + 1])) * scale;
+        }
+        return x;
+    };
+
+    float max_w = 0;
+    for (const std::u32string& line : lines)
+        max_w = std::max(max_w, line_width(line));
+
+    const int        pad = int(px);
+    capture_result_t cap;
+    cap.w = int(std::ceil(max_w)) + pad * 2;
+    cap.h = line_h * int(lines.size()) + pad * 2;
+    cap.data.resize(size_t(cap.w) * cap.h * 4);
+
+    const rgba_t bg = dark ? 0x1e1e1eff_rgba : 0xffffffff_rgba;
+    const rgba_t fg = dark ? 0xdcdcdcff_rgba : 0x202020ff_rgba;
+    for (size_t i = 0; i < cap.data.size(); i += 4)
+        store_rgba(&cap.data[i], bg);
+
+    std::vector<uint8_t> glyph;
+    for (size_t l = 0; l < lines.size(); ++l)
+    {
+        const std::u32string& line = lines[l];
+        const int             y0   = pad + int(l) * line_h + baseline;
+        float                 x    = float(pad);
+        for (size_t i = 0; i < line.size(); ++i)
+        {
+            const int   cp      = int(line[i]);
+            const float x_shift = x - std::floor(x);
+
+            int gx0 = 0, gy0 = 0, gx1 = 0, gy1 = 0;
+            stbtt_GetCodepointBitmapBoxSubpixel(info, cp, scale, scale, x_shift, 0, &gx0, &gy0, &gx1, &gy1);
+            const int gw = gx1 - gx0, gh = gy1 - gy0;
+            if (gw > 0 && gh > 0)
+            {
+                glyph.assign(size_t(gw) * gh, 0);
+                stbtt_MakeCodepointBitmapSubpixel(info, glyph.data(), gw, gh, gw, scale, scale, x_shift, 0, cp);
+
+                for (int gy = 0; gy < gh; ++gy)
+                {
+                    const int py = y0 + gy0 + gy;
+                    if (py < 0 || py >= cap.h)
+                        continue;
+                    for (int gx = 0; gx < gw; ++gx)
+                    {
+                        const int px_x = int(x) + gx0 + gx;
+                        if (px_x < 0 || px_x >= cap.w)
+                            continue;
+
+                        const int a = glyph[size_t(gy) * gw + gx];
+                        uint8_t*  p = &cap.data[(size_t(py) * cap.w + px_x) * 4];
+                        p[0]        = uint8_t((fg.r * a + p[0] * (255 - a)) / 255);
+                        p[1]        = uint8_t((fg.g * a + p[1] * (255 - a)) / 255);
+                        p[2]        = uint8_t((fg.b * a + p[2] * (255 - a)) / 255);
+                    }
+                }
+            }
+
+            int advance = 0, lsb = 0;
+            stbtt_GetCodepointHMetrics(info, cp, &advance, &lsb);
+            x += advance * scale;
+            if (i + 1 < line.size())
+                x += stbtt_GetCodepointKernAdvance(info, cp, int(line[i + 1])) * scale;
+        }
+    }
+
+    return cap;
+}
+
+static double median(std::vector<double> v)
+{
+    if (v.empty())
+        return 0;
+    std::sort(v.begin(), v.end());
+    const size_t n = v.size();
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+// Compare against a previous run, matching cases by name.
+// Returns false on a regression past the thresholds.
+static bool compare_baseline(const json_value_t& now, const json_value_t& base, const bench_options_t& opts)
+{
+    const json_value_t* base_cases = base.find("cases");
+    const json_value_t* now_cases  = now.find("cases");
+    if (!base_cases || !now_cases)
+        return true;
+
+    auto total_ms = [](const json_value_t& c) {
+        const json_value_t* ms = c.find("ms");
+        return ms ? ms->get_num("total") : std::nullopt;
+    };
+
+    bool ok = true;
+    fmt::print(stderr, "{:<24} {:>12} {:>12} {:>9} {:>8} {:>8}\n", "case", "base ms", "now ms", "delta", "base cer", "now cer");
+    for (const json_value_t& c : now_cases->array)
+    {
+        const std::string_view name = c.get_str("name");
+        const auto             it   = std::find_if(base_cases->array.begin(),
+                                     base_cases->array.end(),
+                                     [&](const json_value_t& b) { return b.get_str("name") == name; });
+        if (it == base_cases->array.end())
+            continue;
+
+        const auto& now_ms  = total_ms(c);
+        const auto& old_ms  = total_ms(*it);
+        const auto& now_cer = c.get_num("cer");
+        const auto& old_cer = it->get_num("cer");
+        if (!now_ms || !old_ms || !now_cer || !old_cer)
+            continue;
+
+        const double delta     = *old_ms > 0 ? (*now_ms / *old_ms - 1.0) * 100.0 : 0.0;
+        const bool   slower    = delta > opts.max_slowdown;
+        const bool   worse_cer = *now_cer - *old_cer > opts.max_cer_increase;
+        ok                     = ok && !slower && !worse_cer;
+
+        fmt::print(stderr,
+                   "{:<24} {:>12.2f} {:>12.2f} {:>+8.1f}% {:>8.4f} {:>8.4f}{}\n",
+                   name,
+                   *old_ms,
+                   *now_ms,
+                   delta,
+                   *old_cer,
+                   *now_cer,
+                   slower || worse_cer ? "  REGRESSION" : "");
+    }
+    return ok;
+}
+
+static void usage()
+{
+    fmt::print(R"(Usage: oshot_ocr_bench [OPTIONS]...
+Render a synthetic screen-text corpus, OCR it and report latency, memory and character error rate as JSON.
+
+OPTIONS:
+    --model <MODEL>             Tesseract model for the non-CJK cases (default: config's ocr-model)
+    --tessdata <PATH>           Path to the '.traineddata' models (default: config's ocr-path)
+    --config <PATH>             oshot config file to take the defaults from
+    --iterations <N>            Timed runs per case, after one cold run (default: 5)
+    --filter <TEXT>             Only run the cases whose name contains TEXT
+    --script-routing <on|off>   Override the config's ocr-script-routing (only changes the combined-model cases)
+    --font-sans <FONT>          Font file or name for the sans cases (same for --font-mono, --font-cjk)
+    --out <PATH>                Write the JSON there instead of stdout
+    --baseline <PATH>           Compare against a previous --out, exit 1 on a regression
+    --max-slowdown <PCT>        Allowed total time increase per case (default: 10)
+    --max-cer-increase <N>      Allowed CER increase per case (default: 0.01)
+    --list                      Print the corpus case names and exit
+)");
+}
+
+static bool parse_args(int argc, char* argv[], bench_options_t& opts)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view arg = argv[i];
+        if (arg == "-h" || arg == "--help")
+        {
+            usage();
+            std::exit(EXIT_SUCCESS);
+        }
+        if (arg == "--list")
+        {
+            for (const bench_case_t& c : corpus)
+                fmt::println("{}", c.name);
+            std::exit(EXIT_SUCCESS);
+        }
+
+        if (i + 1 >= argc)
+        {
+            fmt::println(stderr, "Unknown option or missing value: '{}'", arg);
+            return false;
+        }
+
+        const char* value = argv[++i];
+        // clang-format off
+        if      (arg == "--model")            opts.model            = value;
+        else if (arg == "--tessdata")         opts.tessdata         = value;
+        else if (arg == "--config")           opts.config           = value;
+        else if (arg == "--out")              opts.out              = value;
+        else if (arg == "--baseline")         opts.baseline         = value;
+        else if (arg == "--filter")           opts.filter           = value;
+        else if (arg == "--script-routing")   opts.script_routing   = value;
+        else if (arg == "--font-sans")        opts.fonts[0]         = value;
+        else if (arg == "--font-mono")        opts.fonts[1]         = value;
+        else if (arg == "--font-cjk")         opts.fonts[2]         = value;
+        else if (arg == "--iterations")       opts.iterations       = std::max(1, std::atoi(value));
+        else if (arg == "--max-slowdown")     opts.max_slowdown     = std::atof(value);
+        else if (arg == "--max-cer-increase") opts.max_cer_increase = std::atof(value);
+        else
+        {
+            fmt::println(stderr, "Unknown option '{}'", arg);
+            return false;
+        }
+        // clang-format on
+    }
+
+    if (!opts.script_routing.empty() && opts.script_routing != "on" && opts.script_routing != "off")
+    {
+        fmt::println(stderr, "--script-routing: expected \"on\" or \"off\", got '{}'", opts.script_routing);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    bench_options_t opts;
+    if (!parse_args(argc, argv, opts))
+    {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    // Progress goes to stderr, stdout may be the JSON
+    spdlog::set_default_logger(spdlog::stderr_color_mt("oshot_ocr_bench"));
+    spdlog::set_level(spdlog::level::warn);
+
+    const fs::path& config_dir  = get_config_dir();
+    const fs::path& config_file = opts.config.empty() ? config_dir / "config.toml" : fs::path(opts.config);
+    g_config                    = std::make_unique<Config>(config_file, config_dir);
+    g_config->LoadConfigFile(config_file.string());
+    if (opts.model.empty())
+        opts.model = g_config->File.ocr_model;
+    if (opts.tessdata.empty())
+        opts.tessdata = g_config->File.ocr_path;
+    if (!opts.script_routing.empty())
+        g_config->File.ocr_script_routing = opts.script_routing == "on";
+
+    // The DPI heuristic depends on the screen size, keep it the same on every machine
+    g_scr_w = 1920;
+    g_scr_h = 1080;
+
+    std::optional<Result<font_t>> fonts[3];
+    auto get_font = [&](FontRole role) -> const Result<font_t>& {
+        const size_t i = idx(role);
+        if (!fonts[i])
+            fonts[i] = opts.fonts[i].empty() ? load_font(default_fonts[i]) : load_font({ opts.fonts[i] });
+        return *fonts[i];
+    };
+
+    std::unordered_map<std::string, std::unique_ptr<OcrAPI>> engines;
+    auto get_engine = [&](const std::string& model) -> Result<OcrAPI*> {
+        auto it = engines.find(model);
+        if (it == engines.end())
+        {
+            auto api = std::make_unique<OcrAPI>();
+            TRY(api->Configure(opts.tessdata.c_str(), model.c_str()));
+            it = engines.emplace(model, std::move(api)).first;
+        }
+        return Ok(it->second.get());
+    };
+
+    std::string cases_json;
+    double      cer_sum = 0, total_ms = 0;
+    size_t      ran = 0, skipped = 0, total_px = 0, total_images = 0;
+
+    for (const bench_case_t& c : corpus)
+    {
+        if (!opts.filter.empty() && c.name.find(opts.filter) == std::string_view::npos)
+            continue;
+
+        const std::string model = c.model.empty() ? opts.model : std::string(c.model);
+        if (!cases_json.empty())
+            cases_json += ",\n";
+
+        auto skip = [&](const std::string& why) {
+            spdlog::warn("{}: skipped, {}", c.name, why);
+            cases_json += fmt::format("    {{\"name\":\"{}\",\"skipped\":\"{}\"}}", c.name, json_escape(why));
+            ++skipped;
+        };
+
+        const Result<font_t>& font = get_font(c.font);
+        if (!font.ok())
+        {
+            skip(font.error_v());
+            continue;
+        }
+
+        const Result<OcrAPI*>& engine = get_engine(model);
+        if (!engine.ok())
+        {
+            skip(fmt::format("model '{}': {}", model, engine.error_v()));
+            continue;
+        }
+
+        const capture_result_t& cap = render_text(font.get(), c.px, c.dark, c.text);
+
+        // One cold run (first use of the engine/model), then the timed ones
+        double                      cold_ms = 0;
+        std::vector<double>         convert, preprocess, layout, recognize, total;
+        std::optional<ocr_result_t> last;
+        std::string                 error;
+        for (int i = 0; i <= opts.iterations; ++i)
+        {
+            // Every run stands for a new screenshot, so none of them reuses the last script detection
+            engine.get()->ClearScriptCache();
+
+            const auto                  start = std::chrono::steady_clock::now();
+            const Result<ocr_result_t>& res   = engine.get()->ExtractTextCapture(cap);
+            const double                ms    = ms_t(std::chrono::steady_clock::now() - start).count();
+
+            // "No text recognized" still counts, as a 100% CER
+            if (!res.ok())
+                error = res.error_v();
+            else
+                last = res.get();
+
+            if (i == 0)
+            {
+                cold_ms = ms;
+                continue;
+            }
+
+            const ocr_timings_t& t = res.ok() ? res.get().timings : ocr_timings_t{};
+            convert.push_back(t.convert_ms);
+            preprocess.push_back(t.preprocess_ms);
+            layout.push_back(t.layout_ms);
+            recognize.push_back(t.recognize_ms);
+            total.push_back(ms);
+        }
+
+        const bool   drop_spaces = c.font == FontRole::Cjk;
+        const double cer =
+            char_error_rate(normalize(c.text, drop_spaces), normalize(last ? last->data : "", drop_spaces));
+        const double total_med = median(total);
+
+        cer_sum += cer;
+        total_ms += std::accumulate(total.begin(), total.end(), 0.0);
+        total_px += size_t(cap.w) * cap.h * total.size();
+        total_images += total.size();
+        ++ran;
+
+        spdlog::warn("{}: {:.1f} ms, CER {:.4f}", c.name, total_med, cer);
+        cases_json += fmt::format(
+            "    {{\"name\":\"{}\",\"font\":\"{}\",\"px\":{},\"theme\":\"{}\",\"model\":\"{}\",\"w\":{},\"h\":{},"
+            "\"chars\":{},\"cer\":{:.4f},\"confidence\":{},\"text\":\"{}\",{}\"cold_ms\":{:.3f},"
+            "\"ms\":{{\"convert\":{:.3f},\"preprocess\":{:.3f},\"layout\":{:.3f},\"recognize\":{:.3f},\"total\":{:.3f}}},"
+            "\"peak_rss_kib\":{}}}",
+            c.name,
+            json_escape(fs::path(font.get().path).filename().string()),
+            c.px,
+            c.dark ? "dark" : "light",
+            json_escape(model),
+            cap.w,
+            cap.h,
+            normalize(c.text, drop_spaces).size(),
+            cer,
+            last ? last->confidence : -1,
+            json_escape(last ? last->data : ""),
+            last ? "" : fmt::format("\"error\":\"{}\",", json_escape(error)),
+            cold_ms,
+            median(convert),
+            median(preprocess),
+            median(layout),
+            median(recognize),
+            total_med,
+            peak_rss_kib());
+    }
+
+    const double      seconds = total_ms / 1000.0;
+    const std::string json    = fmt::format(
+        "{{\n  \"model\":\"{}\",\n  \"script_routing\":{},\n  \"iterations\":{},\n  \"screen_dpi\":{},\n"
+        "  \"cases\":[\n{}\n  ],\n"
+        "  \"summary\":{{\"cases\":{},\"skipped\":{},\"mean_cer\":{:.4f},\"total_ms\":{:.3f},"
+        "\"images_per_s\":{:.2f},\"mpix_per_s\":{:.3f},\"peak_rss_kib\":{}}}\n}}\n",
+        json_escape(opts.model),
+        g_config->File.ocr_script_routing,
+        opts.iterations,
+        get_screen_dpi(),
+        cases_json,
+        ran,
+        skipped,
+        ran ? cer_sum / ran : 0.0,
+        total_ms,
+        seconds > 0 ? total_images / seconds : 0.0,
+        seconds > 0 ? total_px / seconds / 1e6 : 0.0,
+        peak_rss_kib());
+
+    if (opts.out.empty())
+    {
+        fmt::print("{}", json);
+    }
+    else
+    {
+        std::ofstream out(opts.out, std::ios::binary);
+        if (!out.write(json.data(), std::streamsize(json.size())))
+            die("Failed to write '{}'", opts.out);
+    }
+
+    if (opts.baseline.empty())
+        return EXIT_SUCCESS;
+
+    std::ifstream base_file(opts.baseline, std::ios::binary);
+    if (!base_file)
+        die("Failed to open baseline '{}'", opts.baseline);
+    const std::string base_str((std::istreambuf_iterator<char>(base_file)), std::istreambuf_iterator<char>());
+
+    const Result<json_value_t>& base = json_parse(base_str);
+    if (!base.ok())
+        die("Baseline '{}': {}", opts.baseline, base.error_v());
+    const Result<json_value_t>& now = json_parse(json);
+    if (!now.ok())
+        die("BUG: our own output doesn't parse: {}", now.error_v());
+
+    return compare_baseline(now.get(), base.get(), opts) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
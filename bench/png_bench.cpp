@@ -0,0 +1,253 @@
+/*
+ * Copyright 2026 Toni500
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ * disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ * following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ * products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+// oshot_png_bench: encodes real screenshots with every PNG encoder/level, QOI and lossless WebP,
+// and reports encode time, output size and throughput as JSON.
+//
+//   oshot_png_bench shots/*.png
+//   oshot_png_bench --capture --iterations 10 --out png.json
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "fmt/format.h"
+#include "image_encoder.hpp"
+#include "json.hpp"
+#include "screen_capture.hpp"
+#include "spdlog/sinks/stdout_color_sinks.h"
+#include "util.hpp"
+
+using ms_t = std::chrono::duration<double, std::milli>;
+
+struct bench_options_t
+{
+    std::vector<std::string> images;
+    std::string              out;
+    int                      iterations = 5;
+    unsigned                 jobs       = 0;
+    bool                     capture    = false;
+};
+
+static double median(std::vector<double> v)
+{
+    if (v.empty())
+        return 0;
+    std::sort(v.begin(), v.end());
+    const size_t n = v.size();
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+// Decode `img` back and compare it to the source pixels
+static bool roundtrips(const std::vector<uint8_t>& img, const capture_result_t& cap)
+{
+    const Result<capture_result_t>& decoded = load_image_rgba_from_memory(img);
+    return decoded.ok() && decoded.get().w == cap.w && decoded.get().h == cap.h && decoded.get().data == cap.data;
+}
+
+static void usage()
+{
+    fmt::print(R"(Usage: oshot_png_bench [OPTIONS]... [IMAGE]...
+Encode each IMAGE (ideally real screenshots) with every PNG encoder and compression level,
+QOI and lossless WebP, and report median encode time, output size and throughput as JSON.
+
+OPTIONS:
+    --capture                   Also benchmark a capture of the current screen
+    --iterations <N>            Timed runs per encoder/level, after one warm-up run (default: 5)
+    --jobs <N>                  Threads for the fast encoder, 1 for serial (default: one per CPU core)
+    --out <PATH>                Write the JSON there instead of stdout
+)");
+}
+
+static bool parse_args(int argc, char* argv[], bench_options_t& opts)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view arg = argv[i];
+        if (arg == "-h" || arg == "--help")
+        {
+            usage();
+            std::exit(EXIT_SUCCESS);
+        }
+        if (arg == "--capture")
+        {
+            opts.capture = true;
+            continue;
+        }
+        if (!arg.starts_with("--"))
+        {
+            opts.images.emplace_back(arg);
+            continue;
+        }
+
+        if (i + 1 >= argc)
+        {
+            fmt::println(stderr, "Unknown option or missing value: '{}'", arg);
+            return false;
+        }
+
+        const char* value = argv[++i];
+        // clang-format off
+        if      (arg == "--out")        opts.out        = value;
+        else if (arg == "--iterations") opts.iterations = std::max(1, std::atoi(value));
+        else if (arg == "--jobs")       opts.jobs       = unsigned(std::max(0, std::atoi(value)));
+        else
+        {
+            fmt::println(stderr, "Unknown option '{}'", arg);
+            return false;
+        }
+        // clang-format on
+    }
+    return !opts.images.empty() || opts.capture;
+}
+
+int main(int argc, char* argv[])
+{
+    bench_options_t opts;
+    if (!parse_args(argc, argv, opts))
+    {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    // Progress goes to stderr, stdout may be the JSON
+    spdlog::set_default_logger(spdlog::stderr_color_mt("oshot_png_bench"));
+    spdlog::set_level(spdlog::level::warn);
+
+    struct input_t
+    {
+        std::string      name;
+        capture_result_t cap;
+    };
+    std::vector<input_t> inputs;
+    for (const std::string& path : opts.images)
+    {
+        Result<capture_result_t> img = load_image_rgba(path);
+        if (!img.ok())
+        {
+            spdlog::error("{}: {}", path, img.error_v());
+            return EXIT_FAILURE;
+        }
+        inputs.push_back({ path, std::move(img.get()) });
+    }
+    if (opts.capture)
+    {
+        Result<capture_result_t> img = capture_full_screen();
+        if (!img.ok())
+        {
+            spdlog::error("--capture: {}", img.error_v());
+            return EXIT_FAILURE;
+        }
+        inputs.push_back({ "<screen>", std::move(img.get()) });
+    }
+
+    // stb first, as the reference, then every level of ours, then the other lossless formats
+    struct encoder_t
+    {
+        std::string      name;
+        ImageExt         ext;
+        encode_options_t opts;
+    };
+    std::vector<encoder_t> encoders;
+    encoders.push_back({ "stb", ImageExt::PNG, { .png_backend = PngBackend::Stb } });
+    for (int level = PNG_LEVEL_MIN; level <= PNG_LEVEL_MAX; ++level)
+        encoders.push_back({ fmt::format("fast-{}", level),
+                             ImageExt::PNG,
+                             { .png_backend = PngBackend::Fast, .png_level = level, .png_jobs = opts.jobs } });
+    encoders.push_back({ "qoi", ImageExt::QOI, {} });
+    encoders.push_back({ "webp", ImageExt::WEBP, {} });
+
+    std::string results_json;
+    bool        all_roundtrip = true;
+    for (const input_t& in : inputs)
+    {
+        const double raw_mb = double(in.cap.data.size()) / (1024.0 * 1024.0);
+        for (const encoder_t& enc : encoders)
+        {
+            const bool fast = enc.ext == ImageExt::PNG && enc.opts.png_backend == PngBackend::Fast;
+
+            std::vector<uint8_t> encoded;
+            std::vector<double>  times;
+            for (int i = 0; i <= opts.iterations; ++i)
+            {
+                const auto start = std::chrono::steady_clock::now();
+                encoded          = encode_image(in.cap, enc.ext, enc.opts);
+                if (i > 0)  // the first run only warms up caches and allocations
+                    times.push_back(ms_t(std::chrono::steady_clock::now() - start).count());
+            }
+
+            const double ms = median(times);
+            const bool   ok = roundtrips(encoded, in.cap);
+            all_roundtrip &= ok;
+
+            spdlog::warn("{} {:<7} {:9.1f} ms {:10} bytes ({:5.1f}%){}",
+                         in.name,
+                         enc.name,
+                         ms,
+                         encoded.size(),
+                         100.0 * double(encoded.size()) / double(in.cap.data.size()),
+                         ok ? "" : " ROUNDTRIP FAILED");
+
+            if (!results_json.empty())
+                results_json += ",\n";
+            results_json += fmt::format(
+                "    {{\"image\":\"{}\",\"w\":{},\"h\":{},\"format\":\"{}\",\"encoder\":\"{}\",\"level\":{},"
+                "\"ms\":{:.3f},\"bytes\":{},\"ratio\":{:.4f},\"mb_per_s\":{:.1f},\"roundtrip\":{}}}",
+                json_escape(in.name),
+                in.cap.w,
+                in.cap.h,
+                str_tolower(IMAGE_EXTS_STR[idx(enc.ext)].second),
+                fast ? "fast" : enc.name,
+                fast ? enc.opts.png_level : 0,
+                ms,
+                encoded.size(),
+                double(encoded.size()) / double(in.cap.data.size()),
+                ms > 0 ? raw_mb / (ms / 1000.0) : 0.0,
+                ok);
+        }
+    }
+
+    const std::string json = fmt::format("{{\n  \"iterations\":{},\n  \"jobs\":{},\n  \"results\":[\n{}\n  ]\n}}\n",
+                                         opts.iterations,
+                                         opts.jobs,
+                                         results_json);
+    if (opts.out.empty())
+    {
+        fmt::print("{}", json);
+    }
+    else
+    {
+        std::ofstream out(opts.out, std::ios::binary);
+        if (!out.write(json.data(), std::streamsize(json.size())))
+            die("Failed to write '{}'", opts.out);
+    }
+
+    return all_roundtrip ? EXIT_SUCCESS : EXIT_FAILURE;
+}
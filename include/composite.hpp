@@ -0,0 +1,67 @@
+/*
+ * Copyright 2026 Toni500
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ * disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ * following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ * products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _COMPOSITE_HPP_
+#define _COMPOSITE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "util.hpp"
+
+// Source-over of a solid color onto RGBA pixels, in 8 bit fixed point.
+//
+// Pixels are taken as premultiplied, which for the opaque pixels of a screenshot (and the
+// transparent black around it) is the same as straight alpha. With a = round(color.a * cov / 255),
+// each channel is rounded once, half up:
+//   rgb = round((color.rgb * a + dst.rgb * (255 - a)) / 255)
+//   a   = round((255 * a       + dst.a   * (255 - a)) / 255)
+// Every code path (scalar, SSE2, AVX2, NEON) gives exactly these bytes.
+
+// Blend `color` over `n` pixels, each weighted by its coverage in `cov` (0-255)
+void blend_span(uint8_t* dst, size_t n, rgba_t color, const uint8_t* cov);
+// Same with one coverage for the whole span
+void blend_span(uint8_t* dst, size_t n, rgba_t color, uint8_t cov = 0xFF);
+
+// Plain per-pixel versions of the above, the reference the SIMD ones are checked against
+void blend_span_scalar(uint8_t* dst, size_t n, rgba_t color, const uint8_t* cov);
+void blend_span_scalar(uint8_t* dst, size_t n, rgba_t color, uint8_t cov = 0xFF);
+
+// Premultiplied `src` pixels over `dst` ones: dst = src + round(dst * (255 - src.a) / 255)
+void composite_span(uint8_t* dst, const uint8_t* src, size_t n);
+void composite_span_scalar(uint8_t* dst, const uint8_t* src, size_t n);
+
+// Instruction set blend_span() and composite_span() use on this CPU ("avx2", "sse2", "neon" or "scalar")
+const char* blend_span_isa();
+
+// Every instruction set compiled in and supported by this CPU, best first and "scalar" last
+std::vector<const char*> blend_span_isas();
+// Make blend_span() and composite_span() use one of blend_span_isas(), false if it isn't there.
+// For checks and benchmarks only, don't call it while other threads are blending.
+bool blend_span_set_isa(std::string_view isa);
+
+#endif  // !_COMPOSITE_HPP_
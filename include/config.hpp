@@ -31,6 +31,7 @@
 #include <unordered_map>
 
 #include "fmt/format.h"
+#include "image_encoder.hpp"
 #include "toml_api.hpp"
 #include "util.hpp"
 
@@ -58,9 +59,18 @@ public:
         std::string theme_file_path    = "theme.toml";
         std::string image_out_fmt      = "oshot_{:%F_%H-%M}";
         std::string image_out_size_fmt = "auto";
+        std::string watch_region       = "";  // "WIDTHxHEIGHT+X+Y", empty = whole monitor
+        std::string watch_transcript   = "";  // OCR watch output file, empty = clipboard
         int         delay              = 0;
         int         color_picker       = 0;  // 0 = "Bar - Square"; 1 = "Wheel - Triangle";
         int         cpa_mode           = 2;  // color_picker_alpha_mode
+        int         barcode_density    = 1;
+        int         watch_interval     = 500;
+        int         watch_monitor      = -1;  // XRandR index, -1 = the one under the cursor
+        int         watch_cpu_budget   = 25;  // % of one core
+        int         png_level          = 3;   // PNG_LEVEL_MIN..PNG_LEVEL_MAX
+        int         jpeg_quality       = 90;  // also the highest one image_out_max_kib may pick
+        int         image_out_max_kib  = 0;   // fit saves/copies under this size, 0 = off
         bool        allow_out_edit     = false;
         bool        real_full_screen   = false;
         bool        show_text_tools    = true;
@@ -68,9 +78,16 @@ public:
         bool        render_anns        = true;
         bool        pref_conf_to_env   = false;
         bool        ctrl_c_copy_img    = true;
+        bool        smooth_pencil      = true;
+        bool        ocr_script_routing = false;
+        bool        watch_copy         = true;
+        bool        fit_downscale      = true;  // shrink images that don't fit at the lowest quality
+        bool        save_fsync         = false;  // flush saved images to disk before notifying
 
-        std::pair<std::string, ImageExt> image_out_type = { "png", ImageExt::PNG };
-        std::vector<std::string>         fonts;
+        std::pair<std::string, ImageExt>   image_out_type = { "png", ImageExt::PNG };
+        std::pair<std::string, PngBackend> png_encoder    = { "fast", PngBackend::Fast };
+        std::vector<std::string>           fonts;
+        std::vector<std::string>           barcode_symbologies = { "all" };
 
         bool operator==(const config_file_t&) const = default;
     } File;
@@ -81,11 +98,20 @@ public:
     {
         std::string source_file;
         int         preferred_psm     = 0;
+        int         jobs              = 0;  // 0 = one per CPU core
         bool        enable_handles    = true;
         bool        only_launch_tray  = false;
         bool        only_launch_gui   = false;
+        bool        batch_ocr         = false;
+        bool        json_output       = false;
+        bool        serve             = false;
+        bool        watch             = false;
         SavingOp    instant_copy_save = SavingOp::kNone;
 
+        std::string              serve_socket;         // --serve=SOCKET, empty = stdin/stdout
+        std::string              watch_mode = "qr";    // --watch=MODE, "qr" or "ocr"
+        std::vector<std::string> inputs;               // positional args, e.g. --ocr FILE...
+
         bool operator==(const runtime_settings_t&) const = default;
     } Runtime;
 
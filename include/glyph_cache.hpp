@@ -0,0 +1,90 @@
+/*
+ * Copyright 2026 Toni500
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ * disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ * following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ * products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _GLYPH_CACHE_HPP_
+#define _GLYPH_CACHE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <span>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "util.hpp"
+
+// Coverage of one glyph, rasterized at the size it's drawn at
+struct glyph_mask_t
+{
+    std::vector<uint8_t> cov;  // w * h, 0-255
+    int                  w = 0, h = 0;
+    int                  x = 0, y = 0;  // top-left corner from the pen, on the baseline
+    float                advance = 0;
+};
+
+// A glyph mask put down on an image, its top-left pixel at (x, y)
+struct placed_glyph_t
+{
+    std::shared_ptr<const glyph_mask_t> mask;
+    int                                 x = 0, y = 0;
+};
+
+// Glyph masks for burning text into images, rasterized with stb_truetype straight from the font file,
+// so exporting never depends on (or rebuilds) the ImGui font atlas.
+class GlyphCache
+{
+public:
+    static constexpr int    SUBPIXEL_STEPS = 4;     // horizontal pen positions per pixel, each its own mask
+    static constexpr size_t MAX_GLYPHS     = 4096;  // all dropped past this, sizes come and go as text is edited
+
+    GlyphCache();
+    ~GlyphCache();
+
+    // Id of the font in file `path`, loaded on first use
+    Result<int> LoadFont(const std::string& path);
+    // Same for a font already in memory (e.g. ImGui's built-in one), known by `name`
+    Result<int> LoadFont(const std::string& name, std::span<const uint8_t> data);
+
+    // Distance from the top of a line to its baseline, at `size` pixels
+    float GetAscent(int font, float size) const;
+
+    // Mask of `codepoint` at `size` pixels, the pen `pen_x` into its pixel.
+    // Shared, so it outlives the cache dropping it (and can be read from other threads meanwhile).
+    std::shared_ptr<const glyph_mask_t> GetGlyph(int font, float size, uint32_t codepoint, float pen_x = 0);
+
+    void Clear();
+
+private:
+    struct font_t;
+
+    using glyph_key_t = std::tuple<int, float, uint32_t, int>;  // font, size, codepoint, subpixel
+
+    std::vector<std::unique_ptr<font_t>>                       m_fonts;
+    std::map<glyph_key_t, std::shared_ptr<const glyph_mask_t>> m_glyphs;
+};
+
+#endif  // !_GLYPH_CACHE_HPP_
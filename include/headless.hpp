@@ -0,0 +1,54 @@
+/*
+ * Copyright 2026 Toni500
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ * disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ * following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ * products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _HEADLESS_HPP_
+#define _HEADLESS_HPP_
+
+#include <string>
+#include <vector>
+
+// Expand the --ocr inputs: globs in the last path component
+// (e.g "shots/*.png") are matched against the directory, anything else is kept as-is.
+std::vector<std::string> expand_inputs(const std::vector<std::string>& args);
+
+// oshot --ocr FILE... [--jobs N] [--json]
+// Runs without GLFW or nvdialog, prints results to stdout in input order.
+// Returns the process exit code.
+int run_batch_ocr();
+
+// oshot --serve[=SOCKET] [--jobs N]
+// Keeps the OCR/barcode engines warm and answers newline-delimited JSON requests,
+// on stdin/stdout or, if `socket_path` isn't empty, on a unix socket.
+// Responses may come back out of order, match them by "id".
+// Returns the process exit code.
+int run_server(const std::string& socket_path);
+
+// oshot --watch[=MODE] [--json]
+// Watches default.watch-region and prints each new QR/bar code payload (MODE "qr")
+// or text line (MODE "ocr") until SIGINT/SIGTERM.
+// Returns the process exit code.
+int run_watch(const std::string& mode);
+
+#endif  // !_HEADLESS_HPP_
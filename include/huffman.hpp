@@ -0,0 +1,70 @@
+/*
+ * Copyright 2026 Toni500
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ * disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ * following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ * products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _HUFFMAN_HPP_
+#define _HUFFMAN_HPP_
+
+#include <cstdint>
+#include <vector>
+
+// Shared by the deflate (PNG) and VP8L (WebP) encoders, both pack bits LSB first.
+class BitWriter
+{
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : m_out(out) {}
+
+    // `bits` are written LSB first, n <= 32
+    void Put(uint32_t bits, int n)
+    {
+        m_acc |= uint64_t(bits) << m_count;
+        m_count += n;
+        while (m_count >= 8)
+        {
+            m_out.push_back(uint8_t(m_acc));
+            m_acc >>= 8;
+            m_count -= 8;
+        }
+    }
+
+    void AlignToByte()
+    {
+        if (m_count > 0)
+            Put(0, 8 - m_count);
+    }
+
+private:
+    std::vector<uint8_t>& m_out;
+    uint64_t              m_acc   = 0;
+    int                   m_count = 0;
+};
+
+// Length-limited Huffman code lengths for the `n` symbols of `freq`, at most `max_len` bits.
+// Always gives at least two symbols a code, so the result is a complete code.
+void huffman_lengths(const uint32_t* freq, int n, int max_len, uint8_t* lens);
+
+// Canonical codes for `lens` (at most 15 bits), bit-reversed to be written LSB first
+void huffman_codes(const uint8_t* lens, int n, uint16_t* codes);
+
+#endif  // !_HUFFMAN_HPP_
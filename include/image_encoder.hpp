@@ -0,0 +1,167 @@
+/*
+ * Copyright 2026 Toni500
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ * disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ * following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ * products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _IMAGE_ENCODER_HPP_
+#define _IMAGE_ENCODER_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "screen_capture.hpp"
+#include "util.hpp"
+
+// Which PNG encoder to use (default.png-encoder)
+enum class PngBackend
+{
+    Fast,  // in-house, see encode_png_fast()
+    Stb,   // stb_image_write, kept as fallback
+    COUNT
+};
+
+inline constexpr std::array<std::pair<std::string_view, PngBackend>, idx(PngBackend::COUNT)> PNG_BACKENDS = {
+    { { "fast", PngBackend::Fast }, { "stb", PngBackend::Stb } }
+};
+
+// PNG compression levels of the fast backend, from fastest to smallest
+inline constexpr int PNG_LEVEL_MIN = 1;
+inline constexpr int PNG_LEVEL_MAX = 9;
+
+// Images with less filtered data than this per thread are not split further
+inline constexpr size_t PNG_MIN_BAND_BYTES = 1 << 20;
+
+// JPEG quality range. When fitting under a size with downscaling allowed,
+// the search stops at FIT_JPEG_QUALITY_FLOOR and shrinks the image instead of going lower.
+inline constexpr int JPEG_QUALITY_MIN       = 1;
+inline constexpr int JPEG_QUALITY_MAX       = 100;
+inline constexpr int FIT_JPEG_QUALITY_FLOOR = 40;
+
+struct encode_options_t
+{
+    PngBackend png_backend  = PngBackend::Fast;
+    int        png_level    = 3;  // PNG_LEVEL_MIN..PNG_LEVEL_MAX, ignored by stb
+    int        jpeg_quality = 90;
+    unsigned   png_jobs     = 0;  // threads for the fast backend, 0 = one per CPU core
+};
+
+// Where encoders write their output, piece by piece as it's produced,
+// so a pipe or file receives the first bytes long before encoding is done.
+class ImageSink
+{
+public:
+    virtual ~ImageSink() = default;
+
+    // Write all `size` bytes. On false the encoder stops, errno tells why.
+    virtual bool Write(const uint8_t* data, size_t size) = 0;
+};
+
+class MemorySink final : public ImageSink
+{
+public:
+    explicit MemorySink(std::vector<uint8_t>& out) : m_out(out) {}
+    bool Write(const uint8_t* data, size_t size) override;
+
+private:
+    std::vector<uint8_t>& m_out;
+};
+
+// Doesn't own `fd`
+class FdSink final : public ImageSink
+{
+public:
+    explicit FdSink(int fd) : m_fd(fd) {}
+    bool Write(const uint8_t* data, size_t size) override;
+
+private:
+    int m_fd;
+};
+
+// Doesn't own `fp`
+class FileSink final : public ImageSink
+{
+public:
+    explicit FileSink(FILE* fp) : m_fp(fp) {}
+    bool Write(const uint8_t* data, size_t size) override;
+
+private:
+    FILE* m_fp;
+};
+
+// Encode the RGBA `cap` to `ext`, streaming it into `sink`
+Result<> encode_image(const capture_result_t& cap, ImageExt ext, const encode_options_t& opts, ImageSink& sink);
+
+// Encode the RGBA `cap` to `ext` in memory. Empty on failure.
+std::vector<uint8_t> encode_image(const capture_result_t& cap, ImageExt ext, const encode_options_t& opts);
+
+struct fit_options_t
+{
+    size_t                max_bytes = 0;
+    bool                  downscale = true;  // shrink the image when lowering the quality isn't enough
+    unsigned              jobs      = 0;     // candidates encoded at once, 0 = one per CPU core
+    std::function<bool()> canceled;          // polled between rounds, may be empty
+};
+
+struct fit_result_t
+{
+    std::vector<uint8_t> data;
+    int                  quality = 0;      // JPEG quality picked, 0 for other formats
+    float                scale   = 1;      // of each side
+    bool                 fits    = false;  // false = `data` is the smallest we got, still too big
+};
+
+// Encode `cap` to `ext` in at most `fit.max_bytes`.
+// JPEG gets the highest quality that fits (opts.jpeg_quality at most), searched by encoding
+// `fit.jobs` qualities in parallel per round. The other formats are lossless, so only their
+// resolution can give. Each downscaling step aims straight for the size, from the last one's ratio.
+Result<fit_result_t>
+encode_image_fit(const capture_result_t& cap, ImageExt ext, const encode_options_t& opts, const fit_options_t& fit);
+
+// PNG with our own filtering + deflate, tuned for screenshots (flat areas, repeated rows, no alpha).
+// Fully opaque images are written as RGB.
+// Level 1 is a single hash probe per position and the "up" filter on every row,
+// higher levels search longer match chains, match lazily and pick each row's filter adaptively.
+// Large images are split into row bands encoded on up to `jobs` threads (0 = one per CPU core),
+// the output decodes to the same pixels regardless.
+// Each band becomes its own IDAT chunk, written to `sink` as soon as it and every band above it are done.
+Result<> encode_png_fast(const capture_result_t& cap, int level, unsigned jobs, ImageSink& sink);
+std::vector<uint8_t> encode_png_fast(const capture_result_t& cap, int level, unsigned jobs = 0);
+
+// QOI ("Quite OK Image" format), see qoi.cpp. Several times faster than any PNG encoder,
+// with sizes in between our PNG levels on UI content.
+Result<>                 encode_qoi(const capture_result_t& cap, ImageSink& sink);
+Result<capture_result_t> decode_qoi(std::span<const uint8_t> data);
+
+// Lossless WebP (VP8L), see webp.cpp. Slower than PNG, but noticeably smaller.
+// Lossy WebP files can't be decoded.
+Result<>                 encode_webp_lossless(const capture_result_t& cap, ImageSink& sink);
+Result<capture_result_t> decode_webp(std::span<const uint8_t> data);
+
+#endif  // !_IMAGE_ENCODER_HPP_
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2026 Toni500
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ * disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ * following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ * products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _JSON_HPP_
+#define _JSON_HPP_
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "util.hpp"
+
+// Just enough JSON for oshot's own line protocols (--serve, the OCR benchmark):
+// objects, arrays, strings (with \u escapes), numbers, true/false/null.
+struct json_value_t
+{
+    enum class Type
+    {
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object
+    };
+
+    Type                                              type    = Type::Null;
+    bool                                              boolean = false;
+    double                                            number  = 0;
+    std::string                                       string;
+    std::vector<json_value_t>                         array;
+    std::vector<std::pair<std::string, json_value_t>> object;
+
+    const json_value_t* find(std::string_view key) const
+    {
+        for (const auto& [k, v] : object)
+            if (k == key)
+                return &v;
+        return nullptr;
+    }
+
+    std::string_view get_str(std::string_view key) const
+    {
+        const json_value_t* v = find(key);
+        return (v && v->type == Type::String) ? std::string_view(v->string) : std::string_view();
+    }
+
+    std::optional<double> get_num(std::string_view key) const
+    {
+        const json_value_t* v = find(key);
+        return (v && v->type == Type::Number) ? std::optional<double>(v->number) : std::nullopt;
+    }
+};
+
+// Parse a whole document, trailing garbage is an error.
+Result<json_value_t> json_parse(std::string_view str);
+
+// Escape `s` for use inside a JSON string literal (without the quotes).
+std::string json_escape(std::string_view s);
+
+#endif  // !_JSON_HPP_
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2026 Toni500
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ * disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ * following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ * products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _RASTER_HPP_
+#define _RASTER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "composite.hpp"
+#include "screen_capture.hpp"
+#include "util.hpp"
+
+// Anti-aliased shapes over an RGBA image, coverage computed analytically
+// (exact area of each pixel inside the shape, no supersampling).
+// Coordinates are in pixels, pixel (x, y) covering [x, x+1) x [y, y+1).
+class Rasterizer
+{
+public:
+    explicit Rasterizer(capture_result_t& target)
+        : m_target(target), m_clip{ 0, 0, target.w, target.h }
+    {
+        ResetBounds();
+    }
+
+    // Only pixels in `clip` (and the target) get drawn from now on, set it before adding outlines.
+    // Those that are come out exactly as without it, so a shape can be drawn a piece at a time.
+    void SetClip(const region_t& clip);
+
+    // Pixels drawn into since construction or the last ResetBounds(), empty if none
+    region_t GetBounds() const;
+    void     ResetBounds();
+
+    // Outlines added until the next Fill() are filled as one shape: where they overlap,
+    // pixels are still only painted once, so a translucent stroke doesn't get darker at its joints.
+    // Holes are wound the other way, cutting out of the outlines around them.
+    void AddPolygon(std::span<const point_t> pts, bool hole = false);
+    void AddLine(point_t a, point_t b, float width);  // square ends, flush with a and b
+    void AddDisc(point_t center, float radius);
+    void Fill(rgba_t color);
+
+    // Row by row fills, no outline to build
+    void FillRect(float x0, float y0, float x1, float y1, rgba_t color);
+    void FillRing(point_t center, float outer, float inner, rgba_t color);  // inner 0 = disc
+
+    // Blend one row of precomputed coverage (e.g. a glyph's) starting at (x, y), clipped
+    void BlendRow(int x, int y, const uint8_t* cov, int n, rgba_t color);
+
+private:
+    struct edge_t
+    {
+        float x0, y0, x1, y1;  // y0 < y1
+        float dir;             // +1 going down in the outline, -1 up
+    };
+
+    void AddEdge(float x0, float y0, float x1, float y1);
+    void AccumulateEdge(const edge_t& e, int band_y0, int band_y1, int width);
+    void BlendSpan(int x, int y, size_t n, rgba_t color, const uint8_t* cov);
+    void BlendSpan(int x, int y, size_t n, rgba_t color, uint8_t cov);
+
+    capture_result_t&    m_target;
+    std::vector<edge_t>  m_edges;
+    std::vector<float>   m_acc;
+    std::vector<uint8_t> m_cov;
+    region_t             m_clip;
+    int                  m_drawn_x0 = 0, m_drawn_y0 = 0, m_drawn_x1 = 0, m_drawn_y1 = 0;
+    float                m_min_x = 0, m_min_y = 0, m_max_x = 0, m_max_y = 0;
+    bool                 m_has_outline = false;
+};
+
+#endif  // !_RASTER_HPP_
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2026 Toni500
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ * disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ * following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ * products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _SAVE_QUEUE_HPP_
+#define _SAVE_QUEUE_HPP_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "screen_capture.hpp"
+#include "util.hpp"
+
+struct save_job_t
+{
+    SavingOp         op;
+    std::string      path;  // SavingOp::File only
+    capture_result_t img;
+    ImageExt         ext;
+};
+
+// Encodes and writes saves and copies on its own thread, in the order they came in,
+// so the overlay can close as soon as the user picked what to do with the capture.
+// Each job ends with a notification saying how it went.
+class SaveQueue
+{
+public:
+    ~SaveQueue() { Stop(); }
+
+    void Push(save_job_t job);
+
+    // Block until everything pushed so far is written
+    void Wait();
+
+    // Finish the queued jobs and stop the thread
+    void Stop();
+
+private:
+    void Loop();
+
+    std::thread             m_thread;
+    std::mutex              m_mtx;
+    std::condition_variable m_cv;       // new job or stop, for the writer
+    std::condition_variable m_idle_cv;  // queue drained, for Wait()
+    std::deque<save_job_t>  m_jobs;
+    bool                    m_busy = false;
+    bool                    m_stop = false;
+};
+
+// Encode `img` next to `path` and rename it over, so nothing ever sees a half-written image.
+// With `sync`, the data (and the rename, where possible) is flushed to disk before returning.
+Result<> write_image_atomic(const std::string& path, const capture_result_t& img, ImageExt ext, bool sync);
+
+extern SaveQueue g_save_queue;
+
+#endif  // !_SAVE_QUEUE_HPP_
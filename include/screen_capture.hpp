@@ -27,11 +27,18 @@
 #define _SCREEN_CAPTURE_HPP_
 
 #include <cstdint>
+#include <memory>
 #include <span>
 #include <vector>
 
 #include "util.hpp"
 
+struct point_t
+{
+    float x{};
+    float y{};
+};
+
 struct region_t
 {
     int x{};
@@ -66,6 +73,40 @@ Result<capture_result_t> capture_full_screen_spectacle();
 Result<capture_result_t> capture_full_screen_windows();
 Result<capture_result_t> capture_full_screen_macos();
 
+// Capture with the backend matching get_session_type()
+Result<capture_result_t> capture_full_screen();
+
 SessionType get_session_type();
 
+// Grabs the same area of one monitor over and over, for watching the screen.
+// The display connection stays open, so a frame only costs reading back those pixels.
+// X11 only: the other backends go through a portal or a screenshot tool for every capture.
+class ScreenGrabber
+{
+public:
+    ScreenGrabber();
+    ~ScreenGrabber();
+
+    ScreenGrabber(const ScreenGrabber&)            = delete;
+    ScreenGrabber& operator=(const ScreenGrabber&) = delete;
+
+    // `monitor` is an index into the XRandR monitor list, -1 = the one under the pointer right now.
+    // `region` is relative to that monitor and has to fit inside it, 0 width/height = all of it.
+    Result<> Open(int monitor, const region_t& region);
+    void     Close();
+    bool     IsOpen() const { return m_x11 != nullptr; }
+
+    Result<capture_result_t> Grab();
+
+    // Picked by Open(), in root window coordinates
+    const region_t& GetMonitor() const { return m_monitor; }
+
+private:
+    struct x11_t;
+
+    std::unique_ptr<x11_t> m_x11;
+    region_t               m_monitor;
+    region_t               m_rect;  // what Grab() reads, in root window coordinates
+};
+
 #endif  // !_SCREEN_CAPTURE_HPP_
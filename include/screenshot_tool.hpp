@@ -37,10 +37,13 @@
 #include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <span>
 #include <thread>
 #include <unordered_map>
 #include <utility>
 
+#include "glyph_cache.hpp"
 #include "imgui/imgui.h"
 #include "imgui/imgui_internal.h"
 #include "screen_capture.hpp"
@@ -63,6 +66,8 @@ enum class ToolType : size_t
     Line,
     Text,
     Pencil,
+    Blur,
+    Pixelate,
     ToggleTextTools,
     CopyImage,
     SaveImage,
@@ -169,12 +174,6 @@ enum class GeneralError : size_t
     COUNT,
 };
 
-struct point_t
-{
-    float x{};
-    float y{};
-};
-
 struct selection_rect_t
 {
     point_t start;
@@ -213,6 +212,12 @@ struct inputs_results_t
 
     std::string ann_font;
     std::string resolved_ann_font_path;
+
+    // Barcode panel "Scan settings", synced from the config in SyncRuntimeFromConfig()
+    std::array<bool, ZBAR_SYMBOLOGIES.size()> barcode_symbologies{};
+    int                                       barcode_density    = 1;
+    bool                                      barcode_tiled      = false;
+    bool                                      barcode_first_only = false;
 };
 
 #ifndef DISABLE_PLUGINS
@@ -302,17 +307,97 @@ struct ErrorContext : public GeneralContext<Enum>
     const std::string& Get(Enum e) const { return texts[idx(e)]; }
 };
 
+// Estimates the encoded size of the selection on one long-lived worker thread.
+// Only the newest request matters: a pending one is replaced by the next,
+// and an encode that got superseded gives up at its next write.
+class SizeEstimator
+{
+public:
+    // Selections up to this many pixels are encoded whole,
+    // bigger ones from SAMPLE_BANDS strips of rows adding up to about as many.
+    static constexpr size_t EXACT_MAX_PIXELS = 512 * 1024;
+    static constexpr int    SAMPLE_BANDS     = 8;
+
+    ~SizeEstimator() { Stop(); }
+
+    // `sample` is either the whole image (scale 1) or some of its rows,
+    // whose encoded size then gets multiplied by `scale`.
+    // With `max_bytes`, the estimate is of the image fitted under it (see encode_image_fit()).
+    void Request(capture_result_t sample, ImageExt ext, double scale, size_t max_bytes = 0);
+    void Stop();
+
+    // Last finished estimate, and whether it came from encoding the whole image
+    size_t GetBytes() const { return m_bytes.load(std::memory_order_relaxed); }
+    bool   IsExact() const { return m_exact.load(std::memory_order_relaxed); }
+
+    // What fitting picked for it, 0 and 1 without a size limit
+    int   GetFitQuality() const { return m_fit_quality.load(std::memory_order_relaxed); }
+    float GetFitScale() const { return m_fit_scale.load(std::memory_order_relaxed); }
+
+private:
+    struct request_t
+    {
+        capture_result_t sample;
+        ImageExt         ext;
+        double           scale;
+        size_t           max_bytes;
+    };
+
+    void Loop();
+
+    std::thread              m_thread;
+    std::mutex               m_mtx;
+    std::condition_variable  m_cv;
+    std::optional<request_t> m_pending;
+    bool                     m_stop = false;
+
+    std::atomic<uint64_t> m_generation{ 0 };  // bumped by every request, the worker drops older ones
+    std::atomic<size_t>   m_bytes{ 0 };
+    std::atomic<bool>     m_exact{ true };
+    std::atomic<int>      m_fit_quality{ 0 };
+    std::atomic<float>    m_fit_scale{ 1 };
+};
+
+// Threads kept between calls, so work split over a few of them on every frame doesn't pay
+// for starting and joining new ones each time. Meant for one caller at a time.
+class WorkerPool
+{
+public:
+    ~WorkerPool() { Stop(); }
+
+    // Call `fn` on `nthreads` threads at once, the calling one included, and return when they're done.
+    // Calls that haven't started by the time the caller's returns are skipped,
+    // which is fine for workers draining a shared queue: it's empty by then.
+    void Run(size_t nthreads, const std::function<void()>& fn);
+    void Stop();
+
+private:
+    void Loop();
+
+    std::vector<std::thread>     m_threads;
+    std::mutex                   m_mtx;
+    std::condition_variable      m_cv;       // new work or stop, for the workers
+    std::condition_variable      m_done_cv;  // a call finished, for Run()
+    const std::function<void()>* m_fn      = nullptr;
+    size_t                       m_wanted  = 0;  // calls of m_fn not started yet
+    size_t                       m_running = 0;
+    bool                         m_stop    = false;
+};
+
 class ScreenshotTool
 {
 public:
 #ifndef DISABLE_PLUGINS
     ScreenshotTool(StateManager&& state) : m_plugin_manager(std::move(state), m_plugin_cb, /*is_cli=*/false) {}
+#endif
     ~ScreenshotTool()
     {
+        ResetOcr();
+#ifndef DISABLE_PLUGINS
         if (m_install_thread.joinable())
             m_install_thread.join();
-    }
 #endif
+    }
 
     Result<>             Start();
     Result<>             StartWindow();
@@ -333,7 +418,12 @@ public:
     capture_result_t GetFinalImage(bool is_text_tools = false);
     region_t         GetActiveRegion() const;
 
+    // Crop `region` (image space) of the screenshot and composite the annotation layer over it
+    capture_result_t RenderImage(const region_t& region, bool is_text_tools = false);
+
     ImFont* CacheAndGetFont(const std::string& font_name, const float font_size);
+    // Annotation font in m_glyph_cache, falling back to ImGui's default one
+    Result<int> LoadAnnotationFont();
 
     void        RenderOverlay();
     void        Cancel();
@@ -374,6 +464,10 @@ private:
     static constexpr float HANDLE_DRAW_SIZE  = 4.0f;
     static constexpr float HANDLE_HOVER_SIZE = 20.0f;
 
+    // The annotation layer is drawn in strips of rows, spread over threads once there's enough to draw
+    static constexpr int    ANN_LAYER_STRIP_ROWS          = 128;
+    static constexpr size_t ANN_LAYER_PARALLEL_MIN_PIXELS = 1024 * 1024;
+
     struct font_cache_t
     {
         std::string font_path;
@@ -399,8 +493,21 @@ private:
         float              display_progress{ 0.f };  // smoothed, main thread only
     };
 
+    // Shared between the render thread and the OCR thread for a single "Extract Text" run.
+    // Blocks recognized so far are appended to `partial` and drained into
+    // m_inputs.ocr_results.data every frame, until `result` replaces it.
+    struct ocr_job_t
+    {
+        size_t                              frame_id;  // m_ocr_frame_id it was started on
+        std::atomic<bool>                   running{ true };
+        std::mutex                          mutex;
+        std::string                         partial;
+        std::optional<Result<ocr_result_t>> result;
+    };
+
     OcrAPI           m_ocr_api;
     ZbarAPI          m_zbar_api;
+    region_t         m_barcode_region;  // image region the current zbar_scan_result polygons are relative to
     capture_result_t m_screenshot;
 
     ImTextureRef  m_texture_id;
@@ -424,8 +531,16 @@ private:
     ImVec2 m_image_end;
 
     std::shared_ptr<ocr_download_t>                       m_ocr_download;
+    std::shared_ptr<ocr_job_t>                            m_ocr_job;
+    std::thread                                           m_ocr_thread;  // runs m_ocr_job on m_ocr_api
+    std::shared_ptr<const capture_result_t>               m_ocr_frame;   // what OcrAPI keeps preprocessed
+    size_t                                                m_ocr_frame_id    = 0;
+    size_t                                                m_ocr_frame_gen   = 0;  // m_annotations_gen it was rendered at
+    bool                                                  m_ocr_frame_anns  = false;
+    size_t                                                m_annotations_gen = 0;  // bumped on every add/undo
     std::vector<std::string>                              m_ocr_models_list;
     std::map<std::pair<std::string, float>, font_cache_t> m_font_cache;
+    GlyphCache                                            m_glyph_cache;  // what text annotations are exported with
     std::function<void()>                                 m_on_cancel;
     std::function<void(const capture_result_t&)>          m_on_image_reload;
 
@@ -437,6 +552,21 @@ private:
     std::array<ImTextureRef, idx(ToolType::COUNT)> m_tool_textures;
     ToolType                                       m_current_tool = ToolType::kNone;
     std::vector<annotation_t>                      m_annotations;
+    capture_result_t                               m_ann_layer;  // committed annotations, premultiplied, image space
+    std::vector<region_t>                          m_ann_layer_bounds;  // drawn by each of them in m_ann_layer
+    region_t                                       m_ann_layer_extent;  // all of them
+    region_t                                       m_ann_layer_dirty;   // left by undos, redrawn on next sync
+    ImVec2                                         m_ann_layer_origin;  // m_image_origin it was drawn at
+    std::string                                    m_ann_layer_font;
+    capture_result_t                               m_redacted;             // screenshot under committed redactions
+    size_t                                         m_redacted_count = 0;   // m_annotations gone through for it
+    region_t                                       m_redacted_dirty;       // left by undos, redone on next sync
+    region_t                                       m_redacted_stale;       // not uploaded to the texture yet
+    ImVec2                                         m_redacted_origin;      // m_image_origin they were applied at
+    capture_result_t                               m_redact_preview;       // the one being drawn, over its area
+    region_t                                       m_redact_preview_area;  // texture area it was last shown in
+    SizeEstimator                                  m_size_estimator;
+    WorkerPool                                     m_raster_workers;  // for RasterizeIntoLayer()
     annotation_t                                   m_current_annotation;
     rgba_t                                         m_current_color;
     std::unordered_map<std::string, std::string*>  m_imgui_id_texts;
@@ -456,7 +586,20 @@ private:
     std::vector<install_node_t>             m_install_events;
 #endif
 
+    // Cancels and waits for a running "Extract Text", and drops it and the frame it was on
+    void ResetOcr();
     void CreateCopyTextButton(const std::string& text);
+    void AddAnnotation(const annotation_t& ann);
+    void UndoAnnotation();
+    void SyncAnnotationLayer();
+    // Draws m_annotations[which] over m_ann_layer within `clip`, returns where each one drew
+    std::vector<region_t>       RasterizeIntoLayer(std::span<const size_t> which, const region_t& clip);
+    std::vector<placed_glyph_t> PlaceAnnotationText(const annotation_t& ann, ImVec2 offset);
+    // Brings m_redacted up to date with the blurs/pixelations in m_annotations
+    void                    SyncRedactions();
+    const capture_result_t& RedactedScreenshot() const { return m_redacted.data.empty() ? m_screenshot : m_redacted; }
+    // Uploads what changed in RedactedScreenshot() and the redaction being drawn to the screenshot texture
+    void UpdateRedactionTexture();
     void RefreshOcrModels();
     void NormalizeSelection();
     void SyncRuntimeFromConfig();
@@ -471,6 +614,7 @@ private:
     void DrawAnnotations();
     void DrawMenuItems();
     void DrawSelectionBorder();
+    void DrawBarcodeHighlights();
 
     void DrawOcrTools();
     void DrawBarDecodeTools();
@@ -498,6 +642,9 @@ private:
     void UpdateCursor();
     void UpdateWindowBg();
 
+    // Hand the selection (or a sample of its rows if it's big) to m_size_estimator
+    void RequestSizeEstimate();
+
     template <typename Enum>
     bool ShowIfError(const ErrorContext<Enum>& ctx, Enum e)
     {
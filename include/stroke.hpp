@@ -0,0 +1,47 @@
+/*
+ * Copyright 2026 Toni500
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ * disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ * following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ * products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _STROKE_HPP_
+#define _STROKE_HPP_
+
+#include <span>
+#include <vector>
+
+#include "screen_capture.hpp"
+
+// Freehand strokes as the mouse leaves them are a point every couple of pixels.
+// These turn them into far fewer points that draw (nearly) the same line.
+
+// Ramer-Douglas-Peucker: drops every point closer than `tolerance` pixels
+// to the segment between the ones kept around it. Ends are always kept.
+std::vector<point_t> simplify_polyline(std::span<const point_t> pts, float tolerance);
+
+// Centripetal Catmull-Rom spline through `pts` (no loops or cusps even when points are unevenly spaced),
+// flattened back into segments. Meant for what simplify_polyline() keeps with the same `tolerance`:
+// the curve strays at most that far from each segment, the flattening as much again.
+// Straight runs stay single segments, turns sharper than ~75 degrees stay corners.
+std::vector<point_t> smooth_polyline(std::span<const point_t> pts, float tolerance);
+
+#endif  // !_STROKE_HPP_
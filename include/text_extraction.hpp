@@ -30,9 +30,15 @@
 #include <tesseract/baseapi.h>
 #include <zbar.h>
 
+#include <array>
+#include <atomic>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 #include "screen_capture.hpp"
 #include "util.hpp"
@@ -40,12 +46,23 @@
 // ------------------------------
 // OCR (tesseract img2text)
 // ------------------------------
+// Where an OCR run spent its time, in milliseconds (0 = stage didn't run)
+struct ocr_timings_t
+{
+    double convert_ms    = 0;  // RGBA -> Pix
+    double preprocess_ms = 0;  // preprocess_pix() or the attached frame's grayscale/invert
+    double layout_ms     = 0;  // script detection and block split
+    double recognize_ms  = 0;  // Recognize() and collecting text/confidence
+};
+
 struct ocr_result_t
 {
-    std::string data;
-    int         confidence = -1;  // 0..100
-    int         psm;
-    std::string psm_str;
+    std::string   data;
+    std::string   model;            // model(s) that actually recognized the text
+    int           confidence = -1;  // 0..100
+    int           psm;
+    std::string   psm_str;
+    ocr_timings_t timings;
 };
 
 class OcrAPI
@@ -61,17 +78,59 @@ public:
     Result<>             Configure(const char*              data_path,
                                    const char*              model,
                                    tesseract::OcrEngineMode oem = tesseract::OEM_LSTM_ONLY);
-    Result<ocr_result_t> ExtractTextCapture(const capture_result_t& cap);
+
+    // If on_partial is set, it gets the text of each layout block as soon as its recognition pass
+    // is done (called from the OCR thread). It doesn't change how the page is recognized,
+    // so the returned result is the same as without it.
+    Result<ocr_result_t> ExtractTextCapture(const capture_result_t&                       cap,
+                                            const std::function<void(std::string_view)>& on_partial = nullptr);
+
+    // Force a page segmentation mode instead of choosing one from the image size.
+    void SetPsm(std::optional<tesseract::PageSegMode> psm) { m_psm = psm; }
+
+    // Make a running ExtractText*() give up at its next word and return an error. Can be called from any thread,
+    // stays in effect (and fails every later run) until ResetCancel().
+    void Cancel() { m_cancel.store(true); }
+    void ResetCancel() { m_cancel.store(false); }
+
+    // Forget the last script detection, so the next run on the same image pays for it again (benchmarks)
+    void ClearScriptCache() { m_script_cache.reset(); }
+
+    // Same as ExtractTextCapture(), but on `region` of a full frame.
+    // The frame is converted and preprocessed once per `frame_id` and stays attached to the engine,
+    // so re-running on another region only moves the rectangle (TessBaseAPI::SetRectangle()).
+    // Bump `frame_id` whenever the frame pixels change.
+    Result<ocr_result_t> ExtractTextRegion(const capture_result_t&                       frame,
+                                           const region_t&                               region,
+                                           size_t                                        frame_id,
+                                           const std::function<void(std::string_view)>& on_partial = nullptr);
 
 private:
     struct ocr_config_t
     {
-        std::string path;
-        std::string model;
+        std::string              path;
+        std::string              model;
+        tesseract::OcrEngineMode oem;
 
         bool operator==(const ocr_config_t&) const = default;
     };
 
+    // A text block found by the OSD layout pass, in preprocessed Pix coordinates,
+    // and the single-language model its script maps to (empty = combined model).
+    struct script_block_t
+    {
+        int         x, y, w, h;
+        std::string model;
+    };
+
+    // Script detection is the expensive part of routing,
+    // so keep the result around for as long as the screenshot doesn't change.
+    struct script_cache_t
+    {
+        size_t                      key;
+        std::vector<script_block_t> blocks;
+    };
+
     struct PixDeleter
     {
         void operator()(PIX* pix) const
@@ -84,30 +143,123 @@ private:
     using PixPtr  = std::unique_ptr<PIX, PixDeleter>;
     using TextPtr = std::unique_ptr<char, void (*)(char*)>;
 
+    // Preprocessed full frame for ExtractTextRegion().
+    // The inverted copy (for dark backgrounds) is only made once a region needs it.
+    struct frame_cache_t
+    {
+        size_t id;
+        PixPtr gray;
+        PixPtr inverted;
+        size_t gray_serial;
+        size_t inverted_serial;
+    };
+
+    // `serial` identifies the pix contents, so engines that already have it skip SetImage()
+    Result<ocr_result_t>                RecognizePix(PIX*                                          pix,
+                                                     size_t                                        serial,
+                                                     const region_t&                               rect,
+                                                     int                                           dpi,
+                                                     size_t                                        key,
+                                                     const std::function<void(std::string_view)>& on_partial);
+    Result<std::vector<script_block_t>> DetectScripts(PIX* pix, size_t serial, const region_t& rect, size_t key);
+    tesseract::TessBaseAPI*             GetScriptEngine(const std::string& model);
+    void                                Attach(tesseract::TessBaseAPI* api, PIX* pix, size_t serial);
+
     std::unique_ptr<tesseract::TessBaseAPI> m_api;
     std::optional<ocr_config_t>             m_config;
+    std::optional<tesseract::PageSegMode>   m_psm;
     bool                                    m_initialized = false;
+    std::atomic<bool>                       m_cancel{ false };
+
+    // Script routing (default.ocr-script-routing)
+    std::unique_ptr<tesseract::TessBaseAPI>                                  m_osd_api;
+    std::unordered_map<std::string, std::unique_ptr<tesseract::TessBaseAPI>> m_script_apis;
+    std::optional<script_cache_t>                                            m_script_cache;
+    bool                                                                     m_osd_unavailable = false;
+    bool                                                                     m_can_route       = false;
+
+    // Which pix (by serial) each engine currently has set
+    std::unordered_map<tesseract::TessBaseAPI*, size_t> m_attached;
+    std::optional<frame_cache_t>                        m_frame;
+    size_t                                              m_next_serial = 1;
 };
 
 // ------------------------------
 // Zbar (QR/Bar Codes)
 // ------------------------------
+struct zbar_symbol_t
+{
+    std::string          data;
+    std::string          type;     // e.g. "QR-Code", "EAN-13"
+    std::vector<point_t> polygon;  // outline in the scanned image's pixels
+};
+
 struct zbar_result_t
 {
     std::vector<std::string>             datas;        // decoded payload
     std::unordered_map<std::string, int> symbologies;  // e.g. "QRCODE", "EAN-13", ...
+    std::vector<zbar_symbol_t>           symbols;      // same order as datas
+    double                               convert_ms = 0;  // RGBA -> grayscale
+    double                               scan_ms    = 0;
 };
 
+// ZbarAPI::SearchCapture() settings
+struct zbar_search_options_t
+{
+    // Scales to scan at, cheapest first. Downscaled passes catch codes split across tiles,
+    // upscaled ones catch codes too small for ZBar at the screen's resolution.
+    std::vector<float> scales     = { 0.5f, 1.0f, 2.0f };
+    int                tile_size  = 1024;   // tile side in scaled pixels, neighbours overlap by a quarter
+    unsigned           jobs       = 0;      // 0 = one per CPU core
+    bool               first_only = false;  // stop as soon as any tile decodes something
+};
+
+// Config names of the symbologies that can be turned on/off (default.barcode-symbologies)
+// clang-format off
+inline constexpr std::array<std::pair<std::string_view, zbar::zbar_symbol_type_e>, 15> ZBAR_SYMBOLOGIES = { {
+    { "qrcode",  zbar::ZBAR_QRCODE },  { "ean13",   zbar::ZBAR_EAN13 },   { "ean8",        zbar::ZBAR_EAN8 },
+    { "upca",    zbar::ZBAR_UPCA },    { "upce",    zbar::ZBAR_UPCE },    { "isbn10",      zbar::ZBAR_ISBN10 },
+    { "isbn13",  zbar::ZBAR_ISBN13 },  { "i25",     zbar::ZBAR_I25 },     { "code39",      zbar::ZBAR_CODE39 },
+    { "code93",  zbar::ZBAR_CODE93 },  { "code128", zbar::ZBAR_CODE128 }, { "codabar",     zbar::ZBAR_CODABAR },
+    { "pdf417",  zbar::ZBAR_PDF417 },  { "databar", zbar::ZBAR_DATABAR }, { "databar-exp", zbar::ZBAR_DATABAR_EXP },
+} };
+// clang-format on
+
 class ZbarAPI
 {
 public:
     ZbarAPI();
 
+    // The grayscale buffer and zbar::Image are kept between calls,
+    // so scanning same-sized (or smaller) images doesn't allocate for them again.
     Result<zbar_result_t> ExtractTextsCapture(const capture_result_t& cap);
     bool                  SetConfig(zbar::zbar_symbol_type_e zbar_code, int enable);
 
+    // For large images: scan overlapping tiles at several scales on a few threads,
+    // each with its own scanner. Symbols found by more than one tile/scale are reported once.
+    Result<zbar_result_t> SearchCapture(const capture_result_t& cap, const zbar_search_options_t& opts = {});
+
+    // Enable only `names` (see ZBAR_SYMBOLOGIES), or everything if it contains "all".
+    Result<> SetSymbologies(const std::vector<std::string>& names);
+
+    // Scan every Nth row/column. 1 = most thorough, higher = faster but may miss small codes.
+    void SetDensity(int density);
+
 private:
-    zbar::ImageScanner m_scanner;
+    // Scan the first w*h bytes of m_gray, appending what's found to `out`
+    // mapped back to source pixels (source = offset + point / scale).
+    void ScanGray(int w, int h, float scale, int off_x, int off_y, std::vector<zbar_symbol_t>& out);
+
+    zbar::ImageScanner   m_scanner;
+    zbar::Image          m_image;
+    std::vector<uint8_t> m_gray;
+
+    // Remembered for the tile scanners
+    std::vector<std::string> m_symbologies = { "all" };
+    int                      m_density     = 1;
+
+    std::vector<std::unique_ptr<ZbarAPI>> m_tile_scanners;
+    std::vector<uint8_t>                  m_frame_gray;  // SearchCapture() full-size grayscale
 };
 
 #endif  // !_TEXT_EXTRACTION_HPP_
@@ -102,6 +102,22 @@ GENERAL OPTIONS:
 
     -g, --gui                   Only launch the GUI.
     -t, --tray                  Only launch system tray.
+
+HEADLESS OPTIONS:
+    --ocr <FILE>...             Extract the text from each FILE and print it, in the given order, without any GUI.
+                                FILE can be a glob (e.g "shots/*.png", quote it if the shell doesn't expand it)
+                                or '-' for reading from stdin.
+    -j, --jobs <N>              Number of images to OCR in parallel, each with its own engine (default: 0, one per CPU core).
+    --json                      Print one JSON object per line (path, text, confidence, psm, timings)
+                                instead of plain text.
+    --serve[=<SOCKET>]          Keep the engines loaded and answer JSON-lines requests on stdin/stdout,
+                                or on the unix socket SOCKET. One request per line, e.g
+                                {"id":1,"op":"ocr","path":"shot.png","region":{"x":0,"y":0,"w":400,"h":80}}
+                                ops: "ocr" (options: "model", "psm") and "decode" (QR/bar codes).
+                                Image from "path" or base64 "data". Responses carry the same "id".
+    --watch[=<MODE>]            Watch the screen (default.watch-region) until interrupted, and print
+                                every new QR/bar code (MODE "qr", default) or text line (MODE "ocr")
+                                as it shows up. With --json, one object per line.
 )");
 
 // default oshot config
@@ -118,6 +134,49 @@ ocr-model = "{}"
 # The models must be on the root directory of the repository
 ocr-repo-downlaod = "{}"
 
+# When ocr-model combines several languages (e.g. "eng+jpn+chi_sim"),
+# detect the script of each text block first and recognize it with
+# only the matching model, instead of running all of them at once.
+# Models of a single script (e.g. "eng+fra") are left combined, script detection can't tell them apart.
+# Requires 'osd.traineddata' in ocr-path.
+ocr-script-routing = {}
+
+# Barcode types to look for when scanning QR/bar codes.
+# Fewer types means faster scans and less false positives.
+# "all", or any of: "qrcode", "ean13", "ean8", "upca", "upce", "isbn10", "isbn13", "i25",
+# "code39", "code93", "code128", "codabar", "pdf417", "databar", "databar-exp"
+barcode-symbologies = [{}]
+
+# Scan every Nth pixel row/column when looking for barcodes.
+# 1 is the most thorough, higher values are faster but may miss small codes.
+barcode-density = {}
+
+# Watch modes: QR/bar codes (tray "Watch QR codes", or --watch)
+# and text, e.g. subtitles or slides (tray "Watch text", or --watch=ocr).
+# Area of the monitor to watch, as "WIDTHxHEIGHT+X+Y" (e.g. "800x600+560+240").
+# Empty watches the whole monitor. It has to fit inside the monitor, or watching won't start.
+watch-region = "{}"
+
+# Monitor to watch, by its XRandR index (the order `xrandr --listmonitors` shows them in), X11 only.
+# -1 = the one under the cursor when watching starts, it stays the same after that.
+# On other sessions each capture is of the monitor under the cursor at the time.
+watch-monitor = {}
+
+# How often to look at the screen, in milliseconds.
+# While nothing changes on screen, this slows down on its own (up to 2 seconds).
+watch-interval = {}
+
+# Copy newly found codes (and text lines, if watch-transcript is empty) to the clipboard.
+watch-copy = {}
+
+# File where the text watch mode appends each new line.
+# Empty copies the lines to the clipboard instead.
+watch-transcript = "{}"
+
+# Share of one CPU core (in %) a watched frame may use. When OCR of a frame takes longer
+# than that, the next capture is delayed to make up for it. 0 = no limit.
+watch-cpu-budget = {}
+
 # Delay the app before acquiring a screenshot (in milliseconds)
 # Doesn't affect if opening external image (i.e. -f flag)
 delay = {}
@@ -161,6 +220,10 @@ annotations-in-text-tools = {}
 # false: CTRL+SHIFT+C
 ctrl-c-copy-img = {}
 
+# Redraw pencil strokes as a smooth curve once drawn.
+# Either way, they're reduced to the points that shape them, which keeps long strokes cheap.
+smooth-pencil = {}
+
 # Fonts to use for the application. Can be an absolute path, or just a name.
 # You can combine multiple fonts for multiple language support.
 # for example, using "Roboto-Regular.ttf" and "RobotoCJK-Regular.ttc" for Chinese, Japanese, and Korean support alongside English support.
@@ -169,9 +232,41 @@ fonts = [{}]
 
 # Extension of the output image when saving/copying.
 # Case insensitive.
-# Accepts: "png", "jpeg", "bmp", "tga"
+# Accepts: "png", "jpeg", "bmp", "tga", "qoi", "webp"
+# "qoi" is several times faster to encode than "png" (good for lots of copies),
+# "webp" is lossless and the smallest (good for archiving), but slower to encode.
 image-out-ext = "{}"
 
+# PNG encoder to use.
+# "fast": oshot's own encoder, much faster than "stb" and with smaller files.
+# "stb": stb_image_write, the old encoder, in case "fast" gives you trouble.
+png-encoder = "{}"
+
+# PNG compression level of the "fast" encoder, from 1 (fastest) to 9 (smallest).
+# Past 3, every row tries all the PNG filters, which is noticeably slower on big captures.
+# Past 4, each level also tries the ones below it and keeps the smallest, so a higher level never
+# gives a bigger file, but level 9 takes up to twice as long as it would on its own.
+png-compression = {}
+
+# JPEG quality, from 1 to 100.
+jpeg-quality = {}
+
+# Fit saved and copied images under this many KiB, 0 to turn it off.
+# Meant for places with an upload limit (ticket attachments, chats).
+# "jpeg" gets the highest quality that fits (jpeg-quality at most),
+# the other formats are lossless and can only shrink (see below).
+# The size indicator then shows the quality and scale it would use.
+image-out-max-size = {}
+
+# Shrink the image when it can't fit under image-out-max-size otherwise.
+# For "jpeg", that's once the quality would go below 40.
+image-out-fit-downscale = {}
+
+# Flush saved images to disk before the "Saved!" notification.
+# Images are always written to a temporary file and renamed over,
+# so a crash never leaves a half-written one; this also survives power loss.
+save-fsync = {}
+
 # Format of the output image filename when saving.
 # The image extension is appended automatically.
 # Uses {{fmt}} chrono specifiers. NOTE: 
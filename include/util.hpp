@@ -27,7 +27,9 @@
 #define _UTIL_HPP_
 
 #include <filesystem>
+#include <functional>
 #include <iostream>
+#include <span>
 #include <string>
 #include <utility>
 #include <variant>
@@ -249,8 +251,11 @@ constexpr E toe(T n) noexcept
 
 // Forward declaration
 struct capture_result_t;
+struct region_t;
 struct ImVec4;
 struct ImGuiIO;
+class ImageSink;
+struct fit_result_t;
 enum class ImageExt;
 
 // taken from "fmt/color.h" with the addition of alpha.
@@ -318,6 +323,8 @@ enum class ImageExt
     JPEG,
     BMP,
     TGA,
+    QOI,
+    WEBP,  // lossless only
     COUNT
 };
 
@@ -329,10 +336,29 @@ enum class SavingOp
 };
 
 inline constexpr std::array<std::pair<ImageExt, const char*>, idx(ImageExt::COUNT)> IMAGE_EXTS_STR = {
-    { { ImageExt::PNG, "PNG" }, { ImageExt::JPEG, "JPEG" }, { ImageExt::BMP, "BMP" }, { ImageExt::TGA, "TGA" } }
+    { { ImageExt::PNG, "PNG" },
+      { ImageExt::JPEG, "JPEG" },
+      { ImageExt::BMP, "BMP" },
+      { ImageExt::TGA, "TGA" },
+      { ImageExt::QOI, "QOI" },
+      { ImageExt::WEBP, "WEBP" } }
 };
 inline std::unordered_map<std::string_view, ImageExt> IMAGE_EXTS_ENUM = {
-    { { "PNG", ImageExt::PNG }, { "JPEG", ImageExt::JPEG }, { "BMP", ImageExt::BMP }, { "TGA", ImageExt::TGA } }
+    { { "PNG", ImageExt::PNG },
+      { "JPEG", ImageExt::JPEG },
+      { "BMP", ImageExt::BMP },
+      { "TGA", ImageExt::TGA },
+      { "QOI", ImageExt::QOI },
+      { "WEBP", ImageExt::WEBP } }
+};
+// MIME types, for the clipboard
+inline constexpr std::array<std::pair<ImageExt, const char*>, idx(ImageExt::COUNT)> IMAGE_EXTS_MIME = {
+    { { ImageExt::PNG, "image/png" },
+      { ImageExt::JPEG, "image/jpeg" },
+      { ImageExt::BMP, "image/bmp" },
+      { ImageExt::TGA, "image/x-tga" },
+      { ImageExt::QOI, "image/qoi" },
+      { ImageExt::WEBP, "image/webp" } }
 };
 
 extern bool g_is_systray;  // old g_is_clipboard_server;
@@ -356,6 +382,13 @@ static inline const std::string version_infos = fmt::format(
     GIT_TAG);
 
 std::vector<uint8_t> encode_to_image(const capture_result_t& cap, ImageExt ext);
+Result<>             encode_to_image(const capture_result_t& cap, ImageExt ext, ImageSink& sink);
+
+// Encode under `max_bytes` with the configured encoder settings, see encode_image_fit()
+Result<fit_result_t> encode_to_image_fit(const capture_result_t&      cap,
+                                         ImageExt                     ext,
+                                         size_t                       max_bytes,
+                                         const std::function<bool()>& canceled = {});
 
 std::string replace_str(std::string& str, const std::string_view from, const std::string_view to);
 std::string select_image();
@@ -381,8 +414,12 @@ fs::path get_config_dir();
 fs::path get_cache_dir();
 
 Result<capture_result_t> load_image_rgba(const std::string& path);
+Result<capture_result_t> load_image_rgba_from_memory(std::span<const uint8_t> data);
 Result<std::string>      get_config_image_out_fmt();
-Result<>                 save_image(SavingOp op, const capture_result_t& img, ImageExt ext);
+
+// Ask where to save for SavingOp::File, then hand the image to g_save_queue.
+// Returns before it's encoded, a notification tells when it's done.
+Result<> save_image(SavingOp op, const capture_result_t& img, ImageExt ext);
 
 void minimize_window();
 void maximize_window();
@@ -393,6 +430,7 @@ byte_units_t auto_divide_bytes(const double num, const std::uint16_t base, const
 byte_units_t divide_bytes(const double num, const std::string_view prefix);
 void         fit_to_screen(capture_result_t& img);
 void         rgba_to_grayscale(const uint8_t* rgba, uint8_t* result, int width, int height);
+capture_result_t crop_capture(const capture_result_t& src, const region_t& region);
 void         build_font_atlas(ImGuiIO& io);
 int          get_screen_dpi();
 bool         parse_hex_rgba(const std::string_view hex, rgba_t& out);
@@ -0,0 +1,180 @@
+/*
+ * Copyright 2026 Toni500
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ * disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ * following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ * products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _WATCH_HPP_
+#define _WATCH_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "screen_capture.hpp"
+#include "text_extraction.hpp"
+#include "util.hpp"
+
+// Finds which parts of a frame changed since the previous one, by hashing fixed-size tiles.
+class DamageTracker
+{
+public:
+    explicit DamageTracker(int tile_size = 64) : m_tile(tile_size) {}
+
+    // Changed areas of `frame`, each grown by one tile (so a code or text line
+    // crossing a tile border isn't cut in half) and merged with the ones they touch.
+    // Empty if nothing changed. The first frame, or one of a different size, is reported whole.
+    std::vector<region_t> Update(const capture_result_t& frame);
+    void                  Reset() { m_hashes.clear(); }
+
+private:
+    int                   m_tile;
+    int                   m_w = 0, m_h = 0;
+    int                   m_cols = 0, m_rows = 0;
+    std::vector<uint64_t> m_hashes;
+    std::vector<uint8_t>  m_dirty;
+};
+
+struct watch_options_t
+{
+    region_t region;              // inside the watched monitor, 0 width/height = all of it
+    int      monitor     = -1;    // XRandR index (X11 only), -1 = the one under the pointer at Start()
+    int      interval_ms = 500;   // polling rate while the screen changes
+    int      max_idle_ms = 2000;  // polling slows down to this while it doesn't
+
+    // Share of one core a frame may use (0..1, 0 = no limit).
+    // A frame that took longer than that stretches the wait before the next one.
+    float cpu_budget = 0;
+};
+
+// "WIDTHxHEIGHT+X+Y" -> region_t, empty = the whole monitor (0 width/height)
+Result<region_t> parse_watch_region(const std::string& str);
+
+// Captures the screen periodically on its own thread
+// and hands what changed to OnDamage().
+class ScreenWatcher
+{
+public:
+    virtual ~ScreenWatcher() { Stop(); }
+
+    // Picks the monitor and checks the region fits in it, so a bad region fails here
+    // instead of leaving the watcher looking at nothing.
+    Result<> Start(const watch_options_t& options);
+    void     Stop();
+    bool     IsRunning() const { return m_running.load(); }
+
+protected:
+    // Called on the watcher thread. `frame` is already cropped to the watched region
+    // and `damage` is in its coordinates.
+    // Subclasses must Stop() in their destructor, before their members go away.
+    virtual void OnDamage(const capture_result_t& frame, const std::vector<region_t>& damage) = 0;
+
+private:
+    // Backends without a ScreenGrabber can only take whole screenshots, which slows polling down to this
+    static constexpr int SLOW_CAPTURE_MIN_INTERVAL_MS = 1000;
+
+    void                     Loop();
+    Result<capture_result_t> Capture();
+
+    watch_options_t         m_options;
+    ScreenGrabber           m_grabber;       // X11
+    int                     m_screen_w = 0;  // everywhere else, size of the monitor screenshots are of
+    int                     m_screen_h = 0;
+    DamageTracker           m_damage;
+    std::thread             m_thread;
+    std::mutex              m_mtx;
+    std::condition_variable m_cv;
+    std::atomic<bool>       m_running{ false };
+    bool                    m_stop = false;
+};
+
+// Reports each QR/bar code payload the first time it shows up on screen.
+class BarcodeWatcher : public ScreenWatcher
+{
+public:
+    using callback_t = std::function<void(const zbar_symbol_t&)>;
+
+    explicit BarcodeWatcher(callback_t on_new) : m_on_new(std::move(on_new)) {}
+    ~BarcodeWatcher() override { Stop(); }
+
+    // Configure (symbologies, density) before Start()
+    ZbarAPI& Zbar() { return m_zbar; }
+
+protected:
+    void OnDamage(const capture_result_t& frame, const std::vector<region_t>& damage) override;
+
+private:
+    ZbarAPI    m_zbar;
+    callback_t m_on_new;
+
+    // Payloads already reported, capped to the last MAX_SEEN
+    static constexpr size_t         MAX_SEEN = 1024;
+    std::unordered_set<std::string> m_seen;
+    std::deque<std::string>         m_seen_order;
+};
+
+// Reads the text in the changed parts of the screen (subtitles, slides, ...)
+// and reports each line the first time it shows up.
+class OcrWatcher : public ScreenWatcher
+{
+public:
+    using callback_t = std::function<void(const std::string& line)>;
+
+    explicit OcrWatcher(callback_t on_new) : m_on_new(std::move(on_new)) {}
+    ~OcrWatcher() override { Stop(); }
+
+    // Configure (model, psm) before Start()
+    OcrAPI& Ocr() { return m_ocr; }
+
+protected:
+    void OnDamage(const capture_result_t& frame, const std::vector<region_t>& damage) override;
+
+private:
+    OcrAPI     m_ocr;
+    callback_t m_on_new;
+    size_t     m_frame_id = 0;
+
+    // Lines already reported, capped to the last MAX_SEEN
+    static constexpr size_t         MAX_SEEN = 256;
+    std::unordered_set<std::string> m_seen;
+    std::deque<std::string>         m_seen_order;
+};
+
+// Append `line` to the transcript file at `path`.
+// The file is reopened every time, so it can be moved or truncated while watching.
+Result<> append_transcript_line(const std::string& path, const std::string& line);
+
+// watch_options_t from the default.watch-* config
+Result<watch_options_t> watch_options_from_config();
+
+// Where a new OCR watch line goes: appended to default.watch-transcript if set,
+// else copied to the clipboard if default.watch-copy is on.
+void output_watch_line(const std::string& line);
+
+#endif  // !_WATCH_HPP_
@@ -133,6 +133,40 @@ def create_filled_rectangle_pixels(margin=5):
 
     return pixels
 
+def create_blur_pixels(inner=3.5, outer=9.5):
+    """White disc fading out towards its edge"""
+    size = 24
+    pixels = []
+    c = (size - 1) / 2.0
+
+    for y in range(size):
+        for x in range(size):
+            dist = ((x - c) ** 2 + (y - c) ** 2) ** 0.5
+            if dist <= inner:
+                alpha = 255
+            elif dist < outer:
+                alpha = int(255 * (outer - dist) / (outer - inner))
+            else:
+                alpha = 0
+            pixels.extend([255, 255, 255, alpha] if alpha else [0, 0, 0, 0])
+
+    return pixels
+
+def create_pixelate_pixels(margin=4, cell=4):
+    """White checkerboard of opaque and faint squares"""
+    size = 24
+    pixels = []
+
+    for y in range(size):
+        for x in range(size):
+            if margin <= x < size - margin and margin <= y < size - margin:
+                opaque = ((x - margin) // cell + (y - margin) // cell) % 2 == 0
+                pixels.extend([255, 255, 255, 255 if opaque else 96])
+            else:
+                pixels.extend([0, 0, 0, 0])
+
+    return pixels
+
 def create_counter_bubble_pixels(circle_thickness=1.5):
     size = 24
     pixels = create_circle_pixels(circle_thickness)
@@ -234,7 +268,9 @@ def main():
     #    ("ICON_SQUARE", create_square_pixels()),
     #    ("ICON_RECT_FILLED", create_filled_rectangle_pixels()),
     #    ("ICON_LINE", create_line_pixels()),
-    #    ("ICON_COUNTER_BUBBLE", create_counter_bubble_pixels())
+    #    ("ICON_COUNTER_BUBBLE", create_counter_bubble_pixels()),
+    #    ("ICON_BLUR", create_blur_pixels()),
+    #    ("ICON_PIXELATE", create_pixelate_pixels())
     ]
     
     header = """#pragma once
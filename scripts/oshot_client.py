@@ -0,0 +1,67 @@
+#!/usr/bin/env python3
+"""
+Minimal client for `oshot --serve=SOCKET`.
+
+    oshot --serve=/tmp/oshot.sock &
+    ./oshot_client.py /tmp/oshot.sock shot.png                     # OCR the whole image
+    ./oshot_client.py /tmp/oshot.sock shot.png --region 0,0,400,80 --psm 7
+    ./oshot_client.py /tmp/oshot.sock qr.png --op decode
+"""
+
+import argparse
+import json
+import socket
+import sys
+
+
+def request(sock_path, req):
+    with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as sock:
+        sock.connect(sock_path)
+        sock.sendall((json.dumps(req) + "\n").encode())
+
+        buf = b""
+        while b"\n" not in buf:
+            chunk = sock.recv(65536)
+            if not chunk:
+                break
+            buf += chunk
+        return json.loads(buf.split(b"\n", 1)[0])
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Send a request to a running `oshot --serve=SOCKET`")
+    parser.add_argument("socket")
+    parser.add_argument("image")
+    parser.add_argument("--op", choices=("ocr", "decode"), default="ocr")
+    parser.add_argument("--region", help="x,y,w,h")
+    parser.add_argument("--model")
+    parser.add_argument("--psm", type=int)
+    args = parser.parse_args()
+
+    req = {"id": 1, "op": args.op, "path": args.image}
+    if args.region:
+        x, y, w, h = (int(v) for v in args.region.split(","))
+        req["region"] = {"x": x, "y": y, "w": w, "h": h}
+
+    options = {}
+    if args.model:
+        options["model"] = args.model
+    if args.psm is not None:
+        options["psm"] = args.psm
+    if options:
+        req["options"] = options
+
+    res = request(args.socket, req)
+    if not res.get("ok"):
+        print(res.get("error"), file=sys.stderr)
+        return 1
+
+    if args.op == "decode":
+        print("\n".join(res["datas"]))
+    else:
+        print(res["text"])
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -25,15 +25,31 @@
 
 #include "clipboard.hpp"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "clip/clip.h"
 #include "config.hpp"
+#include "image_encoder.hpp"
 #include "screen_capture.hpp"
 
 #if OSHOT_LINUX
+#  include <X11/Xatom.h>
+#  include <X11/Xlib.h>
+#  include <fcntl.h>
+#  include <poll.h>
 #  include <sys/wait.h>
 #  include <unistd.h>
 #endif
@@ -96,8 +112,429 @@ Result<int> start_linux_copy(SessionType session, const std::string_view mime_ty
 #endif
 }
 
+#if OSHOT_LINUX
+// Owns the X11 CLIPBOARD selection from inside the tray daemon, instead of handing an encoded copy to xclip.
+// It keeps the raw RGBA and only encodes the format a paste actually asks for, once per format.
+// Data bigger than one X request goes out with the INCR protocol.
+// Xlib is only ever called from its own thread, the rest talks to it through m_mtx and a wake-up pipe.
+class X11ClipboardOwner
+{
+public:
+    ~X11ClipboardOwner() { Stop(); }
+
+    Result<> SetImage(const capture_result_t& cap, ImageExt preferred);
+    Result<> SetText(const std::string& text);
+
+private:
+    struct content_t
+    {
+        capture_result_t img;
+        ImageExt         preferred = ImageExt::PNG;
+        std::string      text;
+        bool             is_image = false;
+    };
+
+    using data_ptr = std::shared_ptr<const std::vector<uint8_t>>;
+
+    // A transfer in chunks, each sent once the requestor deleted the previous one
+    struct incr_t
+    {
+        Window                                requestor;
+        Atom                                  property;
+        Atom                                  type;
+        data_ptr                              data;
+        size_t                                offset = 0;
+        std::chrono::steady_clock::time_point last_activity;
+    };
+
+    Result<> Start();
+    void     Stop();
+    Result<> Take(content_t content);
+
+    void Loop();
+    void OnSelectionRequest(const XSelectionRequestEvent& req);
+    void OnPropertyNotify(const XPropertyEvent& ev);
+    bool SendChunk(incr_t& t);
+
+    // What `target` looks like for the current content, encoded on first use
+    bool Convert(Atom target, Atom& type, data_ptr& out);
+
+    Display* m_dpy    = nullptr;
+    Window   m_window = 0;
+    size_t   m_chunk  = 0;  // largest property written at once, bigger data goes through INCR
+    int      m_wake[2]{ -1, -1 };
+
+    struct atoms_t
+    {
+        Atom clipboard, targets, timestamp, incr, utf8, text, text_plain, text_plain_utf8, stamp;
+        std::array<Atom, idx(ImageExt::COUNT)> images;
+    } m_atoms{};
+
+    // Loop thread only
+    content_t                  m_content;
+    Time                       m_owned_since = CurrentTime;
+    std::map<Atom, data_ptr>   m_cache;
+    std::vector<incr_t>        m_transfers;
+
+    std::thread               m_thread;
+    std::mutex                m_mtx;
+    std::condition_variable   m_cv;
+    std::optional<content_t>  m_pending;  // handed over to the loop, which answers in m_taken
+    std::optional<bool>       m_taken;
+    bool                      m_stop = false;
+};
+
+static X11ClipboardOwner& x11_owner()
+{
+    static X11ClipboardOwner owner;
+    return owner;
+}
+
+Result<> X11ClipboardOwner::Start()
+{
+    if (m_thread.joinable())
+        return Ok();
+
+    m_dpy = XOpenDisplay(nullptr);
+    if (!m_dpy)
+        return Err("Failed to open the X display");
+
+    m_window = XCreateSimpleWindow(m_dpy, DefaultRootWindow(m_dpy), 0, 0, 1, 1, 0, 0, 0);
+    XSelectInput(m_dpy, m_window, PropertyChangeMask);
+
+    m_atoms.clipboard       = XInternAtom(m_dpy, "CLIPBOARD", False);
+    m_atoms.targets         = XInternAtom(m_dpy, "TARGETS", False);
+    m_atoms.timestamp       = XInternAtom(m_dpy, "TIMESTAMP", False);
+    m_atoms.incr            = XInternAtom(m_dpy, "INCR", False);
+    m_atoms.utf8            = XInternAtom(m_dpy, "UTF8_STRING", False);
+    m_atoms.text            = XInternAtom(m_dpy, "TEXT", False);
+    m_atoms.text_plain      = XInternAtom(m_dpy, "text/plain", False);
+    m_atoms.text_plain_utf8 = XInternAtom(m_dpy, "text/plain;charset=utf-8", False);
+    m_atoms.stamp           = XInternAtom(m_dpy, "OSHOT_TIMESTAMP", False);
+    for (const auto& [ext, mime] : IMAGE_EXTS_MIME)
+        m_atoms.images[idx(ext)] = XInternAtom(m_dpy, mime, False);
+
+    // Leave room for the request header
+    const long max_request = XExtendedMaxRequestSize(m_dpy) ? XExtendedMaxRequestSize(m_dpy) : XMaxRequestSize(m_dpy);
+    m_chunk                = std::min<size_t>(size_t(max_request) * 4 - 1024, 1 << 20);
+
+    if (pipe(m_wake) == -1)
+    {
+        XDestroyWindow(m_dpy, m_window);
+        XCloseDisplay(m_dpy);
+        m_dpy = nullptr;
+        return Err("Failed to open wake-up pipe: {}", strerror(errno));
+    }
+    fcntl(m_wake[0], F_SETFL, O_NONBLOCK);
+
+    m_stop   = false;
+    m_thread = std::thread(&X11ClipboardOwner::Loop, this);
+    return Ok();
+}
+
+void X11ClipboardOwner::Stop()
+{
+    if (!m_thread.joinable())
+        return;
+
+    {
+        std::lock_guard lk(m_mtx);
+        m_stop = true;
+    }
+    (void)!write(m_wake[1], "", 1);
+    m_thread.join();
+
+    XDestroyWindow(m_dpy, m_window);
+    XCloseDisplay(m_dpy);
+    m_dpy = nullptr;
+    close(m_wake[0]);
+    close(m_wake[1]);
+}
+
+Result<> X11ClipboardOwner::Take(content_t content)
+{
+    TRY(Start());
+
+    std::unique_lock lk(m_mtx);
+    m_pending = std::move(content);
+    m_taken.reset();
+    (void)!write(m_wake[1], "", 1);
+
+    if (!m_cv.wait_for(lk, std::chrono::seconds(2), [&] { return m_taken.has_value(); }))
+        return Err("Timed out taking the clipboard");
+    if (!*m_taken)
+        return Err("Another client took the clipboard first");
+    return Ok();
+}
+
+Result<> X11ClipboardOwner::SetImage(const capture_result_t& cap, ImageExt preferred)
+{
+    content_t content;
+    content.img       = cap;
+    content.preferred = preferred;
+    content.is_image  = true;
+    return Take(std::move(content));
+}
+
+Result<> X11ClipboardOwner::SetText(const std::string& text)
+{
+    content_t content;
+    content.text = text;
+    return Take(std::move(content));
+}
+
+void X11ClipboardOwner::Loop()
+{
+    const int x_fd = ConnectionNumber(m_dpy);
+    while (true)
+    {
+        if (XPending(m_dpy) == 0)
+        {
+            pollfd fds[2] = { { x_fd, POLLIN, 0 }, { m_wake[0], POLLIN, 0 } };
+            poll(fds, 2, 1000);
+        }
+
+        char drain[64];
+        while (read(m_wake[0], drain, sizeof(drain)) > 0)
+            ;
+
+        {
+            std::lock_guard lk(m_mtx);
+            if (m_stop)
+                break;
+            if (m_pending)
+            {
+                m_content = std::move(*m_pending);
+                m_pending.reset();
+                m_cache.clear();
+                m_transfers.clear();
+
+                // ICCCM wants a real server time for XSetSelectionOwner, not CurrentTime.
+                // An empty append to our own property gets us one, in the PropertyNotify it causes.
+                XChangeProperty(m_dpy, m_window, m_atoms.stamp, XA_STRING, 8, PropModeAppend, nullptr, 0);
+                XFlush(m_dpy);
+            }
+        }
+
+        while (XPending(m_dpy) > 0)
+        {
+            XEvent ev;
+            XNextEvent(m_dpy, &ev);
+            switch (ev.type)
+            {
+                case SelectionRequest: OnSelectionRequest(ev.xselectionrequest); break;
+                case PropertyNotify:   OnPropertyNotify(ev.xproperty); break;
+                case SelectionClear:
+                    // Someone else copied something, let the capture go
+                    if (ev.xselectionclear.selection == m_atoms.clipboard)
+                    {
+                        m_content = {};
+                        m_cache.clear();
+                        m_transfers.clear();
+                        m_owned_since = CurrentTime;
+                    }
+                    break;
+            }
+        }
+
+        // Requestors that stopped reading halfway
+        const auto now = std::chrono::steady_clock::now();
+        std::erase_if(m_transfers, [&](const incr_t& t) { return now - t.last_activity > std::chrono::seconds(5); });
+    }
+}
+
+void X11ClipboardOwner::OnPropertyNotify(const XPropertyEvent& ev)
+{
+    if (ev.window == m_window && ev.atom == m_atoms.stamp)
+    {
+        XSetSelectionOwner(m_dpy, m_atoms.clipboard, m_window, ev.time);
+        const bool owned = XGetSelectionOwner(m_dpy, m_atoms.clipboard) == m_window;
+        m_owned_since    = owned ? ev.time : CurrentTime;
+
+        std::lock_guard lk(m_mtx);
+        m_taken = owned;
+        m_cv.notify_all();
+        return;
+    }
+
+    if (ev.state != PropertyDelete)
+        return;
+
+    for (auto it = m_transfers.begin(); it != m_transfers.end(); ++it)
+    {
+        if (it->requestor != ev.window || it->property != ev.atom)
+            continue;
+
+        if (!SendChunk(*it))
+        {
+            const Window requestor = it->requestor;
+            m_transfers.erase(it);
+            if (std::none_of(m_transfers.begin(), m_transfers.end(), [&](const incr_t& t) {
+                    return t.requestor == requestor;
+                }))
+                XSelectInput(m_dpy, requestor, NoEventMask);
+        }
+        XFlush(m_dpy);
+        break;
+    }
+}
+
+// Send the next piece of `t`, the empty one when everything went already.
+// False once that empty one is out, the transfer is over.
+bool X11ClipboardOwner::SendChunk(incr_t& t)
+{
+    const size_t size = std::min(m_chunk, t.data->size() - t.offset);
+    XChangeProperty(
+        m_dpy, t.requestor, t.property, t.type, 8, PropModeReplace, t.data->data() + t.offset, int(size));
+    t.offset += size;
+    t.last_activity = std::chrono::steady_clock::now();
+    return size > 0;
+}
+
+bool X11ClipboardOwner::Convert(Atom target, Atom& type, data_ptr& out)
+{
+    if (!m_content.is_image)
+    {
+        if (target != m_atoms.utf8 && target != m_atoms.text && target != m_atoms.text_plain &&
+            target != m_atoms.text_plain_utf8 && target != XA_STRING)
+            return false;
+
+        type = target == m_atoms.text ? m_atoms.utf8 : target;
+        if (!m_cache.count(m_atoms.utf8))
+            m_cache[m_atoms.utf8] =
+                std::make_shared<const std::vector<uint8_t>>(m_content.text.begin(), m_content.text.end());
+        out = m_cache[m_atoms.utf8];
+        return true;
+    }
+
+    for (size_t i = 0; i < m_atoms.images.size(); ++i)
+    {
+        if (m_atoms.images[i] != target)
+            continue;
+
+        const ImageExt ext = ImageExt(i);
+        if (ext != ImageExt::PNG && ext != ImageExt::JPEG && ext != ImageExt::BMP && ext != m_content.preferred)
+            return false;
+
+        auto it = m_cache.find(target);
+        if (it == m_cache.end())
+        {
+            std::vector<uint8_t> img = encode_to_image(m_content.img, ext);
+            if (img.empty())
+                return false;
+            it = m_cache.emplace(target, std::make_shared<const std::vector<uint8_t>>(std::move(img))).first;
+        }
+
+        type = target;
+        out  = it->second;
+        return true;
+    }
+    return false;
+}
+
+void X11ClipboardOwner::OnSelectionRequest(const XSelectionRequestEvent& req)
+{
+    XSelectionEvent ev{};
+    ev.type      = SelectionNotify;
+    ev.display   = req.display;
+    ev.requestor = req.requestor;
+    ev.selection = req.selection;
+    ev.target    = req.target;
+    ev.time      = req.time;
+    ev.property  = None;
+
+    // Obsolete clients leave the property out and expect the target's name
+    const Atom property = req.property == None ? req.target : req.property;
+
+    const bool have = m_owned_since != CurrentTime && (m_content.is_image || !m_content.text.empty());
+    const bool stale = req.time != CurrentTime && req.time < m_owned_since;
+    if (req.selection == m_atoms.clipboard && have && !stale)
+    {
+        Atom     type = None;
+        data_ptr data;
+        if (req.target == m_atoms.targets)
+        {
+            std::vector<Atom> targets = { m_atoms.targets, m_atoms.timestamp };
+            if (m_content.is_image)
+            {
+                // The configured format first, it's what the user picked
+                targets.push_back(m_atoms.images[idx(m_content.preferred)]);
+                for (const ImageExt ext : { ImageExt::PNG, ImageExt::JPEG, ImageExt::BMP })
+                    if (ext != m_content.preferred)
+                        targets.push_back(m_atoms.images[idx(ext)]);
+            }
+            else
+            {
+                targets.insert(targets.end(),
+                               { m_atoms.utf8, m_atoms.text_plain_utf8, m_atoms.text_plain, m_atoms.text, XA_STRING });
+            }
+            XChangeProperty(m_dpy,
+                            req.requestor,
+                            property,
+                            XA_ATOM,
+                            32,
+                            PropModeReplace,
+                            reinterpret_cast<const unsigned char*>(targets.data()),
+                            int(targets.size()));
+            ev.property = property;
+        }
+        else if (req.target == m_atoms.timestamp)
+        {
+            const long time = long(m_owned_since);
+            XChangeProperty(m_dpy,
+                            req.requestor,
+                            property,
+                            XA_INTEGER,
+                            32,
+                            PropModeReplace,
+                            reinterpret_cast<const unsigned char*>(&time),
+                            1);
+            ev.property = property;
+        }
+        else if (Convert(req.target, type, data))
+        {
+            if (data->size() > m_chunk)
+            {
+                // Announce the (lower bound of the) size, then wait for the requestor to delete the property
+                XSelectInput(m_dpy, req.requestor, PropertyChangeMask);
+                const long size = long(data->size());
+                XChangeProperty(m_dpy,
+                                req.requestor,
+                                property,
+                                m_atoms.incr,
+                                32,
+                                PropModeReplace,
+                                reinterpret_cast<const unsigned char*>(&size),
+                                1);
+                m_transfers.push_back({ req.requestor, property, type, data, 0, std::chrono::steady_clock::now() });
+            }
+            else
+            {
+                XChangeProperty(
+                    m_dpy, req.requestor, property, type, 8, PropModeReplace, data->data(), int(data->size()));
+            }
+            ev.property = property;
+        }
+    }
+
+    XSendEvent(m_dpy, req.requestor, False, NoEventMask, reinterpret_cast<XEvent*>(&ev));
+    XFlush(m_dpy);
+}
+#endif
+
 Result<> Clipboard::CopyText(const std::string& text)
 {
+#if OSHOT_LINUX
+    // The tray daemon outlives the copy, so it can hold the selection itself
+    if (m_session == SessionType::X11 && g_is_systray)
+    {
+        const Result<>& res = x11_owner().SetText(text);
+        if (res.ok())
+            return Ok();
+        spdlog::warn("Falling back to xclip: {}", res.error_v());
+    }
+#endif
+
     if (m_session == SessionType::Wayland || m_session == SessionType::X11)
     {
         const Result<int>& res = start_linux_copy(m_session);
@@ -125,22 +562,28 @@ Result<> Clipboard::CopyImage(const capture_result_t& cap, ImageExt ext)
     if (cap.w <= 0 || cap.h <= 0)
         return Err("Image size is empty");
 
+#if OSHOT_LINUX
+    // Keeps the RGBA, a paste encodes only the format it asks for
+    if (m_session == SessionType::X11 && g_is_systray)
+    {
+        const Result<>& res = x11_owner().SetImage(cap, ext);
+        if (res.ok())
+            return Ok();
+        spdlog::warn("Falling back to xclip: {}", res.error_v());
+    }
+#endif
+
     if (m_session == SessionType::Wayland || m_session == SessionType::X11)
     {
-        const Result<int>& res =
-            start_linux_copy(m_session, "image/" + str_tolower(g_config->File.image_out_type.first));
+        const Result<int>& res = start_linux_copy(m_session, IMAGE_EXTS_MIME[idx(ext)].second);
         TRY(res);
 
-        const std::vector<uint8_t>& png = encode_to_image(cap, ext);
-
-        const int fd = res.get();
-        if (write(fd, reinterpret_cast<const char*>(png.data()), png.size()) == -1)
-        {
-            close(fd);
-            return Err("Failed to write image to stdin: {}", strerror(errno));
-        }
-
+        // Stream straight into the pipe, so wl-copy/xclip reads while we're still encoding
+        const int      fd = res.get();
+        FdSink         sink(fd);
+        const Result<> enc = encode_to_image(cap, ext, sink);
         close(fd);
+        TRY_MSG(enc, "Failed to write image to stdin: {}");
 
         return Ok();
     }
@@ -0,0 +1,408 @@
+/*
+ * Copyright 2026 Toni500
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ * disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ * following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ * products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "composite.hpp"
+
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define OSHOT_BLEND_SSE2 1
+#  include <emmintrin.h>
+// GCC and Clang can build the AVX2 kernel into a generic binary and pick it at runtime
+#  if defined(__GNUC__) || defined(__clang__)
+#    define OSHOT_BLEND_AVX2 1
+#    include <immintrin.h>
+#  endif
+#endif
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+#  define OSHOT_BLEND_NEON 1
+#  include <arm_neon.h>
+#endif
+
+// The SIMD kernels blend as many whole vectors as fit in the span and return how many pixels that was,
+// the scalar code does the rest. `cov` null means every pixel has alpha `a`.
+using blend_kernel_t     = size_t (*)(uint8_t* dst, size_t n, rgba_t color, const uint8_t* cov, uint32_t a);
+using composite_kernel_t = size_t (*)(uint8_t* dst, const uint8_t* src, size_t n);
+
+// x / 255, rounded half up, exact for x in [0, 255 * 255]
+static inline uint32_t div255(uint32_t x)
+{
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+static inline void blend_pixel(uint8_t* p, rgba_t c, uint32_t a)
+{
+    if (a == 0)
+        return;
+    if (a == 0xFF)
+    {
+        store_rgba(p, rgba_t(c.r, c.g, c.b, 0xFF));
+        return;
+    }
+
+    const uint32_t ia = 0xFF - a;
+    p[0]              = uint8_t(div255(c.r * a + p[0] * ia));
+    p[1]              = uint8_t(div255(c.g * a + p[1] * ia));
+    p[2]              = uint8_t(div255(c.b * a + p[2] * ia));
+    p[3]              = uint8_t(div255(0xFF * a + p[3] * ia));
+}
+
+void blend_span_scalar(uint8_t* dst, size_t n, rgba_t color, const uint8_t* cov)
+{
+    for (size_t i = 0; i < n; ++i)
+        blend_pixel(dst + i * 4, color, div255(uint32_t(color.a) * cov[i]));
+}
+
+void blend_span_scalar(uint8_t* dst, size_t n, rgba_t color, uint8_t cov)
+{
+    const uint32_t a = div255(uint32_t(color.a) * cov);
+    for (size_t i = 0; i < n; ++i)
+        blend_pixel(dst + i * 4, color, a);
+}
+
+void composite_span_scalar(uint8_t* dst, const uint8_t* src, size_t n)
+{
+    for (size_t i = 0; i < n; ++i, dst += 4, src += 4)
+    {
+        const uint32_t ia = 0xFF - src[3];
+        if (ia == 0xFF)
+            continue;
+        for (int c = 0; c < 4; ++c)
+            dst[c] = uint8_t(src[c] + div255(dst[c] * ia));
+    }
+}
+
+#if OSHOT_BLEND_SSE2
+static inline __m128i div255_epu16(__m128i x)
+{
+    x = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+// 4 pixels, their alphas in the low 4 lanes of `a16`
+static inline void blend4_sse2(uint8_t* p, __m128i a16, __m128i src16)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ff   = _mm_set1_epi16(0xFF);
+    const __m128i a2   = _mm_unpacklo_epi16(a16, a16);
+    const __m128i a_lo = _mm_unpacklo_epi32(a2, a2);  // a0 x4, a1 x4
+    const __m128i a_hi = _mm_unpackhi_epi32(a2, a2);  // a2 x4, a3 x4
+
+    const __m128i d  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i       lo = _mm_unpacklo_epi8(d, zero);
+    __m128i       hi = _mm_unpackhi_epi8(d, zero);
+    // Both products fit 16 bits unsigned, and so does their sum
+    lo = div255_epu16(_mm_add_epi16(_mm_mullo_epi16(src16, a_lo), _mm_mullo_epi16(lo, _mm_sub_epi16(ff, a_lo))));
+    hi = div255_epu16(_mm_add_epi16(_mm_mullo_epi16(src16, a_hi), _mm_mullo_epi16(hi, _mm_sub_epi16(ff, a_hi))));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm_packus_epi16(lo, hi));
+}
+
+static size_t blend_sse2(uint8_t* dst, size_t n, rgba_t color, const uint8_t* cov, uint32_t a)
+{
+    const __m128i src16  = _mm_setr_epi16(color.r, color.g, color.b, 0xFF, color.r, color.g, color.b, 0xFF);
+    const __m128i opaque = _mm_setr_epi8(color.r, color.g, color.b, -1, color.r, color.g, color.b, -1,
+                                         color.r, color.g, color.b, -1, color.r, color.g, color.b, -1);
+    const __m128i ca     = _mm_set1_epi16(color.a);
+    const __m128i zero   = _mm_setzero_si128();
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        uint8_t* p = dst + i * 4;
+        if (!cov)
+        {
+            blend4_sse2(p, _mm_set1_epi16(short(a)), src16);
+            continue;
+        }
+
+        uint32_t c4;
+        std::memcpy(&c4, cov + i, 4);
+        if (c4 == 0)
+            continue;
+        if (c4 == 0xFFFFFFFF && color.a == 0xFF)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(p), opaque);
+            continue;
+        }
+
+        const __m128i c16 = _mm_unpacklo_epi8(_mm_cvtsi32_si128(int(c4)), zero);
+        blend4_sse2(p, div255_epu16(_mm_mullo_epi16(c16, ca)), src16);
+    }
+    return i;
+}
+
+static size_t composite_sse2(uint8_t* dst, const uint8_t* src, size_t n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ff   = _mm_set1_epi16(0xFF);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(s, zero)) == 0xFFFF)
+            continue;  // nothing drawn there, the usual case in an annotation layer
+
+        uint8_t*      p    = dst + i * 4;
+        const __m128i d    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const __m128i s_lo = _mm_unpacklo_epi8(s, zero);
+        const __m128i s_hi = _mm_unpackhi_epi8(s, zero);
+        // Each pixel's alpha over its 4 channels
+        const __m128i ia_lo = _mm_sub_epi16(
+            ff, _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_lo, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3)));
+        const __m128i ia_hi = _mm_sub_epi16(
+            ff, _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_hi, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3)));
+
+        const __m128i lo = div255_epu16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), ia_lo));
+        const __m128i hi = div255_epu16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), ia_hi));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm_adds_epu8(s, _mm_packus_epi16(lo, hi)));
+    }
+    return i;
+}
+#endif
+
+#if OSHOT_BLEND_AVX2
+__attribute__((target("avx2"))) static inline __m256i div255_epu16_avx2(__m256i x)
+{
+    x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+
+__attribute__((target("avx2"))) static size_t
+blend_avx2(uint8_t* dst, size_t n, rgba_t color, const uint8_t* cov, uint32_t a)
+{
+    const __m256i src16 = _mm256_setr_epi16(color.r, color.g, color.b, 0xFF, color.r, color.g, color.b, 0xFF,
+                                            color.r, color.g, color.b, 0xFF, color.r, color.g, color.b, 0xFF);
+    const __m256i ff    = _mm256_set1_epi16(0xFF);
+    const __m128i ca    = _mm_set1_epi16(color.a);
+    // Spread 8 alphas over the 16 bit channels of pixels 0-3 and 4-7, as _mm256_cvtepu8_epi16() lays them out
+    const __m256i spread_lo = _mm256_setr_epi8(0, 1, 0, 1, 0, 1, 0, 1, 2, 3, 2, 3, 2, 3, 2, 3,
+                                               4, 5, 4, 5, 4, 5, 4, 5, 6, 7, 6, 7, 6, 7, 6, 7);
+    const __m256i spread_hi = _mm256_add_epi8(spread_lo, _mm256_set1_epi8(8));
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        uint8_t* p = dst + i * 4;
+
+        __m128i a16;
+        if (cov)
+        {
+            uint64_t c8;
+            std::memcpy(&c8, cov + i, 8);
+            if (c8 == 0)
+                continue;
+            // _mm_cvtsi64_si128() only exists on x86-64
+            const __m128i c16 = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(cov + i)));
+            const __m128i x   = _mm_add_epi16(_mm_mullo_epi16(c16, ca), _mm_set1_epi16(128));
+            a16               = _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+        }
+        else
+        {
+            a16 = _mm_set1_epi16(short(a));
+        }
+
+        const __m256i ab   = _mm256_broadcastsi128_si256(a16);
+        const __m256i a_lo = _mm256_shuffle_epi8(ab, spread_lo);
+        const __m256i a_hi = _mm256_shuffle_epi8(ab, spread_hi);
+
+        const __m256i d  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i       lo = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(d));
+        __m256i       hi = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(d, 1));
+        lo = div255_epu16_avx2(
+            _mm256_add_epi16(_mm256_mullo_epi16(src16, a_lo), _mm256_mullo_epi16(lo, _mm256_sub_epi16(ff, a_lo))));
+        hi = div255_epu16_avx2(
+            _mm256_add_epi16(_mm256_mullo_epi16(src16, a_hi), _mm256_mullo_epi16(hi, _mm256_sub_epi16(ff, a_hi))));
+
+        // packus works per 128 bit lane, put the 64 bit halves back in pixel order
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p),
+                            _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8));
+    }
+    return i;
+}
+#endif
+
+#if OSHOT_BLEND_NEON
+// x + round(x / 256), then round(/ 256): the same as div255()
+static inline uint8x8_t div255_neon(uint16x8_t x)
+{
+    return vrshrn_n_u16(vrsraq_n_u16(x, x, 8), 8);
+}
+
+static size_t blend_neon(uint8_t* dst, size_t n, rgba_t color, const uint8_t* cov, uint32_t a)
+{
+    const uint8x8_t r  = vdup_n_u8(color.r);
+    const uint8x8_t g  = vdup_n_u8(color.g);
+    const uint8x8_t b  = vdup_n_u8(color.b);
+    const uint8x8_t ff = vdup_n_u8(0xFF);
+    const uint8x8_t ca = vdup_n_u8(color.a);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        uint8_t*  p  = dst + i * 4;
+        uint8x8_t a8 = vdup_n_u8(uint8_t(a));
+        if (cov)
+        {
+            uint64_t c8;
+            std::memcpy(&c8, cov + i, 8);
+            if (c8 == 0)
+                continue;
+            a8 = div255_neon(vmull_u8(vld1_u8(cov + i), ca));
+        }
+        const uint8x8_t ia = vmvn_u8(a8);
+
+        uint8x8x4_t d = vld4_u8(p);  // deinterleaved into r, g, b, a
+        d.val[0]      = div255_neon(vmlal_u8(vmull_u8(r, a8), d.val[0], ia));
+        d.val[1]      = div255_neon(vmlal_u8(vmull_u8(g, a8), d.val[1], ia));
+        d.val[2]      = div255_neon(vmlal_u8(vmull_u8(b, a8), d.val[2], ia));
+        d.val[3]      = div255_neon(vmlal_u8(vmull_u8(ff, a8), d.val[3], ia));
+        vst4_u8(p, d);
+    }
+    return i;
+}
+
+static size_t composite_neon(uint8_t* dst, const uint8_t* src, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        const uint8x8x4_t s = vld4_u8(src + i * 4);
+        const uint8x8_t any = vorr_u8(vorr_u8(s.val[0], s.val[1]), vorr_u8(s.val[2], s.val[3]));
+        if (vget_lane_u64(vreinterpret_u64_u8(any), 0) == 0)
+            continue;
+
+        uint8_t*        p  = dst + i * 4;
+        uint8x8x4_t     d  = vld4_u8(p);
+        const uint8x8_t ia = vmvn_u8(s.val[3]);
+        for (int c = 0; c < 4; ++c)
+            d.val[c] = vqadd_u8(s.val[c], div255_neon(vmull_u8(d.val[c], ia)));
+        vst4_u8(p, d);
+    }
+    return i;
+}
+#endif
+
+static size_t blend_none(uint8_t*, size_t, rgba_t, const uint8_t*, uint32_t)
+{
+    return 0;
+}
+
+static size_t composite_none(uint8_t*, const uint8_t*, size_t)
+{
+    return 0;
+}
+
+struct blend_isa_t
+{
+    const char*        name;
+    blend_kernel_t     kernel;
+    composite_kernel_t composite;
+};
+
+// Every kernel set that's compiled in and runs on this CPU, best first
+static const std::vector<blend_isa_t>& available_isas()
+{
+    static const std::vector<blend_isa_t> isas = [] {
+        std::vector<blend_isa_t> ret;
+#if OSHOT_BLEND_AVX2
+        if (__builtin_cpu_supports("avx2"))
+            ret.push_back({ "avx2", blend_avx2, composite_sse2 });
+#endif
+#if OSHOT_BLEND_SSE2
+        ret.push_back({ "sse2", blend_sse2, composite_sse2 });
+#endif
+#if OSHOT_BLEND_NEON
+        ret.push_back({ "neon", blend_neon, composite_neon });
+#endif
+        ret.push_back({ "scalar", blend_none, composite_none });
+        return ret;
+    }();
+    return isas;
+}
+
+static blend_isa_t& blend_isa()
+{
+    static blend_isa_t isa = available_isas().front();
+    return isa;
+}
+
+const char* blend_span_isa()
+{
+    return blend_isa().name;
+}
+
+std::vector<const char*> blend_span_isas()
+{
+    std::vector<const char*> ret;
+    for (const blend_isa_t& isa : available_isas())
+        ret.push_back(isa.name);
+    return ret;
+}
+
+bool blend_span_set_isa(std::string_view name)
+{
+    for (const blend_isa_t& isa : available_isas())
+    {
+        if (isa.name == name)
+        {
+            blend_isa() = isa;
+            return true;
+        }
+    }
+    return false;
+}
+
+void blend_span(uint8_t* dst, size_t n, rgba_t color, const uint8_t* cov)
+{
+    const size_t done = blend_isa().kernel(dst, n, color, cov, 0);
+    blend_span_scalar(dst + done * 4, n - done, color, cov + done);
+}
+
+void blend_span(uint8_t* dst, size_t n, rgba_t color, uint8_t cov)
+{
+    const uint32_t a = div255(uint32_t(color.a) * cov);
+    if (a == 0)
+        return;
+    if (a == 0xFF)
+    {
+        const rgba_t opaque(color.r, color.g, color.b, 0xFF);
+        for (size_t i = 0; i < n; ++i)
+            store_rgba(dst + i * 4, opaque);
+        return;
+    }
+
+    const size_t done = blend_isa().kernel(dst, n, color, nullptr, a);
+    blend_span_scalar(dst + done * 4, n - done, color, cov);
+}
+
+void composite_span(uint8_t* dst, const uint8_t* src, size_t n)
+{
+    const size_t done = blend_isa().composite(dst, src, n);
+    composite_span_scalar(dst + done * 4, src + done * 4, n - done);
+}
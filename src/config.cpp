@@ -69,6 +69,20 @@ void Config::LoadConfigFile(const std::string& filename)
     File.pref_conf_to_env = GetValue<bool>("default.config-over-env", false);
     File.render_anns      = GetValue<bool>("default.annotations-in-text-tools", true);
     File.ctrl_c_copy_img  = GetValue<bool>("default.ctrl-c-copy-img", false);
+    File.smooth_pencil    = GetValue<bool>("default.smooth-pencil", true);
+
+    File.ocr_script_routing = GetValue<bool>("default.ocr-script-routing", false);
+
+    File.barcode_symbologies = GetValueArrayStr("default.barcode-symbologies", { "all" });
+    File.barcode_density     = std::max(GetValue<int>("default.barcode-density", 1), 1);
+
+    File.watch_region   = GetValue<std::string>("default.watch-region", "");
+    File.watch_monitor  = std::max(GetValue<int>("default.watch-monitor", -1), -1);
+    File.watch_interval = std::max(GetValue<int>("default.watch-interval", 500), 10);
+    File.watch_copy     = GetValue<bool>("default.watch-copy", true);
+
+    File.watch_transcript = GetValue<std::string>("default.watch-transcript", "");
+    File.watch_cpu_budget = std::clamp(GetValue<int>("default.watch-cpu-budget", 25), 0, 100);
 
     File.fonts = GetValueArrayStr("default.fonts", { GetValue<std::string>("default.font", "") });
 
@@ -90,6 +104,26 @@ void Config::LoadConfigFile(const std::string& filename)
         File.image_out_type.second = ImageExt::PNG;
     }
 
+    File.png_encoder.first = str_tolower(GetValue<std::string>("default.png-encoder", "fast"));
+    const auto png_it      = std::find_if(PNG_BACKENDS.begin(), PNG_BACKENDS.end(), [&](const auto& pair) {
+        return pair.first == File.png_encoder.first;
+    });
+    if (png_it != PNG_BACKENDS.end())
+    {
+        File.png_encoder.second = png_it->second;
+    }
+    else
+    {
+        File.png_encoder.first  = "fast";
+        File.png_encoder.second = PngBackend::Fast;
+    }
+    File.png_level = std::clamp(GetValue<int>("default.png-compression", 3), PNG_LEVEL_MIN, PNG_LEVEL_MAX);
+
+    File.jpeg_quality      = std::clamp(GetValue<int>("default.jpeg-quality", 90), JPEG_QUALITY_MIN, JPEG_QUALITY_MAX);
+    File.image_out_max_kib = std::max(GetValue<int>("default.image-out-max-size", 0), 0);
+    File.fit_downscale     = GetValue<bool>("default.image-out-fit-downscale", true);
+    File.save_fsync        = GetValue<bool>("default.save-fsync", false);
+
     static constexpr std::array<std::string_view, 19> prefixes = { "off", "auto", "B",   "KiB", "MiB", "GiB", "TiB",
                                                                    "PiB", "EiB",  "ZiB", "YiB", "KB",  "MB",  "GB",
                                                                    "TB",  "PB",   "EB",  "ZB",  "YB" };
@@ -152,10 +186,23 @@ void Config::GenerateConfig(const std::string& filename, const bool force)
         fonts_str.pop_back();  // ','
     }
 
+    std::string symbologies_str;
+    for (const std::string& sym : File.barcode_symbologies)
+        symbologies_str += fmt::format("{}\"{}\"", symbologies_str.empty() ? "" : ", ", sym);
+
     f.print(AUTOCONFIG,
             File.ocr_path,
             File.ocr_model,
             File.ocr_get_repo,
+            File.ocr_script_routing,
+            symbologies_str,
+            File.barcode_density,
+            File.watch_region,
+            File.watch_monitor,
+            File.watch_interval,
+            File.watch_copy,
+            File.watch_transcript,
+            File.watch_cpu_budget,
             File.delay,
             File.color_picker,
             File.cpa_mode,
@@ -166,8 +213,15 @@ void Config::GenerateConfig(const std::string& filename, const bool force)
             File.pref_conf_to_env,
             File.render_anns,
             File.ctrl_c_copy_img,
+            File.smooth_pencil,
             fonts_str,
             File.image_out_type.first,
+            File.png_encoder.first,
+            File.png_level,
+            File.jpeg_quality,
+            File.image_out_max_kib,
+            File.fit_downscale,
+            File.save_fsync,
             File.image_out_fmt,
             File.image_out_size_fmt,
             File.theme_file_path);
@@ -30,6 +30,7 @@
 #  include "plugin.hpp"
 #  include "state_manager.hh"
 #endif
+#include "save_queue.hpp"
 #include "screenshot_tool.hpp"
 #include "util.hpp"
 
@@ -40,6 +41,7 @@ std::unique_ptr<Cache>  g_cache;
 bool                    g_is_systray = false;
 int                     g_scr_w{}, g_scr_h{};
 Clipboard               g_clipboard(SessionType::Unknown);
+SaveQueue               g_save_queue;  // after g_config and g_clipboard, its thread uses them until destroyed
 
 #ifndef DISABLE_PLUGINS
 static StateManager _s;
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2026 Toni500
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ * disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ * following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ * products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "glyph_cache.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+
+// Our own copy, ImGui's is static to imgui_draw.cpp
+#define STBTT_STATIC
+#define STB_TRUETYPE_IMPLEMENTATION
+#include "imgui/imstb_truetype.h"
+
+struct GlyphCache::font_t
+{
+    std::string          name;
+    std::vector<uint8_t> data;  // stbtt_fontinfo points into it
+    stbtt_fontinfo       info{};
+    int                  ascent = 0;
+};
+
+GlyphCache::GlyphCache()  = default;
+GlyphCache::~GlyphCache() = default;
+
+Result<int> GlyphCache::LoadFont(const std::string& path)
+{
+    for (size_t i = 0; i < m_fonts.size(); ++i)
+        if (m_fonts[i]->name == path)
+            return Ok(int(i));
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return Err("Failed to open font '{}'", path);
+
+    const std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return LoadFont(path, data);
+}
+
+Result<int> GlyphCache::LoadFont(const std::string& name, std::span<const uint8_t> data)
+{
+    for (size_t i = 0; i < m_fonts.size(); ++i)
+        if (m_fonts[i]->name == name)
+            return Ok(int(i));
+
+    auto font  = std::make_unique<font_t>();
+    font->name = name;
+    font->data.assign(data.begin(), data.end());
+
+    const int offset = stbtt_GetFontOffsetForIndex(font->data.data(), 0);
+    if (offset < 0 || !stbtt_InitFont(&font->info, font->data.data(), offset))
+        return Err("Failed to parse font '{}'", name);
+
+    int descent = 0, line_gap = 0;
+    stbtt_GetFontVMetrics(&font->info, &font->ascent, &descent, &line_gap);
+
+    m_fonts.push_back(std::move(font));
+    return Ok(int(m_fonts.size() - 1));
+}
+
+float GlyphCache::GetAscent(int font, float size) const
+{
+    const font_t& f = *m_fonts[size_t(font)];
+    // Rounded like ImGui does, so exported text sits where it's drawn on screen
+    return std::ceil(float(f.ascent) * stbtt_ScaleForPixelHeight(&f.info, size));
+}
+
+std::shared_ptr<const glyph_mask_t> GlyphCache::GetGlyph(int font, float size, uint32_t codepoint, float pen_x)
+{
+    const int subpixel = std::clamp(int((pen_x - std::floor(pen_x)) * SUBPIXEL_STEPS), 0, SUBPIXEL_STEPS - 1);
+    const glyph_key_t key{ font, size, codepoint, subpixel };
+
+    auto it = m_glyphs.find(key);
+    if (it != m_glyphs.end())
+        return it->second;
+
+    if (m_glyphs.size() >= MAX_GLYPHS)
+        m_glyphs.clear();
+
+    const font_t& f     = *m_fonts[size_t(font)];
+    const float   scale = stbtt_ScaleForPixelHeight(&f.info, size);
+    const float   shift = float(subpixel) / SUBPIXEL_STEPS;
+    const int     glyph = stbtt_FindGlyphIndex(&f.info, int(codepoint));
+
+    auto mask    = std::make_shared<glyph_mask_t>();
+    int  advance = 0, lsb = 0;
+    stbtt_GetGlyphHMetrics(&f.info, glyph, &advance, &lsb);
+    mask->advance = float(advance) * scale;
+
+    int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+    stbtt_GetGlyphBitmapBoxSubpixel(&f.info, glyph, scale, scale, shift, 0, &x0, &y0, &x1, &y1);
+    if (x1 > x0 && y1 > y0)
+    {
+        mask->w = x1 - x0;
+        mask->h = y1 - y0;
+        mask->x = x0;
+        mask->y = y0;
+        mask->cov.resize(size_t(mask->w) * mask->h);
+        stbtt_MakeGlyphBitmapSubpixel(
+            &f.info, mask->cov.data(), mask->w, mask->h, mask->w, scale, scale, shift, 0, glyph);
+    }
+
+    m_glyphs.emplace(key, mask);
+    return mask;
+}
+
+void GlyphCache::Clear()
+{
+    m_glyphs.clear();
+    m_fonts.clear();
+}
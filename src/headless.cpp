@@ -0,0 +1,967 @@
+/*
+ * Copyright 2026 Toni500
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ * disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ * following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ * products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "headless.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+#include "clipboard.hpp"
+#include "config.hpp"
+#include "fmt/format.h"
+#include "json.hpp"
+#include "platform.hpp"
+#include "screen_capture.hpp"
+#include "text_extraction.hpp"
+#include "util.hpp"
+#include "watch.hpp"
+
+#if !OSHOT_WINDOWS
+#  include <sys/socket.h>
+#  include <sys/un.h>
+#  include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+using ms_t = std::chrono::duration<double, std::milli>;
+
+static Result<std::vector<uint8_t>> base64_decode(std::string_view in)
+{
+    static constexpr auto table = [] {
+        std::array<int8_t, 256> t{};
+        t.fill(-1);
+        constexpr std::string_view chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        for (size_t i = 0; i < chars.size(); ++i)
+            t[uint8_t(chars[i])] = int8_t(i);
+        return t;
+    }();
+
+    std::vector<uint8_t> out;
+    out.reserve(in.size() / 4 * 3);
+
+    uint32_t buf  = 0;
+    int      bits = 0;
+    for (const char c : in)
+    {
+        if (c == '=' || c == '\n' || c == '\r')
+            continue;
+
+        const int8_t v = table[uint8_t(c)];
+        if (v < 0)
+            return Err("invalid base64 character '{}'", c);
+
+        buf = (buf << 6) | uint32_t(v);
+        bits += 6;
+        if (bits >= 8)
+        {
+            bits -= 8;
+            out.push_back(uint8_t(buf >> bits));
+        }
+    }
+    return Ok(std::move(out));
+}
+
+// Shell-like '*' and '?' matching
+static bool wildcard_match(std::string_view pattern, std::string_view name)
+{
+    size_t p = 0, n = 0;
+    size_t star = std::string_view::npos, star_n = 0;
+
+    while (n < name.size())
+    {
+        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n]))
+        {
+            ++p;
+            ++n;
+        }
+        else if (p < pattern.size() && pattern[p] == '*')
+        {
+            star   = p++;
+            star_n = n;
+        }
+        else if (star != std::string_view::npos)
+        {
+            p = star + 1;
+            n = ++star_n;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    while (p < pattern.size() && pattern[p] == '*')
+        ++p;
+    return p == pattern.size();
+}
+
+std::vector<std::string> expand_inputs(const std::vector<std::string>& args)
+{
+    std::vector<std::string> ret;
+    for (const std::string& arg : args)
+    {
+        const fs::path    path(arg);
+        const std::string pattern = path.filename().string();
+
+        if (arg == "-" || pattern.find_first_of("*?") == std::string::npos || fs::exists(path))
+        {
+            ret.push_back(arg);
+            continue;
+        }
+
+        std::error_code ec;
+        const fs::path& dir = path.has_parent_path() ? path.parent_path() : fs::path(".");
+
+        std::vector<std::string> matches;
+        for (const fs::directory_entry& entry : fs::directory_iterator(dir, ec))
+            if (entry.is_regular_file(ec) && wildcard_match(pattern, entry.path().filename().string()))
+                matches.push_back((path.has_parent_path() ? entry.path() : entry.path().filename()).string());
+
+        if (matches.empty())
+        {
+            // Let it fail later with a proper "can't open" error
+            spdlog::warn("No files match '{}'", arg);
+            ret.push_back(arg);
+            continue;
+        }
+
+        std::sort(matches.begin(), matches.end());
+        ret.insert(ret.end(), std::make_move_iterator(matches.begin()), std::make_move_iterator(matches.end()));
+    }
+    return ret;
+}
+
+int run_batch_ocr()
+{
+    struct batch_item_t
+    {
+        std::string          path;
+        Result<ocr_result_t> result{ Err() };
+        double               decode_ms = 0;
+        double               ocr_ms    = 0;
+        bool                 done      = false;
+    };
+
+    const std::vector<std::string>& inputs = expand_inputs(g_config->Runtime.inputs);
+    if (inputs.empty())
+    {
+        spdlog::error("--ocr: no input files given");
+        return EXIT_FAILURE;
+    }
+    if (std::count(inputs.begin(), inputs.end(), "-") > 1)
+    {
+        spdlog::error("--ocr: stdin ('-') can only be read once");
+        return EXIT_FAILURE;
+    }
+
+    std::vector<batch_item_t> items(inputs.size());
+    for (size_t i = 0; i < inputs.size(); ++i)
+        items[i].path = inputs[i];
+
+    size_t jobs = g_config->Runtime.jobs > 0 ? size_t(g_config->Runtime.jobs) : std::thread::hardware_concurrency();
+    jobs        = std::clamp<size_t>(jobs, 1, items.size());
+
+    // Tesseract's own OpenMP threads only fight with ours when running several engines.
+    // Don't override it if the user set it on purpose.
+    if (jobs > 1)
+    {
+#if OSHOT_WINDOWS
+        if (!std::getenv("OMP_THREAD_LIMIT"))
+            _putenv_s("OMP_THREAD_LIMIT", "1");
+#else
+        setenv("OMP_THREAD_LIMIT", "1", 0);
+#endif
+    }
+
+    // No monitor to go by for the DPI heuristic,
+    // pretend the images were taken on a common 1080p screen.
+    if (g_scr_w <= 0 || g_scr_h <= 0)
+    {
+        g_scr_w = 1920;
+        g_scr_h = 1080;
+    }
+
+    spdlog::debug("Batch OCR: {} input(s), {} job(s), model '{}'", items.size(), jobs, g_config->File.ocr_model);
+
+    std::mutex              mtx;
+    std::condition_variable cv;
+    std::atomic<size_t>     next{ 0 };
+
+    auto worker = [&]() {
+        // One engine per worker, each loading its own copy of the model
+        OcrAPI          api;
+        const Result<>& init = api.Configure(g_config->File.ocr_path.c_str(), g_config->File.ocr_model.c_str());
+
+        for (size_t i = next.fetch_add(1); i < items.size(); i = next.fetch_add(1))
+        {
+            batch_item_t&        item = items[i];
+            Result<ocr_result_t> result{ Err() };
+            double               decode_ms = 0, ocr_ms = 0;
+
+            if (!init.ok())
+            {
+                result = Err(init.error_v());
+            }
+            else
+            {
+                const auto               start = std::chrono::steady_clock::now();
+                Result<capture_result_t> cap   = load_image_rgba(item.path);
+                const auto               mid   = std::chrono::steady_clock::now();
+                decode_ms                      = ms_t(mid - start).count();
+
+                if (!cap.ok())
+                {
+                    result = Err(cap.error_v());
+                }
+                else
+                {
+                    result = api.ExtractTextCapture(cap.get());
+                    ocr_ms = ms_t(std::chrono::steady_clock::now() - mid).count();
+                }
+            }
+
+            {
+                std::lock_guard lk(mtx);
+                item.result    = std::move(result);
+                item.decode_ms = decode_ms;
+                item.ocr_ms    = ocr_ms;
+                item.done      = true;
+            }
+            cv.notify_all();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(jobs);
+    for (size_t i = 0; i < jobs; ++i)
+        workers.emplace_back(worker);
+
+    // Print in input order, as soon as each one (and everything before it) is done
+    int exit_code = EXIT_SUCCESS;
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+        {
+            std::unique_lock lk(mtx);
+            cv.wait(lk, [&] { return items[i].done; });
+        }
+
+        const batch_item_t& item = items[i];
+        if (!item.result.ok())
+        {
+            exit_code = EXIT_FAILURE;
+            if (g_config->Runtime.json_output)
+                fmt::print("{{\"path\":\"{}\",\"error\":\"{}\"}}\n",
+                           json_escape(item.path),
+                           json_escape(item.result.error_v()));
+            else
+                spdlog::error("{}: {}", item.path, item.result.error_v());
+        }
+        else if (g_config->Runtime.json_output)
+        {
+            const ocr_result_t& res = item.result.get();
+            fmt::print(
+                "{{\"path\":\"{}\",\"text\":\"{}\",\"confidence\":{},\"psm\":{},\"psm_str\":\"{}\",\"model\":\"{}\","
+                "\"timings\":{{\"decode_ms\":{:.3f},\"ocr_ms\":{:.3f}}}}}\n",
+                json_escape(item.path),
+                json_escape(res.data),
+                res.confidence,
+                res.psm,
+                json_escape(res.psm_str),
+                json_escape(res.model),
+                item.decode_ms,
+                item.ocr_ms);
+        }
+        else
+        {
+            if (items.size() > 1)
+                fmt::print("==> {} <==\n", item.path);
+            fmt::print("{}\n", item.result.get().data);
+            if (items.size() > 1 && i + 1 < items.size())
+                fmt::print("\n");
+        }
+        std::fflush(stdout);
+    }
+
+    for (std::thread& t : workers)
+        t.join();
+
+    return exit_code;
+}
+
+// ------------------------------
+// --serve
+// ------------------------------
+namespace
+{
+// Where the responses of a client go.
+// The fd is closed once the last job still referencing the connection is done.
+struct server_conn_t
+{
+    int        fd = -1;  // -1 = stdout
+    std::mutex mtx;
+
+    ~server_conn_t()
+    {
+#if !OSHOT_WINDOWS
+        if (fd >= 0)
+            close(fd);
+#endif
+    }
+
+    void Send(std::string line)
+    {
+        line += '\n';
+        std::lock_guard lk(mtx);
+        if (fd < 0)
+        {
+            std::fwrite(line.data(), 1, line.size(), stdout);
+            std::fflush(stdout);
+            return;
+        }
+#if !OSHOT_WINDOWS
+        for (size_t off = 0; off < line.size();)
+        {
+            const ssize_t n = send(fd, line.data() + off, line.size() - off, MSG_NOSIGNAL);
+            if (n <= 0)
+                return;  // client went away, nothing to report to
+            off += size_t(n);
+        }
+#endif
+    }
+};
+
+struct server_job_t
+{
+    std::shared_ptr<server_conn_t> conn;
+    std::string                    line;
+};
+
+// Everything a worker keeps warm between requests
+struct server_worker_t
+{
+    std::unordered_map<std::string, std::unique_ptr<OcrAPI>> engines;  // model -> engine
+    std::unique_ptr<ZbarAPI>                                 zbar;
+
+    // last decoded image, so a client asking for several regions of the same file
+    // only pays for the decode (and the engines' preprocessing) once
+    std::string      frame_key;
+    capture_result_t frame;
+    size_t           frame_id = 0;
+};
+
+class ServerQueue
+{
+public:
+    explicit ServerQueue(size_t max_pending) : m_max_pending(max_pending) {}
+
+    // Blocks while too many requests are pending, so a fast client can't queue up unbounded images.
+    void Push(server_job_t job)
+    {
+        std::unique_lock lk(m_mtx);
+        m_cv_space.wait(lk, [&] { return m_jobs.size() < m_max_pending; });
+        m_jobs.push_back(std::move(job));
+        m_cv_jobs.notify_one();
+    }
+
+    // Returns false once Close()d and drained
+    bool Pop(server_job_t& job)
+    {
+        std::unique_lock lk(m_mtx);
+        m_cv_jobs.wait(lk, [&] { return m_closed || !m_jobs.empty(); });
+        if (m_jobs.empty())
+            return false;
+        job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+        m_cv_space.notify_one();
+        return true;
+    }
+
+    void Close()
+    {
+        std::lock_guard lk(m_mtx);
+        m_closed = true;
+        m_cv_jobs.notify_all();
+    }
+
+private:
+    std::mutex               m_mtx;
+    std::condition_variable  m_cv_jobs;
+    std::condition_variable  m_cv_space;
+    std::deque<server_job_t> m_jobs;
+    size_t                   m_max_pending;
+    bool                     m_closed = false;
+};
+}  // namespace
+
+static constexpr size_t MAX_REQUEST_SIZE = 64 * 1024 * 1024;
+
+static std::atomic<size_t> g_next_frame_id{ 1 };
+
+static std::string json_id(const json_value_t* id)
+{
+    if (!id)
+        return "null";
+    switch (id->type)
+    {
+        case json_value_t::Type::String: return fmt::format("\"{}\"", json_escape(id->string));
+        case json_value_t::Type::Number: return fmt::format("{}", id->number);
+        default:                         return "null";
+    }
+}
+
+static Result<> load_request_frame(server_worker_t& w, const json_value_t& req, double& load_ms)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    std::string              key;
+    Result<capture_result_t> cap{ Err() };
+    if (const std::string_view path = req.get_str("path"); !path.empty())
+    {
+        std::error_code ec;
+        const auto      mtime = fs::last_write_time(path, ec);
+        const auto      size  = fs::file_size(path, ec);
+        if (ec)
+            return Err("{}: {}", path, ec.message());
+
+        key = fmt::format("path:{}:{}:{}", path, mtime.time_since_epoch().count(), size);
+        if (key == w.frame_key)
+            return Ok();
+        cap = load_image_rgba(std::string(path));
+    }
+    else if (const std::string_view data = req.get_str("data"); !data.empty())
+    {
+        key = fmt::format("data:{}:{}", std::hash<std::string_view>{}(data), data.size());
+        if (key == w.frame_key)
+            return Ok();
+
+        const Result<std::vector<uint8_t>>& bytes = base64_decode(data);
+        if (!bytes.ok())
+            return Err(bytes.error_v());
+        cap = load_image_rgba_from_memory(bytes.get());
+    }
+    else
+    {
+        return Err("request needs either \"path\" or \"data\"");
+    }
+
+    if (!cap.ok())
+        return Err(cap.error_v());
+
+    w.frame     = std::move(cap.get());
+    w.frame_key = std::move(key);
+    w.frame_id  = g_next_frame_id.fetch_add(1);
+    load_ms     = ms_t(std::chrono::steady_clock::now() - start).count();
+    return Ok();
+}
+
+// JSON numbers are doubles, and casting one that doesn't fit in an int is undefined
+static std::optional<int> json_int(double n)
+{
+    if (!std::isfinite(n) || n < double(INT_MIN) || n > double(INT_MAX))
+        return std::nullopt;
+    return int(n);
+}
+
+static Result<std::optional<region_t>> request_region(const json_value_t& req, const capture_result_t& frame)
+{
+    const json_value_t* r = req.find("region");
+    if (!r || r->type == json_value_t::Type::Null)
+        return Ok(std::nullopt);
+    if (r->type != json_value_t::Type::Object)
+        return Err("\"region\" must be an object");
+
+    const auto& x = r->get_num("x");
+    const auto& y = r->get_num("y");
+    const auto& w = r->get_num("w");
+    const auto& h = r->get_num("h");
+    if (!x || !y || !w || !h)
+        return Err("\"region\" needs x, y, w and h");
+
+    const std::optional<int> ix = json_int(*x), iy = json_int(*y), iw = json_int(*w), ih = json_int(*h);
+    if (!ix || !iy || !iw || !ih)
+        return Err("\"region\" values must be integers");
+
+    // Compared as "w <= frame.w - x" so a huge width can't overflow past the check
+    region_t region{ *ix, *iy, *iw, *ih };
+    if (region.width <= 0 || region.height <= 0 || region.x < 0 || region.y < 0 ||
+        region.width > frame.w - region.x || region.height > frame.h - region.y)
+        return Err("region {}x{}+{}+{} is outside the {}x{} image",
+                   region.width,
+                   region.height,
+                   region.x,
+                   region.y,
+                   frame.w,
+                   frame.h);
+    return Ok(region);
+}
+
+static Result<OcrAPI*> get_engine(server_worker_t& w, const std::string& model)
+{
+    auto it = w.engines.find(model);
+    if (it != w.engines.end())
+        return Ok(it->second.get());
+
+    auto api = std::make_unique<OcrAPI>();
+    TRY(api->Configure(g_config->File.ocr_path.c_str(), model.c_str()));
+    spdlog::debug("--serve: loaded model '{}' on thread {}", model, std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    return Ok(w.engines.emplace(model, std::move(api)).first->second.get());
+}
+
+// {"data":"...","type":"QR-Code","polygon":[[x,y],...]}
+static std::string symbol_json(const zbar_symbol_t& sym)
+{
+    std::string polygon;
+    for (const point_t& p : sym.polygon)
+        polygon += fmt::format("{}[{},{}]", polygon.empty() ? "" : ",", p.x, p.y);
+    return fmt::format("{{\"data\":\"{}\",\"type\":\"{}\",\"polygon\":[{}]}}",
+                       json_escape(sym.data),
+                       json_escape(sym.type),
+                       polygon);
+}
+
+static Result<std::string> handle_request(server_worker_t& w, const json_value_t& req, const std::string& id)
+{
+    const std::string_view op = req.get_str("op").empty() ? "ocr" : req.get_str("op");
+    if (op != "ocr" && op != "decode")
+        return Err("unknown op '{}'", op);
+
+    double load_ms = 0;
+    TRY(load_request_frame(w, req, load_ms));
+
+    const Result<std::optional<region_t>>& region = request_region(req, w.frame);
+    if (!region.ok())
+        return Err(region.error_v());
+
+    const json_value_t* options = req.find("options");
+    const auto          start   = std::chrono::steady_clock::now();
+
+    if (op == "decode")
+    {
+        if (!w.zbar)
+        {
+            w.zbar = std::make_unique<ZbarAPI>();
+            if (const Result<>& res = w.zbar->SetSymbologies(g_config->File.barcode_symbologies); !res.ok())
+                spdlog::warn("--serve: {}", res.error_v());
+            w.zbar->SetDensity(g_config->File.barcode_density);
+        }
+
+        const json_value_t* tiled      = options ? options->find("tiled") : nullptr;
+        const json_value_t* first_only = options ? options->find("first_only") : nullptr;
+        auto                scan       = [&](const capture_result_t& img) -> Result<zbar_result_t> {
+            if (!(tiled && tiled->boolean))
+                return w.zbar->ExtractTextsCapture(img);
+
+            zbar_search_options_t opts;
+            opts.jobs       = 1;  // requests are already spread across workers
+            opts.first_only = first_only && first_only->boolean;
+            return w.zbar->SearchCapture(img, opts);
+        };
+
+        const Result<zbar_result_t>& res = region.get() ? scan(crop_capture(w.frame, *region.get())) : scan(w.frame);
+        if (!res.ok())
+            return Err(res.error_v());
+
+        std::string datas, symbologies, symbols;
+        for (const std::string& data : res.get().datas)
+            datas += fmt::format("{}\"{}\"", datas.empty() ? "" : ",", json_escape(data));
+        for (const zbar_symbol_t& sym : res.get().symbols)
+            symbols += fmt::format("{}{}", symbols.empty() ? "" : ",", symbol_json(sym));
+        for (const auto& [name, count] : res.get().symbologies)
+            symbologies += fmt::format("{}\"{}\":{}", symbologies.empty() ? "" : ",", json_escape(name), count);
+
+        return Ok(fmt::format(
+            "{{\"id\":{},\"ok\":true,\"op\":\"decode\",\"datas\":[{}],\"symbologies\":{{{}}},\"symbols\":[{}],"
+            "\"timings\":{{\"load_ms\":{:.3f},\"decode_ms\":{:.3f}}}}}",
+            id,
+            datas,
+            symbologies,
+            symbols,
+            load_ms,
+            ms_t(std::chrono::steady_clock::now() - start).count()));
+    }
+
+    std::string                           model = g_config->File.ocr_model;
+    std::optional<tesseract::PageSegMode> psm;
+    if (options && options->type == json_value_t::Type::Object)
+    {
+        if (const std::string_view m = options->get_str("model"); !m.empty())
+            model = m;
+        if (const auto& n = options->get_num("psm"))
+        {
+            const std::optional<int> mode = json_int(*n);
+            if (!mode || *mode < tesseract::PSM_OSD_ONLY || *mode >= tesseract::PSM_COUNT)
+                return Err("invalid psm {}", *n);
+            psm = tesseract::PageSegMode(*mode);
+        }
+    }
+
+    const Result<OcrAPI*>& engine = get_engine(w, model);
+    if (!engine.ok())
+        return Err(engine.error_v());
+
+    OcrAPI* api = engine.get();
+    api->SetPsm(psm);
+    const Result<ocr_result_t>& res =
+        region.get() ? api->ExtractTextRegion(w.frame, *region.get(), w.frame_id) : api->ExtractTextCapture(w.frame);
+    if (!res.ok())
+        return Err(res.error_v());
+
+    return Ok(fmt::format(
+        "{{\"id\":{},\"ok\":true,\"op\":\"ocr\",\"text\":\"{}\",\"confidence\":{},\"psm\":{},\"psm_str\":\"{}\","
+        "\"model\":\"{}\",\"timings\":{{\"load_ms\":{:.3f},\"ocr_ms\":{:.3f}}}}}",
+        id,
+        json_escape(res.get().data),
+        res.get().confidence,
+        res.get().psm,
+        json_escape(res.get().psm_str),
+        json_escape(res.get().model),
+        load_ms,
+        ms_t(std::chrono::steady_clock::now() - start).count()));
+}
+
+static void server_worker(ServerQueue& queue)
+{
+    server_worker_t w;
+    server_job_t    job;
+    while (queue.Pop(job))
+    {
+        const Result<json_value_t>& req = json_parse(job.line);
+        if (!req.ok() || req.get().type != json_value_t::Type::Object)
+        {
+            job.conn->Send(fmt::format("{{\"id\":null,\"ok\":false,\"error\":\"{}\"}}",
+                                       json_escape(req.ok() ? "request must be a JSON object" : req.error_v())));
+            job = {};
+            continue;
+        }
+
+        const std::string&         id  = json_id(req.get().find("id"));
+        const Result<std::string>& res = handle_request(w, req.get(), id);
+        if (res.ok())
+            job.conn->Send(res.get());
+        else
+            job.conn->Send(fmt::format("{{\"id\":{},\"ok\":false,\"error\":\"{}\"}}", id, json_escape(res.error_v())));
+
+        job = {};  // drop our reference to the connection
+    }
+}
+
+static void push_line(ServerQueue& queue, const std::shared_ptr<server_conn_t>& conn, std::string line)
+{
+    if (!line.empty() && line.back() == '\r')
+        line.pop_back();
+    if (line.find_first_not_of(" \t") == std::string::npos)
+        return;
+    queue.Push({ conn, std::move(line) });
+}
+
+// Lines from stdin until EOF, read in bounded chunks like the socket: an oversized one is answered
+// and skipped as it comes in, never held whole
+static void serve_stdin(ServerQueue& queue, const std::shared_ptr<server_conn_t>& conn)
+{
+    std::string line;
+    bool        skipping = false;
+    char        chunk[64 * 1024];
+    while (true)
+    {
+        std::cin.getline(chunk, sizeof(chunk));
+        if (std::cin.bad())
+            break;
+
+        const bool   eof    = std::cin.eof();
+        const bool   full   = std::cin.fail() && !eof;  // filled the chunk before the end of the line
+        const size_t stored = size_t(std::cin.gcount()) - (eof || full ? 0 : 1);  // minus the newline
+
+        if (!skipping)
+        {
+            line.append(chunk, stored);
+            if (line.size() > MAX_REQUEST_SIZE)
+            {
+                conn->Send(fmt::format("{{\"id\":null,\"ok\":false,\"error\":\"request larger than {} bytes\"}}",
+                                       MAX_REQUEST_SIZE));
+                line.clear();
+                skipping = true;
+            }
+        }
+
+        if (full)
+        {
+            std::cin.clear();
+            continue;
+        }
+
+        // end of a line, or of the input with a last request without a trailing newline
+        if (!skipping)
+            push_line(queue, conn, std::move(line));
+        line.clear();
+        skipping = false;
+        if (eof)
+            break;
+    }
+}
+
+#if !OSHOT_WINDOWS
+static void server_signal_handler(int)
+{
+    if (g_sock_path[0] != '\0')
+        unlink(g_sock_path);
+    _exit(EXIT_SUCCESS);
+}
+
+static void serve_connection(ServerQueue& queue, const std::shared_ptr<server_conn_t>& conn)
+{
+    std::string buf;
+    char        chunk[64 * 1024];
+    while (true)
+    {
+        const ssize_t n = recv(conn->fd, chunk, sizeof(chunk), 0);
+        if (n <= 0)
+            break;
+
+        const size_t old_size = buf.size();
+        buf.append(chunk, size_t(n));
+
+        size_t start = 0;
+        for (size_t nl = buf.find('\n', old_size); nl != std::string::npos; nl = buf.find('\n', start))
+        {
+            push_line(queue, conn, buf.substr(start, nl - start));
+            start = nl + 1;
+        }
+        buf.erase(0, start);
+
+        if (buf.size() > MAX_REQUEST_SIZE)
+        {
+            conn->Send(fmt::format("{{\"id\":null,\"ok\":false,\"error\":\"request larger than {} bytes\"}}",
+                                   MAX_REQUEST_SIZE));
+            buf.clear();  // already answered, not a request to run
+            break;
+        }
+    }
+    // a last request without a trailing newline
+    push_line(queue, conn, std::move(buf));
+}
+
+static Result<> listen_unix_socket(const std::string& path)
+{
+    sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path) || path.size() >= sizeof(g_sock_path))
+        return Err("socket path '{}' is too long", path);
+
+    g_sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (g_sock < 0)
+        return Err("socket(): {}", std::strerror(errno));
+
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    // left behind by a crashed instance
+    unlink(path.c_str());
+    if (bind(g_sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+        return Err("bind({}): {}", path, std::strerror(errno));
+    if (listen(g_sock, SOMAXCONN) < 0)
+        return Err("listen({}): {}", path, std::strerror(errno));
+
+    std::strncpy(g_sock_path, path.c_str(), sizeof(g_sock_path) - 1);
+    return Ok();
+}
+#endif
+
+int run_server(const std::string& socket_path)
+{
+    const size_t jobs =
+        g_config->Runtime.jobs > 0 ? size_t(g_config->Runtime.jobs) : std::max(1u, std::thread::hardware_concurrency());
+
+    if (jobs > 1)
+    {
+#if OSHOT_WINDOWS
+        if (!std::getenv("OMP_THREAD_LIMIT"))
+            _putenv_s("OMP_THREAD_LIMIT", "1");
+#else
+        setenv("OMP_THREAD_LIMIT", "1", 0);
+#endif
+    }
+
+    if (g_scr_w <= 0 || g_scr_h <= 0)
+    {
+        g_scr_w = 1920;
+        g_scr_h = 1080;
+    }
+
+    ServerQueue              queue(jobs * 4);
+    std::vector<std::thread> workers;
+    workers.reserve(jobs);
+    for (size_t i = 0; i < jobs; ++i)
+        workers.emplace_back(server_worker, std::ref(queue));
+
+    if (socket_path.empty())
+    {
+        spdlog::debug("--serve: reading requests from stdin, {} job(s)", jobs);
+
+        serve_stdin(queue, std::make_shared<server_conn_t>());
+
+        // EOF: finish what's queued, then quit
+        queue.Close();
+        for (std::thread& t : workers)
+            t.join();
+        return EXIT_SUCCESS;
+    }
+
+#if OSHOT_WINDOWS
+    spdlog::error("--serve: unix sockets are not supported on Windows, use --serve without a path (stdin/stdout)");
+    queue.Close();
+    for (std::thread& t : workers)
+        t.join();
+    return EXIT_FAILURE;
+#else
+    if (const Result<>& res = listen_unix_socket(socket_path); !res.ok())
+    {
+        spdlog::error("--serve: {}", res.error_v());
+        queue.Close();
+        for (std::thread& t : workers)
+            t.join();
+        return EXIT_FAILURE;
+    }
+
+    std::signal(SIGINT, server_signal_handler);
+    std::signal(SIGTERM, server_signal_handler);
+    std::signal(SIGPIPE, SIG_IGN);
+    spdlog::info("--serve: listening on {}, {} job(s)", socket_path, jobs);
+
+    while (true)
+    {
+        const int fd = accept(g_sock, nullptr, nullptr);
+        if (fd < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            spdlog::error("--serve: accept(): {}", std::strerror(errno));
+            break;
+        }
+
+        auto conn = std::make_shared<server_conn_t>();
+        conn->fd  = fd;
+        std::thread(serve_connection, std::ref(queue), conn).detach();
+    }
+
+    unlink(g_sock_path);
+    queue.Close();
+    for (std::thread& t : workers)
+        t.join();
+    return EXIT_FAILURE;
+#endif
+}
+
+// ------------------------------
+// --watch
+// ------------------------------
+static volatile std::sig_atomic_t g_watch_stop = 0;
+
+int run_watch(const std::string& mode)
+{
+    const Result<watch_options_t>& opts = watch_options_from_config();
+    if (!opts.ok())
+    {
+        spdlog::error("--watch: {}", opts.error_v());
+        return EXIT_FAILURE;
+    }
+
+    const bool                     json = g_config->Runtime.json_output;
+    std::unique_ptr<ScreenWatcher> watcher;
+    if (mode == "ocr")
+    {
+        auto ocr = std::make_unique<OcrWatcher>([json](const std::string& line) {
+            if (json)
+                fmt::println("{{\"text\":\"{}\"}}", json_escape(line));
+            else
+                fmt::println("{}", line);
+            std::fflush(stdout);
+            output_watch_line(line);
+        });
+
+        if (const Result<>& res =
+                ocr->Ocr().Configure(g_config->File.ocr_path.c_str(), g_config->File.ocr_model.c_str());
+            !res.ok())
+        {
+            spdlog::error("--watch: {}", res.error_v());
+            return EXIT_FAILURE;
+        }
+        watcher = std::move(ocr);
+    }
+    else
+    {
+        auto qr = std::make_unique<BarcodeWatcher>([json](const zbar_symbol_t& sym) {
+            if (json)
+                fmt::println("{}", symbol_json(sym));
+            else
+                fmt::println("{}: {}", sym.type, sym.data);
+            std::fflush(stdout);
+
+            if (g_config->File.watch_copy)
+                if (const Result<>& res = g_clipboard.CopyText(sym.data); !res.ok())
+                    spdlog::warn("--watch: failed to copy to clipboard: {}", res.error_v());
+        });
+
+        if (const Result<>& res = qr->Zbar().SetSymbologies(g_config->File.barcode_symbologies); !res.ok())
+            spdlog::warn("--watch: {}", res.error_v());
+        qr->Zbar().SetDensity(g_config->File.barcode_density);
+        watcher = std::move(qr);
+    }
+
+    if (const Result<>& res = watcher->Start(opts.get()); !res.ok())
+    {
+        spdlog::error("--watch: {}", res.error_v());
+        return EXIT_FAILURE;
+    }
+
+    std::signal(SIGINT, [](int) { g_watch_stop = 1; });
+    std::signal(SIGTERM, [](int) { g_watch_stop = 1; });
+    spdlog::info("--watch: looking for {} every {}ms, Ctrl+C to stop",
+                 mode == "ocr" ? "new text" : "QR/bar codes",
+                 opts.get().interval_ms);
+
+    while (!g_watch_stop && watcher->IsRunning())
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    watcher->Stop();
+    return g_watch_stop ? EXIT_SUCCESS : EXIT_FAILURE;
+}
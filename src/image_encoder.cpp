@@ -0,0 +1,1241 @@
+/*
+ * Copyright 2026 Toni500
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ * disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ * following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ * products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "image_encoder.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "huffman.hpp"
+#include "platform.hpp"
+#include "stb_image_resize2.h"
+#include "stb_image_write.h"
+
+#if OSHOT_WINDOWS
+#  include <io.h>
+#else
+#  include <unistd.h>
+#endif
+
+// ------------------------------
+// Sinks
+// ------------------------------
+bool MemorySink::Write(const uint8_t* data, size_t size)
+{
+    m_out.insert(m_out.end(), data, data + size);
+    return true;
+}
+
+bool FdSink::Write(const uint8_t* data, size_t size)
+{
+    while (size > 0)
+    {
+#if OSHOT_WINDOWS
+        const int n = _write(m_fd, data, unsigned(std::min<size_t>(size, INT_MAX)));
+#else
+        const ssize_t n = ::write(m_fd, data, size);
+#endif
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += n;
+        size -= size_t(n);
+    }
+    return true;
+}
+
+bool FileSink::Write(const uint8_t* data, size_t size)
+{
+    return std::fwrite(data, 1, size, m_fp) == size;
+}
+
+// ------------------------------
+// Checksums
+// ------------------------------
+static const std::array<std::array<uint32_t, 256>, 4> CRC_TABLES = [] {
+    std::array<std::array<uint32_t, 256>, 4> t{};
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k)
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        t[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; ++i)
+        for (size_t s = 1; s < 4; ++s)
+            t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xFF];
+    return t;
+}();
+
+// Slice-by-4
+static uint32_t crc32(uint32_t crc, const uint8_t* p, size_t n)
+{
+    crc = ~crc;
+    for (; n >= 4; n -= 4, p += 4)
+    {
+        crc ^= uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+        crc = CRC_TABLES[3][crc & 0xFF] ^ CRC_TABLES[2][(crc >> 8) & 0xFF] ^ CRC_TABLES[1][(crc >> 16) & 0xFF] ^
+              CRC_TABLES[0][crc >> 24];
+    }
+    while (n--)
+        crc = CRC_TABLES[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static uint32_t adler32(uint32_t adler, const uint8_t* p, size_t n)
+{
+    // Largest n such that 255n(n+1)/2 + (n+1)(65520) fits in 32 bits
+    constexpr size_t NMAX = 5552;
+
+    uint32_t a = adler & 0xFFFF, b = adler >> 16;
+    while (n > 0)
+    {
+        const size_t chunk = std::min(n, NMAX);
+        n -= chunk;
+        for (size_t i = 0; i < chunk; ++i)
+        {
+            a += p[i];
+            b += a;
+        }
+        p += chunk;
+        a %= 65521;
+        b %= 65521;
+    }
+    return b << 16 | a;
+}
+
+// adler32 of A+B from adler32(A), adler32(B) and len(B), same as zlib's adler32_combine()
+static uint32_t adler32_combine(uint32_t adler1, uint32_t adler2, size_t len2)
+{
+    constexpr uint32_t BASE = 65521;
+
+    const uint32_t rem  = uint32_t(len2 % BASE);
+    uint32_t       sum1 = adler1 & 0xFFFF;
+    uint32_t       sum2 = uint32_t(uint64_t(rem) * sum1 % BASE);
+    sum1 += (adler2 & 0xFFFF) + BASE - 1;
+    sum2 += ((adler1 >> 16) & 0xFFFF) + ((adler2 >> 16) & 0xFFFF) + BASE - rem;
+    if (sum1 >= BASE)
+        sum1 -= BASE;
+    if (sum1 >= BASE)
+        sum1 -= BASE;
+    if (sum2 >= 2 * BASE)
+        sum2 -= 2 * BASE;
+    if (sum2 >= BASE)
+        sum2 -= BASE;
+    return sum1 | (sum2 << 16);
+}
+
+// ------------------------------
+// Deflate (RFC 1951)
+// ------------------------------
+static constexpr int WINDOW_SIZE = 32768;
+static constexpr int MIN_MATCH   = 4;  // hashing 4 bytes, a 3 byte match is rarely worth it on pixels
+static constexpr int MAX_MATCH   = 258;
+static constexpr int NUM_LITLEN  = 286;
+static constexpr int NUM_DIST    = 30;
+
+// clang-format off
+static constexpr uint16_t LEN_BASE[29]   = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                             35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static constexpr uint8_t  LEN_EXTRA[29]  = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                             3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static constexpr uint16_t DIST_BASE[30]  = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385,
+                                             513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static constexpr uint8_t  DIST_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7,
+                                             8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+static constexpr uint8_t  CLEN_ORDER[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+// clang-format on
+
+struct code_tables_t
+{
+    std::array<uint8_t, MAX_MATCH + 1> len_code;   // match length -> index in LEN_BASE
+    std::array<uint8_t, 512>           dist_code;  // see dist_code()
+};
+
+static const code_tables_t CODE_TABLES = [] {
+    code_tables_t t{};
+    for (int c = 0; c < 29; ++c)
+        for (int l = LEN_BASE[c]; l < LEN_BASE[c] + (1 << LEN_EXTRA[c]) && l <= MAX_MATCH; ++l)
+            t.len_code[l] = uint8_t(c);
+    t.len_code[MAX_MATCH] = 28;
+
+    // [0, 256): distance-1 for short distances, [256, 512): (distance-1) >> 7 for the rest
+    for (int c = 0; c < NUM_DIST; ++c)
+    {
+        for (int d = DIST_BASE[c]; d < DIST_BASE[c] + (1 << DIST_EXTRA[c]); ++d)
+        {
+            if (d <= 256)
+                t.dist_code[d - 1] = uint8_t(c);
+            else
+                t.dist_code[256 + ((d - 1) >> 7)] = uint8_t(c);
+        }
+    }
+    return t;
+}();
+
+static int dist_code(int dist)
+{
+    return dist <= 256 ? CODE_TABLES.dist_code[dist - 1] : CODE_TABLES.dist_code[256 + ((dist - 1) >> 7)];
+}
+
+// Length-limited Huffman code lengths for `freq`.
+// Builds the optimal tree, then pushes lengths over `max_len` back in
+// (same approach as miniz/zlib) and gives the shortest codes to the most frequent symbols.
+void huffman_lengths(const uint32_t* freq, int n, int max_len, uint8_t* lens)
+{
+    std::fill(lens, lens + n, 0);
+
+    std::vector<std::pair<uint32_t, int>> syms;  // (freq, symbol)
+    for (int i = 0; i < n; ++i)
+        if (freq[i])
+            syms.emplace_back(freq[i], i);
+
+    // A code needs at least two symbols to be complete
+    for (int i = 0; syms.size() < 2 && i < n; ++i)
+        if (!freq[i])
+            syms.emplace_back(1, i);
+
+    std::sort(syms.begin(), syms.end());
+    const size_t m = syms.size();
+
+    // Two-queue Huffman: leaves are sorted, internal nodes are created in non-decreasing order
+    std::vector<uint64_t> weight(2 * m - 1);
+    std::vector<uint32_t> parent(2 * m - 1);
+    for (size_t i = 0; i < m; ++i)
+        weight[i] = syms[i].first;
+
+    size_t leaf = 0, node = m;
+    for (size_t next = m; next < 2 * m - 1; ++next)
+    {
+        size_t pick[2];
+        for (size_t& p : pick)
+            p = (leaf < m && (node >= next || weight[leaf] <= weight[node])) ? leaf++ : node++;
+        weight[next]    = weight[pick[0]] + weight[pick[1]];
+        parent[pick[0]] = parent[pick[1]] = uint32_t(next);
+    }
+
+    std::vector<int> depth(2 * m - 1, 0);
+    std::array<int, 33> bl_count{};
+    for (size_t i = 2 * m - 1; i-- > 0;)
+        if (i != 2 * m - 2)
+            depth[i] = depth[parent[i]] + 1;
+    for (size_t i = 0; i < m; ++i)
+        ++bl_count[std::min(depth[i], 32)];
+
+    // Limit to max_len while keeping the code complete (Kraft sum == 1)
+    for (int i = max_len + 1; i <= 32; ++i)
+    {
+        bl_count[max_len] += bl_count[i];
+        bl_count[i] = 0;
+    }
+    uint32_t total = 0;
+    for (int i = max_len; i > 0; --i)
+        total += uint32_t(bl_count[i]) << (max_len - i);
+    while (total != (1u << max_len))
+    {
+        --bl_count[max_len];
+        for (int i = max_len - 1; i > 0; --i)
+        {
+            if (bl_count[i])
+            {
+                --bl_count[i];
+                bl_count[i + 1] += 2;
+                break;
+            }
+        }
+        --total;
+    }
+
+    // Least frequent symbols (front of `syms`) get the longest codes
+    size_t s = 0;
+    for (int len = max_len; len > 0; --len)
+        for (int k = 0; k < bl_count[len]; ++k)
+            lens[syms[s++].second] = uint8_t(len);
+}
+
+// Canonical codes, bit-reversed since deflate writes Huffman codes MSB first into an LSB-first stream
+void huffman_codes(const uint8_t* lens, int n, uint16_t* codes)
+{
+    std::array<uint16_t, 16> bl_count{}, next{};
+    for (int i = 0; i < n; ++i)
+        ++bl_count[lens[i]];
+    bl_count[0] = 0;
+
+    uint16_t code = 0;
+    for (int len = 1; len < 16; ++len)
+    {
+        code      = uint16_t((code + bl_count[len - 1]) << 1);
+        next[len] = code;
+    }
+
+    for (int i = 0; i < n; ++i)
+    {
+        if (!lens[i])
+            continue;
+        uint16_t c = next[lens[i]]++, r = 0;
+        for (int b = 0; b < lens[i]; ++b, c >>= 1)
+            r = uint16_t((r << 1) | (c & 1));
+        codes[i] = r;
+    }
+}
+
+// Hash-chain LZ77 + per-block dynamic/fixed/stored Huffman coding
+class Deflater
+{
+public:
+    explicit Deflater(int level)
+    {
+        // clang-format off
+        struct params_t { int max_chain, nice_len; bool lazy, insert_all; };
+        static constexpr params_t PARAMS[PNG_LEVEL_MAX + 1] = {
+            { 1,    32,  false, false },  // unused
+            { 1,    32,  false, false },
+            { 2,    64,  false, false },
+            { 4,    128, false, true  },
+            { 8,    128, true,  true  },
+            { 16,   258, true,  true  },
+            { 32,   258, true,  true  },
+            { 128,  258, true,  true  },
+            { 512,  258, true,  true  },
+            { 2048, 258, true,  true  },
+        };
+        // clang-format on
+        const params_t& p = PARAMS[std::clamp(level, PNG_LEVEL_MIN, PNG_LEVEL_MAX)];
+        m_max_chain       = p.max_chain;
+        m_nice_len        = p.nice_len;
+        m_lazy            = p.lazy;
+        m_insert_all      = p.insert_all;
+    }
+
+    // Compress data[start, end) as one or more blocks. Matches may reach back into the
+    // 32K before `start` (pigz-style priming), so bands compressed separately still find them.
+    // Unless `final`, the output ends byte-aligned with an empty stored block (sync flush),
+    // so the next band's output can be appended as-is.
+    // `on_block` runs after every block, the bytes written so far may be taken out of `bw`'s buffer then.
+    void Compress(const uint8_t*                data,
+                  size_t                        start,
+                  size_t                        end,
+                  bool                          final,
+                  BitWriter&                    bw,
+                  const std::function<void()>& on_block = nullptr)
+    {
+        m_head.assign(size_t(1) << HASH_BITS, -1);
+        m_prev.assign(WINDOW_SIZE, -1);
+        m_syms.clear();
+        m_syms.reserve(BLOCK_SYMS);
+        m_lit_bits.fill(8);
+        m_dist_bits.fill(5);
+        m_avg_lit_bits = 8 * 16;
+
+        for (size_t p = start - std::min<size_t>(start, WINDOW_SIZE); p + MIN_MATCH <= start; ++p)
+            Insert(data, p);
+
+        const size_t n           = end;
+        size_t       block_start = start;
+        size_t       pos         = start;
+        auto         flush       = [&](bool last) {
+            WriteBlock(data + block_start, pos - block_start, last, bw);
+            m_syms.clear();
+            block_start = pos;
+            if (on_block)
+                on_block();
+        };
+
+        while (pos < n)
+        {
+            int len = 0, dist = 0;
+            if (pos + MIN_MATCH <= n)
+            {
+                FindMatch(data, n, pos, len, dist);
+                Insert(data, pos);
+
+                if (m_lazy && len >= MIN_MATCH && len < m_nice_len && pos + 1 + MIN_MATCH <= n)
+                {
+                    int len2 = 0, dist2 = 0;
+                    FindMatch(data, n, pos + 1, len2, dist2);
+                    if (MatchGain(len2, dist2) > MatchGain(len, dist))
+                    {
+                        m_syms.push_back({ data[pos], 0 });
+                        ++pos;
+                        len  = len2;
+                        dist = dist2;
+                        Insert(data, pos);
+                    }
+                }
+            }
+
+            if (len >= MIN_MATCH)
+            {
+                m_syms.push_back({ uint16_t(len), uint16_t(dist) });
+                const size_t match_end = pos + size_t(len);
+                if (m_insert_all)
+                    for (++pos; pos < match_end && pos + MIN_MATCH <= n; ++pos)
+                        Insert(data, pos);
+                pos = match_end;
+            }
+            else
+            {
+                m_syms.push_back({ data[pos], 0 });
+                ++pos;
+            }
+
+            if (m_syms.size() >= BLOCK_SYMS)
+                flush(false);
+        }
+
+        // An empty final block is fine (just the end-of-block code), deflate needs one
+        if (!m_syms.empty() || final)
+            flush(final);
+
+        if (!final)
+        {
+            // Sync flush: empty stored block
+            bw.Put(0, 3);
+            bw.AlignToByte();
+            bw.Put(0x0000, 16);
+            bw.Put(0xFFFF, 16);
+        }
+    }
+
+private:
+    struct sym_t
+    {
+        uint16_t litlen;  // literal byte if dist == 0, else match length
+        uint16_t dist;
+    };
+
+    static constexpr int    HASH_BITS  = 16;
+    static constexpr size_t BLOCK_SYMS = 1 << 16;
+
+    static uint32_t Load32(const uint8_t* p)
+    {
+        uint32_t v;
+        std::memcpy(&v, p, 4);
+        return v;
+    }
+
+    // Length of the common prefix of `a` and `b`, knowing the first `start` bytes match
+    static int match_length(const uint8_t* a, const uint8_t* b, int start, int max_len)
+    {
+        int len = start;
+        while (len + 8 <= max_len)
+        {
+            uint64_t x, y;
+            std::memcpy(&x, a + len, 8);
+            std::memcpy(&y, b + len, 8);
+            if (x != y)
+            {
+                if constexpr (std::endian::native == std::endian::little)
+                    return len + std::countr_zero(x ^ y) / 8;
+                else
+                    return len + std::countl_zero(x ^ y) / 8;
+            }
+            len += 8;
+        }
+        while (len < max_len && a[len] == b[len])
+            ++len;
+        return len;
+    }
+
+    // Bits (x16) a match saves over literals, as coded in the last block. The longest match isn't always
+    // the best one: deeper searches find longer ones further back, whose distance codes can cost more
+    // than the extra bytes save, which made higher levels come out larger.
+    int MatchGain(int len, int dist) const
+    {
+        if (len < MIN_MATCH)
+            return 0;
+        const int lc = CODE_TABLES.len_code[len];
+        const int dc = dist_code(dist);
+        return len * m_avg_lit_bits -
+               16 * (m_lit_bits[257 + lc] + LEN_EXTRA[lc] + m_dist_bits[dc] + DIST_EXTRA[dc]);
+    }
+
+    static uint32_t Hash(const uint8_t* p) { return (Load32(p) * 2654435761u) >> (32 - HASH_BITS); }
+
+    void Insert(const uint8_t* data, size_t pos)
+    {
+        const uint32_t h                = Hash(data + pos);
+        m_prev[pos & (WINDOW_SIZE - 1)] = m_head[h];
+        m_head[h]                       = int32_t(pos);
+    }
+
+    void FindMatch(const uint8_t* data, size_t n, size_t pos, int& best_len, int& best_dist) const
+    {
+        best_len  = 0;
+        best_dist = 0;
+
+        const int      max_len = int(std::min<size_t>(MAX_MATCH, n - pos));
+        const uint8_t* cur     = data + pos;
+        int32_t        cand    = m_head[Hash(cur)];
+        for (int chain = m_max_chain; cand >= 0 && chain > 0; --chain)
+        {
+            const size_t dist = pos - size_t(cand);
+            if (dist > WINDOW_SIZE)
+                break;
+
+            const uint8_t* ref = data + cand;
+            if (best_len < max_len && ref[best_len] == cur[best_len] && Load32(ref) == Load32(cur))
+            {
+                const int len = match_length(ref, cur, MIN_MATCH, max_len);
+                if (len > best_len && MatchGain(len, int(dist)) > MatchGain(best_len, best_dist))
+                {
+                    best_len  = len;
+                    best_dist = int(dist);
+                    if (len >= m_nice_len)
+                        break;
+                }
+            }
+
+            const int32_t next = m_prev[size_t(cand) & (WINDOW_SIZE - 1)];
+            if (next >= cand)
+                break;  // slot reused by a newer position, the chain is over
+            cand = next;
+        }
+    }
+
+    void WriteBlock(const uint8_t* raw, size_t raw_len, bool last, BitWriter& bw)
+    {
+        std::array<uint32_t, NUM_LITLEN> lit_freq{};
+        std::array<uint32_t, NUM_DIST>   dist_freq{};
+        for (const sym_t& s : m_syms)
+        {
+            if (s.dist == 0)
+            {
+                ++lit_freq[s.litlen];
+            }
+            else
+            {
+                ++lit_freq[257 + CODE_TABLES.len_code[s.litlen]];
+                ++dist_freq[dist_code(s.dist)];
+            }
+        }
+        lit_freq[256] = 1;  // end of block
+
+        // Dynamic codes
+        // 288 entries: the fixed code also assigns 286/287, which shifts the canonical codes after them
+        std::array<uint8_t, 288>      lit_len{};
+        std::array<uint8_t, NUM_DIST> dist_len{};
+        huffman_lengths(lit_freq.data(), NUM_LITLEN, 15, lit_len.data());
+        huffman_lengths(dist_freq.data(), NUM_DIST, 15, dist_len.data());
+
+        int hlit = NUM_LITLEN, hdist = NUM_DIST;
+        while (hlit > 257 && lit_len[hlit - 1] == 0)
+            --hlit;
+        while (hdist > 1 && dist_len[hdist - 1] == 0)
+            --hdist;
+
+        // Code lengths, run-length coded with 16 (repeat previous), 17/18 (zeros)
+        std::vector<uint8_t> all(lit_len.begin(), lit_len.begin() + hlit);
+        all.insert(all.end(), dist_len.begin(), dist_len.begin() + hdist);
+
+        std::vector<std::pair<uint8_t, uint8_t>> rle;  // (symbol, extra value)
+        std::array<uint32_t, 19>                 clen_freq{};
+        for (size_t i = 0; i < all.size();)
+        {
+            size_t run = 1;
+            while (i + run < all.size() && all[i + run] == all[i])
+                ++run;
+
+            if (all[i] == 0 && run >= 3)
+            {
+                run = std::min<size_t>(run, 138);
+                rle.emplace_back(run >= 11 ? 18 : 17, uint8_t(run >= 11 ? run - 11 : run - 3));
+            }
+            else if (all[i] != 0 && run >= 4)
+            {
+                rle.emplace_back(all[i], 0);
+                run = std::min<size_t>(run - 1, 6);
+                rle.emplace_back(16, uint8_t(run - 3));
+                ++run;  // the first one was written as-is
+            }
+            else
+            {
+                run = 1;
+                rle.emplace_back(all[i], 0);
+            }
+            i += run;
+        }
+        for (const auto& [sym, extra] : rle)
+            ++clen_freq[sym];
+
+        std::array<uint8_t, 19> clen_len{};
+        huffman_lengths(clen_freq.data(), 19, 7, clen_len.data());
+        int hclen = 19;
+        while (hclen > 4 && clen_len[CLEN_ORDER[hclen - 1]] == 0)
+            --hclen;
+
+        // Pick the cheapest of dynamic, fixed and stored
+        uint64_t extra_bits = 0, dyn_bits = 0, fixed_bits = 0;
+        for (int i = 0; i < NUM_LITLEN; ++i)
+        {
+            dyn_bits += uint64_t(lit_freq[i]) * lit_len[i];
+            fixed_bits += uint64_t(lit_freq[i]) * (i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8);
+            if (i >= 257)
+                extra_bits += uint64_t(lit_freq[i]) * LEN_EXTRA[i - 257];
+        }
+        for (int i = 0; i < NUM_DIST; ++i)
+        {
+            dyn_bits += uint64_t(dist_freq[i]) * dist_len[i];
+            fixed_bits += uint64_t(dist_freq[i]) * 5;
+            extra_bits += uint64_t(dist_freq[i]) * DIST_EXTRA[i];
+        }
+        dyn_bits += 3 + 14 + 3 * uint64_t(hclen) + extra_bits;
+        for (const auto& [sym, extra] : rle)
+            dyn_bits += clen_len[sym] + (sym == 16 ? 2 : sym == 17 ? 3 : sym == 18 ? 7 : 0);
+        fixed_bits += 3 + extra_bits;
+        const uint64_t stored_bits = (raw_len / 65535 + 1) * 40 + uint64_t(raw_len) * 8 + 7;
+
+        if (stored_bits < dyn_bits && stored_bits < fixed_bits)
+        {
+            WriteStored(raw, raw_len, last, bw);
+            return;
+        }
+
+        std::array<uint16_t, 288>      lit_codes{};
+        std::array<uint16_t, NUM_DIST> dist_codes{};
+        if (fixed_bits <= dyn_bits)
+        {
+            bw.Put(last ? 1 : 0, 1);
+            bw.Put(1, 2);
+            for (int i = 0; i < 288; ++i)
+                lit_len[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+            dist_len.fill(5);
+        }
+        else
+        {
+            std::array<uint16_t, 19> clen_codes{};
+            huffman_codes(clen_len.data(), 19, clen_codes.data());
+
+            bw.Put(last ? 1 : 0, 1);
+            bw.Put(2, 2);
+            bw.Put(uint32_t(hlit - 257), 5);
+            bw.Put(uint32_t(hdist - 1), 5);
+            bw.Put(uint32_t(hclen - 4), 4);
+            for (int i = 0; i < hclen; ++i)
+                bw.Put(clen_len[CLEN_ORDER[i]], 3);
+            for (const auto& [sym, extra] : rle)
+            {
+                bw.Put(clen_codes[sym], clen_len[sym]);
+                if (sym == 16)
+                    bw.Put(extra, 2);
+                else if (sym == 17)
+                    bw.Put(extra, 3);
+                else if (sym == 18)
+                    bw.Put(extra, 7);
+            }
+        }
+        huffman_codes(lit_len.data(), 288, lit_codes.data());
+        huffman_codes(dist_len.data(), NUM_DIST, dist_codes.data());
+
+        // What the next block's matches are weighed with, symbols this one didn't use taken as rare
+        uint64_t lit_count = 0, lit_bits = 0;
+        for (int i = 0; i < NUM_LITLEN; ++i)
+        {
+            m_lit_bits[i] = lit_len[i] ? lit_len[i] : 15;
+            if (i < 256)
+            {
+                lit_count += lit_freq[i];
+                lit_bits += uint64_t(lit_freq[i]) * m_lit_bits[i];
+            }
+        }
+        for (int i = 0; i < NUM_DIST; ++i)
+            m_dist_bits[i] = dist_len[i] ? dist_len[i] : 15;
+        if (lit_count)
+            m_avg_lit_bits = int(lit_bits * 16 / lit_count);
+
+        for (const sym_t& s : m_syms)
+        {
+            if (s.dist == 0)
+            {
+                bw.Put(lit_codes[s.litlen], lit_len[s.litlen]);
+                continue;
+            }
+
+            const int lc = CODE_TABLES.len_code[s.litlen];
+            bw.Put(lit_codes[257 + lc], lit_len[257 + lc]);
+            if (LEN_EXTRA[lc])
+                bw.Put(s.litlen - LEN_BASE[lc], LEN_EXTRA[lc]);
+
+            const int dc = dist_code(s.dist);
+            bw.Put(dist_codes[dc], dist_len[dc]);
+            if (DIST_EXTRA[dc])
+                bw.Put(s.dist - DIST_BASE[dc], DIST_EXTRA[dc]);
+        }
+        bw.Put(lit_codes[256], lit_len[256]);
+    }
+
+    static void WriteStored(const uint8_t* raw, size_t raw_len, bool last, BitWriter& bw)
+    {
+        do
+        {
+            const size_t chunk = std::min<size_t>(raw_len, 65535);
+            raw_len -= chunk;
+
+            bw.Put((last && raw_len == 0) ? 1 : 0, 1);
+            bw.Put(0, 2);
+            bw.AlignToByte();
+            bw.Put(uint32_t(chunk), 16);
+            bw.Put(uint32_t(~chunk & 0xFFFF), 16);
+            for (size_t i = 0; i < chunk; ++i)
+                bw.Put(raw[i], 8);
+            raw += chunk;
+        } while (raw_len > 0);
+    }
+
+    int  m_max_chain;
+    int  m_nice_len;
+    bool m_lazy;
+    bool m_insert_all;
+
+    // Code lengths of the last block, and its average bits (x16) per literal
+    std::array<uint8_t, NUM_LITLEN> m_lit_bits;
+    std::array<uint8_t, NUM_DIST>   m_dist_bits;
+    int                             m_avg_lit_bits;
+
+    std::vector<int32_t> m_head;
+    std::vector<int32_t> m_prev;
+    std::vector<sym_t>   m_syms;
+};
+
+// ------------------------------
+// PNG
+// ------------------------------
+// Compressed data is written out in IDAT chunks of about this size while the serial encoder is still running
+static constexpr size_t IDAT_CHUNK_BYTES = 256 * 1024;
+
+// Levels above this one also deflate each band at every level down to it and keep the smallest output.
+// A deeper search usually pays off, but not always (a longer match further back can cost more to code than
+// it saves), and without this a higher level could come out larger. Costs up to about 2x the time at level 9.
+static constexpr int PNG_LEVEL_FALLBACK = 4;
+
+static uint8_t paeth(int a, int b, int c)
+{
+    // Same as the spec's p = a + b - c and distances to it, written to be branchless
+    const int pa = std::abs(b - c), pb = std::abs(a - c), pc = std::abs(a + b - 2 * c);
+    const int ab = pa <= pb ? a : b;
+    return uint8_t(std::min(pa, pb) <= pc ? ab : c);
+}
+
+// Apply PNG filter `type` to `row` (with `prev` the unfiltered row above, zeros for the first row).
+// The first pixel has no left neighbour, the rest of the loops have no branches so they vectorize.
+static void filter_row(int type, const uint8_t* row, const uint8_t* prev, size_t len, int bpp, uint8_t* out)
+{
+    const size_t first = std::min(len, size_t(bpp));
+    switch (type)
+    {
+        case 0: std::memcpy(out, row, len); break;
+        case 1:
+            std::memcpy(out, row, first);
+            for (size_t i = first; i < len; ++i)
+                out[i] = uint8_t(row[i] - row[i - bpp]);
+            break;
+        case 2:
+            for (size_t i = 0; i < len; ++i)
+                out[i] = uint8_t(row[i] - prev[i]);
+            break;
+        case 3:
+            for (size_t i = 0; i < first; ++i)
+                out[i] = uint8_t(row[i] - prev[i] / 2);
+            for (size_t i = first; i < len; ++i)
+                out[i] = uint8_t(row[i] - ((row[i - bpp] + prev[i]) >> 1));
+            break;
+        case 4:
+            for (size_t i = 0; i < first; ++i)
+                out[i] = uint8_t(row[i] - prev[i]);
+            for (size_t i = first; i < len; ++i)
+                out[i] = uint8_t(row[i] - paeth(row[i - bpp], prev[i], prev[i - bpp]));
+            break;
+    }
+}
+
+static void put_be32(std::vector<uint8_t>& out, uint32_t v)
+{
+    out.push_back(uint8_t(v >> 24));
+    out.push_back(uint8_t(v >> 16));
+    out.push_back(uint8_t(v >> 8));
+    out.push_back(uint8_t(v));
+}
+
+static bool write_chunk(ImageSink& sink, const char type[4], const uint8_t* data, size_t len)
+{
+    uint8_t head[8];
+    for (int i = 0; i < 4; ++i)
+        head[i] = uint8_t(uint32_t(len) >> (24 - 8 * i));
+    std::memcpy(head + 4, type, 4);
+
+    const uint32_t crc = crc32(crc32(0, head + 4, 4), data, len);
+    const uint8_t  tail[4] = { uint8_t(crc >> 24), uint8_t(crc >> 16), uint8_t(crc >> 8), uint8_t(crc) };
+    return sink.Write(head, 8) && (len == 0 || sink.Write(data, len)) && sink.Write(tail, 4);
+}
+
+// Filter rows [y0, y1) of `cap` into `filtered`, each prefixed by its filter type.
+// Reads row y0 - 1 as the "previous" row, so bands can be filtered independently.
+static void filter_rows(const capture_result_t& cap, bool opaque, int level, int y0, int y1, uint8_t* filtered)
+{
+    const int    bpp     = opaque ? 3 : 4;
+    const size_t row_len = size_t(cap.w) * bpp;
+
+    auto load_row = [&](int y, uint8_t* row) {
+        const uint8_t* src = cap.data.data() + size_t(y) * cap.w * 4;
+        if (opaque)
+        {
+            for (int x = 0; x < cap.w; ++x)
+                std::memcpy(row + size_t(x) * 3, src + size_t(x) * 4, 3);
+        }
+        else
+        {
+            std::memcpy(row, src, row_len);
+        }
+    };
+
+    std::vector<uint8_t> row(row_len), prev(row_len, 0), trial(row_len);
+    if (y0 > 0)
+        load_row(y0 - 1, prev.data());
+
+    for (int y = y0; y < y1; ++y)
+    {
+        load_row(y, row.data());
+
+        uint8_t* out = filtered + size_t(y - y0) * (row_len + 1);
+        if (level < 4)
+        {
+            out[0] = 2;  // up, cheap and good enough on screen content
+            filter_row(2, row.data(), prev.data(), row_len, bpp, out + 1);
+        }
+        else
+        {
+            // Usual heuristic: the filter with the smallest sum of absolute (signed) values
+            uint64_t best_sum = UINT64_MAX;
+            for (int type = 0; type < 5; ++type)
+            {
+                filter_row(type, row.data(), prev.data(), row_len, bpp, trial.data());
+                uint64_t sum = 0;
+                for (size_t i = 0; i < row_len; ++i)
+                    sum += uint64_t(std::abs(int(int8_t(trial[i]))));
+                if (sum < best_sum)
+                {
+                    best_sum = sum;
+                    out[0]   = uint8_t(type);
+                    std::memcpy(out + 1, trial.data(), row_len);
+                }
+            }
+        }
+        std::swap(row, prev);
+    }
+}
+
+// Run fn(0) .. fn(n - 1), one per thread (the last one on the calling thread)
+template <typename F>
+static void run_bands(size_t n, F&& fn)
+{
+    std::vector<std::thread> threads;
+    threads.reserve(n - 1);
+    for (size_t i = 0; i + 1 < n; ++i)
+        threads.emplace_back(fn, i);
+    fn(n - 1);
+    for (std::thread& t : threads)
+        t.join();
+}
+
+Result<> encode_png_fast(const capture_result_t& cap, int level, unsigned jobs, ImageSink& sink)
+{
+    if (cap.w <= 0 || cap.h <= 0 || cap.data.size() < size_t(cap.w) * cap.h * 4)
+        return Err("Image size is empty");
+
+    level = std::clamp(level, PNG_LEVEL_MIN, PNG_LEVEL_MAX);
+
+    bool opaque = true;
+    for (size_t i = 3; i < cap.data.size() && opaque; i += 4)
+        opaque = cap.data[i] == 0xFF;
+
+    static constexpr uint8_t SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+    std::vector<uint8_t> ihdr;
+    put_be32(ihdr, uint32_t(cap.w));
+    put_be32(ihdr, uint32_t(cap.h));
+    ihdr.insert(ihdr.end(), { 8, uint8_t(opaque ? 2 : 6), 0, 0, 0 });  // 8 bit RGB/RGBA, no interlace
+    if (!sink.Write(SIGNATURE, 8) || !write_chunk(sink, "IHDR", ihdr.data(), ihdr.size()))
+        return Err("Failed to write image: {}", strerror(errno));
+
+    const int    bpp      = opaque ? 3 : 4;
+    const size_t line_len = size_t(cap.w) * bpp + 1;
+
+    // Split into bands of whole rows, each filtered and deflated on its own thread.
+    // Bands smaller than PNG_MIN_BAND_BYTES cost more in thread startup and lost matches than they save.
+    if (jobs == 0)
+        jobs = std::max(1u, std::thread::hardware_concurrency());
+    const size_t total  = line_len * cap.h;
+    const size_t nbands = std::clamp<size_t>(total / PNG_MIN_BAND_BYTES, 1, std::min<size_t>(jobs, cap.h));
+
+    std::vector<int> band_y(nbands + 1);
+    for (size_t i = 0; i <= nbands; ++i)
+        band_y[i] = int(size_t(cap.h) * i / nbands);
+
+    std::vector<uint8_t> filtered(total);
+    run_bands(nbands, [&](size_t i) {
+        filter_rows(cap, opaque, level, band_y[i], band_y[i + 1], filtered.data() + band_y[i] * line_len);
+    });
+
+    // Each band is deflated on its own, with the previous 32K as dictionary, and all but the last
+    // end on a sync flush, so the outputs concatenate into a single valid deflate stream (like pigz).
+    // The zlib header goes in front of the first band, the adler32 of everything after the last one.
+    std::vector<std::vector<uint8_t>> streams(nbands);
+    std::vector<uint32_t>             adlers(nbands);
+    auto compress_band = [&](size_t i, const std::function<void()>& on_block) {
+        const size_t start = band_y[i] * line_len;
+        const size_t end   = band_y[i + 1] * line_len;
+        const bool   last  = i + 1 == nbands;
+
+        auto deflate = [&](int band_level, std::vector<uint8_t>& out, const std::function<void()>& on_out_block) {
+            out.reserve(std::min<size_t>((end - start) / 4, IDAT_CHUNK_BYTES * 2));
+            if (i == 0)
+            {
+                out.push_back(0x78);
+                out.push_back(level <= 1 ? 0x01 : level <= 5 ? 0x5E : level <= 6 ? 0x9C : 0xDA);
+            }
+
+            BitWriter bw(out);
+            Deflater  deflater(band_level);
+            deflater.Compress(filtered.data(), start, end, last, bw, on_out_block);
+            bw.AlignToByte();
+        };
+
+        if (level <= PNG_LEVEL_FALLBACK)
+        {
+            deflate(level, streams[i], on_block);
+        }
+        else
+        {
+            // Not streamed: which output gets written is only known at the end
+            std::vector<uint8_t> trial;
+            deflate(PNG_LEVEL_FALLBACK, streams[i], nullptr);
+            for (int l = PNG_LEVEL_FALLBACK + 1; l <= level; ++l)
+            {
+                trial.clear();
+                deflate(l, trial, nullptr);
+                if (trial.size() < streams[i].size())
+                    streams[i].swap(trial);
+            }
+        }
+        adlers[i] = adler32(1, filtered.data() + start, end - start);
+    };
+
+    bool sink_ok    = true;
+    int  sink_errno = 0;
+    auto emit       = [&](std::vector<uint8_t>& out) {
+        if (sink_ok && !out.empty() && !write_chunk(sink, "IDAT", out.data(), out.size()))
+        {
+            sink_ok    = false;
+            sink_errno = errno;
+        }
+        out.clear();
+    };
+
+    uint32_t adler = 1;
+    if (nbands == 1)
+    {
+        // Serial: hand out IDAT chunks while deflating
+        compress_band(0, [&] {
+            if (streams[0].size() >= IDAT_CHUNK_BYTES)
+                emit(streams[0]);
+        });
+        adler = adlers[0];
+    }
+    else
+    {
+        // Bands finish in any order, but are written in order as soon as possible
+        std::mutex              mtx;
+        std::condition_variable cv;
+        std::vector<bool>       done(nbands, false);
+
+        std::vector<std::thread> threads;
+        threads.reserve(nbands);
+        for (size_t i = 0; i < nbands; ++i)
+            threads.emplace_back([&, i] {
+                compress_band(i, nullptr);
+                std::lock_guard lk(mtx);
+                done[i] = true;
+                cv.notify_one();
+            });
+
+        for (size_t i = 0; i < nbands; ++i)
+        {
+            {
+                std::unique_lock lk(mtx);
+                cv.wait(lk, [&] { return done[i]; });
+            }
+            adler = adler32_combine(adler, adlers[i], (band_y[i + 1] - band_y[i]) * line_len);
+            if (i + 1 < nbands)
+            {
+                emit(streams[i]);
+                std::vector<uint8_t>().swap(streams[i]);
+            }
+        }
+        for (std::thread& t : threads)
+            t.join();
+    }
+
+    std::vector<uint8_t>& tail = streams[nbands - 1];
+    put_be32(tail, adler);
+    emit(tail);
+    if (sink_ok && !write_chunk(sink, "IEND", nullptr, 0))
+    {
+        sink_ok    = false;
+        sink_errno = errno;
+    }
+
+    if (!sink_ok)
+        return Err("Failed to write image: {}", strerror(sink_errno));
+    return Ok();
+}
+
+std::vector<uint8_t> encode_png_fast(const capture_result_t& cap, int level, unsigned jobs)
+{
+    std::vector<uint8_t> out;
+    MemorySink           sink(out);
+    if (!encode_png_fast(cap, level, jobs, sink).ok())
+        return {};
+    return out;
+}
+
+// ------------------------------
+// Dispatch
+// ------------------------------
+Result<> encode_image(const capture_result_t& cap, ImageExt ext, const encode_options_t& opts, ImageSink& sink)
+{
+    if (ext == ImageExt::PNG && opts.png_backend == PngBackend::Fast)
+        return encode_png_fast(cap, opts.png_level, opts.png_jobs, sink);
+    if (ext == ImageExt::QOI)
+        return encode_qoi(cap, sink);
+    if (ext == ImageExt::WEBP)
+        return encode_webp_lossless(cap, sink);
+
+    if (cap.w <= 0 || cap.h <= 0)
+        return Err("Image size is empty");
+
+    // stb can't be stopped midway, after a failed write the rest is dropped
+    struct context_t
+    {
+        ImageSink& sink;
+        int        err = 0;
+    } ctx{ sink };
+
+    auto callback = [](void* context, void* data, int size) {
+        auto* c = static_cast<context_t*>(context);
+        if (c->err == 0 && !c->sink.Write(static_cast<const uint8_t*>(data), size_t(size)))
+            c->err = errno ? errno : EIO;
+    };
+
+    int ok = 0;
+    switch (ext)
+    {
+        case ImageExt::PNG:
+            ok = stbi_write_png_to_func(callback, &ctx, cap.w, cap.h, 4, cap.data.data(), cap.w * 4);
+            break;
+
+        case ImageExt::JPEG:
+            ok = stbi_write_jpg_to_func(callback, &ctx, cap.w, cap.h, 4, cap.data.data(), opts.jpeg_quality);
+            break;
+
+        case ImageExt::BMP: ok = stbi_write_bmp_to_func(callback, &ctx, cap.w, cap.h, 4, cap.data.data()); break;
+        case ImageExt::TGA: ok = stbi_write_tga_to_func(callback, &ctx, cap.w, cap.h, 4, cap.data.data()); break;
+
+        default: return Err("Unsupported image format");
+    }
+
+    if (ctx.err)
+        return Err("Failed to write image: {}", strerror(ctx.err));
+    if (!ok)
+        return Err("Failed to encode image");
+    return Ok();
+}
+
+std::vector<uint8_t> encode_image(const capture_result_t& cap, ImageExt ext, const encode_options_t& opts)
+{
+    std::vector<uint8_t> out;
+    if (ext != ImageExt::PNG || opts.png_backend != PngBackend::Fast)
+        out.reserve(size_t(std::max(cap.w, 0)) * std::max(cap.h, 0) * (ext == ImageExt::QOI ? 2 : 4));
+
+    MemorySink sink(out);
+    if (!encode_image(cap, ext, opts, sink).ok())
+        return {};
+    return out;
+}
+
+// ------------------------------
+// Size fitting
+// ------------------------------
+
+// Downscaling gives up past this many attempts or below this many pixels per side
+static constexpr int FIT_MAX_DOWNSCALES = 8;
+static constexpr int FIT_MIN_SIDE       = 16;
+
+static Result<capture_result_t> downscale_image(const capture_result_t& cap, float scale)
+{
+    capture_result_t out;
+    out.w = std::max(1, int(std::lround(cap.w * scale)));
+    out.h = std::max(1, int(std::lround(cap.h * scale)));
+    out.data.resize(size_t(out.w) * out.h * 4);
+    if (!stbir_resize_uint8_linear(cap.data.data(), cap.w, cap.h, 0, out.data.data(), out.w, out.h, 0, STBIR_RGBA))
+        return Err("Failed to resize image");
+    return Ok(std::move(out));
+}
+
+// Highest quality in [lo, hi] whose JPEG fits, or the smallest encode if none does
+static Result<fit_result_t> search_jpeg_quality(const capture_result_t& cap,
+                                                int                     lo,
+                                                int                     hi,
+                                                const encode_options_t& opts,
+                                                const fit_options_t&    fit,
+                                                unsigned                jobs)
+{
+    fit_result_t best;
+    fit_result_t smallest;
+    for (bool first = true; lo <= hi; first = false)
+    {
+        if (fit.canceled && fit.canceled())
+            return Err("Canceled");
+
+        // `jobs` qualities splitting [lo, hi] evenly (a plain binary search with one job),
+        // or all of them once there are that few left.
+        // The first round always tries `hi` too, often it fits already.
+        std::vector<int> qualities;
+        const int        span   = hi - lo + 1;
+        const unsigned   spread = first ? jobs - 1 : jobs;
+        if (span <= int(jobs))
+        {
+            for (int q = lo; q <= hi; ++q)
+                qualities.push_back(q);
+        }
+        else
+        {
+            for (unsigned i = 0; i < spread; ++i)
+                qualities.push_back(lo + int(int64_t(span) * (i + 1) / (spread + 1)));
+            if (first)
+                qualities.push_back(hi);
+            qualities.erase(std::unique(qualities.begin(), qualities.end()), qualities.end());
+        }
+
+        std::vector<std::vector<uint8_t>> outs(qualities.size());
+        run_bands(qualities.size(), [&](size_t i) {
+            encode_options_t o = opts;
+            o.jpeg_quality     = qualities[i];
+            outs[i]            = encode_image(cap, ImageExt::JPEG, o);
+        });
+
+        // Size grows with quality (close enough), so what's left to search is
+        // between the highest one that fit and the lowest one above it that didn't
+        int next_lo = lo, next_hi = hi;
+        for (size_t i = 0; i < qualities.size(); ++i)
+        {
+            if (outs[i].empty())
+                return Err("Failed to encode image");
+
+            if (outs[i].size() <= fit.max_bytes)
+            {
+                next_lo = qualities[i] + 1;
+                best    = { std::move(outs[i]), qualities[i], 1, true };
+            }
+            else
+            {
+                next_hi = std::min(next_hi, qualities[i] - 1);
+                if (smallest.data.empty() || outs[i].size() < smallest.data.size())
+                    smallest = { std::move(outs[i]), qualities[i], 1, false };
+            }
+        }
+        lo = next_lo;
+        hi = next_hi;
+    }
+
+    return Ok(best.fits ? std::move(best) : std::move(smallest));
+}
+
+Result<fit_result_t>
+encode_image_fit(const capture_result_t& cap, ImageExt ext, const encode_options_t& opts, const fit_options_t& fit)
+{
+    if (cap.w <= 0 || cap.h <= 0 || cap.data.size() < size_t(cap.w) * cap.h * 4)
+        return Err("Image size is empty");
+
+    const unsigned jobs  = fit.jobs ? fit.jobs : std::max(1u, std::thread::hardware_concurrency());
+    const int      max_q = std::clamp(opts.jpeg_quality, JPEG_QUALITY_MIN, JPEG_QUALITY_MAX);
+    const int      min_q = fit.downscale ? std::min(FIT_JPEG_QUALITY_FLOOR, max_q) : JPEG_QUALITY_MIN;
+
+    capture_result_t        scaled;
+    const capture_result_t* img   = &cap;
+    float                   scale = 1;
+    fit_result_t            smallest;
+    for (int attempt = 0;; ++attempt)
+    {
+        fit_result_t res;
+        if (ext == ImageExt::JPEG)
+        {
+            Result<fit_result_t> searched = search_jpeg_quality(*img, min_q, max_q, opts, fit, jobs);
+            TRY(searched);
+            res = std::move(searched.get());
+        }
+        else
+        {
+            if (fit.canceled && fit.canceled())
+                return Err("Canceled");
+            res.data = encode_image(*img, ext, opts);
+            if (res.data.empty())
+                return Err("Failed to encode image");
+            res.fits = res.data.size() <= fit.max_bytes;
+        }
+        res.scale = scale;
+
+        if (res.fits || !fit.downscale)
+            return Ok(std::move(res));
+
+        // Encoded size roughly follows the pixel count, aim a little under
+        const float ratio = std::sqrt(float(fit.max_bytes) / float(res.data.size())) * 0.95f;
+        if (smallest.data.empty() || res.data.size() < smallest.data.size())
+            smallest = std::move(res);
+
+        scale *= std::min(ratio, 0.9f);
+        if (attempt + 1 >= FIT_MAX_DOWNSCALES || cap.w * scale < FIT_MIN_SIDE || cap.h * scale < FIT_MIN_SIDE)
+            break;
+
+        // Always from the original, resizing a resize blurs twice
+        Result<capture_result_t> resized = downscale_image(cap, scale);
+        TRY(resized);
+        scaled = std::move(resized.get());
+        img    = &scaled;
+    }
+
+    return Ok(std::move(smallest));
+}
@@ -0,0 +1,298 @@
+/*
+ * Copyright 2026 Toni500
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ * disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ * following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ * products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "json.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "fmt/format.h"
+
+namespace
+{
+class JsonParser
+{
+public:
+    explicit JsonParser(std::string_view str) : m_str(str) {}
+
+    Result<json_value_t> Parse()
+    {
+        json_value_t ret;
+        TRY(ParseValue(ret, 0));
+        SkipWs();
+        if (m_pos != m_str.size())
+            return Err("unexpected '{}' at offset {}", m_str[m_pos], m_pos);
+        return Ok(std::move(ret));
+    }
+
+private:
+    static constexpr int MAX_DEPTH = 32;
+
+    std::string_view m_str;
+    size_t           m_pos = 0;
+
+    void SkipWs()
+    {
+        while (m_pos < m_str.size() && std::strchr(" \t\r\n", m_str[m_pos]) && m_str[m_pos] != '\0')
+            ++m_pos;
+    }
+
+    bool Consume(std::string_view lit)
+    {
+        if (m_str.substr(m_pos, lit.size()) != lit)
+            return false;
+        m_pos += lit.size();
+        return true;
+    }
+
+    Result<> ParseValue(json_value_t& out, int depth)
+    {
+        if (depth > MAX_DEPTH)
+            return Err("nested too deep");
+
+        SkipWs();
+        if (m_pos >= m_str.size())
+            return Err("unexpected end of input");
+
+        const char c = m_str[m_pos];
+        if (c == '{')
+            return ParseObject(out, depth);
+        if (c == '[')
+            return ParseArray(out, depth);
+        if (c == '"')
+        {
+            out.type = json_value_t::Type::String;
+            return ParseString(out.string);
+        }
+        if (Consume("true") || Consume("false"))
+        {
+            out.type    = json_value_t::Type::Bool;
+            out.boolean = (c == 't');
+            return Ok();
+        }
+        if (Consume("null"))
+        {
+            out.type = json_value_t::Type::Null;
+            return Ok();
+        }
+        return ParseNumber(out);
+    }
+
+    Result<> ParseObject(json_value_t& out, int depth)
+    {
+        out.type = json_value_t::Type::Object;
+        ++m_pos;  // {
+        SkipWs();
+        if (Consume("}"))
+            return Ok();
+
+        while (true)
+        {
+            SkipWs();
+            std::string key;
+            if (m_pos >= m_str.size() || m_str[m_pos] != '"')
+                return Err("expected a key at offset {}", m_pos);
+            TRY(ParseString(key));
+
+            SkipWs();
+            if (!Consume(":"))
+                return Err("expected ':' at offset {}", m_pos);
+
+            json_value_t value;
+            TRY(ParseValue(value, depth + 1));
+            out.object.emplace_back(std::move(key), std::move(value));
+
+            SkipWs();
+            if (Consume("}"))
+                return Ok();
+            if (!Consume(","))
+                return Err("expected ',' or '}}' at offset {}", m_pos);
+        }
+    }
+
+    Result<> ParseArray(json_value_t& out, int depth)
+    {
+        out.type = json_value_t::Type::Array;
+        ++m_pos;  // [
+        SkipWs();
+        if (Consume("]"))
+            return Ok();
+
+        while (true)
+        {
+            json_value_t value;
+            TRY(ParseValue(value, depth + 1));
+            out.array.push_back(std::move(value));
+
+            SkipWs();
+            if (Consume("]"))
+                return Ok();
+            if (!Consume(","))
+                return Err("expected ',' or ']' at offset {}", m_pos);
+        }
+    }
+
+    Result<> ParseNumber(json_value_t& out)
+    {
+        const size_t start = m_pos;
+        while (m_pos < m_str.size() && std::strchr("+-.eE0123456789", m_str[m_pos]) && m_str[m_pos] != '\0')
+            ++m_pos;
+
+        if (start == m_pos)
+            return Err("unexpected '{}' at offset {}", m_str[m_pos], m_pos);
+
+        const std::string num(m_str.substr(start, m_pos - start));
+        char*             end = nullptr;
+        out.type              = json_value_t::Type::Number;
+        out.number            = std::strtod(num.c_str(), &end);
+        if (end != num.c_str() + num.size())
+            return Err("invalid number '{}'", num);
+        return Ok();
+    }
+
+    Result<> ParseString(std::string& out)
+    {
+        ++m_pos;  // "
+        while (m_pos < m_str.size())
+        {
+            const char c = m_str[m_pos++];
+            if (c == '"')
+                return Ok();
+            if (c != '\\')
+            {
+                out += c;
+                continue;
+            }
+
+            if (m_pos >= m_str.size())
+                break;
+
+            switch (const char e = m_str[m_pos++])
+            {
+                case '"':
+                case '\\':
+                case '/': out += e; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u':
+                {
+                    uint32_t cp = 0;
+                    TRY(ParseHex4(cp));
+                    // UTF-16 surrogate pair
+                    if (cp >= 0xD800 && cp <= 0xDBFF && Consume("\\u"))
+                    {
+                        uint32_t lo = 0;
+                        TRY(ParseHex4(lo));
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                    }
+                    AppendUtf8(out, cp);
+                    break;
+                }
+                default: return Err("invalid escape '\\{}' at offset {}", e, m_pos - 1);
+            }
+        }
+        return Err("unterminated string");
+    }
+
+    Result<> ParseHex4(uint32_t& out)
+    {
+        if (m_pos + 4 > m_str.size())
+            return Err("truncated \\u escape");
+
+        for (int i = 0; i < 4; ++i)
+        {
+            const char c = m_str[m_pos++];
+            out <<= 4;
+            if (c >= '0' && c <= '9')
+                out |= uint32_t(c - '0');
+            else if (c >= 'a' && c <= 'f')
+                out |= uint32_t(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F')
+                out |= uint32_t(c - 'A' + 10);
+            else
+                return Err("invalid \\u escape at offset {}", m_pos - 1);
+        }
+        return Ok();
+    }
+
+    static void AppendUtf8(std::string& out, uint32_t cp)
+    {
+        if (cp < 0x80)
+        {
+            out += char(cp);
+        }
+        else if (cp < 0x800)
+        {
+            out += char(0xC0 | (cp >> 6));
+            out += char(0x80 | (cp & 0x3F));
+        }
+        else if (cp < 0x10000)
+        {
+            out += char(0xE0 | (cp >> 12));
+            out += char(0x80 | ((cp >> 6) & 0x3F));
+            out += char(0x80 | (cp & 0x3F));
+        }
+        else
+        {
+            out += char(0xF0 | (cp >> 18));
+            out += char(0x80 | ((cp >> 12) & 0x3F));
+            out += char(0x80 | ((cp >> 6) & 0x3F));
+            out += char(0x80 | (cp & 0x3F));
+        }
+    }
+};
+}  // namespace
+
+Result<json_value_t> json_parse(std::string_view str)
+{
+    return JsonParser(str).Parse();
+}
+
+std::string json_escape(std::string_view s)
+{
+    std::string out;
+    out.reserve(s.size() + 2);
+    for (const char c : s)
+    {
+        switch (c)
+        {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20)
+                    out += fmt::format("\\u{:04x}", c);
+                else
+                    out += c;
+        }
+    }
+    return out;
+}
@@ -24,6 +24,7 @@
  */
 
 #include <atomic>
+#include <charconv>
 #include <condition_variable>
 #include <csignal>
 #include <cstdio>
@@ -35,6 +36,7 @@
 #include <ios>
 #include <memory>
 #include <mutex>
+#include <string_view>
 #include <system_error>
 #include <thread>
 #include <utility>
@@ -55,7 +57,9 @@
 #include "fmt/compile.h"
 #include "fmt/format.h"
 #include "getopt_port/getopt.h"
+#include "headless.hpp"
 #include "nvdialog/nvdialog_error.h"
+#include "nvdialog/nvdialog_notification.h"
 #include "oshot_png.h"
 #include "screen_capture.hpp"
 #include "screenshot_tool.hpp"
@@ -67,6 +71,7 @@
 #include "tinyfiledialogs.h"
 #include "tray.hpp"
 #include "util.hpp"
+#include "watch.hpp"
 
 using namespace Tray;
 
@@ -142,12 +147,23 @@ static fs::path parse_config_path(int argc, char* argv[], const fs::path& config
     return configDir / "config.toml";
 }
 
+// Whether we're going to run without any GUI (e.g --ocr, --serve),
+// checked before parseargs() so we know to skip nvdialog.
+static bool is_headless(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; ++i)
+        if (std::strcmp(argv[i], "--ocr") == 0 || std::strncmp(argv[i], "--serve", 7) == 0 ||
+            std::strncmp(argv[i], "--watch", 7) == 0)
+            return true;
+    return false;
+}
+
 static bool parseargs(int argc, char* argv[], const fs::path& configFile)
 {
     int opt = 0;
     int option_index = 0;
     opterr = 1; // re-enable since before we disabled for "invalid option" error
-    const char *optstring = "-Vhtgd:C:f:O:";
+    const char *optstring = "-Vhtgd:C:f:O:j:";
     static const struct option opts[] = {
         {"version", no_argument,       0, 'V'},
         {"help",    no_argument,       0, 'h'},
@@ -157,10 +173,15 @@ static bool parseargs(int argc, char* argv[], const fs::path& configFile)
         {"config",  required_argument, 0, 'C'},
         {"source",  required_argument, 0, 'f'},
         {"override",required_argument, 0, 'O'},
+        {"jobs",    required_argument, 0, 'j'},
 
         {"instant-save", no_argument,       0, "instant-save"_fnv1a16},
         {"instant-copy", no_argument,       0, "instant-copy"_fnv1a16},
         {"gen-config",   optional_argument, 0, "gen-config"_fnv1a16},
+        {"ocr",          no_argument,       0, "ocr"_fnv1a16},
+        {"json",         no_argument,       0, "json"_fnv1a16},
+        {"serve",        optional_argument, 0, "serve"_fnv1a16},
+        {"watch",        optional_argument, 0, "watch"_fnv1a16},
 
         {0,0,0,0}
     };
@@ -191,11 +212,41 @@ static bool parseargs(int argc, char* argv[], const fs::path& configFile)
                 g_config->Runtime.only_launch_tray = true; break;
             case 'g':
                 g_config->Runtime.only_launch_gui = true; break;
+            case 'j':
+            {
+                const std::string_view arg = optarg;
+                int                    jobs = -1;
+                const auto [end, ec] = std::from_chars(arg.data(), arg.data() + arg.size(), jobs);
+                if (ec != std::errc() || end != arg.data() + arg.size() || jobs < 0)
+                    die("--jobs: expected a number of jobs, or 0 for one per CPU core, got '{}'", arg);
+                g_config->Runtime.jobs = jobs;
+                break;
+            }
+
+            // positional args (because of the leading '-' in optstring)
+            case 1:
+                g_config->Runtime.inputs.push_back(optarg); break;
 
             case "instant-save"_fnv1a16:
                 g_config->Runtime.instant_copy_save = SavingOp::File; break;
             case "instant-copy"_fnv1a16:
                 g_config->Runtime.instant_copy_save = SavingOp::Clipboard; break;
+            case "ocr"_fnv1a16:
+                g_config->Runtime.batch_ocr = true; break;
+            case "json"_fnv1a16:
+                g_config->Runtime.json_output = true; break;
+            case "serve"_fnv1a16:
+                g_config->Runtime.serve = true;
+                if (OPTIONAL_ARGUMENT_IS_PRESENT)
+                    g_config->Runtime.serve_socket = optarg;
+                break;
+            case "watch"_fnv1a16:
+                g_config->Runtime.watch = true;
+                if (OPTIONAL_ARGUMENT_IS_PRESENT)
+                    g_config->Runtime.watch_mode = optarg;
+                if (g_config->Runtime.watch_mode != "qr" && g_config->Runtime.watch_mode != "ocr")
+                    die("--watch: unknown mode '{}', expected \"qr\" or \"ocr\"", g_config->Runtime.watch_mode);
+                break;
 
             case "gen-config"_fnv1a16:
                 if (OPTIONAL_ARGUMENT_IS_PRESENT)
@@ -209,10 +260,97 @@ static bool parseargs(int argc, char* argv[], const fs::path& configFile)
         }
     }
 
+    if (!g_config->Runtime.inputs.empty() && !g_config->Runtime.batch_ocr)
+    {
+        fmt::println(stderr, "Unexpected argument '{}'", g_config->Runtime.inputs.front());
+        help(EXIT_FAILURE);
+    }
+
     return true;
 }
 
 // clang-format on
+static void tray_notify(const std::string& title, const std::string& body, bool warning = false)
+{
+    NvdNotification* notif =
+        nvd_notification_new(title.c_str(), body.c_str(), warning ? NVD_NOTIFICATION_WARNING : NVD_NOTIFICATION_SIMPLE);
+    if (!notif)
+        return;
+    nvd_send_notification(notif);
+    nvd_delete_notification(notif);
+}
+
+// Start/stop the tray "Watch QR codes" watcher, returns whether it's running now.
+// The watcher is created the first time it's turned on, so the tray alone doesn't load ZBar.
+static bool toggle_qr_watch(std::unique_ptr<BarcodeWatcher>& watcher)
+{
+    if (watcher && watcher->IsRunning())
+    {
+        watcher->Stop();
+        return false;
+    }
+
+    if (!watcher)
+    {
+        watcher = std::make_unique<BarcodeWatcher>([](const zbar_symbol_t& sym) {
+            spdlog::info("watch: found {} '{}'", sym.type, sym.data);
+            const bool copied = g_config->File.watch_copy && g_clipboard.CopyText(sym.data).ok();
+            tray_notify(fmt::format("{} found{}", sym.type, copied ? " and copied" : ""), sym.data);
+        });
+        if (const Result<>& res = watcher->Zbar().SetSymbologies(g_config->File.barcode_symbologies); !res.ok())
+            spdlog::warn("watch: {}", res.error_v());
+        watcher->Zbar().SetDensity(g_config->File.barcode_density);
+    }
+
+    const Result<watch_options_t>& opts = watch_options_from_config();
+    if (!opts.ok())
+    {
+        tray_notify("Watch QR codes", opts.error_v(), true);
+        return false;
+    }
+    if (const Result<>& res = watcher->Start(opts.get()); !res.ok())
+        tray_notify("Watch QR codes", res.error_v(), true);
+
+    return watcher->IsRunning();
+}
+
+// Same as toggle_qr_watch(), for the tray "Watch text" OCR watcher
+static bool toggle_text_watch(std::unique_ptr<OcrWatcher>& watcher)
+{
+    if (watcher && watcher->IsRunning())
+    {
+        watcher->Stop();
+        return false;
+    }
+
+    if (!watcher)
+    {
+        watcher = std::make_unique<OcrWatcher>([](const std::string& line) {
+            spdlog::info("watch: new line '{}'", line);
+            output_watch_line(line);
+        });
+        if (const Result<>& res =
+                watcher->Ocr().Configure(g_config->File.ocr_path.c_str(), g_config->File.ocr_model.c_str());
+            !res.ok())
+        {
+            tray_notify("Watch text", res.error_v(), true);
+            watcher.reset();
+            return false;
+        }
+    }
+
+    const Result<watch_options_t>& opts = watch_options_from_config();
+    if (!opts.ok())
+    {
+        tray_notify("Watch text", opts.error_v(), true);
+        return false;
+    }
+    if (const Result<>& res = watcher->Start(opts.get()); !res.ok())
+        tray_notify("Watch text", res.error_v(), true);
+
+    return watcher->IsRunning();
+}
+
 static std::mutex              mtx;
 static std::condition_variable cv;
 static std::atomic<bool>       quit{ false };
@@ -399,15 +537,24 @@ int main(int argc, char* argv[])
     });
 #endif
 
-    if (nvd_init() != 0)
+    // Headless modes print their results to stdout, keep it clean.
+    // Also there may be no display to show dialogs on.
+    const bool headless = is_headless(argc, argv);
+
+    if (!headless && nvd_init() != 0)
     {
         fprintf(
             stderr, "Failed to initialize nvdialog: %s\n", nvd_string_to_cstr(nvd_stringify_error(nvd_get_error())));
         return -67;
     }
 
-    auto           console = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
-    auto           imgui   = std::make_shared<spdlog::sinks::ringbuffer_sink_mt>(500);  // keep last 500 lines
+    spdlog::sink_ptr console;
+    if (headless)
+        console = std::make_shared<spdlog::sinks::stderr_color_sink_mt>();
+    else
+        console = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+
+    auto           imgui = std::make_shared<spdlog::sinks::ringbuffer_sink_mt>(500);  // keep last 500 lines
     spdlog::logger logger("oshot_logger", { console, file, imgui });
     spdlog::set_default_logger(std::make_shared<spdlog::logger>(logger));
 
@@ -433,6 +580,22 @@ int main(int argc, char* argv[])
 
     spdlog::set_level(spdlog::level::debug);
 
+    if (g_config->Runtime.batch_ocr)
+    {
+        console->set_level(spdlog::level::warn);
+        return run_batch_ocr();
+    }
+    if (g_config->Runtime.serve)
+    {
+        console->set_level(spdlog::level::info);
+        return run_server(g_config->Runtime.serve_socket);
+    }
+    if (g_config->Runtime.watch)
+    {
+        console->set_level(spdlog::level::info);
+        return run_watch(g_config->Runtime.watch_mode);
+    }
+
     logger.info("=== oshot starting ===");
     logger.info("Log file path: {}", file->filename());
     logger.flush();
@@ -508,11 +671,12 @@ int main(int argc, char* argv[])
                                       false,
                                       false,
                                       [&](TrayMenu*) {
-                                          const char* filter[] = { "*.png", "*.jpeg", "*.jpg", "*.bmp" };
+                                          const char* filter[] = { "*.png", "*.jpeg", "*.jpg",
+                                                                   "*.bmp", "*.qoi",  "*.webp" };
                                           const char* open_path =
                                               tinyfd_openFileDialog("Open Image",
                                                                     "",        // default path
-                                                                    4,         // number of filter patterns
+                                                                    6,         // number of filter patterns
                                                                     filter,    // file filters
                                                                     "Images",  // filter description
                                                                     false      // allow multiple selections
@@ -534,6 +698,28 @@ int main(int argc, char* argv[])
                                       },
                                       {} });
 
+    std::unique_ptr<BarcodeWatcher> qr_watcher;
+    tray.menu.push_back(new TrayMenu{ "Watch QR codes",
+                                      true,
+                                      false,
+                                      true,
+                                      [&](TrayMenu* item) {
+                                          item->isChecked = toggle_qr_watch(qr_watcher);
+                                          trayMaker.Update();
+                                      },
+                                      {} });
+
+    std::unique_ptr<OcrWatcher> text_watcher;
+    tray.menu.push_back(new TrayMenu{ "Watch text",
+                                      true,
+                                      false,
+                                      true,
+                                      [&](TrayMenu* item) {
+                                          item->isChecked = toggle_text_watch(text_watcher);
+                                          trayMaker.Update();
+                                      },
+                                      {} });
+
     tray.menu.push_back(new TrayMenu{ "Quit", true, false, false, [&](TrayMenu*) { exit_handler(0); }, {} });
 
     if (trayMaker.Initialize(&tray))
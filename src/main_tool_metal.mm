@@ -43,6 +43,7 @@
 
 #  undef fract1
 #  include "config.hpp"
+#  include "save_queue.hpp"
 #  include "screen_capture.hpp"
 #  include "screenshot_tool.hpp"
 #  include "tool_icons.h"
@@ -96,6 +97,7 @@ int run_main_tool()
         glfwSetWindowShouldClose(window, GLFW_TRUE);
     });
     g_ss_tool.SetOnComplete([&](SavingOp op, const capture_result_t& result, ImageExt ext) {
+        // Only asks for the path, g_save_queue encodes and writes after the window is closed
         MUST_OK(save_image(op, result, ext),
                 error("Failed to save as {}: {}", g_config->File.image_out_type.first, _r.error_v()));
 
@@ -230,6 +232,11 @@ int run_main_tool()
                              (__bridge void*)create_metal_texture(device, ICON_ARROW_RGBA, ICON_ARROW_W, ICON_ARROW_H));
     g_ss_tool.SetToolTexture(
         ToolType::Pencil, (__bridge void*)create_metal_texture(device, ICON_PENCIL_RGBA, ICON_PENCIL_W, ICON_PENCIL_H));
+    g_ss_tool.SetToolTexture(ToolType::Blur,
+                             (__bridge void*)create_metal_texture(device, ICON_BLUR_RGBA, ICON_BLUR_W, ICON_BLUR_H));
+    g_ss_tool.SetToolTexture(
+        ToolType::Pixelate,
+        (__bridge void*)create_metal_texture(device, ICON_PIXELATE_RGBA, ICON_PIXELATE_W, ICON_PIXELATE_H));
     g_ss_tool.SetToolTexture(ToolType::Text,
                              (__bridge void*)create_metal_texture(device, ICON_TEXT_RGBA, ICON_TEXT_W, ICON_TEXT_H));
 
@@ -290,6 +297,11 @@ int run_main_tool()
     glfwDestroyWindow(window);
     glfwTerminate();
 
+    // The overlay is gone already. Without the tray, the process ends right after this,
+    // so the last save has to finish first.
+    if (!g_is_systray)
+        g_save_queue.Wait();
+
     return EXIT_SUCCESS;
 }
 
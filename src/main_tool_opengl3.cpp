@@ -30,6 +30,7 @@
 #  include "imgui/imgui.h"
 #  include "imgui/imgui_impl_glfw.h"
 #  include "imgui/imgui_impl_opengl3.h"
+#  include "save_queue.hpp"
 #  include "screen_capture.hpp"
 #  include "screenshot_tool.hpp"
 #  include "util.hpp"
@@ -134,6 +135,7 @@ int run_main_tool()
         glfwSetWindowShouldClose(window, GLFW_TRUE);
     });
     g_ss_tool.SetOnComplete([&](SavingOp op, const capture_result_t& result, ImageExt ext) {
+        // Only asks for the path, g_save_queue encodes and writes after the window is closed
         MUST_OK(save_image(op, result, ext),
                 error("Failed to save as {}: {}", g_config->File.image_out_type.first, _r.error_v()));
 
@@ -282,6 +284,11 @@ int run_main_tool()
     if (!g_is_systray)
         glfwTerminate();
 
+    // The overlay is gone already. Without the tray, the process ends right after this,
+    // so the last save has to finish first.
+    if (!g_is_systray)
+        g_save_queue.Wait();
+
     return EXIT_SUCCESS;
 }
 #endif
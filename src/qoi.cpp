@@ -0,0 +1,270 @@
+/*
+ * Copyright 2026 Toni500
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ * disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ * following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ * products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+// QOI, the "Quite OK Image" format: https://qoiformat.org/qoi-specification.pdf
+// Byte-oriented, one pass, no entropy coding, which is why it's so fast.
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+
+#include "image_encoder.hpp"
+
+static constexpr uint8_t QOI_OP_INDEX = 0x00;  // 00xxxxxx
+static constexpr uint8_t QOI_OP_DIFF  = 0x40;  // 01xxxxxx
+static constexpr uint8_t QOI_OP_LUMA  = 0x80;  // 10xxxxxx
+static constexpr uint8_t QOI_OP_RUN   = 0xC0;  // 11xxxxxx
+static constexpr uint8_t QOI_OP_RGB   = 0xFE;
+static constexpr uint8_t QOI_OP_RGBA  = 0xFF;
+static constexpr uint8_t QOI_MASK_2   = 0xC0;
+
+static constexpr size_t  QOI_HEADER_SIZE = 14;
+static constexpr uint8_t QOI_END[8]      = { 0, 0, 0, 0, 0, 0, 0, 1 };
+
+// Output is flushed to the sink in pieces of this size
+static constexpr size_t QOI_FLUSH_BYTES = 64 * 1024;
+
+struct qoi_px_t
+{
+    uint8_t r, g, b, a;
+
+    bool operator==(const qoi_px_t&) const = default;
+};
+
+static int qoi_hash(const qoi_px_t& p)
+{
+    return (p.r * 3 + p.g * 5 + p.b * 7 + p.a * 11) % 64;
+}
+
+static void put_be32(uint8_t* p, uint32_t v)
+{
+    p[0] = uint8_t(v >> 24);
+    p[1] = uint8_t(v >> 16);
+    p[2] = uint8_t(v >> 8);
+    p[3] = uint8_t(v);
+}
+
+static uint32_t get_be32(const uint8_t* p)
+{
+    return uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 | p[3];
+}
+
+Result<> encode_qoi(const capture_result_t& cap, ImageSink& sink)
+{
+    if (cap.w <= 0 || cap.h <= 0 || cap.data.size() < size_t(cap.w) * cap.h * 4)
+        return Err("Image size is empty");
+
+    bool opaque = true;
+    for (size_t i = 3; i < cap.data.size() && opaque; i += 4)
+        opaque = cap.data[i] == 0xFF;
+
+    // Every op is at most 5 bytes, so only check for a flush once per pixel
+    std::vector<uint8_t> out(QOI_FLUSH_BYTES + 16);
+    size_t               n = 0;
+    auto                 flush = [&] {
+        const bool ok = sink.Write(out.data(), n);
+        n             = 0;
+        return ok;
+    };
+
+    std::memcpy(out.data(), "qoif", 4);
+    put_be32(out.data() + 4, uint32_t(cap.w));
+    put_be32(out.data() + 8, uint32_t(cap.h));
+    out[12] = opaque ? 3 : 4;
+    out[13] = 0;  // sRGB with linear alpha
+    n       = QOI_HEADER_SIZE;
+
+    std::array<qoi_px_t, 64> index{};
+    qoi_px_t                 prev{ 0, 0, 0, 255 };
+    int                      run = 0;
+
+    const size_t   npx = size_t(cap.w) * cap.h;
+    const uint8_t* src = cap.data.data();
+    for (size_t i = 0; i < npx; ++i)
+    {
+        const qoi_px_t px{ src[i * 4], src[i * 4 + 1], src[i * 4 + 2], src[i * 4 + 3] };
+        if (px == prev)
+        {
+            if (++run == 62 || i + 1 == npx)
+            {
+                out[n++] = uint8_t(QOI_OP_RUN | (run - 1));
+                run      = 0;
+            }
+            continue;
+        }
+
+        if (run > 0)
+        {
+            out[n++] = uint8_t(QOI_OP_RUN | (run - 1));
+            run      = 0;
+        }
+
+        const int h = qoi_hash(px);
+        if (index[h] == px)
+        {
+            out[n++] = uint8_t(QOI_OP_INDEX | h);
+        }
+        else
+        {
+            index[h] = px;
+            if (px.a == prev.a)
+            {
+                const int8_t vr   = int8_t(px.r - prev.r);
+                const int8_t vg   = int8_t(px.g - prev.g);
+                const int8_t vb   = int8_t(px.b - prev.b);
+                const int8_t vg_r = int8_t(vr - vg);
+                const int8_t vg_b = int8_t(vb - vg);
+
+                if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2)
+                {
+                    out[n++] = uint8_t(QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2));
+                }
+                else if (vg_r > -9 && vg_r < 8 && vg > -33 && vg < 32 && vg_b > -9 && vg_b < 8)
+                {
+                    out[n++] = uint8_t(QOI_OP_LUMA | (vg + 32));
+                    out[n++] = uint8_t((vg_r + 8) << 4 | (vg_b + 8));
+                }
+                else
+                {
+                    out[n++] = QOI_OP_RGB;
+                    out[n++] = px.r;
+                    out[n++] = px.g;
+                    out[n++] = px.b;
+                }
+            }
+            else
+            {
+                out[n++] = QOI_OP_RGBA;
+                out[n++] = px.r;
+                out[n++] = px.g;
+                out[n++] = px.b;
+                out[n++] = px.a;
+            }
+        }
+        prev = px;
+
+        if (n >= QOI_FLUSH_BYTES && !flush())
+            return Err("Failed to write image: {}", strerror(errno));
+    }
+
+    std::memcpy(out.data() + n, QOI_END, sizeof(QOI_END));
+    n += sizeof(QOI_END);
+    if (!flush())
+        return Err("Failed to write image: {}", strerror(errno));
+    return Ok();
+}
+
+Result<capture_result_t> decode_qoi(std::span<const uint8_t> data)
+{
+    if (data.size() < QOI_HEADER_SIZE + sizeof(QOI_END) || std::memcmp(data.data(), "qoif", 4) != 0)
+        return Err("Not a QOI image");
+
+    const uint32_t w        = get_be32(data.data() + 4);
+    const uint32_t h        = get_be32(data.data() + 8);
+    const uint8_t  channels = data[12];  // informative only, alpha is decoded either way
+    if (w == 0 || h == 0 || channels < 3 || channels > 4)
+        return Err("Bad QOI header");
+    // Each op decodes at most 62 pixels, anything larger than that is a lie
+    if (uint64_t(w) * h > uint64_t(data.size()) * 62)
+        return Err("Bad QOI header: {}x{} doesn't fit in {} bytes", w, h, data.size());
+
+    capture_result_t cap;
+    cap.w = int(w);
+    cap.h = int(h);
+    cap.data.resize(size_t(w) * h * 4);
+
+    std::array<qoi_px_t, 64> index{};
+    qoi_px_t                 px{ 0, 0, 0, 255 };
+    int                      run = 0;
+
+    const uint8_t* p   = data.data() + QOI_HEADER_SIZE;
+    const uint8_t* end = data.data() + data.size() - sizeof(QOI_END);
+    uint8_t*       dst = cap.data.data();
+    const size_t   npx = size_t(w) * h;
+    for (size_t i = 0; i < npx; ++i, dst += 4)
+    {
+        if (run > 0)
+        {
+            --run;
+        }
+        else if (p < end)
+        {
+            const uint8_t b1 = *p++;
+            if (b1 == QOI_OP_RGB)
+            {
+                if (end - p < 3)
+                    return Err("Truncated QOI data");
+                px.r = *p++;
+                px.g = *p++;
+                px.b = *p++;
+            }
+            else if (b1 == QOI_OP_RGBA)
+            {
+                if (end - p < 4)
+                    return Err("Truncated QOI data");
+                px.r = *p++;
+                px.g = *p++;
+                px.b = *p++;
+                px.a = *p++;
+            }
+            else if ((b1 & QOI_MASK_2) == QOI_OP_INDEX)
+            {
+                px = index[b1];
+            }
+            else if ((b1 & QOI_MASK_2) == QOI_OP_DIFF)
+            {
+                px.r += ((b1 >> 4) & 0x03) - 2;
+                px.g += ((b1 >> 2) & 0x03) - 2;
+                px.b += (b1 & 0x03) - 2;
+            }
+            else if ((b1 & QOI_MASK_2) == QOI_OP_LUMA)
+            {
+                if (p >= end)
+                    return Err("Truncated QOI data");
+                const uint8_t b2 = *p++;
+                const int     vg = (b1 & 0x3F) - 32;
+                px.r += vg - 8 + ((b2 >> 4) & 0x0F);
+                px.g += vg;
+                px.b += vg - 8 + (b2 & 0x0F);
+            }
+            else  // QOI_OP_RUN
+            {
+                run = b1 & 0x3F;
+            }
+            index[qoi_hash(px)] = px;
+        }
+        else
+        {
+            return Err("Truncated QOI data");
+        }
+
+        dst[0] = px.r;
+        dst[1] = px.g;
+        dst[2] = px.b;
+        dst[3] = px.a;
+    }
+
+    return Ok(std::move(cap));
+}
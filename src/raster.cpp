@@ -0,0 +1,423 @@
+/*
+ * Copyright 2026 Toni500
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ * disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ * following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ * products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "raster.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <tuple>
+#include <utility>
+
+// Rows rasterized at once, bounds the accumulation buffer to a strip of the shape
+static constexpr int BAND_ROWS = 16;
+
+void Rasterizer::SetClip(const region_t& clip)
+{
+    const int x0 = std::clamp(clip.x, 0, m_target.w);
+    const int y0 = std::clamp(clip.y, 0, m_target.h);
+    const int x1 = std::clamp(clip.x + clip.width, x0, m_target.w);
+    const int y1 = std::clamp(clip.y + clip.height, y0, m_target.h);
+    m_clip       = { x0, y0, x1 - x0, y1 - y0 };
+}
+
+region_t Rasterizer::GetBounds() const
+{
+    if (m_drawn_x1 <= m_drawn_x0 || m_drawn_y1 <= m_drawn_y0)
+        return {};
+    return { m_drawn_x0, m_drawn_y0, m_drawn_x1 - m_drawn_x0, m_drawn_y1 - m_drawn_y0 };
+}
+
+void Rasterizer::ResetBounds()
+{
+    m_drawn_x0 = m_target.w;
+    m_drawn_y0 = m_target.h;
+    m_drawn_x1 = m_drawn_y1 = 0;
+}
+
+void Rasterizer::BlendSpan(int x, int y, size_t n, rgba_t color, const uint8_t* cov)
+{
+    m_drawn_x0 = std::min(m_drawn_x0, x);
+    m_drawn_y0 = std::min(m_drawn_y0, y);
+    m_drawn_x1 = std::max(m_drawn_x1, x + int(n));
+    m_drawn_y1 = std::max(m_drawn_y1, y + 1);
+    blend_span(m_target.data.data() + (size_t(y) * m_target.w + size_t(x)) * 4, n, color, cov);
+}
+
+void Rasterizer::BlendSpan(int x, int y, size_t n, rgba_t color, uint8_t cov)
+{
+    if (cov == 0 || n == 0)
+        return;
+    m_drawn_x0 = std::min(m_drawn_x0, x);
+    m_drawn_y0 = std::min(m_drawn_y0, y);
+    m_drawn_x1 = std::max(m_drawn_x1, x + int(n));
+    m_drawn_y1 = std::max(m_drawn_y1, y + 1);
+    blend_span(m_target.data.data() + (size_t(y) * m_target.w + size_t(x)) * 4, n, color, cov);
+}
+
+void Rasterizer::BlendRow(int x, int y, const uint8_t* cov, int n, rgba_t color)
+{
+    if (y < m_clip.y || y >= m_clip.y + m_clip.height)
+        return;
+
+    const int from = std::max(x, m_clip.x);
+    const int to   = std::min(x + n, m_clip.x + m_clip.width);
+    if (from < to)
+        BlendSpan(from, y, size_t(to - from), color, cov + (from - x));
+}
+
+void Rasterizer::AddEdge(float x0, float y0, float x1, float y1)
+{
+    if (y0 == y1 || !std::isfinite(x0 + y0 + x1 + y1))
+        return;
+
+    if (!m_has_outline)
+    {
+        m_min_x = m_max_x = x0;
+        m_min_y = m_max_y = y0;
+        m_has_outline     = true;
+    }
+    m_min_x = std::min({ m_min_x, x0, x1 });
+    m_max_x = std::max({ m_max_x, x0, x1 });
+    m_min_y = std::min({ m_min_y, y0, y1 });
+    m_max_y = std::max({ m_max_y, y0, y1 });
+
+    // Still counted in the bounding box above, Fill() lays its rows out from it
+    if (std::max(y0, y1) <= float(m_clip.y) || std::min(y0, y1) >= float(m_clip.y + m_clip.height))
+        return;
+
+    if (y0 < y1)
+        m_edges.push_back({ x0, y0, x1, y1, 1.0f });
+    else
+        m_edges.push_back({ x1, y1, x0, y0, -1.0f });
+}
+
+void Rasterizer::AddPolygon(std::span<const point_t> pts, bool hole)
+{
+    if (pts.size() < 3)
+        return;
+
+    // Outlines one way, holes the other, so overlapping outlines add up and holes cancel them
+    float area = 0;
+    for (size_t i = 0, j = pts.size() - 1; i < pts.size(); j = i++)
+        area += pts[j].x * pts[i].y - pts[i].x * pts[j].y;
+    const bool reverse = (area < 0) != hole;
+
+    for (size_t i = 0, j = pts.size() - 1; i < pts.size(); j = i++)
+    {
+        if (reverse)
+            AddEdge(pts[i].x, pts[i].y, pts[j].x, pts[j].y);
+        else
+            AddEdge(pts[j].x, pts[j].y, pts[i].x, pts[i].y);
+    }
+}
+
+void Rasterizer::AddLine(point_t a, point_t b, float width)
+{
+    const float dx  = b.x - a.x;
+    const float dy  = b.y - a.y;
+    const float len = std::sqrt(dx * dx + dy * dy);
+    if (len < 1e-4f || width <= 0)
+        return;
+
+    const float   nx     = -dy / len * width * 0.5f;
+    const float   ny     = dx / len * width * 0.5f;
+    const point_t quad[] = {
+        { a.x + nx, a.y + ny }, { b.x + nx, b.y + ny }, { b.x - nx, b.y - ny }, { a.x - nx, a.y - ny }
+    };
+    AddPolygon(quad);
+}
+
+void Rasterizer::AddDisc(point_t center, float radius)
+{
+    if (radius <= 0)
+        return;
+
+    // Enough segments to stay within a quarter pixel of the real circle
+    const int n = std::clamp(
+        int(std::ceil(std::numbers::pi_v<float> / std::acos(std::max(-1.0f, 1.0f - 0.25f / radius)))), 8, 256);
+
+    std::vector<point_t> pts(static_cast<size_t>(n));
+    for (int i = 0; i < n; ++i)
+    {
+        const float angle = 2 * std::numbers::pi_v<float> * float(i) / float(n);
+        pts[size_t(i)]    = { center.x + radius * std::cos(angle), center.y + radius * std::sin(angle) };
+    }
+    AddPolygon(pts);
+}
+
+// Signed area of `e` in each pixel of the band rows it crosses, added to the cell it's in
+// and carried to the right by the prefix sum in Fill() (the accumulation scheme of font-rs).
+void Rasterizer::AccumulateEdge(const edge_t& e, int band_y0, int band_y1, int width)
+{
+    const float dxdy   = (e.x1 - e.x0) / (e.y1 - e.y0);
+    const int   y_from = std::max(band_y0, int(std::floor(e.y0)));
+    const int   y_to   = std::min(band_y1, int(std::ceil(e.y1)));
+    const float fw     = float(width);
+
+    for (int y = y_from; y < y_to; ++y)
+    {
+        const float top = std::max(float(y), e.y0);
+        const float bot = std::min(float(y + 1), e.y1);
+        if (bot <= top)
+            continue;
+
+        float*      row = m_acc.data() + size_t(y - band_y0) * size_t(width + 2);
+        const float d   = (bot - top) * e.dir;
+        const float xa  = std::clamp(e.x0 + (top - e.y0) * dxdy, 0.0f, fw);
+        const float xb  = std::clamp(e.x0 + (bot - e.y0) * dxdy, 0.0f, fw);
+        const float x0  = std::min(xa, xb);
+        const float x1  = std::max(xa, xb);
+
+        const float x0f = std::floor(x0);
+        const float x1c = std::ceil(x1);
+        const int   x0i = int(x0f);
+        const int   x1i = int(x1c);
+        if (x1i <= x0i + 1)
+        {
+            // Within one pixel: split at the mean x
+            const float xmf = 0.5f * (x0 + x1) - x0f;
+            row[x0i] += d - d * xmf;
+            row[x0i + 1] += d * xmf;
+            continue;
+        }
+
+        const float s   = 1.0f / (x1 - x0);
+        const float x0r = x0 - x0f;
+        const float a0  = 0.5f * s * (1 - x0r) * (1 - x0r);
+        const float x1r = x1 - x1c + 1;
+        const float am  = 0.5f * s * x1r * x1r;
+        row[x0i] += d * a0;
+        if (x1i == x0i + 2)
+        {
+            row[x0i + 1] += d * (1 - a0 - am);
+        }
+        else
+        {
+            const float a1 = s * (1.5f - x0r);
+            row[x0i + 1] += d * (a1 - a0);
+            for (int xi = x0i + 2; xi < x1i - 1; ++xi)
+                row[xi] += d * s;
+            const float a2 = a1 + float(x1i - x0i - 3) * s;
+            row[x1i - 1] += d * (1 - a2 - am);
+        }
+        row[x1i] += d * am;
+    }
+}
+
+void Rasterizer::Fill(rgba_t color)
+{
+    // Rows are laid out over the whole shape in the target, not just in the clip: the float sums
+    // then add up the same whichever part is drawn, and so do the coverages rounded from them
+    const int bx0 = std::max(0, int(std::floor(m_min_x)));
+    const int bx1 = std::min(m_target.w, int(std::ceil(m_max_x)));
+    const int by0 = std::max(m_clip.y, int(std::floor(m_min_y)));
+    const int by1 = std::min(m_clip.y + m_clip.height, int(std::ceil(m_max_y)));
+    const int cx0 = std::max(m_clip.x, bx0) - bx0;
+    const int cx1 = std::min(m_clip.x + m_clip.width, bx1) - bx0;
+    m_has_outline = false;
+    if (m_edges.empty() || color.a == 0 || cx0 >= cx1 || by0 >= by1)
+    {
+        m_edges.clear();
+        return;
+    }
+
+    // Into the bounding box's x. What's left of it still covers everything to its right,
+    // so it becomes a vertical edge on the border, what's right of it can't reach any pixel.
+    const int           width = bx1 - bx0;
+    const float         fw    = float(width);
+    std::vector<edge_t> edges;
+    edges.reserve(m_edges.size());
+    for (const edge_t& src : m_edges)
+    {
+        const float x0 = src.x0 - float(bx0);
+        const float x1 = src.x1 - float(bx0);
+        auto        x_at = [&](float y) { return x0 + (y - src.y0) / (src.y1 - src.y0) * (x1 - x0); };
+
+        // Split where it crosses x = 0 and x = width, each piece then lies on one side of them
+        float cuts[4] = { src.y0 };
+        int   n       = 1;
+        for (const float bound : { 0.0f, fw })
+        {
+            if ((x0 < bound) == (x1 < bound))
+                continue;
+            const float y = src.y0 + (bound - x0) / (x1 - x0) * (src.y1 - src.y0);
+            if (y > src.y0 && y < src.y1)
+                cuts[n++] = y;
+        }
+        if (n == 3 && cuts[2] < cuts[1])
+            std::swap(cuts[1], cuts[2]);
+        cuts[n] = src.y1;
+
+        for (int i = 0; i < n; ++i)
+        {
+            const float ya = cuts[i], yb = cuts[i + 1];
+            if (yb <= ya)
+                continue;
+
+            const float xa = x_at(ya), xb = x_at(yb);
+            const float mid = 0.5f * (xa + xb);
+            if (mid < 0)
+                edges.push_back({ 0, ya, 0, yb, src.dir });
+            else if (mid <= fw)
+                edges.push_back({ xa, ya, xb, yb, src.dir });
+        }
+    }
+    m_edges.clear();
+
+    // Stable, so each row sums its edges in the same order whatever the clip left out
+    std::stable_sort(edges.begin(), edges.end(), [](const edge_t& a, const edge_t& b) { return a.y0 < b.y0; });
+
+    const size_t stride = size_t(width) + 2;
+    m_acc.resize(stride * BAND_ROWS);
+    m_cov.resize(size_t(width));
+
+    // Edges crossing the current band, taken in from the sorted list as the bands go down
+    std::vector<edge_t> active;
+    size_t              next = 0;
+    for (int band_y0 = by0; band_y0 < by1; band_y0 += BAND_ROWS)
+    {
+        const int band_y1 = std::min(by1, band_y0 + BAND_ROWS);
+        std::fill(m_acc.begin(), m_acc.begin() + ptrdiff_t(stride) * (band_y1 - band_y0), 0.0f);
+
+        std::erase_if(active, [&](const edge_t& e) { return e.y1 <= float(band_y0); });
+        for (; next < edges.size() && edges[next].y0 < float(band_y1); ++next)
+            if (edges[next].y1 > float(band_y0))
+                active.push_back(edges[next]);
+
+        for (const edge_t& e : active)
+            AccumulateEdge(e, band_y0, band_y1, width);
+
+        for (int y = band_y0; y < band_y1; ++y)
+        {
+            const float* row   = m_acc.data() + size_t(y - band_y0) * stride;
+            float        acc   = 0;
+            int          first = width, last = -1;
+            for (int x = 0; x < cx1; ++x)
+            {
+                acc += row[x];
+                const uint8_t c = uint8_t(std::min(1.0f, std::fabs(acc)) * 255.0f + 0.5f);
+                m_cov[size_t(x)] = c;
+                if (c && x >= cx0)
+                {
+                    first = std::min(first, x);
+                    last  = x;
+                }
+            }
+            if (last < first)
+                continue;
+
+            BlendSpan(bx0 + first, y, size_t(last - first + 1), color, m_cov.data() + first);
+        }
+    }
+}
+
+void Rasterizer::FillRect(float x0, float y0, float x1, float y1, rgba_t color)
+{
+    const float cx0 = float(m_clip.x), cx1 = float(m_clip.x + m_clip.width);
+    const float cy0 = float(m_clip.y), cy1 = float(m_clip.y + m_clip.height);
+    std::tie(x0, x1) = std::minmax(x0, x1);
+    std::tie(y0, y1) = std::minmax(y0, y1);
+    x0               = std::clamp(x0, cx0, cx1);
+    x1               = std::clamp(x1, cx0, cx1);
+    y0               = std::clamp(y0, cy0, cy1);
+    y1               = std::clamp(y1, cy0, cy1);
+    if (x1 <= x0 || y1 <= y0 || color.a == 0)
+        return;
+
+    const int xl = int(std::floor(x0));
+    const int xr = int(std::ceil(x1));
+
+    for (int y = int(std::floor(y0)); y < int(std::ceil(y1)); ++y)
+    {
+        // Vertical share of this row, times the horizontal one of each end pixel
+        const float cy  = std::min(float(y + 1), y1) - std::max(float(y), y0);
+        auto        cov = [&](float c) { return uint8_t(c * cy * 255.0f + 0.5f); };
+
+        if (xr - xl == 1)
+        {
+            BlendSpan(xl, y, 1, color, cov(x1 - x0));
+            continue;
+        }
+
+        BlendSpan(xl, y, 1, color, cov(float(xl + 1) - x0));
+        BlendSpan(xl + 1, y, size_t(xr - xl - 2), color, cov(1.0f));
+        BlendSpan(xr - 1, y, 1, color, cov(x1 - float(xr - 1)));
+    }
+}
+
+void Rasterizer::FillRing(point_t center, float outer, float inner, rgba_t color)
+{
+    if (outer <= 0 || inner >= outer || color.a == 0)
+        return;
+
+    // Coverage ramps over one pixel across each circle, by distance from the pixel center.
+    // Pixels surely all in or all out get found by their squared distance alone.
+    const float full_out = outer > 0.5f ? (outer - 0.5f) * (outer - 0.5f) : -1.0f;  // closer: inside outer
+    const float none_out = (outer + 0.5f) * (outer + 0.5f);                          // farther: outside outer
+    const bool  has_hole = inner > 0;
+    const float full_in  = has_hole && inner > 0.5f ? (inner - 0.5f) * (inner - 0.5f) : -1.0f;
+    const float none_in  = (inner + 0.5f) * (inner + 0.5f);
+
+    const int y_from = std::max(m_clip.y, int(std::floor(center.y - outer - 0.5f)));
+    const int y_to   = std::min(m_clip.y + m_clip.height, int(std::ceil(center.y + outer + 0.5f)));
+    for (int y = y_from; y < y_to; ++y)
+    {
+        const float dy  = float(y) + 0.5f - center.y;
+        const float dy2 = dy * dy;
+        if (dy2 >= none_out)
+            continue;
+
+        const float ext    = std::sqrt(none_out - dy2);
+        const int   x_from = std::max(m_clip.x, int(std::floor(center.x - ext)));
+        const int   x_to   = std::min(m_clip.x + m_clip.width, int(std::ceil(center.x + ext)));
+        if (x_from >= x_to)
+            continue;
+
+        m_cov.resize(size_t(x_to - x_from));
+        for (int x = x_from; x < x_to; ++x)
+        {
+            const float dx = float(x) + 0.5f - center.x;
+            const float d2 = dx * dx + dy2;
+
+            uint8_t c;
+            if (has_hole && d2 <= full_in)
+                c = 0;
+            else if (d2 <= full_out && (!has_hole || d2 >= none_in))
+                c = 0xFF;
+            else
+            {
+                const float d = std::sqrt(d2);
+                float       a = std::clamp(outer + 0.5f - d, 0.0f, 1.0f);
+                if (has_hole)
+                    a -= std::clamp(inner + 0.5f - d, 0.0f, 1.0f);
+                c = uint8_t(std::max(a, 0.0f) * 255.0f + 0.5f);
+            }
+            m_cov[size_t(x - x_from)] = c;
+        }
+
+        BlendSpan(x_from, y, size_t(x_to - x_from), color, m_cov.data());
+    }
+}
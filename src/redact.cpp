@@ -0,0 +1,308 @@
+/*
+ * Copyright 2026 Toni500
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ * disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ * following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ * products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "redact.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define OSHOT_REDACT_SSE2 1
+#  include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+#  define OSHOT_REDACT_NEON 1
+#  include <arm_neon.h>
+#endif
+
+// Row kernels work on `n` bytes: the channels of the pixels side by side, each its own column.
+// Only vertical passes exist, horizontal ones run down the columns of the image transposed.
+// Sums are 16 bits: windows and blocks are kept under 256 pixels, so they never get past 255 * 255.
+
+// acc += add - sub
+static void slide_row(uint16_t* acc, const uint8_t* add, const uint8_t* sub, size_t n)
+{
+    size_t i = 0;
+#if OSHOT_REDACT_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= n; i += 16)
+    {
+        const __m128i a  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(add + i));
+        const __m128i s  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sub + i));
+        __m128i*      lo = reinterpret_cast<__m128i*>(acc + i);
+        __m128i*      hi = reinterpret_cast<__m128i*>(acc + i + 8);
+        _mm_storeu_si128(lo, _mm_add_epi16(_mm_loadu_si128(lo),
+                                           _mm_sub_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(s, zero))));
+        _mm_storeu_si128(hi, _mm_add_epi16(_mm_loadu_si128(hi),
+                                           _mm_sub_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(s, zero))));
+    }
+#elif OSHOT_REDACT_NEON
+    for (; i + 16 <= n; i += 16)
+    {
+        const uint8x16_t a = vld1q_u8(add + i);
+        const uint8x16_t s = vld1q_u8(sub + i);
+        vst1q_u16(acc + i, vaddq_u16(vld1q_u16(acc + i), vsubl_u8(vget_low_u8(a), vget_low_u8(s))));
+        vst1q_u16(acc + i + 8, vaddq_u16(vld1q_u16(acc + i + 8), vsubl_u8(vget_high_u8(a), vget_high_u8(s))));
+    }
+#endif
+    for (; i < n; ++i)
+        acc[i] = uint16_t(acc[i] + add[i] - sub[i]);
+}
+
+// dst = (acc + bias) * mul >> 16, the window's average, then the window moves on: acc += add - sub
+static void emit_row(
+    uint8_t* dst, uint16_t* acc, const uint8_t* add, const uint8_t* sub, uint16_t bias, uint16_t mul, size_t n)
+{
+    size_t i = 0;
+#if OSHOT_REDACT_SSE2
+    const __m128i zero  = _mm_setzero_si128();
+    const __m128i vbias = _mm_set1_epi16(short(bias));
+    const __m128i vmul  = _mm_set1_epi16(short(mul));
+    for (; i + 16 <= n; i += 16)
+    {
+        const __m128i a  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(add + i));
+        const __m128i s  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sub + i));
+        __m128i*      lo = reinterpret_cast<__m128i*>(acc + i);
+        __m128i*      hi = reinterpret_cast<__m128i*>(acc + i + 8);
+        const __m128i l  = _mm_loadu_si128(lo);
+        const __m128i h  = _mm_loadu_si128(hi);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                         _mm_packus_epi16(_mm_mulhi_epu16(_mm_add_epi16(l, vbias), vmul),
+                                          _mm_mulhi_epu16(_mm_add_epi16(h, vbias), vmul)));
+        _mm_storeu_si128(lo, _mm_add_epi16(l, _mm_sub_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(s, zero))));
+        _mm_storeu_si128(hi, _mm_add_epi16(h, _mm_sub_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(s, zero))));
+    }
+#elif OSHOT_REDACT_NEON
+    const uint16x8_t vbias = vdupq_n_u16(bias);
+    const uint16x4_t vmul  = vdup_n_u16(mul);
+    auto             scale = [&](uint16x8_t v) {
+        v = vaddq_u16(v, vbias);
+        return vcombine_u16(vshrn_n_u32(vmull_u16(vget_low_u16(v), vmul), 16),
+                            vshrn_n_u32(vmull_u16(vget_high_u16(v), vmul), 16));
+    };
+    for (; i + 16 <= n; i += 16)
+    {
+        const uint8x16_t a = vld1q_u8(add + i);
+        const uint8x16_t s = vld1q_u8(sub + i);
+        const uint16x8_t l = vld1q_u16(acc + i);
+        const uint16x8_t h = vld1q_u16(acc + i + 8);
+
+        vst1q_u8(dst + i, vcombine_u8(vqmovn_u16(scale(l)), vqmovn_u16(scale(h))));
+        vst1q_u16(acc + i, vaddq_u16(l, vsubl_u8(vget_low_u8(a), vget_low_u8(s))));
+        vst1q_u16(acc + i + 8, vaddq_u16(h, vsubl_u8(vget_high_u8(a), vget_high_u8(s))));
+    }
+#endif
+    for (; i < n; ++i)
+    {
+        dst[i] = uint8_t(std::min<uint32_t>((uint32_t(uint16_t(acc[i] + bias)) * mul) >> 16, 255));
+        acc[i] = uint16_t(acc[i] + add[i] - sub[i]);
+    }
+}
+
+// One box blur of radius `r` (under 128) down the columns of `src` (w x h pixels, packed) into `dst`,
+// pixels past the top and bottom taken as copies of the edge rows
+static void box_blur_cols(const uint8_t* src, uint8_t* dst, int w, int h, int r, std::vector<uint16_t>& acc)
+{
+    const size_t n = size_t(w) * 4;
+    if (r == 0)
+    {
+        std::memcpy(dst, src, n * h);
+        return;
+    }
+
+    auto row = [&](int y) { return src + size_t(std::clamp(y, 0, h - 1)) * n; };
+
+    // Window around row 0, the repeated edge rows counted in one go so this is never more than a pass
+    const uint8_t* first = row(0);
+    const uint8_t* last  = row(h - 1);
+    const int      below = std::max(0, r - (h - 1));  // copies of the last row
+    acc.resize(n);
+    for (size_t i = 0; i < n; ++i)
+        acc[i] = uint16_t((r + 1) * first[i] + below * last[i]);
+    for (int y = 1; y <= std::min(r, h - 1); ++y)
+    {
+        const uint8_t* p = row(y);
+        for (size_t i = 0; i < n; ++i)
+            acc[i] = uint16_t(acc[i] + p[i]);
+    }
+
+    // Rounded division by the window size as a multiplication, off by one at worst
+    const int      size = 2 * r + 1;
+    const uint16_t bias = uint16_t(size / 2);
+    const uint16_t mul  = uint16_t((65536 + size - 1) / size);
+    for (int y = 0; y < h; ++y)
+        emit_row(dst + size_t(y) * n, acc.data(), row(y + r + 1), row(y - r), bias, mul, n);
+}
+
+#if OSHOT_REDACT_SSE2
+// 4 x 4 pixels, rows `src_stride` bytes apart, into columns of `dst`
+static inline void transpose4_sse2(const uint8_t* src, size_t src_stride, uint8_t* dst, size_t dst_stride)
+{
+    auto load = [&](size_t i) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * src_stride)); };
+
+    const __m128i r0 = load(0), r1 = load(1), r2 = load(2), r3 = load(3);
+    const __m128i t0 = _mm_unpacklo_epi32(r0, r1);  // a0 b0 a1 b1
+    const __m128i t1 = _mm_unpacklo_epi32(r2, r3);  // c0 d0 c1 d1
+    const __m128i t2 = _mm_unpackhi_epi32(r0, r1);  // a2 b2 a3 b3
+    const __m128i t3 = _mm_unpackhi_epi32(r2, r3);  // c2 d2 c3 d3
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_unpacklo_epi64(t0, t1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + dst_stride), _mm_unpackhi_epi64(t0, t1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * dst_stride), _mm_unpacklo_epi64(t2, t3));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 3 * dst_stride), _mm_unpackhi_epi64(t2, t3));
+}
+#endif
+
+// Pixel (x, y) of `src` (w x h) to (y, x) of `dst` (h x w), in blocks so both sides stay in cache
+static void transpose(const uint8_t* src, uint8_t* dst, int w, int h)
+{
+    static constexpr int BLOCK = 32;
+
+    const size_t src_stride = size_t(w) * 4;
+    const size_t dst_stride = size_t(h) * 4;
+    for (int by = 0; by < h; by += BLOCK)
+        for (int bx = 0; bx < w; bx += BLOCK)
+            for (int y = by; y < std::min(by + BLOCK, h); y += 4)
+                for (int x = bx; x < std::min(bx + BLOCK, w); x += 4)
+                {
+                    const uint8_t* from = src + size_t(y) * src_stride + size_t(x) * 4;
+                    uint8_t*       to   = dst + size_t(x) * dst_stride + size_t(y) * 4;
+#if OSHOT_REDACT_SSE2
+                    if (y + 4 <= h && x + 4 <= w)
+                    {
+                        transpose4_sse2(from, src_stride, to, dst_stride);
+                        continue;
+                    }
+#endif
+                    for (int j = 0; j < std::min(4, h - y); ++j)
+                        for (int i = 0; i < std::min(4, w - x); ++i)
+                            std::memcpy(to + size_t(i) * dst_stride + size_t(j) * 4,
+                                        from + size_t(j) * src_stride + size_t(i) * 4,
+                                        4);
+                }
+}
+
+// Radii of the three box blurs adding up to a gaussian of `sigma`
+// (Kutskir, "Fastest Gaussian blur": widths as close as odd ones get to the ideal, mixed to match the variance)
+static void box_radii(float sigma, int (&radii)[3])
+{
+    const float var   = 12 * sigma * sigma;
+    const float ideal = std::sqrt(var / 3 + 1);
+    int         wl    = int(std::floor(ideal));
+    if (wl % 2 == 0)
+        --wl;
+    const int m = int(std::lround((var - 3.0f * wl * wl - 12.0f * wl - 9) / (-4.0f * wl - 4)));
+    for (int i = 0; i < 3; ++i)
+        radii[i] = std::max(0, ((i < m ? wl : wl + 2) - 1) / 2);
+}
+
+static region_t clip_to_image(const capture_result_t& img, const region_t& area)
+{
+    const int x0 = std::clamp(area.x, 0, img.w);
+    const int y0 = std::clamp(area.y, 0, img.h);
+    const int x1 = std::clamp(area.x + area.width, x0, img.w);
+    const int y1 = std::clamp(area.y + area.height, y0, img.h);
+    return { x0, y0, x1 - x0, y1 - y0 };
+}
+
+void blur_region(capture_result_t& img, const region_t& area, float sigma)
+{
+    const region_t a = clip_to_image(img, area);
+    if (a.width <= 0 || a.height <= 0 || !(sigma > 0))
+        return;
+
+    int radii[3];
+    box_radii(std::min(sigma, 100.0f), radii);  // radii stay under 128 and the sums in 16 bits
+
+    const int             w = a.width, h = a.height;
+    const size_t          n = size_t(w) * 4;
+    std::vector<uint8_t>  buf(n * h), tmp(n * h);
+    std::vector<uint16_t> acc;
+    for (int y = 0; y < h; ++y)
+        std::memcpy(buf.data() + size_t(y) * n, img.data.data() + (size_t(a.y + y) * img.w + size_t(a.x)) * 4, n);
+
+    for (const int r : radii)
+    {
+        box_blur_cols(buf.data(), tmp.data(), w, h, r, acc);
+        std::swap(buf, tmp);
+    }
+    transpose(buf.data(), tmp.data(), w, h);
+    std::swap(buf, tmp);
+    for (const int r : radii)
+    {
+        box_blur_cols(buf.data(), tmp.data(), h, w, r, acc);
+        std::swap(buf, tmp);
+    }
+    transpose(buf.data(), tmp.data(), h, w);
+
+    for (int y = 0; y < h; ++y)
+        std::memcpy(img.data.data() + (size_t(a.y + y) * img.w + size_t(a.x)) * 4, tmp.data() + size_t(y) * n, n);
+}
+
+void pixelate_region(capture_result_t& img, const region_t& area, int block)
+{
+    const region_t a = clip_to_image(img, area);
+    if (a.width <= 0 || a.height <= 0)
+        return;
+
+    block = std::clamp(block, 1, 256);
+    const size_t          n = size_t(a.width) * 4;
+    std::vector<uint16_t> acc(n);
+    std::vector<uint8_t>  zeros(n, 0), out(n);
+    auto                  row = [&](int y) { return img.data.data() + (size_t(a.y + y) * img.w + size_t(a.x)) * 4; };
+
+    for (int y0 = 0; y0 < a.height; y0 += block)
+    {
+        const int y1 = std::min(y0 + block, a.height);
+
+        // Column sums over the block row, then each block's across its columns
+        std::fill(acc.begin(), acc.end(), 0);
+        for (int y = y0; y < y1; ++y)
+            slide_row(acc.data(), row(y), zeros.data(), n);
+
+        for (int x0 = 0; x0 < a.width; x0 += block)
+        {
+            const int x1     = std::min(x0 + block, a.width);
+            uint32_t  sum[4] = {};
+            for (int x = x0; x < x1; ++x)
+                for (int c = 0; c < 4; ++c)
+                    sum[c] += acc[size_t(x) * 4 + c];
+
+            const uint32_t count = uint32_t((x1 - x0) * (y1 - y0));
+            uint8_t        avg[4];
+            for (int c = 0; c < 4; ++c)
+                avg[c] = uint8_t((sum[c] + count / 2) / count);
+            for (int x = x0; x < x1; ++x)
+                std::memcpy(out.data() + size_t(x) * 4, avg, 4);
+        }
+
+        for (int y = y0; y < y1; ++y)
+            std::memcpy(row(y), out.data(), n);
+    }
+}
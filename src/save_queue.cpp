@@ -0,0 +1,201 @@
+/*
+ * Copyright 2026 Toni500
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ * disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ * following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ * products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "save_queue.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <system_error>
+#include <utility>
+
+#include "clipboard.hpp"
+#include "config.hpp"
+#include "image_encoder.hpp"
+#include "nvdialog/nvdialog_notification.h"
+#include "platform.hpp"
+
+#if OSHOT_WINDOWS
+#  include <io.h>
+#  include <process.h>
+#else
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+static int sync_fd(int fd)
+{
+#if OSHOT_WINDOWS
+    return _commit(fd);
+#else
+    return fsync(fd);
+#endif
+}
+
+Result<> write_image_atomic(const std::string& path, const capture_result_t& img, ImageExt ext, bool sync)
+{
+    // Same directory, so the rename can't cross filesystems
+    const std::string tmp_path = fmt::format("{}.oshot-{}.tmp", path, getpid());
+
+    FILE* fp = fopen(tmp_path.c_str(), "wb");
+    if (!fp)
+        return Err("Failed to open '{}': {}", tmp_path, strerror(errno));
+
+    FileSink sink(fp);
+    Result<> res = encode_to_image(img, ext, sink);
+    if (res.ok() && fflush(fp) != 0)
+        res = Err("Failed to write image data: {}", strerror(errno));
+    if (res.ok() && sync && sync_fd(fileno(fp)) != 0)
+        res = Err("Failed to sync '{}': {}", tmp_path, strerror(errno));
+    if (fclose(fp) != 0 && res.ok())
+        res = Err("Failed to write image data: {}", strerror(errno));
+
+    std::error_code ec;
+    if (res.ok())
+    {
+        fs::rename(tmp_path, path, ec);
+        if (ec)
+            res = Err("Failed to move '{}' to '{}': {}", tmp_path, path, ec.message());
+    }
+    if (!res.ok())
+    {
+        fs::remove(tmp_path, ec);
+        return res;
+    }
+
+#if !OSHOT_WINDOWS
+    // The rename itself lives in the directory
+    if (sync)
+    {
+        const std::string dir = fs::path(path).parent_path().string();
+        const int         fd  = open(dir.empty() ? "." : dir.c_str(), O_RDONLY);
+        if (fd >= 0)
+        {
+            fsync(fd);
+            close(fd);
+        }
+    }
+#endif
+
+    return Ok();
+}
+
+void SaveQueue::Push(save_job_t job)
+{
+    {
+        std::lock_guard lk(m_mtx);
+        m_jobs.push_back(std::move(job));
+        if (!m_thread.joinable())
+        {
+            m_stop   = false;
+            m_thread = std::thread(&SaveQueue::Loop, this);
+        }
+    }
+    m_cv.notify_one();
+}
+
+void SaveQueue::Wait()
+{
+    std::unique_lock lk(m_mtx);
+    m_idle_cv.wait(lk, [&] { return m_jobs.empty() && !m_busy; });
+}
+
+void SaveQueue::Stop()
+{
+    {
+        std::lock_guard lk(m_mtx);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+void SaveQueue::Loop()
+{
+    auto deleter = [](NvdNotification* p) {
+        nvd_send_notification(p);
+        nvd_delete_notification(p);
+    };
+
+    while (true)
+    {
+        save_job_t job;
+        {
+            std::unique_lock lk(m_mtx);
+            m_cv.wait(lk, [&] { return m_stop || !m_jobs.empty(); });
+            if (m_jobs.empty())
+                break;  // stopping, and nothing left to write
+
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            m_busy = true;
+        }
+
+        std::unique_ptr<NvdNotification, decltype(deleter)> notif(nullptr, deleter);
+        if (job.op == SavingOp::Clipboard)
+        {
+            const Result<>& res = g_clipboard.CopyImage(job.img, job.ext);
+            if (res.ok())
+            {
+                notif.reset(
+                    nvd_notification_new("Copied!", "Screenshot copied to clipboard", NVD_NOTIFICATION_SIMPLE));
+            }
+            else
+            {
+                spdlog::error("Failed to copy the screenshot: {}", res.error_v());
+                notif.reset(nvd_notification_new("Copy failed", res.error_v().c_str(), NVD_NOTIFICATION_ERROR));
+            }
+        }
+        else
+        {
+            const Result<>& res = write_image_atomic(job.path, job.img, job.ext, g_config->File.save_fsync);
+            if (res.ok())
+            {
+                notif.reset(nvd_notification_new("Saved!", "Screenshot saved successfully", NVD_NOTIFICATION_SIMPLE));
+            }
+            else
+            {
+                spdlog::error("Failed to save '{}': {}", job.path, res.error_v());
+                notif.reset(nvd_notification_new("Save failed", res.error_v().c_str(), NVD_NOTIFICATION_ERROR));
+            }
+        }
+        notif.reset();
+
+        {
+            std::lock_guard lk(m_mtx);
+            m_busy = false;
+            if (m_jobs.empty())
+                m_idle_cv.notify_all();
+        }
+    }
+
+    std::lock_guard lk(m_mtx);
+    m_idle_cv.notify_all();
+}
@@ -110,6 +110,19 @@ SessionType get_session_type()
     return SessionType::Unknown;
 }
 
+Result<capture_result_t> capture_full_screen()
+{
+    switch (get_session_type())
+    {
+        case SessionType::X11:     return capture_full_screen_x11();
+        case SessionType::Wayland: return capture_full_screen_wayland();
+        case SessionType::KDE:     return capture_full_screen_spectacle();
+        case SessionType::Windows: return capture_full_screen_windows();
+        case SessionType::MacOS:   return capture_full_screen_macos();
+        default:                   return Err("Unknown platform");
+    }
+}
+
 #if OSHOT_LINUX
 Result<capture_result_t> capture_full_screen_portal();
 
@@ -261,6 +274,100 @@ Result<capture_result_t> capture_full_screen_x11()
     return Ok(std::move(result));
 }
 
+struct ScreenGrabber::x11_t
+{
+    Display* display = nullptr;
+    Window   root    = 0;
+
+    ~x11_t()
+    {
+        if (display)
+            XCloseDisplay(display);
+    }
+};
+
+Result<> ScreenGrabber::Open(int monitor, const region_t& region)
+{
+    Close();
+
+    auto x11     = std::make_unique<x11_t>();
+    x11->display = XOpenDisplay(nullptr);
+    if (!x11->display)
+        return Err("Failed to open X display");
+    x11->root = DefaultRootWindow(x11->display);
+
+    if (monitor >= 0)
+    {
+        int             nmon     = 0;
+        XRRMonitorInfo* monitors = XRRGetMonitors(x11->display, x11->root, True, &nmon);
+        if (monitors && monitor < nmon)
+            m_monitor = { monitors[monitor].x, monitors[monitor].y, monitors[monitor].width, monitors[monitor].height };
+        if (monitors)
+            XRRFreeMonitors(monitors);
+        if (monitor >= nmon)
+            return Err("There's no monitor {}, XRandR lists {}", monitor, nmon);
+    }
+    else if (!get_cursor_monitor_xrandr(x11->display, m_monitor.x, m_monitor.y, m_monitor.width, m_monitor.height))
+    {
+        XWindowAttributes attrs;
+        XGetWindowAttributes(x11->display, x11->root, &attrs);
+        m_monitor = { 0, 0, attrs.width, attrs.height };
+    }
+
+    if (region.width <= 0 || region.height <= 0)
+    {
+        m_rect = m_monitor;
+    }
+    else
+    {
+        if (region.x + region.width > m_monitor.width || region.y + region.height > m_monitor.height)
+            return Err("Region {}x{}+{}+{} doesn't fit in the {}x{} monitor",
+                       region.width,
+                       region.height,
+                       region.x,
+                       region.y,
+                       m_monitor.width,
+                       m_monitor.height);
+        m_rect = { m_monitor.x + region.x, m_monitor.y + region.y, region.width, region.height };
+    }
+
+    debug("Grabbing {}x{}+{}+{} of monitor {}x{}+{}+{}",
+          m_rect.width,
+          m_rect.height,
+          m_rect.x,
+          m_rect.y,
+          m_monitor.width,
+          m_monitor.height,
+          m_monitor.x,
+          m_monitor.y);
+    m_x11 = std::move(x11);
+    return Ok();
+}
+
+Result<capture_result_t> ScreenGrabber::Grab()
+{
+    if (!m_x11)
+        return Err("Nothing to grab, Open() first");
+
+    XImage* image = XGetImage(m_x11->display,
+                              m_x11->root,
+                              m_rect.x,
+                              m_rect.y,
+                              static_cast<unsigned int>(m_rect.width),
+                              static_cast<unsigned int>(m_rect.height),
+                              AllPlanes,
+                              ZPixmap);
+    if (!image)
+        return Err("Failed to capture screen image with X11");
+
+    capture_result_t result;
+    result.data = ximage_to_rgba(image, m_rect.width, m_rect.height);
+    result.w    = m_rect.width;
+    result.h    = m_rect.height;
+    XDestroyImage(image);
+    return Ok(std::move(result));
+}
+
 // Capture the monitor that contains the pointer using KDE's `spectacle`.
 // `spectacle -m` (--screen) always captures the monitor the cursor is on,
 // which is exactly what we need and what the generic XDG portal does NOT
@@ -588,8 +695,30 @@ Result<capture_result_t> capture_full_screen_portal()
 {
     return Err();
 }
+
+struct ScreenGrabber::x11_t
+{
+};
+
+Result<> ScreenGrabber::Open(int, const region_t&)
+{
+    return Err("Only supported on X11");
+}
+
+Result<capture_result_t> ScreenGrabber::Grab()
+{
+    return Err("Only supported on X11");
+}
 #endif  // OSHOT_LINUX
 
+ScreenGrabber::ScreenGrabber()  = default;
+ScreenGrabber::~ScreenGrabber() = default;
+
+void ScreenGrabber::Close()
+{
+    m_x11.reset();
+}
+
 #if OSHOT_MACOS
 // The OS automatically prompts for Screen Recording permission on first use.
 // Returns the 1-based screencapture display index (-D flag) for the monitor that
@@ -27,6 +27,7 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <chrono>
 #include <cmath>
 #include <cstdint>
@@ -34,20 +35,25 @@
 #include <cstring>
 #include <filesystem>
 #include <functional>
+#include <limits>
 #include <memory>
 #include <mutex>
 #include <span>
 #include <string_view>
 #include <thread>
+#include <tuple>
 #include <utility>
 #include <vector>
 
 #include "cache.hpp"
 #include "clipboard.hpp"
+#include "composite.hpp"
 #include "config.hpp"
 #include "fmt/chrono.h"
 #include "fmt/format.h"
 #include "fmt/ranges.h"
+#include "glyph_cache.hpp"
+#include "image_encoder.hpp"
 #include "imgui/imgui.h"
 #include "imgui/imgui_impl_opengl3_loader.h"
 #include "imgui/imgui_internal.h"
@@ -59,8 +65,11 @@
 #  define OCR_OUTPUT  "ocr_output"
 #  define ZBAR_OUTPUT "barcode_output"
 #endif
+#include "raster.hpp"
+#include "redact.hpp"
 #include "screen_capture.hpp"
 #include "spdlog/sinks/ringbuffer_sink.h"
+#include "stroke.hpp"
 #include "tiny-process-library/process.hpp"
 #include "tinyfiledialogs.h"
 #include "tool_icons.h"
@@ -84,17 +93,6 @@ constexpr ImVec4 rgba_t::to_imvec4() const
     return ImVec4(r / 255.0f, g / 255.0f, b / 255.0f, a / 255.0f);
 }
 
-inline rgba_t blend(rgba_t src, rgba_t dst)
-{
-    float a  = src.a / 255.0f;
-    float ia = 1.0f - a;
-
-    return rgba_t{ uint8_t(src.r * a + dst.r * ia),
-                   uint8_t(src.g * a + dst.g * ia),
-                   uint8_t(src.b * a + dst.b * ia),
-                   uint8_t(src.a + dst.a * ia) };
-}
-
 static void get_filtered_filenames(const std::string&                          dir,
                                    std::vector<std::string>&                   list,
                                    std::function<bool(const fs::path&)>        filter,
@@ -235,6 +233,77 @@ static HandleHovered flip_handle_y(HandleHovered handle)
     }
 }
 
+// Empty (zero sized) if they don't overlap
+static region_t region_intersect(const region_t& a, const region_t& b)
+{
+    const int x0 = std::max(a.x, b.x);
+    const int y0 = std::max(a.y, b.y);
+    const int x1 = std::min(a.x + a.width, b.x + b.width);
+    const int y1 = std::min(a.y + a.height, b.y + b.height);
+    if (x1 <= x0 || y1 <= y0)
+        return {};
+    return { x0, y0, x1 - x0, y1 - y0 };
+}
+
+// Smallest region holding both, an empty one adding nothing
+static region_t region_union(const region_t& a, const region_t& b)
+{
+    if (a.width <= 0 || a.height <= 0)
+        return b;
+    if (b.width <= 0 || b.height <= 0)
+        return a;
+
+    const int x0 = std::min(a.x, b.x);
+    const int y0 = std::min(a.y, b.y);
+    const int x1 = std::max(a.x + a.width, b.x + b.width);
+    const int y1 = std::max(a.y + a.height, b.y + b.height);
+    return { x0, y0, x1 - x0, y1 - y0 };
+}
+
+// Blurs and pixelations change the screenshot itself, under every other annotation
+static bool is_redaction(ToolType type)
+{
+    return type == ToolType::Blur || type == ToolType::Pixelate;
+}
+
+// Image pixels a redaction covers, `offset` being where the image was on screen
+static region_t redaction_area(const annotation_t& ann, ImVec2 offset)
+{
+    const int x0 = int(std::lround(std::min(ann.start.x, ann.end.x) - offset.x));
+    const int y0 = int(std::lround(std::min(ann.start.y, ann.end.y) - offset.y));
+    const int x1 = int(std::lround(std::max(ann.start.x, ann.end.x) - offset.x));
+    const int y1 = int(std::lround(std::max(ann.start.y, ann.end.y) - offset.y));
+    return { x0, y0, x1 - x0, y1 - y0 };
+}
+
+// The thickness slider (1 to 10) doubles as the strength
+static void apply_redaction(capture_result_t& img, const annotation_t& ann, const region_t& area)
+{
+    if (ann.type == ToolType::Blur)
+        blur_region(img, area, ann.thickness * 2.5f);
+    else if (ann.type == ToolType::Pixelate)
+        pixelate_region(img, area, int(std::lround(ann.thickness * 4)));
+}
+
+#if !OSHOT_MACOS
+// `from` of `img` into the screenshot texture at (x, y)
+static void upload_texture_area(ImTextureRef tex, const capture_result_t& img, const region_t& from, int x, int y)
+{
+    glBindTexture(GL_TEXTURE_2D, GLuint(tex._TexID));
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, img.w);
+    glTexSubImage2D(GL_TEXTURE_2D,
+                    0,
+                    x,
+                    y,
+                    from.width,
+                    from.height,
+                    GL_RGBA,
+                    GL_UNSIGNED_BYTE,
+                    img.data.data() + (size_t(from.y) * img.w + size_t(from.x)) * 4);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+}
+#endif
+
 static bool ui_blocks_selection()
 {
     static ImGuiWindow* overlay_window = nullptr;
@@ -333,25 +402,34 @@ Result<> ScreenshotTool::Start()
         if (g_config->File.delay > 0)
             std::this_thread::sleep_for(std::chrono::milliseconds(g_config->File.delay));
 
-        switch (get_session_type())
-        {
-            case SessionType::X11:     result = capture_full_screen_x11(); break;
-            case SessionType::Wayland: result = capture_full_screen_wayland(); break;
-            case SessionType::KDE:     result = capture_full_screen_spectacle(); break;
-            case SessionType::Windows: result = capture_full_screen_windows(); break;
-            case SessionType::MacOS:   result = capture_full_screen_macos(); break;
-            default:                   return Err("Unknown platform");
-        }
+        result = capture_full_screen();
     }
 
     TRY_MSG(result, "Failed to load image: {}");
 
     m_screenshot = std::move(result.get());
+    ResetOcr();
+    m_ann_layer = {};
+    m_redacted       = {};
+    m_redacted_count = 0;
     m_tool_thickness.fill(3.0f);
     m_tool_thickness[idx(ToolType::Text)] = 16.0f;
     return Ok();
 }
 
+void ScreenshotTool::ResetOcr()
+{
+    if (m_ocr_thread.joinable())
+    {
+        m_ocr_api.Cancel();
+        m_ocr_thread.join();
+        m_ocr_api.ResetCancel();
+    }
+    m_ocr_job.reset();
+    m_ocr_frame.reset();
+    ++m_ocr_frame_id;
+}
+
 Result<> ScreenshotTool::StartWindow()
 {
     // Do not load anything about the text tools window,
@@ -423,6 +501,9 @@ Result<> ScreenshotTool::StartWindow()
         CreateTexture(nullptr, ICON_COUNTER_BUBBLE_RGBA, ICON_COUNTER_BUBBLE_W, ICON_COUNTER_BUBBLE_H).get();
     m_tool_textures[idx(ToolType::Pencil)] =
         CreateTexture(nullptr, ICON_PENCIL_RGBA, ICON_PENCIL_W, ICON_PENCIL_H).get();
+    m_tool_textures[idx(ToolType::Blur)] = CreateTexture(nullptr, ICON_BLUR_RGBA, ICON_BLUR_W, ICON_BLUR_H).get();
+    m_tool_textures[idx(ToolType::Pixelate)] =
+        CreateTexture(nullptr, ICON_PIXELATE_RGBA, ICON_PIXELATE_W, ICON_PIXELATE_H).get();
 
     m_tool_textures[idx(ToolType::Arrow)] = CreateTexture(nullptr, ICON_ARROW_RGBA, ICON_ARROW_W, ICON_ARROW_H).get();
     m_tool_textures[idx(ToolType::Text)]  = CreateTexture(nullptr, ICON_TEXT_RGBA, ICON_TEXT_W, ICON_TEXT_H).get();
@@ -473,6 +554,7 @@ void ScreenshotTool::RenderOverlay()
 
     // Screenshot as a centered bg image
     UpdateWindowBg();
+    UpdateRedactionTexture();
 
     if (ImGui::GetPlatformIO().DrawCallback_SetSamplerNearest)
         ImGui::GetBackgroundDrawList()->AddCallback(ImGui::GetPlatformIO().DrawCallback_SetSamplerNearest, nullptr);
@@ -497,6 +579,7 @@ void ScreenshotTool::RenderOverlay()
         DrawAnnotations();
         DrawDarkOverlay();
         DrawSelectionBorder();
+        DrawBarcodeHighlights();
         HandleSelectionInput();
     }
 
@@ -590,8 +673,8 @@ void ScreenshotTool::HandleShortcutsInput()
         m_state           = ToolState::Selected;
     }
 
-    if (ImGui::Shortcut(ImGuiKey_Z | ImGuiMod_Ctrl, ImGuiInputFlags_RouteGlobal) && !m_annotations.empty())
-        m_annotations.pop_back();
+    if (ImGui::Shortcut(ImGuiKey_Z | ImGuiMod_Ctrl, ImGuiInputFlags_RouteGlobal))
+        UndoAnnotation();
 
     if (ImGui::Shortcut(ImGuiKey_G | ImGuiMod_Ctrl, ImGuiInputFlags_RouteGlobal))
         g_config->Runtime.enable_handles = !g_config->Runtime.enable_handles;
@@ -800,7 +883,7 @@ void ScreenshotTool::HandleAnnotationInput()
                     m_current_annotation.start.x += fp.x;
                     m_current_annotation.start.y += fp.y;
 
-                    m_annotations.push_back(m_current_annotation);
+                    AddAnnotation(m_current_annotation);
                 }
                 m_current_annotation = {};
                 m_current_actions.Clear(CurrentAction::IsTextPlacing);
@@ -884,8 +967,18 @@ void ScreenshotTool::HandleAnnotationInput()
             should_add = (dx * dx + dy * dy) > 25.0f;  // Minimum 5px distance
         }
 
+        if (should_add && m_current_tool == ToolType::Pencil)
+        {
+            // Down to the points that shape the stroke, within a fraction of its width,
+            // then (if enabled) a curve through them, both what's drawn each frame and what's exported
+            const float tolerance = std::clamp(m_current_annotation.thickness * 0.25f, 0.5f, 2.0f);
+            m_current_annotation.points = simplify_polyline(m_current_annotation.points, tolerance);
+            if (g_config->File.smooth_pencil)
+                m_current_annotation.points = smooth_polyline(m_current_annotation.points, tolerance);
+        }
+
         if (should_add)
-            m_annotations.push_back(m_current_annotation);
+            AddAnnotation(m_current_annotation);
 
         m_current_annotation = annotation_t{};
     }
@@ -1172,6 +1265,31 @@ void ScreenshotTool::DrawDarkOverlay()
     draw_list->AddRectFilled(ImVec2(sel_x + sel_w, sel_y), ImVec2(m_image_end.x, sel_y + sel_h), dark_color);
 }
 
+void ScreenshotTool::DrawBarcodeHighlights()
+{
+    if (m_inputs.zbar_scan_result.symbols.empty())
+        return;
+
+    ImDrawList*  draw_list = ImGui::GetBackgroundDrawList();
+    const ImVec2 origin(m_image_origin.x + m_barcode_region.x, m_image_origin.y + m_barcode_region.y);
+
+    std::vector<ImVec2> points;
+    for (const zbar_symbol_t& symbol : m_inputs.zbar_scan_result.symbols)
+    {
+        // 1D barcodes may only report the scanline they were read on
+        if (symbol.polygon.size() < 2)
+            continue;
+
+        points.clear();
+        for (const point_t& p : symbol.polygon)
+            points.emplace_back(origin.x + p.x, origin.y + p.y);
+
+        if (points.size() >= 3)
+            draw_list->AddConvexPolyFilled(points.data(), int(points.size()), rgba_t(0x00ff6640).to_abgr());
+        draw_list->AddPolyline(points.data(), int(points.size()), rgba_t(0x00ff66FF).to_abgr(), 2.0f, ImDrawFlags_Closed);
+    }
+}
+
 void ScreenshotTool::DrawSelectionBorder()
 {
     ImDrawList* draw_list = ImGui::GetBackgroundDrawList();
@@ -1233,10 +1351,10 @@ void ScreenshotTool::DrawSelectionBorder()
         std::string str(fmt::format("{:.0f}x{:.0f}+{:.0f}+{:.0f}", sel_w, sel_h, sel_x, sel_y));
         if (g_config->File.image_out_size_fmt != "off")
         {
-            static std::atomic<size_t> estimated_size{ 0 };
-            static std::atomic<bool>   size_computing{ false };
-            static selection_rect_t    tracked_selection{};    // last geometry observed, any source
-            static selection_rect_t    committed_selection{};  // geometry estimated_size currently reflects
+            static selection_rect_t tracked_selection{};    // last geometry observed, any source
+            static selection_rect_t committed_selection{};  // geometry last sent to the estimator
+            static size_t           committed_gen = 0;      // m_annotations_gen it was sent at
+            static std::tuple<ImageExt, int, int> committed_cfg{};  // format, size limit and quality it was sent with
             static std::chrono::steady_clock::time_point last_change_ts{};
 
             auto same_geo = [](const selection_rect_t& a, const selection_rect_t& b) {
@@ -1250,28 +1368,40 @@ void ScreenshotTool::DrawSelectionBorder()
                 last_change_ts    = std::chrono::steady_clock::now();
             }
 
-            if (!size_computing && !same_geo(tracked_selection, committed_selection) &&
+            const std::tuple<ImageExt, int, int> cfg{ g_config->File.image_out_type.second,
+                                                      g_config->File.image_out_max_kib,
+                                                      g_config->File.jpeg_quality };
+            if ((!same_geo(tracked_selection, committed_selection) || committed_gen != m_annotations_gen ||
+                 committed_cfg != cfg) &&
                 std::chrono::steady_clock::now() - last_change_ts > 150ms)
             {
                 committed_selection = tracked_selection;
-                size_computing      = true;
+                committed_gen       = m_annotations_gen;
+                committed_cfg       = cfg;
+                RequestSizeEstimate();
+            }
 
-                capture_result_t snapshot = GetFinalImage();  // render thread only, cheap crop
-                ImageExt         ext      = g_config->File.image_out_type.second;
+            const double estimated_size = double(m_size_estimator.GetBytes());
+            byte_units_t byte_units     = (g_config->File.image_out_size_fmt == "auto")
+                                              ? auto_divide_bytes(estimated_size, 1024)
+                                              : divide_bytes(estimated_size, g_config->File.image_out_size_fmt);
 
-                std::thread([snapshot = std::move(snapshot), ext]() mutable {
-                    std::vector<uint8_t> img = encode_to_image(snapshot, ext);
-                    estimated_size.store(img.size(), std::memory_order_relaxed);
-                    size_computing.store(false, std::memory_order_relaxed);
-                }).detach();
+            // With a size limit, also what it takes to fit under it
+            std::string fit_str;
+            if (g_config->File.image_out_max_kib > 0)
+            {
+                if (m_size_estimator.GetFitQuality() > 0)
+                    fit_str += fmt::format(" q{}", m_size_estimator.GetFitQuality());
+                if (m_size_estimator.GetFitScale() < 1.0f)
+                    fit_str += fmt::format(" @{:.0f}%", m_size_estimator.GetFitScale() * 100);
             }
-            byte_units_t byte_units =
-                (g_config->File.image_out_size_fmt == "auto")
-                    ? auto_divide_bytes(double(estimated_size.load()), 1024)
-                    : divide_bytes(double(estimated_size.load()), g_config->File.image_out_size_fmt);
 
-            str += fmt::format(
-                "\n{}: {:.2f}{}", g_config->File.image_out_type.first, byte_units.num_bytes, byte_units.unit);
+            str += fmt::format("\n{}{}: {}{:.2f}{}",
+                               g_config->File.image_out_type.first,
+                               fit_str,
+                               m_size_estimator.IsExact() ? "" : "~",
+                               byte_units.num_bytes,
+                               byte_units.unit);
         }
         const ImVec2 str_size = ImGui::CalcTextSize(str.c_str());
 
@@ -1319,10 +1449,10 @@ void ScreenshotTool::DrawMenuItems()
             {
                 minimize_window();
 
-                const char* filter[]  = { "*.png", "*.jpeg", "*.jpg", "*.bmp" };
+                const char* filter[]  = { "*.png", "*.jpeg", "*.jpg", "*.bmp", "*.qoi", "*.webp" };
                 const char* open_path = tinyfd_openFileDialog("Open Image",
                                                               "",        // default path
-                                                              4,         // number of filter patterns
+                                                              6,         // number of filter patterns
                                                               filter,    // file filters
                                                               "Images",  // filter description
                                                               false      // allow multiple selections
@@ -1571,16 +1701,77 @@ void ScreenshotTool::DrawOcrTools()
     // --- Extract button + result details ---
     if (!invalid_path && !invalid_model && !need_to_scan)
     {
+        const bool is_extracting = m_ocr_job && m_ocr_job->running.load();
+        if (is_extracting)
+            ImGui::BeginDisabled();
+
         if (ImGui::Button("Extract Text"))
         {
-            const Result<>& configure_res = m_ocr_api.Configure(ocr_path.c_str(), ocr_model.c_str());
-            if (!configure_res.ok())
+            // The whole screenshot (plus annotations, if they count for text tools) is what
+            // the OCR engine keeps preprocessed, so only rebuild it when that actually changes.
+            const bool with_anns = g_config->File.render_anns && !m_annotations.empty();
+            if (!m_ocr_frame || m_ocr_frame_anns != with_anns || (with_anns && m_ocr_frame_gen != m_annotations_gen))
             {
-                SetError(ectx, OcrError::FailedToOCR, configure_res.error_v());
+                const region_t full{ 0, 0, m_screenshot.w, m_screenshot.h };
+                m_ocr_frame      = std::make_shared<const capture_result_t>(
+                    with_anns ? RenderImage(full, true) : m_screenshot);
+                m_ocr_frame_anns = with_anns;
+                m_ocr_frame_gen  = m_annotations_gen;
+                ++m_ocr_frame_id;
             }
-            else
+
+            // The last run is over (the button is disabled until then), its thread just needs joining
+            if (m_ocr_thread.joinable())
+                m_ocr_thread.join();
+
+            m_inputs.ocr_results = {};
+            m_ocr_job            = std::make_shared<ocr_job_t>();
+            m_ocr_job->frame_id  = m_ocr_frame_id;
+
+            m_ocr_thread = std::thread([job      = m_ocr_job,
+                                        api      = &m_ocr_api,
+                                        frame    = m_ocr_frame,
+                                        frame_id = m_ocr_frame_id,
+                                        region   = GetActiveRegion(),
+                                        ocr_path,
+                                        ocr_model] {
+                Result<ocr_result_t> result = [&]() -> Result<ocr_result_t> {
+                    TRY(api->Configure(ocr_path.c_str(), ocr_model.c_str()));
+                    return api->ExtractTextRegion(*frame, region, frame_id, [&job](std::string_view text) {
+                        std::lock_guard g(job->mutex);
+                        job->partial.append(text);
+                    });
+                }();
+
+                std::lock_guard g(job->mutex);
+                job->result = std::move(result);
+                job->running.store(false);
+            });
+        }
+
+        if (is_extracting)
+        {
+            ImGui::EndDisabled();
+            ImGui::SameLine();
+            ImGui::TextUnformatted("Extracting...");
+        }
+
+        // Started on a frame that's gone since, nothing it found applies anymore
+        if (m_ocr_job && m_ocr_job->frame_id != m_ocr_frame_id && !m_ocr_job->running.load())
+            m_ocr_job.reset();
+
+        if (m_ocr_job)
+        {
+            std::lock_guard g(m_ocr_job->mutex);
+            if (!m_ocr_job->partial.empty())
             {
-                Result<ocr_result_t> result = m_ocr_api.ExtractTextCapture(GetFinalImage(true));
+                m_inputs.ocr_results.data += m_ocr_job->partial;
+                m_ocr_job->partial.clear();
+            }
+
+            if (m_ocr_job->result)
+            {
+                Result<ocr_result_t>& result = *m_ocr_job->result;
                 if (result.ok())
                 {
                     ClearError(ectx, OcrError::FailedToOCR);
@@ -1607,11 +1798,16 @@ void ScreenshotTool::DrawOcrTools()
                 }
                 else
                 {
+                    m_inputs.ocr_results = {};
                     SetError(ectx, OcrError::FailedToOCR, result.error_v());
                 }
             }
         }
 
+        // Can't reset while holding its mutex
+        if (m_ocr_job && m_ocr_job->result)
+            m_ocr_job.reset();
+
         ImGui::SameLine();
 
         if (HasError(ectx, OcrError::FailedToOCR))
@@ -1640,6 +1836,7 @@ void ScreenshotTool::DrawOcrTools()
             ImGui::TextColored(confidence_color, "%d%%", m_inputs.ocr_results.confidence);
 
             ImGui::BulletText("PSM: %s", m_inputs.ocr_results.psm_str.c_str());
+            ImGui::BulletText("Model: %s", m_inputs.ocr_results.model.c_str());
             ImGui::TreePop();
         }
     }
@@ -1664,9 +1861,16 @@ void ScreenshotTool::DrawBarDecodeTools()
 
     if (ImGui::Button("Extract Text"))
     {
-        const Result<zbar_result_t>& scan = m_zbar_api.ExtractTextsCapture(GetFinalImage(true));
+        zbar_search_options_t opts;
+        opts.first_only = m_inputs.barcode_first_only;
+
+        m_barcode_region                  = GetActiveRegion();
+        const capture_result_t&      img  = GetFinalImage(true);
+        const Result<zbar_result_t>& scan = m_inputs.barcode_tiled ? m_zbar_api.SearchCapture(img, opts)
+                                                                   : m_zbar_api.ExtractTextsCapture(img);
         if (!scan.ok())
         {
+            m_inputs.zbar_scan_result = {};
             SetError(ectx, ZbarError::FailedToScan, scan.error_v());
         }
         else
@@ -1690,6 +1894,53 @@ void ScreenshotTool::DrawBarDecodeTools()
         ImGui::Text("Detected barcodes:");
         for (const auto& [sym, count] : m_inputs.zbar_scan_result.symbologies)
             ImGui::BulletText("%s (x%d)", sym.c_str(), count);
+        ImGui::BulletText("Scan time: %.1f ms (grayscale %.1f ms)",
+                          m_inputs.zbar_scan_result.scan_ms,
+                          m_inputs.zbar_scan_result.convert_ms);
+        ImGui::TreePop();
+    }
+
+    if (ImGui::TreeNode("Scan settings"))
+    {
+        // Session only, the defaults are default.barcode-symbologies/barcode-density
+        bool changed = false;
+        ImGui::SetNextItemWidth(ImGui::GetFontSize() * 10);
+        changed |= ImGui::SliderInt("Density##barcode_density", &m_inputs.barcode_density, 1, 8);
+        ImGui::SameLine();
+        HelpMarker("Scan every Nth pixel row/column.\n1 is the most thorough, higher is faster but may miss small codes.");
+
+        ImGui::Checkbox("Tiled search##barcode_tiled", &m_inputs.barcode_tiled);
+        ImGui::SameLine();
+        HelpMarker(
+            "Scan overlapping tiles at several scales in parallel.\n"
+            "Slower on small selections, but finds small codes on large screens.");
+        if (m_inputs.barcode_tiled)
+        {
+            ImGui::SameLine();
+            ImGui::Checkbox("First code only##barcode_first_only", &m_inputs.barcode_first_only);
+        }
+
+        if (ImGui::BeginTable("##barcode_symbologies", 3))
+        {
+            for (size_t i = 0; i < ZBAR_SYMBOLOGIES.size(); ++i)
+            {
+                ImGui::TableNextColumn();
+                const std::string label(ZBAR_SYMBOLOGIES[i].first);
+                changed |= ImGui::Checkbox(label.c_str(), &m_inputs.barcode_symbologies[i]);
+            }
+            ImGui::EndTable();
+        }
+
+        if (changed)
+        {
+            std::vector<std::string> names;
+            for (size_t i = 0; i < ZBAR_SYMBOLOGIES.size(); ++i)
+                if (m_inputs.barcode_symbologies[i])
+                    names.emplace_back(ZBAR_SYMBOLOGIES[i].first);
+            if (const Result<>& res = m_zbar_api.SetSymbologies(names); !res.ok())
+                SetError(m_zbar_errors, ZbarError::FailedToScan, res.error_v());
+            m_zbar_api.SetDensity(m_inputs.barcode_density);
+        }
         ImGui::TreePop();
     }
 
@@ -1792,22 +2043,26 @@ void ScreenshotTool::DrawAnnotationToolbar()
             {
                 ImGui::SliderFloat("##thickness", &m_tool_thickness[idx(m_current_tool)], 1.0f, 10.0f, "%.2f");
                 ImGui::SameLine();
-                ImGui::TextUnformatted("Thickness");
+                ImGui::TextUnformatted(is_redaction(m_current_tool) ? "Strength" : "Thickness");
             }
 
-            if (ImGui::Button("Pick color"))
+            // Redactions have no color, only what's under them
+            if (!is_redaction(m_current_tool))
             {
-                m_current_actions.Set(CurrentAction::IsColorPicking);
-                ImGui::CloseCurrentPopup();
-            }
-            ImGui::SameLine();
-            HelpMarker("Click anywhere on the image to pick a color");
+                if (ImGui::Button("Pick color"))
+                {
+                    m_current_actions.Set(CurrentAction::IsColorPicking);
+                    ImGui::CloseCurrentPopup();
+                }
+                ImGui::SameLine();
+                HelpMarker("Click anywhere on the image to pick a color");
 
-            ImVec4 picker = m_current_color.to_imvec4();
-            ImGui::ColorPicker4("Color", reinterpret_cast<float*>(&picker), flags);
+                ImVec4 picker = m_current_color.to_imvec4();
+                ImGui::ColorPicker4("Color", reinterpret_cast<float*>(&picker), flags);
 
-            m_current_color = rgba_t(picker);
-            g_cache->SetValue(CacheEntry::AnnColor, m_current_color.to_rgba());
+                m_current_color = rgba_t(picker);
+                g_cache->SetValue(CacheEntry::AnnColor, m_current_color.to_rgba());
+            }
             ImGui::EndPopup();
         }
 
@@ -1824,6 +2079,8 @@ void ScreenshotTool::DrawAnnotationToolbar()
     draw_and_set_button(ToolType::CounterBubble, "##Counter_bubble", m_tool_textures[idx(ToolType::CounterBubble)]);
     draw_and_set_button(ToolType::Text, "##icon_Text", m_tool_textures[idx(ToolType::Text)]);
     draw_and_set_button(ToolType::Pencil, "##Pencil", m_tool_textures[idx(ToolType::Pencil)]);
+    draw_and_set_button(ToolType::Blur, "##Blur", m_tool_textures[idx(ToolType::Blur)]);
+    draw_and_set_button(ToolType::Pixelate, "##Pixelate", m_tool_textures[idx(ToolType::Pixelate)]);
 
     ImGui::SameLine(0, 16.0f);
 
@@ -1848,8 +2105,8 @@ void ScreenshotTool::DrawAnnotationToolbar()
     ImGui::Separator();
 
     ImGui::SameLine();
-    if (ImGui::Button("Undo") && !m_annotations.empty())
-        m_annotations.pop_back();
+    if (ImGui::Button("Undo"))
+        UndoAnnotation();
 
     ImGui::End();
 }
@@ -1890,6 +2147,12 @@ static void draw_preference_edit_config(const std::function<void()>& refresh_mod
     // --- OCR model ---
     ImGui::Text("Default OCR model");
     ImGui::InputText("##config_ocr_model", &g_config->File.ocr_model);
+    ImGui::Checkbox("Route text blocks by script##config_ocr_script_routing", &g_config->File.ocr_script_routing);
+    ImGui::SameLine();
+    HelpMarker(
+        "When the model combines several languages (e.g. \"eng+jpn+chi_sim\"), detect the script of each text block "
+        "and recognize it with only the matching model. Faster than running all of them at once.\n"
+        "Requires 'osd.traineddata' in the OCR path.");
     ImGui::Spacing();
 
     // --- Capture delay ---
@@ -1967,6 +2230,12 @@ static void draw_preference_edit_config(const std::function<void()>& refresh_mod
         "Shortcut to use when copying the image selection.\n"
         "If disabled, the shortcut will be CTRL+SHIFT+C.");
 
+    ImGui::Checkbox("Smooth pencil strokes##config_smooth_pencil", &g_config->File.smooth_pencil);
+    ImGui::SameLine();
+    HelpMarker(
+        "Pencil strokes are always reduced to the points that shape them once drawn.\n"
+        "When enabled, they're then redrawn as a smooth curve through those points.");
+
     // --- Image filename output format section ---
     ImGui::Dummy(ImVec2(0, 8));
     ImGui::Separator();
@@ -1992,6 +2261,52 @@ static void draw_preference_edit_config(const std::function<void()>& refresh_mod
         ImGui::EndCombo();
     }
 
+    if (g_config->File.image_out_type.second == ImageExt::PNG)
+    {
+        ImGui::Spacing();
+        ImGui::Text("PNG encoder");
+        ImGui::SameLine();
+        HelpMarker("\"fast\" is oshot's own encoder, \"stb\" the old one, in case \"fast\" gives you trouble.");
+        if (ImGui::BeginCombo("##config_png_encoder", g_config->File.png_encoder.first.c_str()))
+        {
+            for (const auto& [name, backend] : PNG_BACKENDS)
+            {
+                const bool selected = g_config->File.png_encoder.second == backend;
+                if (ImGui::Selectable(name.data(), selected))
+                    g_config->File.png_encoder = { std::string(name), backend };
+
+                if (selected)
+                    ImGui::SetItemDefaultFocus();
+            }
+            ImGui::EndCombo();
+        }
+
+        if (g_config->File.png_encoder.second == PngBackend::Fast)
+        {
+            ImGui::SliderInt(
+                "Compression level##config_png_level", &g_config->File.png_level, PNG_LEVEL_MIN, PNG_LEVEL_MAX);
+            ImGui::SameLine();
+            HelpMarker("1 is the fastest, 9 the smallest.\nPast 3 it gets noticeably slower on big captures.");
+        }
+    }
+    else if (g_config->File.image_out_type.second == ImageExt::JPEG)
+    {
+        ImGui::Spacing();
+        ImGui::SliderInt(
+            "Quality##config_jpeg_quality", &g_config->File.jpeg_quality, JPEG_QUALITY_MIN, JPEG_QUALITY_MAX);
+    }
+
+    ImGui::Spacing();
+
+    ImGui::Text("Max size (KiB)");
+    ImGui::SameLine();
+    HelpMarker("Fit saved and copied images under this size, 0 to turn it off.\n"
+               "JPEG gets the highest quality that fits, the other formats can only be shrunk.");
+    if (ImGui::InputInt("##config_image_out_max_kib", &g_config->File.image_out_max_kib, 64, 1024))
+        g_config->File.image_out_max_kib = std::max(g_config->File.image_out_max_kib, 0);
+    if (g_config->File.image_out_max_kib > 0)
+        ImGui::Checkbox("Shrink if needed##config_fit_downscale", &g_config->File.fit_downscale);
+
     ImGui::Spacing();
 
     ImGui::Text("Size preview unit");
@@ -3557,6 +3872,8 @@ void ScreenshotTool::DrawAnnotations()
             case ToolType::CounterBubble:   draw_counter_bubble(ann, p1, p2, t); break;
             case ToolType::Text:            draw_text(ann, p1); break;
             case ToolType::Pencil:          draw_pencil(ann, t); break;
+            case ToolType::Blur:
+            case ToolType::Pixelate:        break;  // in the screenshot texture itself
 
             case ToolType::kNone:
             case ToolType::ToggleTextTools:
@@ -3573,6 +3890,17 @@ void ScreenshotTool::DrawAnnotations()
     // Render current annotation being drawn on top of committed ones
     if (m_current_actions.Has(CurrentAction::IsDrawing))
         draw_annotation(m_current_annotation);
+
+    // Where a redaction being drawn ends, its effect may be hard to tell apart
+    if (m_current_actions.Has(CurrentAction::IsDrawing) && is_redaction(m_current_annotation.type))
+    {
+        const annotation_t& ann = m_current_annotation;
+        draw_list->AddRect(ImVec2(std::min(ann.start.x, ann.end.x), std::min(ann.start.y, ann.end.y)),
+                           ImVec2(std::max(ann.start.x, ann.end.x), std::max(ann.start.y, ann.end.y)),
+                           IM_COL32(255, 255, 255, 160),
+                           0.0f,
+                           dpi);
+    }
 }
 
 void ScreenshotTool::Cancel()
@@ -3598,6 +3926,10 @@ void ScreenshotTool::Cancel()
 
     // (just clears our references, not the actual ImGui fonts)
     m_font_cache.clear();
+    m_glyph_cache.Clear();
+    m_ann_layer      = {};
+    m_redacted       = {};
+    m_redacted_count = 0;
 
     if (m_on_cancel)
         m_on_cancel();
@@ -3613,6 +3945,11 @@ bool ScreenshotTool::OpenImage(const std::string& path)
 
     m_screenshot = std::move(cap.get());
     fit_to_screen(m_screenshot);
+    ResetOcr();
+    m_ann_layer               = {};
+    m_redacted                = {};
+    m_redacted_count          = 0;
+    m_inputs.zbar_scan_result = {};
 
 #if OSHOT_MACOS
     // Tell backend to recreate Metal texture
@@ -3653,15 +3990,22 @@ bool ScreenshotTool::OpenImage(const std::string& path)
 capture_result_t ScreenshotTool::GetFinalImage(bool is_text_tools)
 {
     UpdateWindowBg();
+    return RenderImage(GetActiveRegion(), is_text_tools);
+}
 
-    const region_t& region = GetActiveRegion();
-
+capture_result_t ScreenshotTool::RenderImage(const region_t& region, bool is_text_tools)
+{
     capture_result_t result;
     result.w = region.width;
     result.h = region.height;
     result.data.resize(size_t(region.width) * region.height * 4);
 
-    std::span<const uint8_t> src(m_screenshot.view());
+    // Redactions are annotations too, left out along with the others
+    const bool with_anns = !(is_text_tools && !g_config->File.render_anns) && !m_annotations.empty();
+    if (with_anns)
+        SyncRedactions();
+
+    std::span<const uint8_t> src(with_anns ? RedactedScreenshot().view() : m_screenshot.view());
     std::span<uint8_t>       dst(result.data);
 
     const int src_width = m_screenshot.w;
@@ -3690,310 +4034,580 @@ capture_result_t ScreenshotTool::GetFinalImage(bool is_text_tools)
         }
     }
 
-    if (is_text_tools && !g_config->File.render_anns)
+    if (!with_anns)
         return result;
 
-    // Render annotations to the final image
-    const float offset_x = m_selection.get_x();
-    const float offset_y = m_selection.get_y();
+    // Composite the annotation layer over the crop, only where something was ever drawn on it
+    SyncAnnotationLayer();
+    const region_t area = region_intersect(region, m_ann_layer_extent);
+    for (int y = area.y; y < area.y + area.height; ++y)
+    {
+        uint8_t*       out   = result.data.data() + (size_t(y - region.y) * dst_width + size_t(area.x - region.x)) * 4;
+        const uint8_t* layer = m_ann_layer.data.data() + (size_t(y) * m_ann_layer.w + size_t(area.x)) * 4;
+        composite_span(out, layer, size_t(area.width));
+    }
+
+    return result;
+}
+
+// Pixels `ann` may draw into, a bit generous: only used to know where it can't
+static region_t annotation_extent(const annotation_t& ann, ImVec2 offset, std::span<const placed_glyph_t> glyphs)
+{
+    float x0 = std::numeric_limits<float>::max(), y0 = x0;
+    float x1 = std::numeric_limits<float>::lowest(), y1 = x1;
+    auto  add = [&](float x, float y, float pad) {
+        x0 = std::min(x0, x - offset.x - pad);
+        y0 = std::min(y0, y - offset.y - pad);
+        x1 = std::max(x1, x - offset.x + pad);
+        y1 = std::max(y1, y - offset.y + pad);
+    };
+
+    const float t = ann.thickness;
+    switch (ann.type)
+    {
+        case ToolType::Circle:
+        case ToolType::CircleFilled:
+        case ToolType::CounterBubble:
+            add(ann.start.x, ann.start.y, std::hypot(ann.end.x - ann.start.x, ann.end.y - ann.start.y) + t + 2);
+            break;
+        case ToolType::Pencil:
+            for (const point_t& p : ann.points)
+                add(p.x, p.y, t + 2);
+            break;
+        case ToolType::Blur:
+        case ToolType::Pixelate:
+            return {};  // in the screenshot, not the layer
+        default:
+            // Arrow heads stick out 2 thicknesses from the shaft
+            add(ann.start.x, ann.start.y, 2 * t + 2);
+            add(ann.end.x, ann.end.y, 2 * t + 2);
+            break;
+    }
+
+    for (const placed_glyph_t& g : glyphs)
+    {
+        x0 = std::min(x0, float(g.x));
+        y0 = std::min(y0, float(g.y));
+        x1 = std::max(x1, float(g.x + g.mask->w));
+        y1 = std::max(y1, float(g.y + g.mask->h));
+    }
+
+    if (!(x0 < x1 && y0 < y1))
+        return {};
+
+    const int ix0 = int(std::floor(x0)), iy0 = int(std::floor(y0));
+    return { ix0, iy0, int(std::ceil(x1)) - ix0, int(std::ceil(y1)) - iy0 };
+}
+
+// Touches nothing but `raster`, strips of the annotation layer get drawn from several threads at once
+static void rasterize_annotation(Rasterizer&                     raster,
+                                 const annotation_t&             ann,
+                                 ImVec2                          offset,
+                                 std::span<const placed_glyph_t> glyphs)
+{
+    const float offset_x = offset.x;
+    const float offset_y = offset.y;
+
+    auto center = [](point_t p) { return point_t{ p.x + 0.5f, p.y + 0.5f }; };
+
+    // Text, and the count in a counter bubble, laid out by PlaceAnnotationText()
+    for (const placed_glyph_t& g : glyphs)
+        for (int row = 0; row < g.mask->h; ++row)
+            raster.BlendRow(g.x, g.y + row, g.mask->cov.data() + size_t(row) * g.mask->w, g.mask->w, ann.color);
 
-    auto set_pixel = [&](int x, int y, rgba_t color) {
-        if (x < 0 || x >= result.w || y < 0 || y >= result.h)
+    const point_t a{ ann.start.x - offset_x, ann.start.y - offset_y };
+    const point_t b{ ann.end.x - offset_x, ann.end.y - offset_y };
+    const float   t = ann.thickness;
+
+    // Same geometry as DrawAnnotations(), ImGui strokes lines through pixel centers
+    if (ann.type == ToolType::CounterBubble || ann.type == ToolType::Circle)
+    {
+        const float r = std::hypot(b.x - a.x, b.y - a.y) - 0.5f;
+        raster.FillRing(a, r + t * 0.5f, std::max(0.0f, r - t * 0.5f), ann.color);
+    }
+
+    else if (ann.type == ToolType::Line)
+    {
+        raster.AddLine(center(a), center(b), t);
+        raster.Fill(ann.color);
+    }
+
+    else if (ann.type == ToolType::Arrow)
+    {
+        const float dx  = b.x - a.x;
+        const float dy  = b.y - a.y;
+        const float len = std::sqrt(dx * dx + dy * dy);
+        if (len < 1.0f)
             return;
 
-        size_t   idx = (size_t(y) * result.w + x) * 4;
-        uint8_t* p   = &result.data[idx];
+        const float   head_len = std::min(6.0f * t, len * 0.6f);
+        const float   head_w   = 4.0f * t;
+        const point_t dir{ dx / len, dy / len };
+        const point_t base{ b.x - dir.x * head_len, b.y - dir.y * head_len };
+        const point_t head[]   = { b,
+                                   { base.x - dir.y * head_w * 0.5f, base.y + dir.x * head_w * 0.5f },
+                                   { base.x + dir.y * head_w * 0.5f, base.y - dir.x * head_w * 0.5f } };
+
+        raster.AddLine(center(a), center(base), t);
+        raster.AddPolygon(head);
+        raster.Fill(ann.color);
+    }
+
+    else if (ann.type == ToolType::Rectangle)
+    {
+        const float rx1 = std::min(a.x, b.x) + 0.5f, rx2 = std::max(a.x, b.x) - 0.5f;
+        const float ry1 = std::min(a.y, b.y) + 0.5f, ry2 = std::max(a.y, b.y) - 0.5f;
+        const float h   = t * 0.5f;
 
-        if (color.a == 0xFF)
+        const point_t outer[] = {
+            { rx1 - h, ry1 - h }, { rx2 + h, ry1 - h }, { rx2 + h, ry2 + h }, { rx1 - h, ry2 + h }
+        };
+        raster.AddPolygon(outer);
+        if (rx2 - rx1 > t && ry2 - ry1 > t)
         {
-            store_rgba(p, color);
-            return;
+            const point_t inner[] = {
+                { rx1 + h, ry1 + h }, { rx2 - h, ry1 + h }, { rx2 - h, ry2 - h }, { rx1 + h, ry2 - h }
+            };
+            raster.AddPolygon(inner, true);
         }
+        raster.Fill(ann.color);
+    }
 
-        rgba_t dst = load_rgba(p);
-        store_rgba(p, blend(color, dst));
-    };
+    else if (ann.type == ToolType::RectangleFilled)
+    {
+        raster.FillRect(a.x, a.y, b.x, b.y, ann.color);
+    }
 
-    auto draw_line = [&](int x0, int y0, int x1, int y1, rgba_t color, float thickness) {
-        // Bresenham's line algorithm with thickness
-        int dx     = std::abs(x1 - x0);
-        int dy     = std::abs(y1 - y0);
-        int sx     = x0 < x1 ? 1 : -1;
-        int sy     = y0 < y1 ? 1 : -1;
-        int err    = dx - dy;
-        int radius = int(thickness / 2.0f);
+    else if (ann.type == ToolType::CircleFilled)
+    {
+        raster.FillRing(a, std::hypot(b.x - a.x, b.y - a.y), 0.0f, ann.color);
+    }
 
-        while (true)
+    else if (ann.type == ToolType::Pencil)
+    {
+        // One fill for the whole stroke, round joins so a translucent one stays even at its turns
+        for (size_t i = 0; i < ann.points.size(); ++i)
         {
-            // Draw thick point
-            for (int oy = -radius; oy <= radius; ++oy)
-                for (int ox = -radius; ox <= radius; ++ox)
-                    if (ox * ox + oy * oy <= radius * radius)
-                        set_pixel(x0 + ox, y0 + oy, color);
+            const point_t p{ ann.points[i].x - offset_x, ann.points[i].y - offset_y };
+            if (i > 0)
+                raster.AddLine({ ann.points[i - 1].x - offset_x, ann.points[i - 1].y - offset_y }, p, t);
+            if (i > 0 && i + 1 < ann.points.size())
+                raster.AddDisc(p, t * 0.5f);
+        }
+        raster.Fill(ann.color);
+    }
+}
 
-            if (x0 == x1 && y0 == y1)
-                break;
+void ScreenshotTool::SyncAnnotationLayer()
+{
+    // Anything moving or restyling every annotation means drawing them all again
+    if (m_ann_layer.w != m_screenshot.w || m_ann_layer.h != m_screenshot.h ||
+        m_ann_layer_origin.x != m_image_origin.x || m_ann_layer_origin.y != m_image_origin.y ||
+        m_ann_layer_font != m_inputs.resolved_ann_font_path)
+    {
+        m_ann_layer.w = m_screenshot.w;
+        m_ann_layer.h = m_screenshot.h;
+        m_ann_layer.data.assign(size_t(m_ann_layer.w) * m_ann_layer.h * 4, 0);
+        m_ann_layer_bounds.clear();
+        m_ann_layer_extent = {};
+        m_ann_layer_dirty  = {};
+        m_ann_layer_origin = m_image_origin;
+        m_ann_layer_font   = m_inputs.resolved_ann_font_path;
+    }
 
-            int e2 = 2 * err;
-            if (e2 > -dy)
-            {
-                err -= dy;
-                x0 += sx;
-            }
-            if (e2 < dx)
-            {
-                err += dx;
-                y0 += sy;
-            }
-        }
+    // Undone annotations: clear what they covered and redraw, in order, what's left there
+    if (m_ann_layer_dirty.width > 0 && m_ann_layer_dirty.height > 0)
+    {
+        const region_t& dirty = m_ann_layer_dirty;
+        for (int y = dirty.y; y < dirty.y + dirty.height; ++y)
+            std::memset(m_ann_layer.data.data() + (size_t(y) * m_ann_layer.w + size_t(dirty.x)) * 4,
+                        0,
+                        size_t(dirty.width) * 4);
+
+        std::vector<size_t> redraw;
+        for (size_t i = 0; i < m_ann_layer_bounds.size(); ++i)
+            if (region_intersect(m_ann_layer_bounds[i], dirty).width > 0)
+                redraw.push_back(i);
+        RasterizeIntoLayer(redraw, dirty);
+        m_ann_layer_dirty = {};
+    }
+
+    // New ones go on top of everything
+    std::vector<size_t> added;
+    for (size_t i = m_ann_layer_bounds.size(); i < m_annotations.size(); ++i)
+        added.push_back(i);
+    if (added.empty())
+        return;
+
+    for (const region_t& bounds : RasterizeIntoLayer(added, { 0, 0, m_ann_layer.w, m_ann_layer.h }))
+    {
+        m_ann_layer_bounds.push_back(bounds);
+        m_ann_layer_extent = region_union(m_ann_layer_extent, bounds);
+    }
+}
+
+std::vector<region_t> ScreenshotTool::RasterizeIntoLayer(std::span<const size_t> which, const region_t& clip)
+{
+    struct job_t
+    {
+        const annotation_t*         ann;
+        std::vector<placed_glyph_t> glyphs;
+        region_t                    extent;
     };
 
-    for (const annotation_t& ann : m_annotations)
+    // Text is laid out here, ImGui and the glyph cache are for this thread only
+    std::vector<job_t> jobs;
+    jobs.reserve(which.size());
+    for (const size_t i : which)
     {
-        int x1 = int(ann.start.x - offset_x);
-        int y1 = int(ann.start.y - offset_y);
-        int x2 = int(ann.end.x - offset_x);
-        int y2 = int(ann.end.y - offset_y);
-        int cx = x1;
-        int cy = y1;
-
-        int radius = int(std::sqrt((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1)));
-
-        // Previous switch case has been moved to an if/elseif long branch for keeping away duplicated code because of the counter bubble being
-        // a combination of a circle and text inside it.
-        // Please stfu, the compiler will make ts into a switch case automatically. Stop fighting the machine
-        if (ann.type == ToolType::Text || ann.type == ToolType::CounterBubble)
-        {
-            const std::string& label = ann.type == ToolType::CounterBubble ? fmt::to_string(ann.count) : ann.text;
+        job_t& job = jobs.emplace_back();
+        job.ann    = &m_annotations[i];
+        job.glyphs = PlaceAnnotationText(*job.ann, m_ann_layer_origin);
+        job.extent = region_intersect(annotation_extent(*job.ann, m_ann_layer_origin, job.glyphs), clip);
+    }
 
-            if (label.empty())
-                continue;
+    size_t work = 0;
+    for (const job_t& job : jobs)
+        work += size_t(std::max(job.extent.width, 0)) * size_t(std::max(job.extent.height, 0));
+
+    const size_t jobs_cfg  = g_config->Runtime.jobs > 0 ? size_t(g_config->Runtime.jobs) : 0;
+    const size_t hw        = jobs_cfg ? jobs_cfg : std::max(1u, std::thread::hardware_concurrency());
+    const size_t max_strip = clip.height > 0 ? size_t(clip.height - 1) / ANN_LAYER_STRIP_ROWS + 1 : 0;
+    const size_t nthreads  = work >= ANN_LAYER_PARALLEL_MIN_PIXELS ? std::clamp<size_t>(hw, 1, max_strip) : 1;
+
+    // The clip in strips of whole rows, each with the annotations that reach into it.
+    // Strips share no pixels and the rasterizer draws the same ones whatever it's clipped to,
+    // so they can be drawn in any order, by any number of threads, and still match drawing at once
+    // (which is what one thread does: strips would only make it redo each outline for all of them).
+    const int                        strip_rows = nthreads > 1 ? ANN_LAYER_STRIP_ROWS : std::max(clip.height, 1);
+    const size_t                     nstrips    = clip.height > 0 ? size_t(clip.height - 1) / strip_rows + 1 : 0;
+    std::vector<std::vector<size_t>> bins(nstrips);
+    for (size_t j = 0; j < jobs.size(); ++j)
+    {
+        const region_t& e = jobs[j].extent;
+        if (e.width <= 0 || e.height <= 0)
+            continue;
 
-            float font_size;
-            if (ann.type == ToolType::CounterBubble)
-                font_size = std::max(8.0f, float(radius) * 1.4f);  // ~70 % of diameter so the digit has breathing room
-            else
-                font_size = ann.thickness > 8.0f ? ann.thickness : ImGui::GetFontSize();
+        for (size_t s = size_t(e.y - clip.y) / strip_rows; s <= size_t(e.y + e.height - 1 - clip.y) / strip_rows; ++s)
+            bins[s].push_back(j);
+    }
 
-            ImFont* font = CacheAndGetFont(m_inputs.resolved_ann_font_path, font_size);
-            if (!font || !font->OwnerAtlas)
-                continue;
+    // Bounds drawn by each of a strip's annotations
+    std::vector<std::vector<region_t>> drawn(nstrips);
 
-            ImFontBaked* baked = font->GetFontBaked(font_size);
-            if (!baked)
-                continue;
+    auto draw_strip = [&](size_t s) {
+        const int  y = clip.y + int(s) * strip_rows;
+        Rasterizer raster(m_ann_layer);
+        raster.SetClip({ clip.x, y, clip.width, std::min(strip_rows, clip.y + clip.height - y) });
+        for (const size_t j : bins[s])
+        {
+            raster.ResetBounds();
+            rasterize_annotation(raster, *jobs[j].ann, m_ann_layer_origin, jobs[j].glyphs);
+            drawn[s].push_back(raster.GetBounds());
+        }
+    };
 
-            ImTextureData* tex = font->OwnerAtlas->TexData;
-            // from obsolete GetTexDataAsFormat()
-            if (!font->OwnerAtlas->TexIsBuilt || tex == NULL || tex->Pixels == NULL)
-            {
-                ImFontAtlasBuildMain(font->OwnerAtlas);
-                tex = font->OwnerAtlas->TexData;
-            }
-            unsigned char* pixels  = tex->Pixels;
-            int            atlas_w = tex->Width, atlas_h = tex->Height;
-            if (!pixels || atlas_w == 0 || atlas_h == 0)
-                continue;
+    std::atomic<size_t> next{ 0 };
+    auto                worker = [&] {
+        for (size_t s = next.fetch_add(1); s < nstrips; s = next.fetch_add(1))
+            draw_strip(s);
+    };
 
-            const char* p   = label.c_str();
-            const char* end = p + label.size();
+    m_raster_workers.Run(nthreads, worker);
 
-            float cursor_x;
-            float cursor_y;
-            if (ann.type == ToolType::CounterBubble)
-            {
-                // Measure total advance to compute the centered origin
-                float total_w = 0.0f;
-                float total_h = font_size;  // approximate; refined below
-                {
-                    const char* pp  = label.c_str();
-                    const char* end = p + label.size();
-                    while (pp < end)
-                    {
-                        unsigned int cp = 0;
-                        pp += ImTextCharFromUtf8(&cp, pp, end);
-                        if (cp == 0)
-                            break;
-                        const ImFontGlyph* g = baked->FindGlyph(ImWchar(cp));
-                        if (g)
-                        {
-                            total_w += g->AdvanceX;
-                            total_h = std::max(total_h, g->Y1 - g->Y0);
-                        }
-                    }
-                }
+    std::vector<region_t> bounds(jobs.size());
+    for (size_t s = 0; s < nstrips; ++s)
+        for (size_t k = 0; k < bins[s].size(); ++k)
+            bounds[bins[s][k]] = region_union(bounds[bins[s][k]], drawn[s][k]);
 
-                cursor_x = float(cx) - total_w * 0.5f;
-                cursor_y = float(cy) - total_h * 0.5f;
-            }
-            else
-            {
-                cursor_x = x1;
-                cursor_y = y2;
-            }
+    return bounds;
+}
 
-            while (p < end)
-            {
-                unsigned int codepoint = 0;
-                p += ImTextCharFromUtf8(&codepoint, p, end);
-                if (codepoint == 0)
-                    break;
-
-                const ImFontGlyph* glyph = baked->FindGlyph(ImWchar(codepoint));
-                if (!glyph)
-                    continue;
-
-                const int dst_x0 = int(cursor_x + glyph->X0);
-                const int dst_y0 = int(cursor_y + glyph->Y0);
-                const int dst_x1 = int(cursor_x + glyph->X1);
-                const int dst_y1 = int(cursor_y + glyph->Y1);
-
-                const int src_x0 = int(glyph->U0 * atlas_w);
-                const int src_y0 = int(glyph->V0 * atlas_h);
-                const int src_x1 = int(glyph->U1 * atlas_w);
-                const int src_y1 = int(glyph->V1 * atlas_h);
-
-                const int dst_gw = dst_x1 - dst_x0;
-                const int dst_gh = dst_y1 - dst_y0;
-                const int src_gw = src_x1 - src_x0;
-                const int src_gh = src_y1 - src_y0;
-
-                if (dst_gw <= 0 || dst_gh <= 0 || src_gw <= 0 || src_gh <= 0)
-                {
-                    cursor_x += glyph->AdvanceX;
-                    continue;
-                }
+std::vector<placed_glyph_t> ScreenshotTool::PlaceAnnotationText(const annotation_t& ann, ImVec2 offset)
+{
+    if (ann.type != ToolType::Text && ann.type != ToolType::CounterBubble)
+        return {};
+
+    const std::string& label = ann.type == ToolType::CounterBubble ? fmt::to_string(ann.count) : ann.text;
+    if (label.empty())
+        return {};
+
+    const int x1     = int(ann.start.x - offset.x);
+    const int y1     = int(ann.start.y - offset.y);
+    const int x2     = int(ann.end.x - offset.x);
+    const int y2     = int(ann.end.y - offset.y);
+    const int radius = int(std::sqrt((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1)));
+
+    float font_size;
+    if (ann.type == ToolType::CounterBubble)
+        font_size = std::max(8.0f, float(radius) * 1.4f);  // ~70 % of diameter so the digit has breathing room
+    else
+        font_size = ann.thickness > 8.0f ? ann.thickness : ImGui::GetFontSize();
 
-                const uint32_t* font_pixels = reinterpret_cast<const uint32_t*>(pixels);
-                rgba_t          col         = ann.color;
-                for (int dy = 0; dy < dst_gh; ++dy)
-                {
-                    const int src_ay = src_y0 + dy * src_gh / dst_gh;
-                    if (src_ay < 0 || src_ay >= atlas_h)
-                        continue;
+    const Result<int>& font = LoadAnnotationFont();
+    if (!font.ok())
+        return {};
 
-                    for (int dx = 0; dx < dst_gw; ++dx)
-                    {
-                        const int src_ax = src_x0 + dx * src_gw / dst_gw;
-                        if (src_ax < 0 || src_ax >= atlas_w)
-                            continue;
-
-                        const uint32_t atlas_px    = font_pixels[src_ay * atlas_w + src_ax];
-                        const uint8_t  glyph_alpha = uint8_t((atlas_px >> 24) & 0xFF);
-                        if (glyph_alpha == 0)
-                            continue;
-
-                        uint8_t src_a = col.a * glyph_alpha / 255u;
-                        rgba_t  pixel(col.r, col.g, col.b, src_a);
-                        set_pixel(dst_x0 + dx, dst_y0 + dy, pixel);
-                    }
-                }
+    // Decode first, so the label can be measured before anything is placed
+    std::vector<uint32_t> codepoints;
+    for (const char *p = label.c_str(), *end = p + label.size(); p < end;)
+    {
+        unsigned int cp = 0;
+        p += ImTextCharFromUtf8(&cp, p, end);
+        if (cp == 0)
+            break;
+        codepoints.push_back(cp);
+    }
 
-                cursor_x += glyph->AdvanceX;
-            }
+    float cursor_x;
+    float cursor_y;
+    if (ann.type == ToolType::CounterBubble)
+    {
+        // Measure total advance to compute the centered origin
+        float total_w = 0.0f;
+        float total_h = font_size;  // at least a line, more if a glyph is taller
+        for (const uint32_t cp : codepoints)
+        {
+            const std::shared_ptr<const glyph_mask_t>& g = m_glyph_cache.GetGlyph(font.get(), font_size, cp);
+            total_w += g->advance;
+            total_h = std::max(total_h, float(g->h));
         }
 
-        if (ann.type == ToolType::CounterBubble || ann.type == ToolType::Circle)
-        {
-            // Midpoint circle algorithm
-            int x       = radius;
-            int y       = 0;
-            int err     = 0;
-            int thick_r = int(ann.thickness / 2.0f);
+        cursor_x = float(x1) - total_w * 0.5f;
+        cursor_y = float(y1) - total_h * 0.5f;
+    }
+    else
+    {
+        cursor_x = x1;
+        cursor_y = y2;
+    }
 
-            while (x >= y)
-            {
-                for (int oy = -thick_r; oy <= thick_r; ++oy)
-                    for (int ox = -thick_r; ox <= thick_r; ++ox)
-                        if (ox * ox + oy * oy <= thick_r * thick_r)
-                        {
-                            set_pixel(cx + x + ox, cy + y + oy, ann.color);
-                            set_pixel(cx + y + ox, cy + x + oy, ann.color);
-                            set_pixel(cx - y + ox, cy + x + oy, ann.color);
-                            set_pixel(cx - x + ox, cy + y + oy, ann.color);
-                            set_pixel(cx - x + ox, cy - y + oy, ann.color);
-                            set_pixel(cx - y + ox, cy - x + oy, ann.color);
-                            set_pixel(cx + y + ox, cy - x + oy, ann.color);
-                            set_pixel(cx + x + ox, cy - y + oy, ann.color);
-                        }
+    std::vector<placed_glyph_t> glyphs;
+    const int                   baseline = int(std::floor(cursor_y + m_glyph_cache.GetAscent(font.get(), font_size)));
+    for (const uint32_t cp : codepoints)
+    {
+        std::shared_ptr<const glyph_mask_t> g   = m_glyph_cache.GetGlyph(font.get(), font_size, cp, cursor_x);
+        const int                           pen = int(std::floor(cursor_x));
+        cursor_x += g->advance;
+        if (g->w > 0 && g->h > 0)
+            glyphs.push_back({ g, pen + g->x, baseline + g->y });
+    }
+
+    return glyphs;
+}
 
-                y += 1;
-                err += 1 + 2 * y;
-                if (2 * (err - x) + 1 > 0)
+void ScreenshotTool::SyncRedactions()
+{
+    const region_t full{ 0, 0, m_screenshot.w, m_screenshot.h };
+
+    // Moving every annotation means applying them all again
+    if (m_redacted_origin.x != m_image_origin.x || m_redacted_origin.y != m_image_origin.y ||
+        (!m_redacted.data.empty() && (m_redacted.w != m_screenshot.w || m_redacted.h != m_screenshot.h)))
+    {
+        if (!m_redacted.data.empty())
+            m_redacted_stale = full;
+        m_redacted        = {};
+        m_redacted_count  = 0;
+        m_redacted_origin = m_image_origin;
+    }
+    if (m_redacted.data.empty())
+        m_redacted_dirty = {};
+
+    // Undone ones: back to the screenshot wherever they reached, and so did any redaction overlapping that,
+    // then those that are left done again there in order. Each reads only its own area, so that's all it takes.
+    if (m_redacted_dirty.width > 0 && m_redacted_dirty.height > 0)
+    {
+        std::vector<std::pair<const annotation_t*, region_t>> left;
+        for (size_t i = 0; i < m_redacted_count; ++i)
+            if (is_redaction(m_annotations[i].type))
+                left.emplace_back(&m_annotations[i],
+                                  region_intersect(redaction_area(m_annotations[i], m_redacted_origin), full));
+
+        region_t area = region_intersect(m_redacted_dirty, full);
+        for (bool grew = true; grew;)
+        {
+            grew = false;
+            for (const auto& [ann, a] : left)
+            {
+                const region_t u = region_union(area, a);
+                if (region_intersect(area, a).width > 0 && (u.width != area.width || u.height != area.height))
                 {
-                    x -= 1;
-                    err += 1 - 2 * x;
+                    area = u;
+                    grew = true;
                 }
             }
         }
 
-        else if (ann.type == ToolType::Line)
+        if (left.empty())
         {
-            draw_line(x1, y1, x2, y2, ann.color, ann.thickness);
+            m_redacted = {};
         }
-
-        else if (ann.type == ToolType::Arrow)
+        else
         {
-            draw_line(x1, y1, x2, y2, ann.color, ann.thickness);
-            // Draw arrowhead
-            float dx  = x2 - x1;
-            float dy  = y2 - y1;
-            float len = std::sqrt(dx * dx + dy * dy);
-            if (len > 0.1f)
+            for (int y = area.y; y < area.y + area.height; ++y)
             {
-                dx /= len;
-                dy /= len;
-                float arrow_size = 15.0f + ann.thickness;
-                int   ax1        = int(x2 - arrow_size * dx + arrow_size * 0.5f * dy);
-                int   ay1        = int(y2 - arrow_size * dy - arrow_size * 0.5f * dx);
-                int   ax2        = int(x2 - arrow_size * dx - arrow_size * 0.5f * dy);
-                int   ay2        = int(y2 - arrow_size * dy + arrow_size * 0.5f * dx);
-                draw_line(x2, y2, ax1, ay1, ann.color, ann.thickness);
-                draw_line(x2, y2, ax2, ay2, ann.color, ann.thickness);
+                const size_t off = (size_t(y) * m_screenshot.w + size_t(area.x)) * 4;
+                std::memcpy(m_redacted.data.data() + off, m_screenshot.data.data() + off, size_t(area.width) * 4);
             }
+            for (const auto& [ann, a] : left)
+                if (region_intersect(area, a).width > 0)
+                    apply_redaction(m_redacted, *ann, a);
         }
 
-        else if (ann.type == ToolType::Rectangle)
-        {
-            draw_line(x1, y1, x2, y1, ann.color, ann.thickness);
-            draw_line(x2, y1, x2, y2, ann.color, ann.thickness);
-            draw_line(x2, y2, x1, y2, ann.color, ann.thickness);
-            draw_line(x1, y2, x1, y1, ann.color, ann.thickness);
-        }
+        m_redacted_stale = region_union(m_redacted_stale, area);
+        m_redacted_dirty = {};
+    }
 
-        else if (ann.type == ToolType::RectangleFilled)
-        {
-            int rx1 = std::min(x1, x2);
-            int rx2 = std::max(x1, x2);
-            int ry1 = std::min(y1, y2);
-            int ry2 = std::max(y1, y2);
-            for (int fy = ry1; fy <= ry2; ++fy)
-                for (int fx = rx1; fx <= rx2; ++fx)
-                    set_pixel(fx, fy, ann.color);
-        }
+    // New ones over the rest
+    for (; m_redacted_count < m_annotations.size(); ++m_redacted_count)
+    {
+        const annotation_t& ann = m_annotations[m_redacted_count];
+        if (!is_redaction(ann.type))
+            continue;
 
-        else if (ann.type == ToolType::CircleFilled)
-        {
-            for (int fy = cy - radius; fy <= cy + radius; ++fy)
-                for (int fx = cx - radius; fx <= cx + radius; ++fx)
-                    if ((fx - cx) * (fx - cx) + (fy - cy) * (fy - cy) <= radius * radius)
-                        set_pixel(fx, fy, ann.color);
-        }
+        const region_t area = region_intersect(redaction_area(ann, m_redacted_origin), full);
+        if (area.width <= 0)
+            continue;
 
-        else if (ann.type == ToolType::Pencil)
-        {
-            for (size_t i = 1; i < ann.points.size(); ++i)
-            {
-                int px1 = int(ann.points[i - 1].x - offset_x);
-                int py1 = int(ann.points[i - 1].y - offset_y);
-                int px2 = int(ann.points[i].x - offset_x);
-                int py2 = int(ann.points[i].y - offset_y);
-                draw_line(px1, py1, px2, py2, ann.color, ann.thickness);
-            }
-        }
+        if (m_redacted.data.empty())
+            m_redacted = m_screenshot;
+        apply_redaction(m_redacted, ann, area);
+        m_redacted_stale = region_union(m_redacted_stale, area);
     }
+}
 
-    return result;
+void ScreenshotTool::UpdateRedactionTexture()
+{
+    SyncRedactions();
+
+#if OSHOT_MACOS
+    // The backend only takes whole images: committed redactions show, the one being drawn is just outlined
+    if (m_redacted_stale.width > 0 && m_on_image_reload)
+        m_on_image_reload(RedactedScreenshot());
+    m_redacted_stale = {};
+#else
+    if (!m_texture_id._TexID)
+        return;
+
+    const capture_result_t& base = RedactedScreenshot();
+    const region_t          full{ 0, 0, base.w, base.h };
+
+    region_t preview;
+    if (m_current_actions.Has(CurrentAction::IsDrawing) && is_redaction(m_current_annotation.type))
+        preview = region_intersect(redaction_area(m_current_annotation, m_image_origin), full);
+
+    // Only what changed is uploaded: committed redactions, and the base again where the last preview was
+    const region_t& last  = m_redact_preview_area;
+    const bool      moved = preview.x != last.x || preview.y != last.y || preview.width != last.width ||
+                       preview.height != last.height;
+    region_t restore = m_redacted_stale;
+    if (moved)
+        restore = region_union(restore, last);
+    restore = region_intersect(restore, full);
+    if (restore.width > 0)
+        upload_texture_area(m_texture_id, base, restore, restore.x, restore.y);
+
+    // The one being drawn on a copy of its area, the same pixels it'll have once committed
+    if (preview.width > 0 && (moved || region_intersect(restore, preview).width > 0))
+    {
+        m_redact_preview.w = preview.width;
+        m_redact_preview.h = preview.height;
+        m_redact_preview.data.resize(size_t(preview.width) * preview.height * 4);
+        for (int y = 0; y < preview.height; ++y)
+            std::memcpy(m_redact_preview.data.data() + size_t(y) * preview.width * 4,
+                        base.data.data() + (size_t(preview.y + y) * base.w + size_t(preview.x)) * 4,
+                        size_t(preview.width) * 4);
+
+        const region_t all{ 0, 0, preview.width, preview.height };
+        apply_redaction(m_redact_preview, m_current_annotation, all);
+        upload_texture_area(m_texture_id, m_redact_preview, all, preview.x, preview.y);
+    }
+
+    m_redact_preview_area = preview;
+    m_redacted_stale      = {};
+#endif
+}
+
+void ScreenshotTool::AddAnnotation(const annotation_t& ann)
+{
+    m_annotations.push_back(ann);
+    ++m_annotations_gen;
+}
+
+void ScreenshotTool::UndoAnnotation()
+{
+    if (m_annotations.empty())
+        return;
+
+    // A redaction already applied leaves its area to be redone without it
+    if (m_redacted_count == m_annotations.size() && is_redaction(m_annotations.back().type))
+        m_redacted_dirty = region_union(m_redacted_dirty, redaction_area(m_annotations.back(), m_redacted_origin));
+    m_redacted_count = std::min(m_redacted_count, m_annotations.size() - 1);
+
+    m_annotations.pop_back();
+    ++m_annotations_gen;
+
+    // Only what it covered in the annotation layer has to be redrawn
+    if (m_ann_layer_bounds.size() > m_annotations.size())
+    {
+        m_ann_layer_dirty = region_union(m_ann_layer_dirty, m_ann_layer_bounds.back());
+        m_ann_layer_bounds.pop_back();
+
+        m_ann_layer_extent = {};
+        for (const region_t& bounds : m_ann_layer_bounds)
+            m_ann_layer_extent = region_union(m_ann_layer_extent, bounds);
+    }
+}
+
+void ScreenshotTool::RequestSizeEstimate()
+{
+    UpdateWindowBg();
+
+    const region_t region = GetActiveRegion();
+    const ImageExt ext       = g_config->File.image_out_type.second;
+    const size_t   max_bytes = size_t(g_config->File.image_out_max_kib) * 1024;
+    if (region.width <= 0 || region.height <= 0)
+        return;
+
+    const size_t pixels = size_t(region.width) * region.height;
+    if (pixels <= SizeEstimator::EXACT_MAX_PIXELS)
+    {
+        m_size_estimator.Request(RenderImage(region), ext, 1.0, max_bytes);
+        return;
+    }
+
+    // Render only a few evenly spaced strips of rows and stack them.
+    // Each strip is tall enough for the encoders to see the vertical redundancy
+    // screenshots are full of, and together they're about as cheap as the biggest exact estimate.
+    const int bands  = std::min(SizeEstimator::SAMPLE_BANDS, region.height);
+    const int band_h = std::max<int>(
+        8, SizeEstimator::EXACT_MAX_PIXELS / (size_t(region.width) * SizeEstimator::SAMPLE_BANDS));
+    if (size_t(bands) * band_h >= size_t(region.height))
+    {
+        m_size_estimator.Request(RenderImage(region), ext, 1.0, max_bytes);
+        return;
+    }
+
+    capture_result_t sample;
+    sample.w = region.width;
+    sample.h = bands * band_h;
+    sample.data.reserve(size_t(sample.w) * sample.h * 4);
+
+    const int stride = (region.height - band_h) / std::max(1, bands - 1);
+    for (int i = 0; i < bands; ++i)
+    {
+        const int y = std::min(i * stride, region.height - band_h);
+
+        region_t band = region;
+        band.y += y;
+        band.height = band_h;
+
+        const capture_result_t strip = RenderImage(band);
+        sample.data.insert(sample.data.end(), strip.data.begin(), strip.data.end());
+    }
+
+    const double scale = double(region.height) / sample.h;
+    m_size_estimator.Request(std::move(sample), ext, scale, max_bytes);
 }
 
 region_t ScreenshotTool::GetActiveRegion() const
@@ -4043,6 +4657,26 @@ void ScreenshotTool::UpdateWindowBg()
     // clang-format on
 }
 
+Result<int> ScreenshotTool::LoadAnnotationFont()
+{
+    const std::string& path = m_inputs.resolved_ann_font_path;
+    if (!path.empty())
+    {
+        const Result<int>& font = m_glyph_cache.LoadFont(path);
+        if (font.ok())
+            return Ok(font.get());
+    }
+
+    // Whatever ImGui draws its text with, a configured font or the built-in one
+    const ImFont* font = ImGui::GetDefaultFont();
+    if (!font || font->Sources.empty() || !font->Sources[0]->FontData)
+        return Err("No font to render annotations with");
+
+    const ImFontConfig* src = font->Sources[0];
+    return m_glyph_cache.LoadFont(
+        "<default>", { static_cast<const uint8_t*>(src->FontData), size_t(std::max(0, src->FontDataSize)) });
+}
+
 ImFont* ScreenshotTool::CacheAndGetFont(const std::string& font_path, const float font_size)
 {
     if (font_path.empty())
@@ -4098,6 +4732,16 @@ void ScreenshotTool::SyncRuntimeFromConfig()
     m_inputs.ocr_model = g_config->File.ocr_model;
     RefreshOcrModels();
 
+    const std::vector<std::string>& syms     = g_config->File.barcode_symbologies;
+    const bool                      all_syms = std::find(syms.begin(), syms.end(), "all") != syms.end();
+    for (size_t i = 0; i < ZBAR_SYMBOLOGIES.size(); ++i)
+        m_inputs.barcode_symbologies[i] =
+            all_syms || std::find(syms.begin(), syms.end(), ZBAR_SYMBOLOGIES[i].first) != syms.end();
+    m_inputs.barcode_density = g_config->File.barcode_density;
+    if (const Result<>& res = m_zbar_api.SetSymbologies(syms); !res.ok())
+        spdlog::warn("{}", res.error_v());
+    m_zbar_api.SetDensity(m_inputs.barcode_density);
+
     // Sync annotation font
     m_inputs.ann_font               = g_config->File.fonts.empty() ? "" : g_config->File.fonts[0];
     m_inputs.resolved_ann_font_path = get_font_path(m_inputs.ann_font).string();
@@ -4226,3 +4870,164 @@ Result<ImTextureRef> ScreenshotTool::CreateTexture(void* tex, std::span<const ui
     return Ok(ref);
 #endif
 }
+
+// Counts what an encoder produces without keeping it,
+// and stops it as soon as a newer request comes in.
+class CountingSink final : public ImageSink
+{
+public:
+    CountingSink(const std::atomic<uint64_t>& generation, uint64_t mine) : m_generation(generation), m_mine(mine) {}
+
+    bool Write(const uint8_t*, size_t size) override
+    {
+        if (m_generation.load(std::memory_order_relaxed) != m_mine)
+            return false;
+        m_count += size;
+        return true;
+    }
+
+    size_t Count() const { return m_count; }
+
+private:
+    const std::atomic<uint64_t>& m_generation;
+    uint64_t                     m_mine;
+    size_t                       m_count = 0;
+};
+
+void SizeEstimator::Request(capture_result_t sample, ImageExt ext, double scale, size_t max_bytes)
+{
+    {
+        std::lock_guard lk(m_mtx);
+        m_pending = request_t{ std::move(sample), ext, scale, max_bytes };
+        ++m_generation;
+        if (!m_thread.joinable())
+        {
+            m_stop   = false;
+            m_thread = std::thread(&SizeEstimator::Loop, this);
+        }
+    }
+    m_cv.notify_one();
+}
+
+void SizeEstimator::Stop()
+{
+    {
+        std::lock_guard lk(m_mtx);
+        m_stop = true;
+        m_pending.reset();
+        ++m_generation;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+void SizeEstimator::Loop()
+{
+    while (true)
+    {
+        request_t req;
+        uint64_t  generation;
+        {
+            std::unique_lock lk(m_mtx);
+            m_cv.wait(lk, [&] { return m_stop || m_pending; });
+            if (m_stop)
+                break;
+
+            req        = std::move(*m_pending);
+            generation = m_generation.load();
+            m_pending.reset();
+        }
+
+        size_t bytes   = 0;
+        int    quality = 0;
+        float  scale   = 1;
+        if (req.max_bytes > 0)
+        {
+            // A sample has to fit under its share of the limit
+            const Result<fit_result_t>& res = encode_to_image_fit(
+                req.sample, req.ext, size_t(double(req.max_bytes) / req.scale), [&] {
+                    return m_generation.load(std::memory_order_relaxed) != generation;
+                });
+            if (!res.ok())
+                continue;
+            bytes   = res.get().data.size();
+            quality = res.get().quality;
+            scale   = res.get().scale;
+        }
+        else
+        {
+            CountingSink sink(m_generation, generation);
+            if (!encode_to_image(req.sample, req.ext, sink).ok())
+                continue;
+            bytes = sink.Count();
+        }
+
+        // Superseded: the newer request fills it in
+        if (m_generation.load() != generation)
+            continue;
+
+        m_bytes.store(size_t(double(bytes) * req.scale), std::memory_order_relaxed);
+        m_exact.store(req.scale == 1.0, std::memory_order_relaxed);
+        m_fit_quality.store(quality, std::memory_order_relaxed);
+        m_fit_scale.store(scale, std::memory_order_relaxed);
+    }
+}
+
+void WorkerPool::Run(size_t nthreads, const std::function<void()>& fn)
+{
+    if (nthreads <= 1)
+    {
+        fn();
+        return;
+    }
+
+    {
+        std::lock_guard lk(m_mtx);
+        m_stop = false;
+        while (m_threads.size() + 1 < nthreads)
+            m_threads.emplace_back(&WorkerPool::Loop, this);
+        m_fn     = &fn;
+        m_wanted = nthreads - 1;
+    }
+    m_cv.notify_all();
+
+    fn();
+
+    std::unique_lock lk(m_mtx);
+    m_wanted = 0;
+    m_done_cv.wait(lk, [&] { return m_running == 0; });
+    m_fn = nullptr;
+}
+
+void WorkerPool::Stop()
+{
+    {
+        std::lock_guard lk(m_mtx);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    for (std::thread& t : m_threads)
+        t.join();
+    m_threads.clear();
+}
+
+void WorkerPool::Loop()
+{
+    std::unique_lock lk(m_mtx);
+    while (true)
+    {
+        m_cv.wait(lk, [&] { return m_stop || m_wanted > 0; });
+        if (m_stop)
+            break;
+
+        --m_wanted;
+        ++m_running;
+        const std::function<void()>& fn = *m_fn;
+        lk.unlock();
+        fn();
+        lk.lock();
+        if (--m_running == 0)
+            m_done_cv.notify_one();
+    }
+}
@@ -0,0 +1,169 @@
+/*
+ * Copyright 2026 Toni500
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ * disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ * following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ * products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "stroke.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+static point_t lerp(point_t a, point_t b, float t) { return { a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t }; }
+
+static float distance(point_t a, point_t b) { return std::hypot(b.x - a.x, b.y - a.y); }
+
+// Whether the stroke turns by more than ~75 degrees at b, coming from a and going on to c
+static bool is_corner(point_t a, point_t b, point_t c)
+{
+    const float ab = distance(a, b), bc = distance(b, c);
+    if (ab <= 0 || bc <= 0)
+        return false;
+    return ((b.x - a.x) * (c.x - b.x) + (b.y - a.y) * (c.y - b.y)) / (ab * bc) < 0.25f;
+}
+
+// Distance from `p` to the segment a-b (not its line: a stroke may double back past its ends)
+static float segment_distance(point_t p, point_t a, point_t b)
+{
+    const float dx  = b.x - a.x;
+    const float dy  = b.y - a.y;
+    const float len = dx * dx + dy * dy;
+    if (len <= 0)
+        return distance(p, a);
+
+    const float t = std::clamp(((p.x - a.x) * dx + (p.y - a.y) * dy) / len, 0.0f, 1.0f);
+    return distance(p, { a.x + dx * t, a.y + dy * t });
+}
+
+std::vector<point_t> simplify_polyline(std::span<const point_t> pts, float tolerance)
+{
+    if (pts.size() < 3)
+        return { pts.begin(), pts.end() };
+
+    std::vector<bool> keep(pts.size(), false);
+    keep.front() = keep.back() = true;
+
+    // Ranges still to split, on a stack rather than recursing: strokes can be thousands of points
+    std::vector<std::pair<size_t, size_t>> ranges{ { 0, pts.size() - 1 } };
+    while (!ranges.empty())
+    {
+        const auto [first, last] = ranges.back();
+        ranges.pop_back();
+
+        float  farthest = 0;
+        size_t split    = first;
+        for (size_t i = first + 1; i < last; ++i)
+        {
+            const float d = segment_distance(pts[i], pts[first], pts[last]);
+            if (d > farthest)
+            {
+                farthest = d;
+                split    = i;
+            }
+        }
+
+        if (farthest <= tolerance)
+            continue;
+
+        keep[split] = true;
+        ranges.push_back({ first, split });
+        ranges.push_back({ split, last });
+    }
+
+    std::vector<point_t> out;
+    for (size_t i = 0; i < pts.size(); ++i)
+        if (keep[i])
+            out.push_back(pts[i]);
+    return out;
+}
+
+std::vector<point_t> smooth_polyline(std::span<const point_t> pts, float tolerance)
+{
+    if (pts.size() < 3)
+        return { pts.begin(), pts.end() };
+
+    // Ends get a neighbour mirrored from the inside one, so the curve leaves them heading straight at it
+    auto at = [&](ptrdiff_t i) -> point_t {
+        const ptrdiff_t n = ptrdiff_t(pts.size());
+        if (i < 0)
+            return lerp(pts[1], pts[0], 2.0f);
+        if (i >= n)
+            return lerp(pts[size_t(n - 2)], pts[size_t(n - 1)], 2.0f);
+        return pts[size_t(i)];
+    };
+
+    std::vector<point_t> out{ pts.front() };
+    for (size_t i = 0; i + 1 < pts.size(); ++i)
+    {
+        const point_t p0 = at(ptrdiff_t(i) - 1), p1 = pts[i], p2 = pts[i + 1], p3 = at(ptrdiff_t(i) + 2);
+
+        // The piece from p1 to p2 as a cubic Bezier, knots spaced by the square root of the distances
+        const float d1 = std::sqrt(distance(p0, p1));
+        const float d2 = std::sqrt(distance(p1, p2));
+        const float d3 = std::sqrt(distance(p2, p3));
+        if (d2 <= 0)
+            continue;
+
+        // Corners stay corners: the curve leaves and reaches them straight along the chord
+        point_t c1 = p1, c2 = p2;
+        if (d1 > 0 && !is_corner(p0, p1, p2))
+        {
+            const float k = 3 * d1 * (d1 + d2);
+            const float a = 2 * d1 * d1 + 3 * d1 * d2 + d2 * d2;
+            c1 = { (d1 * d1 * p2.x - d2 * d2 * p0.x + a * p1.x) / k, (d1 * d1 * p2.y - d2 * d2 * p0.y + a * p1.y) / k };
+        }
+        if (d3 > 0 && !is_corner(p1, p2, p3))
+        {
+            const float k = 3 * d3 * (d3 + d2);
+            const float a = 2 * d3 * d3 + 3 * d3 * d2 + d2 * d2;
+            c2 = { (d3 * d3 * p1.x - d2 * d2 * p3.x + a * p2.x) / k, (d3 * d3 * p1.y - d2 * d2 * p3.y + a * p2.y) / k };
+        }
+
+        // Handles no longer than a third of the chord, nor further off it than 4/3 of the tolerance.
+        // The curve then strays at most `tolerance` from the chord, where simplify_polyline() left
+        // every point it dropped, instead of swinging wide past a turn between long segments.
+        const float   chord = distance(p1, p2);
+        const point_t dir{ (p2.x - p1.x) / chord, (p2.y - p1.y) / chord };
+        auto          limit = [&](point_t from, point_t handle) {
+            const float len  = distance(from, handle);
+            const float side = std::fabs((handle.x - from.x) * dir.y - (handle.y - from.y) * dir.x);
+            const float k    = std::min(chord / 3 / std::max(len, 1e-6f), tolerance * 4 / 3 / std::max(side, 1e-6f));
+            return lerp(from, handle, std::min(k, 1.0f));
+        };
+        c1 = limit(p1, c1);
+        c2 = limit(p2, c2);
+
+        // n chords stray at most 3/4 of the largest second difference of the control points, over n^2
+        const float dd   = std::max(distance(lerp(p1, c2, 0.5f), c1), distance(lerp(c1, p2, 0.5f), c2)) * 2;
+        const float flat = std::max(tolerance, 0.01f);
+        const int   n    = std::clamp(int(std::ceil(std::sqrt(0.75f * dd / flat))), 1, 32);
+        for (int s = 1; s < n; ++s)
+        {
+            const float   t = float(s) / float(n);
+            const point_t a = lerp(p1, c1, t), b = lerp(c1, c2, t), c = lerp(c2, p2, t);
+            out.push_back(lerp(lerp(a, b, t), lerp(b, c, t), t));
+        }
+        out.push_back(p2);
+    }
+    return out;
+}
@@ -25,20 +25,30 @@
 
 #include "text_extraction.hpp"
 
+#include <tesseract/ocrclass.h>
 #include <tesseract/publictypes.h>
 #include <zbar.h>
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <cmath>
 #include <cstring>
+#include <mutex>
 #include <numbers>
+#include <string_view>
+#include <thread>
 #include <utility>
 #include <vector>
 
 #include "config.hpp"
 #include "screen_capture.hpp"
+#include "stb_image_resize2.h"
 #include "util.hpp"
 
+using ms_t = std::chrono::duration<double, std::milli>;
+
 // --------------------
 // OCR
 // --------------------
@@ -196,6 +206,80 @@ static Pix* rgba_to_pix(std::span<const uint8_t> rgba, int w, int h)
     return pix;
 }
 
+// Tesseract OSD script name -> single-language models that can read it, in order of preference
+struct script_models_t
+{
+    std::string_view                script;
+    std::array<std::string_view, 6> models;
+};
+
+static constexpr std::array<script_models_t, 13> SCRIPT_MODELS = { {
+    { "Latin", { "eng", "deu", "fra", "spa", "ita", "por" } },
+    { "Han", { "chi_sim", "chi_tra", "jpn" } },
+    { "Japanese", { "jpn", "jpn_vert" } },
+    { "Hiragana", { "jpn", "jpn_vert" } },
+    { "Katakana", { "jpn", "jpn_vert" } },
+    { "Hangul", { "kor", "kor_vert" } },
+    { "Korean", { "kor", "kor_vert" } },
+    { "Cyrillic", { "rus", "ukr", "bul", "srp", "bel" } },
+    { "Arabic", { "ara", "fas", "urd" } },
+    { "Greek", { "ell" } },
+    { "Hebrew", { "heb" } },
+    { "Devanagari", { "hin", "mar", "nep", "san" } },
+    { "Thai", { "tha" } },
+} };
+
+// The model `script` is routed to, out of the ones included in the configured model
+static std::string_view script_to_model(std::string_view script, std::string_view configured)
+{
+    auto has_model = [&](std::string_view m) {
+        size_t pos = 0;
+        while (pos <= configured.size())
+        {
+            size_t end = configured.find('+', pos);
+            if (end == configured.npos)
+                end = configured.size();
+            if (configured.substr(pos, end - pos) == m)
+                return true;
+            pos = end + 1;
+        }
+        return false;
+    };
+
+    for (const script_models_t& entry : SCRIPT_MODELS)
+    {
+        if (entry.script != script)
+            continue;
+        for (std::string_view m : entry.models)
+            if (!m.empty() && has_model(m))
+                return m;
+        break;
+    }
+    return {};
+}
+
+// Whether script detection can send blocks of `configured` to different models.
+// With a single one to route to (e.g. "eng+fra", where OSD can't tell the two apart anyway),
+// it would only cost the OSD pass and drop the other languages, so the combined model is used as is.
+static bool can_route_scripts(std::string_view configured)
+{
+    if (configured.find('+') == configured.npos)
+        return false;
+
+    std::string_view first;
+    for (const script_models_t& entry : SCRIPT_MODELS)
+    {
+        const std::string_view model = script_to_model(entry.script, configured);
+        if (model.empty())
+            continue;
+        if (first.empty())
+            first = model;
+        else if (model != first)
+            return true;
+    }
+    return false;
+}
+
 OcrAPI::OcrAPI() : m_api(std::make_unique<tesseract::TessBaseAPI>())
 {}
 
@@ -207,7 +291,7 @@ OcrAPI::~OcrAPI()
 
 Result<> OcrAPI::Configure(const char* data_path, const char* model, tesseract::OcrEngineMode oem)
 {
-    ocr_config_t next{ data_path, model };
+    ocr_config_t next{ data_path, model, oem };
 
     if (m_config && *m_config == next)
         return Ok();  // nothing to do
@@ -219,14 +303,133 @@ Result<> OcrAPI::Configure(const char* data_path, const char* model, tesseract::
         m_initialized = false;
     }
 
+    // The routed engines are tied to the old path/model too
+    m_osd_api.reset();
+    m_script_apis.clear();
+    m_script_cache.reset();
+    m_attached.clear();
+    m_osd_unavailable = false;
+
     if (m_api->Init(data_path, model, oem) != 0)
         return Err("Failed to Init OCR engine");
 
+    m_can_route   = can_route_scripts(next.model);
     m_config      = std::move(next);
     m_initialized = true;
     return Ok();
 }
 
+Result<std::vector<OcrAPI::script_block_t>> OcrAPI::DetectScripts(PIX*            pix,
+                                                                  size_t          serial,
+                                                                  const region_t& rect,
+                                                                  size_t          key)
+{
+    if (m_script_cache && m_script_cache->key == key)
+        return Ok(m_script_cache->blocks);
+
+    if (m_osd_unavailable)
+        return Err("OSD model not available");
+
+    if (!m_osd_api)
+    {
+        // OSD only exists for the legacy engine
+        m_osd_api = std::make_unique<tesseract::TessBaseAPI>();
+        if (m_osd_api->Init(m_config->path.c_str(), "osd", tesseract::OEM_TESSERACT_ONLY) != 0)
+        {
+            m_osd_api.reset();
+            m_osd_unavailable = true;
+            return Err("Failed to Init OSD engine (is 'osd.traineddata' in '{}'?)", m_config->path);
+        }
+    }
+
+    // Below this the script guess is mostly noise, let the combined model handle it.
+    static constexpr float MIN_SCRIPT_CONF = 1.0f;
+
+    std::vector<script_block_t> blocks;
+    Attach(m_osd_api.get(), pix, serial);
+    m_osd_api->SetPageSegMode(tesseract::PSM_AUTO_ONLY);
+    m_osd_api->SetRectangle(rect.x, rect.y, rect.width, rect.height);
+
+    std::vector<region_t> boxes;
+    if (Boxa* boxa = m_osd_api->GetComponentImages(tesseract::RIL_BLOCK, true, nullptr, nullptr))
+    {
+        const int n = boxaGetCount(boxa);
+        for (int i = 0; i < n; ++i)
+        {
+            Box*     box = boxaGetBox(boxa, i, L_CLONE);
+            region_t r;
+            boxGetGeometry(box, &r.x, &r.y, &r.width, &r.height);
+            boxDestroy(&box);
+            boxes.push_back(r);
+        }
+        boxaDestroy(&boxa);
+    }
+    if (boxes.empty())
+        boxes.push_back(rect);
+
+    for (const region_t& r : boxes)
+    {
+        script_block_t block{ r.x, r.y, r.width, r.height, {} };
+        int            orient_deg  = 0;
+        float          orient_conf = 0.f, script_conf = 0.f;
+        const char*    script      = nullptr;
+
+        m_osd_api->SetRectangle(r.x, r.y, r.width, r.height);
+        if (m_osd_api->DetectOrientationScript(&orient_deg, &orient_conf, &script, &script_conf) && script &&
+            script_conf >= MIN_SCRIPT_CONF)
+        {
+            block.model = script_to_model(script, m_config->model);
+            spdlog::debug("OSD block {}x{}+{}+{}: script {} ({:.2f}) -> '{}'",
+                          r.width,
+                          r.height,
+                          r.x,
+                          r.y,
+                          script,
+                          script_conf,
+                          block.model);
+        }
+        blocks.push_back(std::move(block));
+    }
+
+    // Same script everywhere: recognize the whole image in one go,
+    // so the result is exactly what a single-model run would give.
+    const bool same_model = std::all_of(
+        blocks.begin(), blocks.end(), [&](const script_block_t& b) { return b.model == blocks.front().model; });
+    if (same_model)
+        blocks = { { rect.x, rect.y, rect.width, rect.height, blocks.front().model } };
+
+    m_script_cache = script_cache_t{ key, blocks };
+    return Ok(std::move(blocks));
+}
+
+tesseract::TessBaseAPI* OcrAPI::GetScriptEngine(const std::string& model)
+{
+    if (model.empty() || model == m_config->model)
+        return m_api.get();
+
+    if (const auto& it = m_script_apis.find(model); it != m_script_apis.end())
+        return it->second.get();
+
+    auto api = std::make_unique<tesseract::TessBaseAPI>();
+    if (api->Init(m_config->path.c_str(), model.c_str(), m_config->oem) != 0)
+    {
+        spdlog::warn("Failed to Init OCR engine for '{}', using '{}' instead", model, m_config->model);
+        return m_api.get();
+    }
+
+    return m_script_apis.emplace(model, std::move(api)).first->second.get();
+}
+
+void OcrAPI::Attach(tesseract::TessBaseAPI* api, PIX* pix, size_t serial)
+{
+    size_t& attached = m_attached[api];
+    if (attached == serial)
+        return;
+
+    api->SetImage(pix);
+    attached = serial;
+}
+
 // From "  hello world  \n  " to "hello world"
 static void trim(std::string& s)
 {
@@ -235,10 +438,23 @@ static void trim(std::string& s)
     s.erase(std::find_if(s.rbegin(), s.rend(), not_ws).base(), s.end());
 }
 
-Result<ocr_result_t> OcrAPI::ExtractTextCapture(const capture_result_t& cap)
+static size_t hash_combine(size_t seed, size_t v)
 {
-    ocr_result_t ret;
+    return seed ^ (v + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
 
+static int effective_dpi(int w, int h)
+{
+    // Querying it opens a display connection, don't do that for every image
+    static const int screen_dpi = get_screen_dpi();
+
+    float scale = std::min(float(g_scr_w) / w, float(g_scr_h) / h);
+    return std::clamp(int(screen_dpi * scale), 150, 300);
+}
+
+Result<ocr_result_t> OcrAPI::ExtractTextCapture(const capture_result_t&                       cap,
+                                                const std::function<void(std::string_view)>& on_partial)
+{
     if (!m_initialized)
         return Err("Initialize the engine first");
 
@@ -250,70 +466,276 @@ Result<ocr_result_t> OcrAPI::ExtractTextCapture(const capture_result_t& cap)
         return Err(fmt::format(
             "Image buffer too small: got {} bytes, need {} ({}x{} × 4)", cap.view().size(), required, cap.w, cap.h));
 
-    PixPtr raw_pix(rgba_to_pix(cap.view(), cap.w, cap.h));
+    const auto start = std::chrono::steady_clock::now();
+    PixPtr     raw_pix(rgba_to_pix(cap.view(), cap.w, cap.h));
     if (!raw_pix)
         return Err("Failed to convert image into Pix format");
+    const auto converted = std::chrono::steady_clock::now();
 
     // Preprocess: dark-bg inversion, upscale, deskew.
     // Returns grayscale so Tesseract's LSTM engine retains stroke-gradient info.
     PixPtr pix(preprocess_pix(raw_pix.get()));
     if (!pix)
         return Err("Failed to preprocess image");
+    const auto preprocessed = std::chrono::steady_clock::now();
 
     // Use the binarized pix dimensions for PSM (they may differ after deskew rotation)
-    const int proc_w = pixGetWidth(pix.get());
-    const int proc_h = pixGetHeight(pix.get());
+    const region_t rect{ 0, 0, pixGetWidth(pix.get()), pixGetHeight(pix.get()) };
+
+    size_t key =
+        std::hash<std::string_view>{}(std::string_view(reinterpret_cast<const char*>(cap.view().data()), required));
+    key = hash_combine(hash_combine(key, cap.w), cap.h);
+
+    Result<ocr_result_t> ret =
+        RecognizePix(pix.get(), m_next_serial++, rect, effective_dpi(cap.w, cap.h), key, on_partial);
+    if (ret.ok())
+    {
+        ret.get().timings.convert_ms    = ms_t(converted - start).count();
+        ret.get().timings.preprocess_ms = ms_t(preprocessed - converted).count();
+    }
+    return ret;
+}
 
-    tesseract::PageSegMode psm = choose_psm(proc_w, proc_h);
+Result<ocr_result_t> OcrAPI::ExtractTextRegion(const capture_result_t&                       frame,
+                                               const region_t&                               region,
+                                               size_t                                        frame_id,
+                                               const std::function<void(std::string_view)>& on_partial)
+{
+    if (!m_initialized)
+        return Err("Initialize the engine first");
 
-    float scale         = std::min(float(g_scr_w) / cap.w, float(g_scr_h) / cap.h);
-    int   effective_dpi = int(get_screen_dpi() * scale);
-    effective_dpi       = std::clamp(effective_dpi, 150, 300);
+    if (frame.view().empty() || frame.w <= 0 || frame.h <= 0)
+        return Err("Image is empty");
 
-    m_api->SetPageSegMode(psm);
-    m_api->SetImage(pix.get());
-    m_api->SetSourceResolution(effective_dpi);
+    if (region.width <= 0 || region.height <= 0 || region.x < 0 || region.y < 0 ||
+        region.width > frame.w - region.x || region.height > frame.h - region.y)
+        return Err("Region {}x{}+{}+{} is outside of the {}x{} image",
+                   region.width,
+                   region.height,
+                   region.x,
+                   region.y,
+                   frame.w,
+                   frame.h);
 
-    // Make OCR + confidence deterministic
-    if (m_api->Recognize(nullptr) != 0)
-        return Err("tesseract::Recognize() failed");
+    auto crop_fallback = [&]() { return ExtractTextCapture(crop_capture(frame, region), on_partial); };
 
-    TextPtr text(m_api->GetUTF8Text(), [](char* p) { delete[] p; });
-    if (!text)
-        return Err("Failed to get recognized text");
+    // preprocess_pix() upscales tiny crops before recognition, which can't be done on a shared frame.
+    // Those are cheap to convert anyway.
+    if (region.height < 200)
+        return crop_fallback();
 
-    std::string data(text.get());
-    trim(data);
-    if (data.empty())
-        return Err(fmt::format(
-            "No text recognized (PSM: {}, {}x{} px, DPI: {})", psm_to_str(psm), proc_w, proc_h, effective_dpi));
+    const auto start = std::chrono::steady_clock::now();
+    if (!m_frame || m_frame->id != frame_id)
+    {
+        const size_t required = size_t(frame.w) * frame.h * 4;
+        if (frame.view().size() < required)
+            return Err(fmt::format("Image buffer too small: got {} bytes, need {} ({}x{} × 4)",
+                                   frame.view().size(),
+                                   required,
+                                   frame.w,
+                                   frame.h));
 
-    ret.data    = std::move(data);
-    ret.psm_str = psm_to_str(psm);
-    ret.psm     = std::move(psm);
+        m_frame.reset();
+
+        PixPtr raw_pix(rgba_to_pix(frame.view(), frame.w, frame.h));
+        if (!raw_pix)
+            return Err("Failed to convert image into Pix format");
 
-    if (tesseract::ResultIterator* ri = m_api->GetIterator())
+        // Same luma conversion as preprocess_pix()
+        PixPtr no_alpha(pixRemoveAlpha(raw_pix.get()));
+        PixPtr gray(pixConvertRGBToGray(no_alpha ? no_alpha.get() : raw_pix.get(), 0.299f, 0.587f, 0.114f));
+        if (!gray)
+            return Err("Failed to preprocess image");
+
+        spdlog::debug("OCR frame {} ({}x{}) preprocessed", frame_id, frame.w, frame.h);
+        m_frame = frame_cache_t{ frame_id, std::move(gray), nullptr, m_next_serial++, 0 };
+    }
+
+    // Dark-bg detection and deskew still depend on the selection, so probe just that part of the frame
+    PIX*      pix      = m_frame->gray.get();
+    size_t    serial   = m_frame->gray_serial;
+    l_float32 mean_val = 128.f;
+    Box*      box      = boxCreate(region.x, region.y, region.width, region.height);
+    PixPtr    region_pix(pixClipRectangle(pix, box, nullptr));
+    boxDestroy(&box);
+    if (region_pix)
+        pixGetAverageMasked(region_pix.get(), nullptr, 0, 0, 1, L_MEAN_ABSVAL, &mean_val);
+
+    if (mean_val < 128.f)
     {
-        double sum   = 0.0;
-        int    count = 0;
-        do
+        if (!m_frame->inverted)
         {
-            float conf = ri->Confidence(tesseract::RIL_WORD);
-            if (conf >= 0.0f)
-            {
-                sum += conf;
-                ++count;
-            }
-        } while (ri->Next(tesseract::RIL_WORD));
+            // Max-channel + invert, see preprocess_pix()
+            PixPtr raw_pix(rgba_to_pix(frame.view(), frame.w, frame.h));
+            PixPtr no_alpha(raw_pix ? pixRemoveAlpha(raw_pix.get()) : nullptr);
+            PixPtr max_gray(pixConvertRGBToGrayMinMax(no_alpha ? no_alpha.get() : raw_pix.get(), L_CHOOSE_MAX));
+            if (!max_gray)
+                return Err("Failed to preprocess image");
 
-        ret.confidence = count ? int(std::round(sum / count)) : 0;
-        delete ri;
+            m_frame->inverted.reset(pixInvert(nullptr, max_gray.get()));
+            if (!m_frame->inverted)
+                return Err("Failed to preprocess image");
+            m_frame->inverted_serial = m_next_serial++;
+        }
+
+        pix    = m_frame->inverted.get();
+        serial = m_frame->inverted_serial;
+        box    = boxCreate(region.x, region.y, region.width, region.height);
+        region_pix.reset(pixClipRectangle(pix, box, nullptr));
+        boxDestroy(&box);
     }
-    else
+
+    // A skewed selection needs the rotated crop preprocess_pix() makes
+    if (region_pix)
+    {
+        PixPtr    bin(pixThresholdToBinary(region_pix.get(), 128));
+        l_float32 angle = 0.f, conf = 0.f;
+        if (bin && pixFindSkew(bin.get(), &angle, &conf) == 0 && std::abs(angle) > 0.4f && conf > 1.5f)
+            return crop_fallback();
+    }
+
+    size_t key = hash_combine(frame_id, serial);
+    key        = hash_combine(hash_combine(key, region.x), region.y);
+    key        = hash_combine(hash_combine(key, region.width), region.height);
+
+    const auto           preprocessed = std::chrono::steady_clock::now();
+    Result<ocr_result_t> ret =
+        RecognizePix(pix, serial, region, effective_dpi(region.width, region.height), key, on_partial);
+    if (ret.ok())
+        ret.get().timings.preprocess_ms = ms_t(preprocessed - start).count();
+    return ret;
+}
+
+Result<ocr_result_t> OcrAPI::RecognizePix(PIX*                                          pix,
+                                          size_t                                        serial,
+                                          const region_t&                               rect,
+                                          int                                           dpi,
+                                          size_t                                        key,
+                                          const std::function<void(std::string_view)>& on_partial)
+{
+    ocr_result_t           ret;
+    tesseract::PageSegMode psm = m_psm ? *m_psm : choose_psm(rect.width, rect.height);
+
+    const auto start = std::chrono::steady_clock::now();
+
+    // Script routing: only worth it when the configured model combines several scripts (e.g. "eng+jpn+chi_sim"),
+    // otherwise there's nothing to route to and the OSD pass is skipped altogether.
+    std::vector<script_block_t> blocks;
+    if (g_config->File.ocr_script_routing && m_can_route)
     {
-        ret.confidence = m_api->MeanTextConf();
+        if (Result<std::vector<script_block_t>> detected = DetectScripts(pix, serial, rect, key); detected.ok())
+            blocks = std::move(detected.get());
+        else
+            spdlog::debug("Script routing disabled for this capture: {}", detected.error_v());
+    }
+    if (blocks.empty())
+        blocks = { { rect.x, rect.y, rect.width, rect.height, {} } };
+    if (m_cancel.load())
+        return Err("Cancelled");
+
+    const auto detect_end = std::chrono::steady_clock::now();
+
+    std::string data;
+    std::string models;
+    double      conf_sum   = 0.0;
+    int         conf_count = 0;
+    bool        got_conf   = false;
+
+    // Checked by tesseract between words, so Cancel() doesn't have to wait for a whole block
+    tesseract::ETEXT_DESC monitor;
+    monitor.cancel      = [](void* cancel, int) { return static_cast<std::atomic<bool>*>(cancel)->load(); };
+    monitor.cancel_this = &m_cancel;
+
+    for (const script_block_t& block : blocks)
+    {
+        tesseract::TessBaseAPI* api         = GetScriptEngine(block.model);
+        const bool              whole_image =
+            (block.x == rect.x && block.y == rect.y && block.w == rect.width && block.h == rect.height);
+
+        Attach(api, pix, serial);
+        api->SetPageSegMode(whole_image ? psm : tesseract::PSM_SINGLE_BLOCK);
+        api->SetSourceResolution(dpi);
+        api->SetRectangle(block.x, block.y, block.w, block.h);
+
+        // Make OCR + confidence deterministic
+        const int recognized = api->Recognize(&monitor);
+        if (m_cancel.load())
+            return Err("Cancelled");
+        if (recognized != 0)
+            return Err("tesseract::Recognize() failed");
+
+        TextPtr text(api->GetUTF8Text(), [](char* p) { delete[] p; });
+        if (!text)
+            return Err("Failed to get recognized text");
+
+        if (!data.empty() && data.back() != '\n')
+            data += '\n';
+        data += text.get();
+
+        // Streaming: hand out the page's layout blocks from this same pass, so the final
+        // result is exactly what a run without streaming would give
+        if (on_partial)
+        {
+            std::unique_ptr<tesseract::ResultIterator> it(api->GetIterator());
+            if (it)
+            {
+                do
+                {
+                    TextPtr block_text(it->GetUTF8Text(tesseract::RIL_BLOCK), [](char* p) { delete[] p; });
+                    if (block_text && *block_text)
+                        on_partial(block_text.get());
+                } while (it->Next(tesseract::RIL_BLOCK));
+            }
+        }
+
+        const std::string& used_model = block.model.empty() ? m_config->model : block.model;
+        if (models.find(used_model) == std::string::npos)
+            models += (models.empty() ? "" : "+") + used_model;
+
+        if (tesseract::ResultIterator* ri = api->GetIterator())
+        {
+            do
+            {
+                float conf = ri->Confidence(tesseract::RIL_WORD);
+                if (conf >= 0.0f)
+                {
+                    conf_sum += conf;
+                    ++conf_count;
+                }
+            } while (ri->Next(tesseract::RIL_WORD));
+
+            got_conf = true;
+            delete ri;
+        }
+        else if (blocks.size() == 1)
+        {
+            ret.confidence = api->MeanTextConf();
+        }
     }
 
+    const auto end = std::chrono::steady_clock::now();
+    spdlog::debug("OCR took {:.1f} ms ({} block(s), models: {}, script detection: {:.1f} ms)",
+                  ms_t(end - start).count(),
+                  blocks.size(),
+                  models,
+                  ms_t(detect_end - start).count());
+
+    trim(data);
+    if (data.empty())
+        return Err(
+            fmt::format("No text recognized (PSM: {}, {}x{} px, DPI: {})", psm_to_str(psm), rect.width, rect.height, dpi));
+
+    ret.data    = std::move(data);
+    ret.model   = std::move(models);
+    ret.psm_str = psm_to_str(psm);
+    ret.psm     = std::move(psm);
+
+    ret.timings.layout_ms    = ms_t(detect_end - start).count();
+    ret.timings.recognize_ms = ms_t(end - detect_end).count();
+
+    if (got_conf)
+        ret.confidence = conf_count ? int(std::round(conf_sum / conf_count)) : 0;
+
     return Ok(std::move(ret));
 }
 
@@ -323,35 +745,235 @@ Result<ocr_result_t> OcrAPI::ExtractTextCapture(const capture_result_t& cap)
 ZbarAPI::ZbarAPI()
 {
     SetConfig(zbar::ZBAR_NONE, true);  // enable all
+    m_image.set_format("Y800");        // GRAYSCALE
 }
 
-Result<zbar_result_t> ZbarAPI::ExtractTextsCapture(const capture_result_t& cap)
+void ZbarAPI::ScanGray(int w, int h, float scale, int off_x, int off_y, std::vector<zbar_symbol_t>& out)
 {
-    zbar_result_t        ret;
-    std::vector<uint8_t> gray(cap.w * cap.h);
-
-    rgba_to_grayscale(cap.view().data(), gray.data(), cap.w, cap.h);
+    m_image.set_size(w, h);
+    m_image.set_data(m_gray.data(), size_t(w) * h);
+    if (m_scanner.scan(m_image) <= 0)
+        return;
 
-    zbar::Image image(cap.w,
-                      cap.h,
-                      "Y800",  // GRAYSCALE
-                      gray.data(),
-                      gray.size());
+    for (auto sym = m_image.symbol_begin(); sym != m_image.symbol_end(); ++sym)
+    {
+        zbar_symbol_t& symbol = out.emplace_back();
+        symbol.data           = sym->get_data();
+        symbol.type           = sym->get_type_name();
 
-    if (m_scanner.scan(image) <= 0)
-        return Err("Failed to scan image");
+        const int n = sym->get_location_size();
+        symbol.polygon.reserve(n);
+        for (int i = 0; i < n; ++i)
+            symbol.polygon.push_back(
+                { off_x + sym->get_location_x(i) / scale, off_y + sym->get_location_y(i) / scale });
+    }
+}
 
-    for (auto sym = image.symbol_begin(); sym != image.symbol_end(); ++sym)
+static void fill_result(zbar_result_t& ret)
+{
+    for (const zbar_symbol_t& symbol : ret.symbols)
     {
-        ret.datas.push_back(sym->get_data());
-        ret.symbologies[sym->get_type_name()]++;
+        ret.datas.push_back(symbol.data);
+        ret.symbologies[symbol.type]++;
     }
+}
+
+Result<zbar_result_t> ZbarAPI::ExtractTextsCapture(const capture_result_t& cap)
+{
+    zbar_result_t ret;
+
+    const size_t pixels = size_t(cap.w) * cap.h;
+    if (cap.w <= 0 || cap.h <= 0 || cap.view().size() < pixels * 4)
+        return Err("Image is empty");
+
+    const auto start = std::chrono::steady_clock::now();
 
+    // Only ever grows, a smaller image just uses the front of it
+    if (m_gray.size() < pixels)
+        m_gray.resize(pixels);
+    rgba_to_grayscale(cap.view().data(), m_gray.data(), cap.w, cap.h);
+
+    const auto converted = std::chrono::steady_clock::now();
+    ScanGray(cap.w, cap.h, 1.0f, 0, 0, ret.symbols);
+    ret.convert_ms = ms_t(converted - start).count();
+    ret.scan_ms    = ms_t(std::chrono::steady_clock::now() - converted).count();
+    spdlog::debug("ZBar: {}x{} scanned in {:.1f} ms (grayscale {:.1f} ms)", cap.w, cap.h, ret.scan_ms, ret.convert_ms);
+
+    fill_result(ret);
     if (ret.datas.empty() || ret.symbologies.empty())
         return Err("Failed to decode barcode from image");
 
-    // Prevent ZBar from freeing the buffer
-    image.set_data(nullptr, 0);
+    return Ok(std::move(ret));
+}
+
+// Same payload found again by an overlapping tile or another scale,
+// i.e. their centers are closer than half the bigger one's size.
+static bool same_symbol(const zbar_symbol_t& a, const zbar_symbol_t& b)
+{
+    if (a.data != b.data || a.type != b.type || a.polygon.empty() || b.polygon.empty())
+        return a.data == b.data && a.type == b.type;
+
+    auto bounds = [](const std::vector<point_t>& poly) {
+        float min_x = poly[0].x, min_y = poly[0].y, max_x = poly[0].x, max_y = poly[0].y;
+        for (const point_t& p : poly)
+        {
+            min_x = std::min(min_x, p.x);
+            min_y = std::min(min_y, p.y);
+            max_x = std::max(max_x, p.x);
+            max_y = std::max(max_y, p.y);
+        }
+        return std::array<float, 4>{ min_x, min_y, max_x, max_y };
+    };
+
+    const auto  ba   = bounds(a.polygon);
+    const auto  bb   = bounds(b.polygon);
+    const float dx   = (ba[0] + ba[2]) / 2 - (bb[0] + bb[2]) / 2;
+    const float dy   = (ba[1] + ba[3]) / 2 - (bb[1] + bb[3]) / 2;
+    const float size = std::max({ ba[2] - ba[0], ba[3] - ba[1], bb[2] - bb[0], bb[3] - bb[1], 8.0f });
+    return dx * dx + dy * dy < (size / 2) * (size / 2);
+}
+
+Result<zbar_result_t> ZbarAPI::SearchCapture(const capture_result_t& cap, const zbar_search_options_t& opts)
+{
+    struct tile_job_t
+    {
+        float scale;
+        int   x, y, w, h;  // source pixels
+    };
+
+    zbar_result_t ret;
+
+    const size_t pixels = size_t(cap.w) * cap.h;
+    if (cap.w <= 0 || cap.h <= 0 || cap.view().size() < pixels * 4)
+        return Err("Image is empty");
+
+    const auto start = std::chrono::steady_clock::now();
+    if (m_frame_gray.size() < pixels)
+        m_frame_gray.resize(pixels);
+    rgba_to_grayscale(cap.view().data(), m_frame_gray.data(), cap.w, cap.h);
+    const auto converted = std::chrono::steady_clock::now();
+
+    // Tiles of tile_size scaled pixels, overlapping by a quarter so a code
+    // up to that size always fits whole in at least one of them.
+    std::vector<tile_job_t> jobs;
+    const int               tile_size = std::max(opts.tile_size, 64);
+    for (const float scale : opts.scales)
+    {
+        if (scale <= 0 || cap.w * scale < 32 || cap.h * scale < 32)
+            continue;
+
+        const int src_tile = std::max(int(tile_size / scale), 1);
+        const int stride   = std::max(src_tile - src_tile / 4, 1);
+        for (int y = 0; y < cap.h; y += stride)
+        {
+            const int h = std::min(src_tile, cap.h - y);
+            for (int x = 0; x < cap.w; x += stride)
+            {
+                jobs.push_back({ scale, x, y, std::min(src_tile, cap.w - x), h });
+                if (x + src_tile >= cap.w)
+                    break;
+            }
+            if (y + src_tile >= cap.h)
+                break;
+        }
+    }
+
+    const unsigned hw       = std::max(1u, std::thread::hardware_concurrency());
+    const size_t   nthreads = std::clamp<size_t>(opts.jobs ? opts.jobs : hw, 1, std::max<size_t>(jobs.size(), 1));
+
+    // One scanner per thread, same settings as ours
+    while (m_tile_scanners.size() < nthreads)
+    {
+        auto scanner = std::make_unique<ZbarAPI>();
+        (void)scanner->SetSymbologies(m_symbologies);
+        scanner->SetDensity(m_density);
+        m_tile_scanners.push_back(std::move(scanner));
+    }
+
+    std::atomic<size_t>        next{ 0 };
+    std::atomic<bool>          found{ false };
+    std::mutex                 mtx;
+    std::vector<zbar_symbol_t> symbols;
+
+    auto worker = [&](ZbarAPI& scanner) {
+        std::vector<zbar_symbol_t> local;
+        for (size_t i = next.fetch_add(1); i < jobs.size(); i = next.fetch_add(1))
+        {
+            if (opts.first_only && found.load(std::memory_order_relaxed))
+                break;
+
+            const tile_job_t& job = jobs[i];
+            const int         dw  = std::max(int(std::lround(job.w * job.scale)), 1);
+            const int         dh  = std::max(int(std::lround(job.h * job.scale)), 1);
+            if (scanner.m_gray.size() < size_t(dw) * dh)
+                scanner.m_gray.resize(size_t(dw) * dh);
+
+            const uint8_t* src = m_frame_gray.data() + size_t(job.y) * cap.w + job.x;
+            if (dw == job.w && dh == job.h)
+            {
+                for (int row = 0; row < dh; ++row)
+                    std::memcpy(scanner.m_gray.data() + size_t(row) * dw, src + size_t(row) * cap.w, dw);
+            }
+            else if (!stbir_resize_uint8_linear(
+                         src, job.w, job.h, cap.w, scanner.m_gray.data(), dw, dh, dw, STBIR_1CHANNEL))
+            {
+                continue;
+            }
+
+            const size_t before = local.size();
+            scanner.ScanGray(dw, dh, float(dw) / job.w, job.x, job.y, local);
+            if (local.size() > before)
+                found.store(true, std::memory_order_relaxed);
+        }
+
+        std::lock_guard lk(mtx);
+        symbols.insert(symbols.end(), std::make_move_iterator(local.begin()), std::make_move_iterator(local.end()));
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(nthreads - 1);
+    for (size_t i = 1; i < nthreads; ++i)
+        threads.emplace_back(worker, std::ref(*m_tile_scanners[i]));
+    worker(*m_tile_scanners[0]);
+    for (std::thread& t : threads)
+        t.join();
+
+    // Tiles finish in any order, sort for stable output (top-to-bottom, left-to-right)
+    auto top_left = [](const zbar_symbol_t& s) {
+        point_t ret = s.polygon.empty() ? point_t{} : s.polygon.front();
+        for (const point_t& p : s.polygon)
+            if (std::tie(p.y, p.x) < std::tie(ret.y, ret.x))
+                ret = p;
+        return ret;
+    };
+    std::sort(symbols.begin(), symbols.end(), [&](const zbar_symbol_t& a, const zbar_symbol_t& b) {
+        const point_t pa = top_left(a), pb = top_left(b);
+        return std::tie(pa.y, pa.x) < std::tie(pb.y, pb.x);
+    });
+
+    for (zbar_symbol_t& symbol : symbols)
+    {
+        const bool dup = std::any_of(
+            ret.symbols.begin(), ret.symbols.end(), [&](const zbar_symbol_t& s) { return same_symbol(s, symbol); });
+        if (!dup)
+            ret.symbols.push_back(std::move(symbol));
+        if (opts.first_only && !ret.symbols.empty())
+            break;
+    }
+
+    ret.convert_ms = ms_t(converted - start).count();
+    ret.scan_ms    = ms_t(std::chrono::steady_clock::now() - converted).count();
+    spdlog::debug("ZBar: {}x{} tiled search, {} tile(s) on {} thread(s), {} symbol(s) in {:.1f} ms",
+                  cap.w,
+                  cap.h,
+                  std::min(next.load(), jobs.size()),
+                  nthreads,
+                  ret.symbols.size(),
+                  ret.scan_ms);
+
+    fill_result(ret);
+    if (ret.datas.empty())
+        return Err("Failed to decode barcode from image");
 
     return Ok(std::move(ret));
 }
@@ -360,3 +982,43 @@ bool ZbarAPI::SetConfig(zbar::zbar_symbol_type_e zbar_code, int enable)
 {
     return m_scanner.set_config(zbar_code, zbar::ZBAR_CFG_ENABLE, enable) == 0;
 }
+
+Result<> ZbarAPI::SetSymbologies(const std::vector<std::string>& names)
+{
+    m_symbologies = names;
+    for (const std::unique_ptr<ZbarAPI>& scanner : m_tile_scanners)
+        (void)scanner->SetSymbologies(names);
+
+    if (std::find(names.begin(), names.end(), "all") != names.end())
+    {
+        SetConfig(zbar::ZBAR_NONE, true);
+        return Ok();
+    }
+
+    SetConfig(zbar::ZBAR_NONE, false);
+    std::string unknown;
+    for (const std::string& name : names)
+    {
+        const auto it = std::find_if(
+            ZBAR_SYMBOLOGIES.begin(), ZBAR_SYMBOLOGIES.end(), [&](const auto& sym) { return sym.first == name; });
+        if (it != ZBAR_SYMBOLOGIES.end())
+            SetConfig(it->second, true);
+        else
+            unknown += (unknown.empty() ? "" : ", ") + name;
+    }
+
+    if (!unknown.empty())
+        return Err("Unknown barcode symbology: {}", unknown);
+    return Ok();
+}
+
+void ZbarAPI::SetDensity(int density)
+{
+    density   = std::max(density, 1);
+    m_density = density;
+    for (const std::unique_ptr<ZbarAPI>& scanner : m_tile_scanners)
+        scanner->SetDensity(density);
+
+    m_scanner.set_config(zbar::ZBAR_NONE, zbar::ZBAR_CFG_X_DENSITY, density);
+    m_scanner.set_config(zbar::ZBAR_NONE, zbar::ZBAR_CFG_Y_DENSITY, density);
+}
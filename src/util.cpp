@@ -27,12 +27,15 @@
 
 #include <fcntl.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <filesystem>
+#include <fstream>
+#include <iterator>
 #include <utility>
 #include <vector>
 
@@ -42,8 +45,10 @@
 #include "dotenv.hpp"
 #include "fmt/chrono.h"
 #include "fmt/format.h"
+#include "image_encoder.hpp"
 #include "nvdialog/nvdialog_notification.h"
 #include "platform.hpp"
+#include "save_queue.hpp"
 #include "screen_capture.hpp"
 #include "screenshot_tool.hpp"
 #include "tinyfiledialogs.h"
@@ -214,39 +219,79 @@ int get_screen_dpi()
 }
 #endif
 
-std::vector<uint8_t> encode_to_image(const capture_result_t& cap, ImageExt ext)
+static encode_options_t encode_options_from_config()
 {
-    std::vector<uint8_t> out;
+    encode_options_t opts;
+    opts.png_backend  = g_config->File.png_encoder.second;
+    opts.png_level    = g_config->File.png_level;
+    opts.png_jobs     = unsigned(std::max(g_config->Runtime.jobs, 0));
+    opts.jpeg_quality = g_config->File.jpeg_quality;
+    return opts;
+}
 
-    auto callback = [](void* context, void* data, int size) {
-        auto* buf   = static_cast<std::vector<uint8_t>*>(context);
-        auto* bytes = static_cast<uint8_t*>(data);
+Result<fit_result_t> encode_to_image_fit(const capture_result_t&      cap,
+                                         ImageExt                     ext,
+                                         size_t                       max_bytes,
+                                         const std::function<bool()>& canceled)
+{
+    fit_options_t fit;
+    fit.max_bytes = max_bytes;
+    fit.downscale = g_config->File.fit_downscale;
+    fit.jobs      = unsigned(std::max(g_config->Runtime.jobs, 0));
+    fit.canceled  = canceled;
+    return encode_image_fit(cap, ext, encode_options_from_config(), fit);
+}
 
-        buf->insert(buf->end(), bytes, bytes + size);
-    };
+// Encode under default.image-out-max-size
+static Result<std::vector<uint8_t>> encode_fitted(const capture_result_t& cap, ImageExt ext)
+{
+    const size_t         max_bytes = size_t(g_config->File.image_out_max_kib) * 1024;
+    Result<fit_result_t> res       = encode_to_image_fit(cap, ext, max_bytes);
+    TRY(res);
 
-    out.reserve(size_t(cap.w) * cap.h * 4);
+    const fit_result_t& fit = res.get();
+    if (!fit.fits)
+        spdlog::warn("Couldn't fit the image under {} KiB, smallest was {} bytes",
+                     g_config->File.image_out_max_kib,
+                     fit.data.size());
+    spdlog::debug("fitted: {} bytes, quality {}, scale {:.2f}", fit.data.size(), fit.quality, fit.scale);
+    return Ok(std::move(res.get().data));
+}
 
-    switch (ext)
+std::vector<uint8_t> encode_to_image(const capture_result_t& cap, ImageExt ext)
+{
+    std::vector<uint8_t> out;
+    if (g_config->File.image_out_max_kib > 0)
     {
-        case ImageExt::PNG:
-            stbi_write_png_to_func(callback, &out, cap.w, cap.h, STBIR_RGBA, cap.data.data(), cap.w * 4);
-            break;
-
-        case ImageExt::JPEG:
-            stbi_write_jpg_to_func(callback, &out, cap.w, cap.h, STBIR_RGBA, cap.data.data(), 90);
-            break;
-
-        case ImageExt::BMP: stbi_write_bmp_to_func(callback, &out, cap.w, cap.h, STBIR_RGBA, cap.data.data()); break;
-        case ImageExt::TGA: stbi_write_tga_to_func(callback, &out, cap.w, cap.h, STBIR_RGBA, cap.data.data()); break;
-
-        default: break;
+        Result<std::vector<uint8_t>> res = encode_fitted(cap, ext);
+        if (!res.ok())
+        {
+            spdlog::error("{}", res.error_v());
+            return {};
+        }
+        out = std::move(res.get());
+    }
+    else
+    {
+        out = encode_image(cap, ext, encode_options_from_config());
     }
-
     spdlog::debug("out size = {}", out.size());
     return out;
 }
 
+Result<> encode_to_image(const capture_result_t& cap, ImageExt ext, ImageSink& sink)
+{
+    if (g_config->File.image_out_max_kib <= 0)
+        return encode_image(cap, ext, encode_options_from_config(), sink);
+
+    // The size is only known once the whole image is encoded, nothing to stream
+    Result<std::vector<uint8_t>> res = encode_fitted(cap, ext);
+    TRY(res);
+    if (!sink.Write(res.get().data(), res.get().size()))
+        return Err("Failed to write image: {}", strerror(errno));
+    return Ok();
+}
+
 void fit_to_screen(capture_result_t& img)
 {
     const int img_w = img.w;
@@ -290,21 +335,52 @@ static std::vector<uint8_t> read_stdin_binary()
     return buffer;
 }
 
-Result<capture_result_t> load_image_rgba(const std::string& path)
+// Formats stb_image doesn't know, by their magic bytes
+static bool is_qoi(std::span<const uint8_t> head)
 {
-    capture_result_t result{};
+    return head.size() >= 4 && std::memcmp(head.data(), "qoif", 4) == 0;
+}
+
+static bool is_webp(std::span<const uint8_t> head)
+{
+    return head.size() >= 12 && std::memcmp(head.data(), "RIFF", 4) == 0 &&
+           std::memcmp(head.data() + 8, "WEBP", 4) == 0;
+}
+
+Result<capture_result_t> load_image_rgba_from_memory(std::span<const uint8_t> data)
+{
+    if (data.empty())
+        return Err("Empty image data");
+
+    if (is_qoi(data))
+        return decode_qoi(data);
+    if (is_webp(data))
+        return decode_webp(data);
 
     int width    = 0;
     int height   = 0;
     int channels = 0;
 
     // Force RGBA output (4 channels)
-    stbi_uc* pixels = nullptr;
-    if (path != "-")
-    {
-        pixels = stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
-    }
-    else
+    stbi_uc* pixels = stbi_load_from_memory(data.data(), int(data.size()), &width, &height, &channels, STBI_rgb_alpha);
+    if (!pixels)
+        return Err("Failed to load image: {}", STBI_ERROR);
+
+    capture_result_t result{};
+    result.w = width;
+    result.h = height;
+
+    const size_t size = size_t(width) * height * 4;
+    result.data.assign(pixels, pixels + size);
+
+    stbi_image_free(pixels);
+
+    return Ok(std::move(result));
+}
+
+Result<capture_result_t> load_image_rgba(const std::string& path)
+{
+    if (path == "-")
     {
 #if OSHOT_WINDOWS
         _setmode(_fileno(stdin), _O_BINARY);
@@ -314,9 +390,33 @@ Result<capture_result_t> load_image_rgba(const std::string& path)
         if (input.empty())
             return Err("No image data received from stdin");
 
-        pixels = stbi_load_from_memory(input.data(), int(input.size()), &width, &height, &channels, STBI_rgb_alpha);
+        return load_image_rgba_from_memory(input);
+    }
+
+    {
+        uint8_t head[12] = {};
+        FILE*   fp       = fopen(path.c_str(), "rb");
+        if (!fp)
+            return Err("Failed to open '{}': {}", path, strerror(errno));
+        const size_t n = fread(head, 1, sizeof(head), fp);
+        fclose(fp);
+
+        if (is_qoi({ head, n }) || is_webp({ head, n }))
+        {
+            std::ifstream              file(path, std::ios::binary);
+            const std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            return load_image_rgba_from_memory(data);
+        }
     }
 
+    capture_result_t result{};
+
+    int width    = 0;
+    int height   = 0;
+    int channels = 0;
+
+    // Force RGBA output (4 channels)
+    stbi_uc* pixels = stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
     if (!pixels)
         return Err("Failed to load image: {}", STBI_ERROR);
 
@@ -331,6 +431,28 @@ Result<capture_result_t> load_image_rgba(const std::string& path)
     return Ok(std::move(result));
 }
 
+capture_result_t crop_capture(const capture_result_t& src, const region_t& region)
+{
+    capture_result_t ret;
+
+    // Clamp to the source, so it's safe to pass anything user-provided
+    const int x0 = std::clamp(region.x, 0, src.w);
+    const int y0 = std::clamp(region.y, 0, src.h);
+    const int x1 = std::clamp(region.x + region.width, x0, src.w);
+    const int y1 = std::clamp(region.y + region.height, y0, src.h);
+
+    ret.w = x1 - x0;
+    ret.h = y1 - y0;
+    ret.data.resize(size_t(ret.w) * ret.h * 4);
+
+    for (int y = 0; y < ret.h; ++y)
+        std::memcpy(ret.data.data() + size_t(y) * ret.w * 4,
+                    src.data.data() + (size_t(y0 + y) * src.w + x0) * 4,
+                    size_t(ret.w) * 4);
+
+    return ret;
+}
+
 Result<std::string> get_config_image_out_fmt()
 {
     auto        now = std::chrono::system_clock::now();
@@ -349,18 +471,10 @@ Result<std::string> get_config_image_out_fmt()
 
 Result<> save_image(SavingOp op, const capture_result_t& img, ImageExt ext)
 {
-    auto deleter = [](NvdNotification* p) {
-        nvd_send_notification(p);
-        nvd_delete_notification(p);
-    };
-    std::unique_ptr<NvdNotification, decltype(deleter)> notif(nullptr, deleter);
-
     if (op == SavingOp::Clipboard)
     {
-        const Result<>& res = g_clipboard.CopyImage(img, ext);
-        if (res.ok())
-            notif.reset(nvd_notification_new("Copied!", "Screenshot copied to clipboard", NVD_NOTIFICATION_SIMPLE));
-        return res;
+        g_save_queue.Push({ op, {}, img, ext });
+        return Ok();
     }
 
     const Result<std::string>& fmt = get_config_image_out_fmt();
@@ -382,35 +496,28 @@ Result<> save_image(SavingOp op, const capture_result_t& img, ImageExt ext)
 
     if (!save_path)
     {
-        notif.reset(nvd_notification_new("Canceled", "Save canceled by user", NVD_NOTIFICATION_WARNING));
+        NvdNotification* notif = nvd_notification_new("Canceled", "Save canceled by user", NVD_NOTIFICATION_WARNING);
+        nvd_send_notification(notif);
+        nvd_delete_notification(notif);
         return Ok();  // Not really an error, maybe the user cancelled
     }
 
-    FILE* fp = fopen(save_path, "wb");
-    if (!fp)
-        return Err("Failed to open file to write image");
-
-    const std::vector<uint8_t>& data    = encode_to_image(img, ext);
-    size_t                      written = fwrite(data.data(), 1, data.size(), fp);
-    fclose(fp);
-    if (written != data.size())
-        return Err("Failed to write image data");
-    notif.reset(nvd_notification_new("Saved!", "Screenshot saved successfully", NVD_NOTIFICATION_SIMPLE));
-
     fs::path path(save_path);
     g_cache->SetValue(CacheEntry::ImgSavePath, path.parent_path().string());
 
+    g_save_queue.Push({ op, path.string(), img, ext });
     return Ok();
 }
 
-void rgba_to_grayscale(const uint8_t* src, uint8_t* result, int width, int height)
+void rgba_to_grayscale(const uint8_t* __restrict src, uint8_t* __restrict result, int width, int height)
 {
-    const int pixels = width * height;
-    for (int i = 0; i < pixels; ++i)
+    // Plain byte loads and no aliasing, so the compiler can vectorize this
+    const size_t pixels = size_t(width) * height;
+    for (size_t i = 0; i < pixels; ++i)
     {
-        rgba_t c = load_rgba(src + i * 4);
+        const uint8_t* p = src + i * 4;
         // ITU-R BT.601 luminance
-        result[i] = uint8_t((77 * c.r + 150 * c.g + 29 * c.b) >> 8);
+        result[i] = uint8_t((77u * p[0] + 150u * p[1] + 29u * p[2]) >> 8);
     }
 }
 
@@ -0,0 +1,447 @@
+/*
+ * Copyright 2026 Toni500
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ * disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ * following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ * products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "watch.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#include "clipboard.hpp"
+#include "config.hpp"
+#include "fmt/format.h"
+
+// ------------------------------
+// DamageTracker
+// ------------------------------
+static uint64_t hash_tile(const uint8_t* data, size_t stride, size_t row_bytes, int rows)
+{
+    // Not cryptographic, just cheap: multiply-xorshift over 8 bytes at a time
+    constexpr uint64_t k = 0x9E3779B97F4A7C15ull;
+
+    uint64_t h = 0;
+    for (int y = 0; y < rows; ++y)
+    {
+        const uint8_t* p = data + size_t(y) * stride;
+        size_t         i = 0;
+        for (; i + 8 <= row_bytes; i += 8)
+        {
+            uint64_t v;
+            std::memcpy(&v, p + i, 8);
+            h = (h ^ v) * k;
+            h ^= h >> 29;
+        }
+        if (i < row_bytes)  // rows are whole RGBA pixels, so at most 4 bytes left
+        {
+            uint32_t v;
+            std::memcpy(&v, p + i, 4);
+            h = (h ^ v) * k;
+            h ^= h >> 29;
+        }
+    }
+    return h;
+}
+
+std::vector<region_t> DamageTracker::Update(const capture_result_t& frame)
+{
+    if (frame.w <= 0 || frame.h <= 0)
+        return {};
+
+    const int    cols   = (frame.w + m_tile - 1) / m_tile;
+    const int    rows   = (frame.h + m_tile - 1) / m_tile;
+    const size_t stride = size_t(frame.w) * 4;
+    const bool   resize = frame.w != m_w || frame.h != m_h || m_hashes.empty();
+
+    if (resize)
+    {
+        m_w    = frame.w;
+        m_h    = frame.h;
+        m_cols = cols;
+        m_rows = rows;
+        m_hashes.assign(size_t(cols) * rows, 0);
+    }
+
+    m_dirty.assign(size_t(cols) * rows, 0);
+    bool any = false;
+    for (int ty = 0; ty < rows; ++ty)
+    {
+        for (int tx = 0; tx < cols; ++tx)
+        {
+            const int      x  = tx * m_tile;
+            const int      y  = ty * m_tile;
+            const int      tw = std::min(m_tile, frame.w - x);
+            const int      th = std::min(m_tile, frame.h - y);
+            const uint64_t h  = hash_tile(frame.data.data() + size_t(y) * stride + size_t(x) * 4, stride, tw * 4, th);
+
+            uint64_t& prev = m_hashes[size_t(ty) * cols + tx];
+            if (resize || prev != h)
+            {
+                prev                            = h;
+                m_dirty[size_t(ty) * cols + tx] = 1;
+                any                             = true;
+            }
+        }
+    }
+
+    if (!any)
+        return {};
+    if (resize)
+        return { region_t{ 0, 0, frame.w, frame.h } };
+
+    // Grow each changed tile by one in every direction
+    std::vector<uint8_t> grown(m_dirty.size(), 0);
+    for (int ty = 0; ty < rows; ++ty)
+        for (int tx = 0; tx < cols; ++tx)
+            if (m_dirty[size_t(ty) * cols + tx])
+                for (int y = std::max(ty - 1, 0); y <= std::min(ty + 1, rows - 1); ++y)
+                    for (int x = std::max(tx - 1, 0); x <= std::min(tx + 1, cols - 1); ++x)
+                        grown[size_t(y) * cols + x] = 1;
+
+    // One rectangle per connected group of tiles (its bounding box)
+    std::vector<region_t>            out;
+    std::vector<std::pair<int, int>> stack;
+    for (int ty = 0; ty < rows; ++ty)
+    {
+        for (int tx = 0; tx < cols; ++tx)
+        {
+            if (grown[size_t(ty) * cols + tx] != 1)
+                continue;
+
+            int min_x = tx, max_x = tx, min_y = ty, max_y = ty;
+            grown[size_t(ty) * cols + tx] = 2;
+            stack.emplace_back(tx, ty);
+            while (!stack.empty())
+            {
+                const auto [cx, cy] = stack.back();
+                stack.pop_back();
+                min_x = std::min(min_x, cx);
+                max_x = std::max(max_x, cx);
+                min_y = std::min(min_y, cy);
+                max_y = std::max(max_y, cy);
+
+                constexpr int dirs[4][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+                for (const auto& d : dirs)
+                {
+                    const int nx = cx + d[0], ny = cy + d[1];
+                    if (nx < 0 || ny < 0 || nx >= cols || ny >= rows || grown[size_t(ny) * cols + nx] != 1)
+                        continue;
+                    grown[size_t(ny) * cols + nx] = 2;
+                    stack.emplace_back(nx, ny);
+                }
+            }
+
+            const int x0 = min_x * m_tile;
+            const int y0 = min_y * m_tile;
+            out.push_back({ x0, y0, std::min((max_x + 1) * m_tile, frame.w) - x0,
+                            std::min((max_y + 1) * m_tile, frame.h) - y0 });
+        }
+    }
+
+    return out;
+}
+
+// ------------------------------
+// ScreenWatcher
+// ------------------------------
+Result<region_t> parse_watch_region(const std::string& str)
+{
+    region_t region;
+    if (str.empty())
+        return Ok(region);
+
+    char tail = 0;
+    if (std::sscanf(str.c_str(), "%dx%d+%d+%d%c", &region.width, &region.height, &region.x, &region.y, &tail) != 4 ||
+        region.width <= 0 || region.height <= 0 || region.x < 0 || region.y < 0)
+        return Err("invalid watch region '{}', expected WIDTHxHEIGHT+X+Y (e.g \"800x200+0+880\")", str);
+
+    return Ok(region);
+}
+
+Result<> ScreenWatcher::Start(const watch_options_t& options)
+{
+    if (m_running.load())
+        return Err("watcher is already running");
+    if (m_thread.joinable())
+        m_thread.join();  // stopped by itself after a capture error
+
+    m_options             = options;
+    m_options.interval_ms = std::max(m_options.interval_ms, 10);
+
+    const region_t&   region  = m_options.region;
+    const bool        crop    = region.width > 0 && region.height > 0;
+    const SessionType session = get_session_type();
+    if (session == SessionType::X11)
+    {
+        TRY(m_grabber.Open(m_options.monitor, region));
+    }
+    else
+    {
+        // Every capture is a whole screenshot of the monitor under the pointer, frames of another one are skipped.
+        // Going through the portal or spawning spectacle, grim or screencapture is too slow to poll at the usual rate.
+        if (m_options.monitor >= 0)
+            return Err("picking the monitor to watch only works on X11");
+
+        m_grabber.Close();
+        const Result<capture_result_t>& cap = capture_full_screen();
+        TRY_MSG(cap, "failed to capture the screen: {}");
+        m_screen_w = cap.get().w;
+        m_screen_h = cap.get().h;
+        if (crop && (region.x + region.width > m_screen_w || region.y + region.height > m_screen_h))
+            return Err("region {}x{}+{}+{} doesn't fit in the {}x{} monitor",
+                       region.width,
+                       region.height,
+                       region.x,
+                       region.y,
+                       m_screen_w,
+                       m_screen_h);
+
+        if (session != SessionType::Windows && m_options.interval_ms < SLOW_CAPTURE_MIN_INTERVAL_MS)
+        {
+            spdlog::warn("watch: every capture here is a full screenshot, polling every {}ms instead of {}ms",
+                         SLOW_CAPTURE_MIN_INTERVAL_MS,
+                         m_options.interval_ms);
+            m_options.interval_ms = SLOW_CAPTURE_MIN_INTERVAL_MS;
+        }
+    }
+
+    m_options.max_idle_ms = std::max(m_options.max_idle_ms, m_options.interval_ms);
+    m_options.cpu_budget  = std::clamp(m_options.cpu_budget, 0.0f, 1.0f);
+    m_stop                = false;
+    m_damage.Reset();
+    m_running.store(true);
+    m_thread = std::thread(&ScreenWatcher::Loop, this);
+    return Ok();
+}
+
+void ScreenWatcher::Stop()
+{
+    {
+        std::lock_guard lk(m_mtx);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+Result<capture_result_t> ScreenWatcher::Capture()
+{
+    if (m_grabber.IsOpen())
+        return m_grabber.Grab();  // just the region already
+
+    Result<capture_result_t> cap = capture_full_screen();
+    if (!cap.ok())
+        return cap;
+
+    // The pointer went to another monitor, there's nothing to compare this one with
+    if (cap.get().w != m_screen_w || cap.get().h != m_screen_h)
+        return Ok(capture_result_t{});
+
+    const region_t& region = m_options.region;
+    if (region.width > 0 && region.height > 0)
+        return Ok(crop_capture(cap.get(), region));
+    return cap;
+}
+
+void ScreenWatcher::Loop()
+{
+    int wait_ms = m_options.interval_ms;
+    while (true)
+    {
+        const auto start = std::chrono::steady_clock::now();
+
+        Result<capture_result_t> cap = Capture();
+        if (!cap.ok())
+        {
+            spdlog::error("watch: failed to capture the screen: {}", cap.error_v());
+            break;
+        }
+
+        const capture_result_t&      frame  = cap.get();
+        const std::vector<region_t>& damage = m_damage.Update(frame);
+        if (damage.empty())
+        {
+            // Nothing moved, back off a bit so a static screen costs next to nothing
+            wait_ms = std::min(wait_ms + m_options.interval_ms / 2, m_options.max_idle_ms);
+        }
+        else
+        {
+            wait_ms = m_options.interval_ms;
+            OnDamage(frame, damage);
+        }
+
+        const double elapsed_ms =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        spdlog::trace("watch: {} damaged area(s), frame took {:.1f}ms", damage.size(), elapsed_ms);
+
+        // Keep busy/(busy + idle) under the budget, e.g a 300ms OCR pass at 25% waits 900ms at least
+        double sleep_ms = wait_ms - elapsed_ms;
+        if (m_options.cpu_budget > 0)
+            sleep_ms = std::max(sleep_ms, elapsed_ms * (1 - m_options.cpu_budget) / m_options.cpu_budget);
+
+        std::unique_lock lk(m_mtx);
+        if (m_cv.wait_for(lk, std::chrono::duration<double, std::milli>(sleep_ms), [this] { return m_stop; }))
+            break;
+    }
+
+    m_running.store(false);
+}
+
+// ------------------------------
+// BarcodeWatcher
+// ------------------------------
+void BarcodeWatcher::OnDamage(const capture_result_t& frame, const std::vector<region_t>& damage)
+{
+    for (const region_t& rect : damage)
+    {
+        const bool                   whole = rect.width == frame.w && rect.height == frame.h;
+        const Result<zbar_result_t>& scan =
+            whole ? m_zbar.ExtractTextsCapture(frame) : m_zbar.ExtractTextsCapture(crop_capture(frame, rect));
+        if (!scan.ok())
+            continue;  // nothing decoded
+
+        for (zbar_symbol_t symbol : scan.get().symbols)
+        {
+            std::string key = symbol.type + ':' + symbol.data;
+            if (!m_seen.insert(key).second)
+                continue;
+
+            m_seen_order.push_back(std::move(key));
+            if (m_seen_order.size() > MAX_SEEN)
+            {
+                m_seen.erase(m_seen_order.front());
+                m_seen_order.pop_front();
+            }
+
+            for (point_t& p : symbol.polygon)
+            {
+                p.x += rect.x;
+                p.y += rect.y;
+            }
+            m_on_new(symbol);
+        }
+    }
+}
+
+// ------------------------------
+// OcrWatcher
+// ------------------------------
+// Trim and collapse whitespace, so the same line OCR'd with a different spacing still matches
+static std::string normalize_line(std::string_view line)
+{
+    std::string out;
+    out.reserve(line.size());
+    for (const char c : line)
+    {
+        if (c == ' ' || c == '\t' || c == '\r')
+        {
+            if (!out.empty() && out.back() != ' ')
+                out += ' ';
+        }
+        else
+        {
+            out += c;
+        }
+    }
+    if (!out.empty() && out.back() == ' ')
+        out.pop_back();
+    return out;
+}
+
+void OcrWatcher::OnDamage(const capture_result_t& frame, const std::vector<region_t>& damage)
+{
+    // New pixels: the engine converts/preprocesses the frame once, then only moves the rectangle per area
+    ++m_frame_id;
+    for (const region_t& rect : damage)
+    {
+        const Result<ocr_result_t>& res = m_ocr.ExtractTextRegion(frame, rect, m_frame_id);
+        if (!res.ok())
+        {
+            spdlog::debug("watch: OCR failed on {}x{}+{}+{}: {}", rect.width, rect.height, rect.x, rect.y, res.error_v());
+            continue;
+        }
+
+        std::string_view text = res.get().data;
+        while (!text.empty())
+        {
+            const size_t nl   = text.find('\n');
+            std::string  line = normalize_line(text.substr(0, nl));
+            text.remove_prefix(nl == text.npos ? text.size() : nl + 1);
+
+            if (line.empty() || !m_seen.insert(line).second)
+                continue;
+
+            m_seen_order.push_back(line);
+            if (m_seen_order.size() > MAX_SEEN)
+            {
+                m_seen.erase(m_seen_order.front());
+                m_seen_order.pop_front();
+            }
+            m_on_new(line);
+        }
+    }
+}
+
+Result<> append_transcript_line(const std::string& path, const std::string& line)
+{
+    std::ofstream f(path, std::ios::app);
+    if (!f)
+        return Err("failed to open transcript '{}'", path);
+    f << line << '\n';
+    if (!f)
+        return Err("failed to write transcript '{}'", path);
+    return Ok();
+}
+
+Result<watch_options_t> watch_options_from_config()
+{
+    const Result<region_t>& region = parse_watch_region(g_config->File.watch_region);
+    TRY(region);
+
+    watch_options_t opts;
+    opts.region      = region.get();
+    opts.monitor     = g_config->File.watch_monitor;
+    opts.interval_ms = g_config->File.watch_interval;
+    opts.max_idle_ms = std::max(opts.interval_ms, 2000);
+    opts.cpu_budget  = g_config->File.watch_cpu_budget / 100.0f;
+    return Ok(opts);
+}
+
+void output_watch_line(const std::string& line)
+{
+    if (!g_config->File.watch_transcript.empty())
+    {
+        if (const Result<>& res = append_transcript_line(g_config->File.watch_transcript, line); !res.ok())
+            spdlog::warn("watch: {}", res.error_v());
+    }
+    else if (g_config->File.watch_copy)
+    {
+        if (const Result<>& res = g_clipboard.CopyText(line); !res.ok())
+            spdlog::warn("watch: failed to copy to clipboard: {}", res.error_v());
+    }
+}
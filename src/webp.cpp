@@ -0,0 +1,1227 @@
+/*
+ * Copyright 2026 Toni500
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ * disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ * following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+ * products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+// Lossless WebP (VP8L): https://developers.google.com/speed/webp/docs/webp_lossless_bitstream_specification
+//
+// The encoder picks between two pipelines:
+//  - up to 256 colors (common for UI): color indexing, with pixels bundled 2/4/8 per byte for small palettes
+//  - anything else: subtract green, then spatial prediction with one of the 14 modes per 16x16 tile
+// then LZ77 (favoring the pixel on the left and the one above), a color cache and one set of prefix codes.
+// The decoder handles everything libwebp can write in lossless mode.
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+
+#include "huffman.hpp"
+#include "image_encoder.hpp"
+
+static constexpr int VP8L_MAX_SIZE        = 16384;
+static constexpr int VP8L_SIGNATURE       = 0x2F;
+static constexpr int NUM_LENGTH_CODES     = 24;
+static constexpr int NUM_DISTANCE_CODES   = 40;
+static constexpr int NUM_PLANE_CODES      = 120;
+static constexpr int MAX_LENGTH           = 4096;
+static constexpr int MAX_DISTANCE         = (1 << 20) - NUM_PLANE_CODES;
+static constexpr int CODE_LENGTH_CODES    = 19;
+static constexpr int MAX_ALLOWED_CODE_LEN = 15;
+
+enum TransformType
+{
+    PREDICTOR_TRANSFORM      = 0,
+    CROSS_COLOR_TRANSFORM    = 1,
+    SUBTRACT_GREEN_TRANSFORM = 2,
+    COLOR_INDEXING_TRANSFORM = 3
+};
+
+// clang-format off
+static constexpr uint8_t CODE_LENGTH_ORDER[CODE_LENGTH_CODES] = { 17, 18, 0, 1, 2, 3, 4, 5, 16, 6,
+                                                                  7, 8, 9, 10, 11, 12, 13, 14, 15 };
+
+// (xi, yi) of the 120 short distance codes: the pixel xi to the left and yi rows above
+static constexpr int8_t PLANE_CODES[NUM_PLANE_CODES][2] = {
+    { 0, 1 }, { 1, 0 }, { 1, 1 }, { -1, 1 }, { 0, 2 }, { 2, 0 }, { 1, 2 }, { -1, 2 }, { 2, 1 }, { -2, 1 },
+    { 2, 2 }, { -2, 2 }, { 0, 3 }, { 3, 0 }, { 1, 3 }, { -1, 3 }, { 3, 1 }, { -3, 1 }, { 2, 3 }, { -2, 3 },
+    { 3, 2 }, { -3, 2 }, { 0, 4 }, { 4, 0 }, { 1, 4 }, { -1, 4 }, { 4, 1 }, { -4, 1 }, { 3, 3 }, { -3, 3 },
+    { 2, 4 }, { -2, 4 }, { 4, 2 }, { -4, 2 }, { 0, 5 }, { 3, 4 }, { -3, 4 }, { 4, 3 }, { -4, 3 }, { 5, 0 },
+    { 1, 5 }, { -1, 5 }, { 5, 1 }, { -5, 1 }, { 2, 5 }, { -2, 5 }, { 5, 2 }, { -5, 2 }, { 4, 4 }, { -4, 4 },
+    { 3, 5 }, { -3, 5 }, { 5, 3 }, { -5, 3 }, { 0, 6 }, { 6, 0 }, { 1, 6 }, { -1, 6 }, { 6, 1 }, { -6, 1 },
+    { 2, 6 }, { -2, 6 }, { 6, 2 }, { -6, 2 }, { 4, 5 }, { -4, 5 }, { 5, 4 }, { -5, 4 }, { 3, 6 }, { -3, 6 },
+    { 6, 3 }, { -6, 3 }, { 0, 7 }, { 7, 0 }, { 1, 7 }, { -1, 7 }, { 5, 5 }, { -5, 5 }, { 7, 1 }, { -7, 1 },
+    { 4, 6 }, { -4, 6 }, { 6, 4 }, { -6, 4 }, { 2, 7 }, { -2, 7 }, { 7, 2 }, { -7, 2 }, { 3, 7 }, { -3, 7 },
+    { 7, 3 }, { -7, 3 }, { 5, 6 }, { -5, 6 }, { 6, 5 }, { -6, 5 }, { 8, 0 }, { 4, 7 }, { -4, 7 }, { 7, 4 },
+    { -7, 4 }, { 8, 1 }, { 8, 2 }, { 6, 6 }, { -6, 6 }, { 8, 3 }, { 5, 7 }, { -5, 7 }, { 7, 5 }, { -7, 5 },
+    { 8, 4 }, { 6, 7 }, { -6, 7 }, { 7, 6 }, { -7, 6 }, { 8, 5 }, { 7, 7 }, { -7, 7 }, { 8, 6 }, { 8, 7 }
+};
+// clang-format on
+
+// ------------------------------
+// Pixel helpers (ARGB in a uint32_t, like the spec)
+// ------------------------------
+static uint32_t to_argb(const uint8_t* rgba)
+{
+    return uint32_t(rgba[3]) << 24 | uint32_t(rgba[0]) << 16 | uint32_t(rgba[1]) << 8 | rgba[2];
+}
+
+static void from_argb(uint32_t argb, uint8_t* rgba)
+{
+    rgba[0] = uint8_t(argb >> 16);
+    rgba[1] = uint8_t(argb >> 8);
+    rgba[2] = uint8_t(argb);
+    rgba[3] = uint8_t(argb >> 24);
+}
+
+// Per channel a + b and a - b, mod 256
+static uint32_t add_pixels(uint32_t a, uint32_t b)
+{
+    const uint32_t ag = (a & 0xFF00FF00u) + (b & 0xFF00FF00u);
+    const uint32_t rb = (a & 0x00FF00FFu) + (b & 0x00FF00FFu);
+    return (ag & 0xFF00FF00u) | (rb & 0x00FF00FFu);
+}
+
+static uint32_t sub_pixels(uint32_t a, uint32_t b)
+{
+    const uint32_t ag = 0x00FF00FFu + (a & 0xFF00FF00u) - (b & 0xFF00FF00u);
+    const uint32_t rb = 0xFF00FF00u + (a & 0x00FF00FFu) - (b & 0x00FF00FFu);
+    return (ag & 0xFF00FF00u) | (rb & 0x00FF00FFu);
+}
+
+static uint32_t average2(uint32_t a, uint32_t b)
+{
+    return (((a ^ b) & 0xFEFEFEFEu) >> 1) + (a & b);
+}
+
+static int clip255(int v)
+{
+    return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+static uint32_t select_pixel(uint32_t L, uint32_t T, uint32_t TL)
+{
+    int p_l = 0, p_t = 0;
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        const int l = int(L >> shift & 0xFF), t = int(T >> shift & 0xFF), tl = int(TL >> shift & 0xFF);
+        p_l += std::abs(t - tl);  // |estimate - L| where estimate = L + T - TL
+        p_t += std::abs(l - tl);
+    }
+    return p_l < p_t ? L : T;
+}
+
+static uint32_t clamp_add_subtract_full(uint32_t a, uint32_t b, uint32_t c)
+{
+    uint32_t ret = 0;
+    for (int shift = 0; shift < 32; shift += 8)
+        ret |= uint32_t(clip255(int(a >> shift & 0xFF) + int(b >> shift & 0xFF) - int(c >> shift & 0xFF))) << shift;
+    return ret;
+}
+
+static uint32_t clamp_add_subtract_half(uint32_t a, uint32_t b)
+{
+    uint32_t ret = 0;
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        const int ca = int(a >> shift & 0xFF), cb = int(b >> shift & 0xFF);
+        ret |= uint32_t(clip255(ca + (ca - cb) / 2)) << shift;
+    }
+    return ret;
+}
+
+// Prediction of pixel `i` of a `width` wide image from already known pixels, with the given mode.
+// Also valid for the last column: "top-right" then is the first pixel of the current row, as in the spec.
+static uint32_t predict(const uint32_t* px, size_t i, int width, int mode)
+{
+    const uint32_t L  = px[i - 1];
+    const uint32_t T  = px[i - width];
+    const uint32_t TL = px[i - width - 1];
+    const uint32_t TR = px[i - width + 1];
+    switch (mode)
+    {
+        case 0: return 0xFF000000u;
+        case 1: return L;
+        case 2: return T;
+        case 3: return TR;
+        case 4: return TL;
+        case 5: return average2(average2(L, TR), T);
+        case 6: return average2(L, TL);
+        case 7: return average2(L, T);
+        case 8: return average2(TL, T);
+        case 9: return average2(T, TR);
+        case 10: return average2(average2(L, TL), average2(T, TR));
+        case 11: return select_pixel(L, T, TL);
+        case 12: return clamp_add_subtract_full(L, T, TL);
+        case 13: return clamp_add_subtract_half(average2(L, T), TL);
+        default: return 0xFF000000u;  // 14 and 15 are unused, libwebp treats them like 0
+    }
+}
+
+// LZ77 lengths and distances are sent as a prefix code plus extra bits.
+// `value` >= 1, returns the prefix code, sets the extra bits.
+static int prefix_encode(int value, int& extra_bits, int& extra)
+{
+    const int d = value - 1;
+    if (d < 4)
+    {
+        extra_bits = 0;
+        extra      = 0;
+        return d;
+    }
+    const int high   = 31 - std::countl_zero(uint32_t(d));
+    const int second = (d >> (high - 1)) & 1;
+    extra_bits       = high - 1;
+    extra            = d & ((1 << extra_bits) - 1);
+    return 2 * high + second;
+}
+
+static int color_cache_hash(uint32_t argb, int bits)
+{
+    return int((0x1E35A7BDu * argb) >> (32 - bits));
+}
+
+static int div_round_up(int num, int bits)
+{
+    return (num + (1 << bits) - 1) >> bits;
+}
+
+// ------------------------------
+// Encoder
+// ------------------------------
+static constexpr int CACHE_BITS     = 10;
+static constexpr int PREDICTOR_BITS = 4;  // 16x16 tiles
+static constexpr int LZ_HASH_BITS   = 18;
+static constexpr int LZ_MAX_CHAIN   = 24;
+static constexpr int LZ_MIN_MATCH   = 3;
+
+struct token_t
+{
+    enum Kind : uint8_t
+    {
+        Literal,
+        Cache,
+        Copy
+    };
+
+    Kind     kind;
+    uint16_t len;    // Copy
+    uint32_t value;  // ARGB, cache index or distance code
+};
+
+// Tokenize `px` with LZ77 and the color cache (cache_bits 0 = none)
+static std::vector<token_t> lz77(const std::vector<uint32_t>& px, int width, int cache_bits)
+{
+    const size_t n = px.size();
+
+    // Short distances have their own codes, try those first: left, above
+    std::array<std::array<uint8_t, 17>, 8> plane_code{};  // [yi][xi + 8], code + 1
+    for (int c = NUM_PLANE_CODES; c-- > 0;)
+        plane_code[PLANE_CODES[c][1]][PLANE_CODES[c][0] + 8] = uint8_t(c + 1);
+    auto distance_code = [&](size_t dist) -> uint32_t {
+        for (int yi = 0; yi < 8; ++yi)
+        {
+            const long xi = long(dist) - long(yi) * width;
+            if (xi >= -8 && xi <= 8 && plane_code[yi][xi + 8])
+                return plane_code[yi][xi + 8];
+        }
+        return uint32_t(dist) + NUM_PLANE_CODES;
+    };
+
+    auto match_len = [&](size_t ref, size_t pos) {
+        const size_t max = std::min<size_t>(MAX_LENGTH, n - pos);
+        size_t       len = 0;
+        while (len < max && px[ref + len] == px[pos + len])
+            ++len;
+        return len;
+    };
+
+    // Small tables for the small transform images
+    const int            hash_bits = std::clamp(int(std::bit_width(n)), 8, LZ_HASH_BITS);
+    std::vector<int32_t> head(size_t(1) << hash_bits, -1);
+    std::vector<int32_t> prev(n, -1);
+    auto                 hash = [&](size_t pos) {
+        const uint64_t v = uint64_t(px[pos]) << 32 | px[pos + 1];
+        return uint32_t((v * 0x9E3779B97F4A7C15ull) >> (64 - hash_bits));
+    };
+    auto insert = [&](size_t pos) {
+        if (pos + 1 < n)
+        {
+            const uint32_t h = hash(pos);
+            prev[pos]        = head[h];
+            head[h]          = int32_t(pos);
+        }
+    };
+
+    std::vector<uint32_t> cache(cache_bits ? size_t(1) << cache_bits : 0, 0);
+    auto                  cache_insert = [&](uint32_t argb) {
+        if (cache_bits)
+            cache[color_cache_hash(argb, cache_bits)] = argb;
+    };
+
+    std::vector<token_t> tokens;
+    tokens.reserve(n / 4);
+    for (size_t pos = 0; pos < n;)
+    {
+        size_t best_len = 0, best_dist = 0;
+        for (const size_t dist : { size_t(1), size_t(width) })
+        {
+            if (dist <= pos)
+            {
+                const size_t len = match_len(pos - dist, pos);
+                if (len > best_len)
+                {
+                    best_len  = len;
+                    best_dist = dist;
+                }
+            }
+        }
+        if (best_len < std::min<size_t>(MAX_LENGTH, n - pos) && pos + 1 < n)
+        {
+            int32_t cand = head[hash(pos)];
+            for (int chain = LZ_MAX_CHAIN; cand >= 0 && chain > 0; --chain, cand = prev[cand])
+            {
+                const size_t dist = pos - size_t(cand);
+                if (dist > MAX_DISTANCE)
+                    break;
+                if (px[cand + best_len] != px[pos + best_len])
+                    continue;
+                const size_t len = match_len(size_t(cand), pos);
+                if (len > best_len)
+                {
+                    best_len  = len;
+                    best_dist = dist;
+                    if (len == std::min<size_t>(MAX_LENGTH, n - pos))
+                        break;
+                }
+            }
+        }
+
+        if (best_len >= LZ_MIN_MATCH)
+        {
+            tokens.push_back({ token_t::Copy, uint16_t(best_len), distance_code(best_dist) });
+            for (size_t end = pos + best_len; pos < end; ++pos)
+            {
+                insert(pos);
+                cache_insert(px[pos]);
+            }
+            continue;
+        }
+
+        const uint32_t argb = px[pos];
+        if (cache_bits && cache[color_cache_hash(argb, cache_bits)] == argb)
+        {
+            tokens.push_back({ token_t::Cache, 0, uint32_t(color_cache_hash(argb, cache_bits)) });
+        }
+        else
+        {
+            tokens.push_back({ token_t::Literal, 0, argb });
+            cache_insert(argb);
+        }
+        insert(pos);
+        ++pos;
+    }
+    return tokens;
+}
+
+struct prefix_code_t
+{
+    std::vector<uint8_t>  lens;
+    std::vector<uint16_t> codes;
+};
+
+// Write the lengths of a "normal" code, themselves compressed with the code length code
+static void write_code_lengths(BitWriter& bw, const std::vector<uint8_t>& lens)
+{
+    // Run-length encode: 0..15 literal, 16 repeats the previous non-zero length 3-6 times,
+    // 17 and 18 repeat zeros 3-10 and 11-138 times
+    struct clen_token_t
+    {
+        uint8_t sym, extra;
+    };
+    std::vector<clen_token_t> tokens;
+    const size_t              n = lens.size();
+    for (size_t i = 0; i < n;)
+    {
+        const uint8_t v   = lens[i];
+        size_t        run = 1;
+        while (i + run < n && lens[i + run] == v)
+            ++run;
+        i += run;
+
+        if (v == 0)
+        {
+            while (run >= 11)
+            {
+                const size_t r = std::min<size_t>(run, 138);
+                tokens.push_back({ 18, uint8_t(r - 11) });
+                run -= r;
+            }
+            if (run >= 3)
+            {
+                tokens.push_back({ 17, uint8_t(run - 3) });
+                run = 0;
+            }
+        }
+        else
+        {
+            tokens.push_back({ v, 0 });
+            --run;
+            while (run >= 3)
+            {
+                const size_t r = std::min<size_t>(run, 6);
+                tokens.push_back({ 16, uint8_t(r - 3) });
+                run -= r;
+            }
+        }
+        for (; run > 0; --run)
+            tokens.push_back({ v, 0 });
+    }
+
+    std::array<uint32_t, CODE_LENGTH_CODES> freq{};
+    for (const clen_token_t& t : tokens)
+        ++freq[t.sym];
+    std::array<uint8_t, CODE_LENGTH_CODES>  clen_lens{};
+    std::array<uint16_t, CODE_LENGTH_CODES> clen_codes{};
+    huffman_lengths(freq.data(), CODE_LENGTH_CODES, 7, clen_lens.data());
+    huffman_codes(clen_lens.data(), CODE_LENGTH_CODES, clen_codes.data());
+
+    int num = CODE_LENGTH_CODES;
+    while (num > 4 && clen_lens[CODE_LENGTH_ORDER[num - 1]] == 0)
+        --num;
+
+    bw.Put(0, 1);  // normal code
+    bw.Put(uint32_t(num - 4), 4);
+    for (int i = 0; i < num; ++i)
+        bw.Put(clen_lens[CODE_LENGTH_ORDER[i]], 3);
+    bw.Put(0, 1);  // max_symbol = alphabet size
+
+    static constexpr int EXTRA_BITS[3] = { 2, 3, 7 };
+    for (const clen_token_t& t : tokens)
+    {
+        bw.Put(clen_codes[t.sym], clen_lens[t.sym]);
+        if (t.sym >= 16)
+            bw.Put(t.extra, EXTRA_BITS[t.sym - 16]);
+    }
+}
+
+// Build and write the prefix code for `freq`
+static prefix_code_t write_prefix_code(BitWriter& bw, const std::vector<uint32_t>& freq)
+{
+    const int     n = int(freq.size());
+    prefix_code_t code{ std::vector<uint8_t>(n, 0), std::vector<uint16_t>(n, 0) };
+
+    int used[3], nused = 0;
+    for (int i = 0; i < n && nused < 3; ++i)
+        if (freq[i])
+            used[nused++] = i;
+
+    // "Simple" codes: one symbol costs no bits at all, two cost one bit each
+    if (nused <= 2 && (nused == 0 || used[nused - 1] < 256))
+    {
+        const int s0 = nused ? used[0] : 0;
+        bw.Put(1, 1);
+        bw.Put(uint32_t(std::max(nused, 1) - 1), 1);
+        bw.Put(s0 > 1, 1);
+        bw.Put(uint32_t(s0), s0 > 1 ? 8 : 1);
+        if (nused == 2)
+        {
+            bw.Put(uint32_t(used[1]), 8);
+            code.lens[used[0]] = code.lens[used[1]] = 1;
+            huffman_codes(code.lens.data(), n, code.codes.data());
+        }
+        return code;
+    }
+
+    huffman_lengths(freq.data(), n, MAX_ALLOWED_CODE_LEN, code.lens.data());
+    huffman_codes(code.lens.data(), n, code.codes.data());
+    write_code_lengths(bw, code.lens);
+    return code;
+}
+
+// Entropy-code `px`. Sub-images (transform data) have no meta prefix codes bit.
+static void write_image(BitWriter& bw, const std::vector<uint32_t>& px, int width, bool main_image)
+{
+    const int                  cache_bits = main_image ? CACHE_BITS : 0;
+    const std::vector<token_t> tokens     = lz77(px, width, cache_bits);
+
+    if (cache_bits)
+    {
+        bw.Put(1, 1);
+        bw.Put(uint32_t(cache_bits), 4);
+    }
+    else
+    {
+        bw.Put(0, 1);
+    }
+    if (main_image)
+        bw.Put(0, 1);  // a single set of prefix codes for the whole image
+
+    // Green + lengths + cache indices, red, blue, alpha, distances
+    std::array<std::vector<uint32_t>, 5> freq = {
+        std::vector<uint32_t>(256 + NUM_LENGTH_CODES + (cache_bits ? 1 << cache_bits : 0)),
+        std::vector<uint32_t>(256),
+        std::vector<uint32_t>(256),
+        std::vector<uint32_t>(256),
+        std::vector<uint32_t>(NUM_DISTANCE_CODES),
+    };
+    int extra_bits = 0, extra = 0;
+    for (const token_t& t : tokens)
+    {
+        switch (t.kind)
+        {
+            case token_t::Literal:
+                ++freq[0][t.value >> 8 & 0xFF];
+                ++freq[1][t.value >> 16 & 0xFF];
+                ++freq[2][t.value & 0xFF];
+                ++freq[3][t.value >> 24];
+                break;
+            case token_t::Cache: ++freq[0][256 + NUM_LENGTH_CODES + t.value]; break;
+            case token_t::Copy:
+                ++freq[0][256 + prefix_encode(t.len, extra_bits, extra)];
+                ++freq[4][prefix_encode(int(t.value), extra_bits, extra)];
+                break;
+        }
+    }
+
+    std::array<prefix_code_t, 5> codes;
+    for (size_t i = 0; i < 5; ++i)
+        codes[i] = write_prefix_code(bw, freq[i]);
+
+    auto put = [&](const prefix_code_t& c, int sym) { bw.Put(c.codes[sym], c.lens[sym]); };
+    for (const token_t& t : tokens)
+    {
+        switch (t.kind)
+        {
+            case token_t::Literal:
+                put(codes[0], t.value >> 8 & 0xFF);
+                put(codes[1], t.value >> 16 & 0xFF);
+                put(codes[2], t.value & 0xFF);
+                put(codes[3], t.value >> 24);
+                break;
+            case token_t::Cache: put(codes[0], 256 + NUM_LENGTH_CODES + int(t.value)); break;
+            case token_t::Copy:
+            {
+                put(codes[0], 256 + prefix_encode(t.len, extra_bits, extra));
+                bw.Put(uint32_t(extra), extra_bits);
+                put(codes[4], prefix_encode(int(t.value), extra_bits, extra));
+                bw.Put(uint32_t(extra), extra_bits);
+                break;
+            }
+        }
+    }
+}
+
+// Sorted palette if `px` has at most 256 colors
+static bool find_palette(const std::vector<uint32_t>& px, std::vector<uint32_t>& palette)
+{
+    palette.clear();
+    std::array<uint32_t, 1024> table;
+    std::array<bool, 1024>     used{};
+    uint32_t                   last = ~px[0];
+    for (const uint32_t argb : px)
+    {
+        if (argb == last)
+            continue;
+        last = argb;
+
+        uint32_t h = (argb * 0x1E35A7BDu) >> 22;
+        while (used[h] && table[h] != argb)
+            h = (h + 1) & 1023;
+        if (used[h])
+            continue;
+        if (palette.size() == 256)
+            return false;
+        used[h]  = true;
+        table[h] = argb;
+        palette.push_back(argb);
+    }
+    std::sort(palette.begin(), palette.end());
+    return true;
+}
+
+Result<> encode_webp_lossless(const capture_result_t& cap, ImageSink& sink)
+{
+    if (cap.w <= 0 || cap.h <= 0 || cap.data.size() < size_t(cap.w) * cap.h * 4)
+        return Err("Image size is empty");
+    if (cap.w > VP8L_MAX_SIZE || cap.h > VP8L_MAX_SIZE)
+        return Err("WebP images can't be larger than {0}x{0}", VP8L_MAX_SIZE);
+
+    const int             w = cap.w, h = cap.h;
+    std::vector<uint32_t> px(size_t(w) * h);
+    bool                  has_alpha = false;
+    for (size_t i = 0; i < px.size(); ++i)
+    {
+        px[i] = to_argb(cap.data.data() + i * 4);
+        has_alpha |= (px[i] >> 24) != 0xFF;
+    }
+
+    std::vector<uint8_t> out;
+    out.reserve(px.size());
+    BitWriter bw(out);
+    bw.Put(VP8L_SIGNATURE, 8);
+    bw.Put(uint32_t(w - 1), 14);
+    bw.Put(uint32_t(h - 1), 14);
+    bw.Put(has_alpha, 1);
+    bw.Put(0, 3);  // version
+
+    int                   main_w = w;
+    std::vector<uint32_t> palette;
+    if (find_palette(px, palette))
+    {
+        const int size        = int(palette.size());
+        const int width_bits  = size <= 2 ? 3 : size <= 4 ? 2 : size <= 16 ? 1 : 0;
+        const int bits_per_px = 8 >> width_bits;
+
+        bw.Put(1, 1);
+        bw.Put(COLOR_INDEXING_TRANSFORM, 2);
+        bw.Put(uint32_t(size - 1), 8);
+        std::vector<uint32_t> deltas(size);
+        for (int i = 0; i < size; ++i)
+            deltas[i] = i ? sub_pixels(palette[i], palette[i - 1]) : palette[0];
+        write_image(bw, deltas, size, false);
+
+        // Indices in the green channel, several per pixel for small palettes
+        main_w = div_round_up(w, width_bits);
+        std::vector<uint32_t> packed(size_t(main_w) * h, 0xFF000000u);
+        uint32_t              last     = palette[0];
+        uint32_t              last_idx = 0;
+        for (int y = 0; y < h; ++y)
+        {
+            for (int x = 0; x < w; ++x)
+            {
+                const uint32_t argb = px[size_t(y) * w + x];
+                if (argb != last)
+                {
+                    last     = argb;
+                    last_idx = uint32_t(std::lower_bound(palette.begin(), palette.end(), argb) - palette.begin());
+                }
+                const int shift = 8 + (x & ((1 << width_bits) - 1)) * bits_per_px;
+                packed[size_t(y) * main_w + (x >> width_bits)] |= last_idx << shift;
+            }
+        }
+        px = std::move(packed);
+    }
+    else
+    {
+        bw.Put(1, 1);
+        bw.Put(SUBTRACT_GREEN_TRANSFORM, 2);
+        for (uint32_t& argb : px)
+        {
+            const uint32_t g = argb >> 8 & 0xFF;
+            argb             = sub_pixels(argb, g << 16 | g);
+        }
+
+        // Per tile, the mode with the smallest sum of absolute residuals
+        const int             tiles_w = div_round_up(w, PREDICTOR_BITS);
+        const int             tiles_h = div_round_up(h, PREDICTOR_BITS);
+        std::vector<uint32_t> modes(size_t(tiles_w) * tiles_h);
+        std::vector<uint32_t> residuals(px.size());
+        for (int ty = 0; ty < tiles_h; ++ty)
+        {
+            for (int tx = 0; tx < tiles_w; ++tx)
+            {
+                const int x0 = tx << PREDICTOR_BITS, x1 = std::min(w, x0 + (1 << PREDICTOR_BITS));
+                const int y0 = ty << PREDICTOR_BITS, y1 = std::min(h, y0 + (1 << PREDICTOR_BITS));
+
+                int      best_mode = 1;
+                uint64_t best_cost = UINT64_MAX;
+                for (int mode = 0; mode < 14; ++mode)
+                {
+                    uint64_t cost = 0;
+                    for (int y = std::max(y0, 1); y < y1 && cost < best_cost; ++y)
+                    {
+                        for (int x = std::max(x0, 1); x < x1; ++x)
+                        {
+                            const size_t   i   = size_t(y) * w + x;
+                            const uint32_t res = sub_pixels(px[i], predict(px.data(), i, w, mode));
+                            for (int shift = 0; shift < 32; shift += 8)
+                                cost += uint64_t(std::abs(int(int8_t(res >> shift))));
+                        }
+                    }
+                    if (cost < best_cost)
+                    {
+                        best_cost = cost;
+                        best_mode = mode;
+                    }
+                }
+                modes[size_t(ty) * tiles_w + tx] = 0xFF000000u | uint32_t(best_mode) << 8;
+
+                for (int y = y0; y < y1; ++y)
+                {
+                    for (int x = x0; x < x1; ++x)
+                    {
+                        const size_t   i    = size_t(y) * w + x;
+                        const uint32_t pred = y == 0 ? (x == 0 ? 0xFF000000u : px[i - 1])
+                                              : x == 0 ? px[i - w]
+                                                       : predict(px.data(), i, w, best_mode);
+                        residuals[i] = sub_pixels(px[i], pred);
+                    }
+                }
+            }
+        }
+
+        bw.Put(1, 1);
+        bw.Put(PREDICTOR_TRANSFORM, 2);
+        bw.Put(PREDICTOR_BITS - 2, 3);
+        write_image(bw, modes, tiles_w, false);
+        px = std::move(residuals);
+    }
+    bw.Put(0, 1);  // no more transforms
+
+    write_image(bw, px, main_w, true);
+    bw.AlignToByte();
+
+    // RIFF container. The sizes go first, so this one can't be streamed.
+    const uint32_t vp8l_size = uint32_t(out.size());
+    const bool     pad       = vp8l_size & 1;
+    uint8_t        header[20];
+    auto           put_le32 = [](uint8_t* p, uint32_t v) {
+        for (int i = 0; i < 4; ++i)
+            p[i] = uint8_t(v >> (8 * i));
+    };
+    std::memcpy(header, "RIFF", 4);
+    put_le32(header + 4, 4 + 8 + vp8l_size + pad);
+    std::memcpy(header + 8, "WEBPVP8L", 8);
+    put_le32(header + 16, vp8l_size);
+    if (pad)
+        out.push_back(0);
+
+    if (!sink.Write(header, sizeof(header)) || !sink.Write(out.data(), out.size()))
+        return Err("Failed to write image: {}", strerror(errno));
+    return Ok();
+}
+
+// ------------------------------
+// Decoder
+// ------------------------------
+class BitReader
+{
+public:
+    BitReader(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+    // n <= 32. Reading past the end gives zeros, see Eos().
+    uint32_t Read(int n)
+    {
+        const uint32_t v = Peek(n);
+        Skip(n);
+        return v;
+    }
+
+    uint32_t Peek(int n)
+    {
+        Fill();
+        return n ? uint32_t(m_acc & ((uint64_t(1) << n) - 1)) : 0;
+    }
+
+    void Skip(int n)
+    {
+        Fill();
+        m_acc >>= n;
+        m_count -= n;
+    }
+
+    // Whether more bits were read than there are
+    bool Eos() const { return m_pos * 8 - size_t(m_count) > m_size * 8; }
+
+private:
+    void Fill()
+    {
+        for (; m_count <= 56; m_count += 8, ++m_pos)
+            m_acc |= uint64_t(m_pos < m_size ? m_data[m_pos] : 0) << m_count;
+    }
+
+    const uint8_t* m_data;
+    size_t         m_size;
+    size_t         m_pos   = 0;
+    uint64_t       m_acc   = 0;
+    int            m_count = 0;
+};
+
+// Prefix code decoding: codes up to FAST_BITS long in one table lookup,
+// longer ones walk the canonical code bit by bit (like zlib's puff.c)
+class HuffmanDecoder
+{
+public:
+    static constexpr int FAST_BITS = 9;
+
+    // False if the lengths don't make a valid code
+    bool Build(const std::vector<uint8_t>& lens)
+    {
+        m_count.fill(0);
+        m_symbols.clear();
+        m_single = -1;
+
+        int nonzero = 0, last = 0;
+        for (size_t i = 0; i < lens.size(); ++i)
+        {
+            if (lens[i])
+            {
+                ++m_count[lens[i]];
+                ++nonzero;
+                last = int(i);
+            }
+        }
+        // A single symbol takes no bits at all
+        if (nonzero <= 1)
+        {
+            m_single = last;
+            return nonzero == 1;
+        }
+
+        int left = 1;
+        for (int len = 1; len <= MAX_ALLOWED_CODE_LEN; ++len)
+        {
+            left = (left << 1) - m_count[len];
+            if (left < 0)
+                return false;
+        }
+        if (left != 0)
+            return false;
+
+        std::array<uint16_t, MAX_ALLOWED_CODE_LEN + 2> offs{};
+        for (int len = 1; len <= MAX_ALLOWED_CODE_LEN; ++len)
+            offs[len + 1] = uint16_t(offs[len] + m_count[len]);
+        m_symbols.resize(nonzero);
+        for (size_t i = 0; i < lens.size(); ++i)
+            if (lens[i])
+                m_symbols[offs[lens[i]]++] = uint16_t(i);
+
+        std::vector<uint16_t> codes(lens.size());
+        huffman_codes(lens.data(), int(lens.size()), codes.data());
+        m_fast.assign(size_t(1) << FAST_BITS, 0);
+        for (size_t i = 0; i < lens.size(); ++i)
+        {
+            if (!lens[i] || lens[i] > FAST_BITS)
+                continue;
+            for (uint32_t k = codes[i]; k < m_fast.size(); k += 1u << lens[i])
+                m_fast[k] = uint16_t(i << 4 | lens[i]);
+        }
+        return true;
+    }
+
+    int Read(BitReader& br) const
+    {
+        if (m_single >= 0)
+            return m_single;
+
+        const uint16_t e = m_fast[br.Peek(FAST_BITS)];
+        if (e & 0xF)
+        {
+            br.Skip(e & 0xF);
+            return e >> 4;
+        }
+
+        int code = 0, first = 0, index = 0;
+        for (int len = 1; len <= MAX_ALLOWED_CODE_LEN; ++len)
+        {
+            code |= int(br.Read(1));
+            const int count = m_count[len];
+            if (code - count < first)
+                return m_symbols[index + (code - first)];
+            index += count;
+            first = (first + count) << 1;
+            code <<= 1;
+        }
+        return 0;  // unreachable with a complete code
+    }
+
+private:
+    std::array<uint16_t, MAX_ALLOWED_CODE_LEN + 1> m_count{};
+    std::vector<uint16_t>                          m_symbols;
+    std::vector<uint16_t>                          m_fast;
+    int                                            m_single = -1;
+};
+
+struct transform_t
+{
+    TransformType         type;
+    int                   bits  = 0;   // tile size (predictor, cross color) or pixel bundling (color indexing)
+    int                   xsize = 0;   // image width before the transform
+    std::vector<uint32_t> data  = {};  // tile data or palette
+};
+
+class Vp8lDecoder
+{
+public:
+    Vp8lDecoder(const uint8_t* data, size_t size) : m_br(data, size) {}
+
+    Result<capture_result_t> Decode()
+    {
+        if (m_br.Read(8) != VP8L_SIGNATURE)
+            return Err("Bad VP8L signature");
+        const int w = int(m_br.Read(14)) + 1;
+        const int h = int(m_br.Read(14)) + 1;
+        m_br.Skip(1);  // alpha hint
+        if (m_br.Read(3) != 0)
+            return Err("Unknown VP8L version");
+
+        // Transforms, each at most once, in the order the encoder applied them
+        std::vector<transform_t> transforms;
+        int                      xsize = w;
+        while (m_br.Read(1))
+        {
+            transform_t t{ TransformType(m_br.Read(2)) };
+            for (const transform_t& other : transforms)
+                if (other.type == t.type)
+                    return Err("Repeated VP8L transform");
+            t.xsize = xsize;
+
+            switch (t.type)
+            {
+                case PREDICTOR_TRANSFORM:
+                case CROSS_COLOR_TRANSFORM:
+                    t.bits = int(m_br.Read(3)) + 2;
+                    TRY(ReadImage(div_round_up(xsize, t.bits), div_round_up(h, t.bits), false, t.data));
+                    break;
+
+                case SUBTRACT_GREEN_TRANSFORM: break;
+
+                case COLOR_INDEXING_TRANSFORM:
+                {
+                    const int size = int(m_br.Read(8)) + 1;
+                    t.bits         = size <= 2 ? 3 : size <= 4 ? 2 : size <= 16 ? 1 : 0;
+                    std::vector<uint32_t> palette;
+                    TRY(ReadImage(size, 1, false, palette));
+                    for (int i = 1; i < size; ++i)
+                        palette[i] = add_pixels(palette[i], palette[i - 1]);
+                    // Out of range indices are transparent black
+                    palette.resize(size_t(1) << (8 >> t.bits), 0);
+                    t.data = std::move(palette);
+                    xsize  = div_round_up(xsize, t.bits);
+                    break;
+                }
+            }
+            transforms.push_back(std::move(t));
+        }
+
+        std::vector<uint32_t> px;
+        TRY(ReadImage(xsize, h, true, px));
+
+        for (auto it = transforms.rbegin(); it != transforms.rend(); ++it)
+            Inverse(*it, h, px);
+
+        capture_result_t cap;
+        cap.w = w;
+        cap.h = h;
+        cap.data.resize(size_t(w) * h * 4);
+        for (size_t i = 0; i < px.size(); ++i)
+            from_argb(px[i], cap.data.data() + i * 4);
+        return Ok(std::move(cap));
+    }
+
+private:
+    using group_t = std::array<HuffmanDecoder, 5>;
+
+    Result<> ReadCode(int alphabet_size, HuffmanDecoder& code)
+    {
+        std::vector<uint8_t> lens(alphabet_size, 0);
+        if (m_br.Read(1))  // simple code
+        {
+            const int num   = int(m_br.Read(1)) + 1;
+            const int first = int(m_br.Read(m_br.Read(1) ? 8 : 1));
+            if (first >= alphabet_size)
+                return Err("Bad VP8L prefix code");
+            lens[first] = 1;
+            if (num == 2)
+            {
+                const int second = int(m_br.Read(8));
+                if (second >= alphabet_size)
+                    return Err("Bad VP8L prefix code");
+                lens[second] = 1;
+            }
+            code.Build(lens);  // one symbol (maybe given twice) or two of length 1, always valid
+            return Ok();
+        }
+
+        std::vector<uint8_t> clen_lens(CODE_LENGTH_CODES, 0);
+        const int            num = int(m_br.Read(4)) + 4;
+        for (int i = 0; i < num; ++i)
+            clen_lens[CODE_LENGTH_ORDER[i]] = uint8_t(m_br.Read(3));
+        HuffmanDecoder clen_code;
+        if (!clen_code.Build(clen_lens))
+            return Err("Bad VP8L code length code");
+
+        int max_symbol = alphabet_size;
+        if (m_br.Read(1))
+        {
+            const int length_nbits = 2 + 2 * int(m_br.Read(3));
+            max_symbol             = 2 + int(m_br.Read(length_nbits));
+            if (max_symbol > alphabet_size)
+                return Err("Bad VP8L code lengths");
+        }
+
+        int prev = 8;
+        for (int i = 0; i < alphabet_size && max_symbol-- > 0;)
+        {
+            const int sym = clen_code.Read(m_br);
+            if (sym < 16)
+            {
+                lens[i++] = uint8_t(sym);
+                if (sym)
+                    prev = sym;
+                continue;
+            }
+            // 16: previous non-zero length 3-6 times, 17: zero 3-10 times, 18: zero 11-138 times
+            const int repeat = sym == 16   ? 3 + int(m_br.Read(2))
+                               : sym == 17 ? 3 + int(m_br.Read(3))
+                                           : 11 + int(m_br.Read(7));
+            const uint8_t value = sym == 16 ? uint8_t(prev) : 0;
+            if (i + repeat > alphabet_size)
+                return Err("Bad VP8L code lengths");
+            std::fill_n(lens.begin() + i, repeat, value);
+            i += repeat;
+        }
+        if (m_br.Eos() || !code.Build(lens))
+            return Err("Bad VP8L prefix code");
+        return Ok();
+    }
+
+    // An entropy-coded image: optional color cache, (main image only) meta prefix codes, then pixels
+    Result<> ReadImage(int xsize, int ysize, bool main_image, std::vector<uint32_t>& px)
+    {
+        int cache_bits = 0;
+        if (m_br.Read(1))
+        {
+            cache_bits = int(m_br.Read(4));
+            if (cache_bits < 1 || cache_bits > 11)
+                return Err("Bad VP8L color cache size");
+        }
+
+        int                   prefix_bits = 0, prefix_xsize = 0;
+        std::vector<uint32_t> entropy;
+        int                   num_groups = 1;
+        if (main_image && m_br.Read(1))
+        {
+            prefix_bits  = int(m_br.Read(3)) + 2;
+            prefix_xsize = div_round_up(xsize, prefix_bits);
+            TRY(ReadImage(prefix_xsize, div_round_up(ysize, prefix_bits), false, entropy));
+            for (uint32_t& e : entropy)
+            {
+                e          = e >> 8 & 0xFFFF;
+                num_groups = std::max(num_groups, int(e) + 1);
+            }
+        }
+
+        const int            sizes[5] = { 256 + NUM_LENGTH_CODES + (cache_bits ? 1 << cache_bits : 0), 256, 256, 256,
+                                          NUM_DISTANCE_CODES };
+        std::vector<group_t> groups(num_groups);
+        for (group_t& group : groups)
+            for (int i = 0; i < 5; ++i)
+                TRY(ReadCode(sizes[i], group[i]));
+
+        const size_t n = size_t(xsize) * ysize;
+        px.assign(n, 0);
+        std::vector<uint32_t> cache(cache_bits ? size_t(1) << cache_bits : 0, 0);
+        size_t                cached = 0;  // px[0, cached) are in the cache
+        auto                  update_cache = [&](size_t upto) {
+            if (cache_bits)
+                for (; cached < upto; ++cached)
+                    cache[color_cache_hash(px[cached], cache_bits)] = px[cached];
+        };
+
+        int            x = 0, y = 0;
+        const group_t* group   = &groups[0];
+        bool           refresh = true;
+        for (size_t pos = 0; pos < n;)
+        {
+            if (prefix_bits && (refresh || (x & ((1 << prefix_bits) - 1)) == 0))
+                group = &groups[entropy[size_t(y >> prefix_bits) * prefix_xsize + (x >> prefix_bits)]];
+
+            const int sym = (*group)[0].Read(m_br);
+            size_t    len = 1;
+            if (sym < 256)
+            {
+                const uint32_t r = uint32_t((*group)[1].Read(m_br));
+                const uint32_t b = uint32_t((*group)[2].Read(m_br));
+                const uint32_t a = uint32_t((*group)[3].Read(m_br));
+                px[pos]          = a << 24 | r << 16 | uint32_t(sym) << 8 | b;
+            }
+            else if (sym < 256 + NUM_LENGTH_CODES)
+            {
+                len                 = PrefixValue(sym - 256);
+                const int dist_code = int(PrefixValue((*group)[4].Read(m_br)));
+                long      dist      = dist_code - NUM_PLANE_CODES;
+                if (dist_code <= NUM_PLANE_CODES)
+                {
+                    const int8_t* xy = PLANE_CODES[dist_code - 1];
+                    dist             = std::max(1L, long(xy[0]) + long(xy[1]) * xsize);
+                }
+                if (size_t(dist) > pos || len > n - pos)
+                    return Err("Bad VP8L backward reference");
+                for (size_t i = 0; i < len; ++i)
+                    px[pos + i] = px[pos + i - dist];
+            }
+            else
+            {
+                update_cache(pos);
+                px[pos] = cache[sym - 256 - NUM_LENGTH_CODES];
+            }
+
+            if (m_br.Eos())
+                return Err("Truncated VP8L data");
+            pos += len;
+            x += int(len);
+            while (x >= xsize)
+            {
+                x -= xsize;
+                ++y;
+            }
+            refresh = len > 1;  // a copy may end anywhere in another tile
+        }
+        return Ok();
+    }
+
+    size_t PrefixValue(int code)
+    {
+        if (code < 4)
+            return size_t(code) + 1;
+        const int extra_bits = (code - 2) >> 1;
+        const int offset     = (2 + (code & 1)) << extra_bits;
+        return size_t(offset) + m_br.Read(extra_bits) + 1;
+    }
+
+    static void Inverse(const transform_t& t, int h, std::vector<uint32_t>& px)
+    {
+        const int w = t.xsize;
+        switch (t.type)
+        {
+            case PREDICTOR_TRANSFORM:
+            {
+                const int tiles_w = div_round_up(w, t.bits);
+                for (int y = 0; y < h; ++y)
+                {
+                    for (int x = 0; x < w; ++x)
+                    {
+                        const size_t i = size_t(y) * w + x;
+                        uint32_t     pred;
+                        if (y == 0)
+                        {
+                            pred = x == 0 ? 0xFF000000u : px[i - 1];
+                        }
+                        else if (x == 0)
+                        {
+                            pred = px[i - w];
+                        }
+                        else
+                        {
+                            const uint32_t mode = t.data[(y >> t.bits) * tiles_w + (x >> t.bits)] >> 8 & 0xF;
+                            pred                = predict(px.data(), i, w, int(mode));
+                        }
+                        px[i] = add_pixels(px[i], pred);
+                    }
+                }
+                break;
+            }
+
+            case CROSS_COLOR_TRANSFORM:
+            {
+                const int tiles_w = div_round_up(w, t.bits);
+                auto      delta   = [](uint32_t t8, uint32_t c8) { return (int(int8_t(t8)) * int(int8_t(c8))) >> 5; };
+                for (int y = 0; y < h; ++y)
+                {
+                    for (int x = 0; x < w; ++x)
+                    {
+                        const uint32_t m             = t.data[size_t(y >> t.bits) * tiles_w + (x >> t.bits)];
+                        const uint32_t green_to_red  = m & 0xFF;
+                        const uint32_t green_to_blue = m >> 8 & 0xFF;
+                        const uint32_t red_to_blue   = m >> 16 & 0xFF;
+
+                        uint32_t&      argb  = px[size_t(y) * w + x];
+                        const uint32_t green = argb >> 8 & 0xFF;
+                        int            red   = int(argb >> 16 & 0xFF);
+                        int            blue  = int(argb & 0xFF);
+                        red += delta(green_to_red, green);
+                        red &= 0xFF;
+                        blue += delta(green_to_blue, green);
+                        blue += delta(red_to_blue, uint32_t(red));
+                        blue &= 0xFF;
+                        argb = (argb & 0xFF00FF00u) | uint32_t(red) << 16 | uint32_t(blue);
+                    }
+                }
+                break;
+            }
+
+            case SUBTRACT_GREEN_TRANSFORM:
+                for (uint32_t& argb : px)
+                {
+                    const uint32_t g = argb >> 8 & 0xFF;
+                    argb             = add_pixels(argb, g << 16 | g);
+                }
+                break;
+
+            case COLOR_INDEXING_TRANSFORM:
+            {
+                // Unbundle from the packed width back to the full one
+                const int             packed_w    = div_round_up(w, t.bits);
+                const int             bits_per_px = 8 >> t.bits;
+                const uint32_t        mask        = (1u << bits_per_px) - 1;
+                std::vector<uint32_t> out(size_t(w) * h);
+                for (int y = 0; y < h; ++y)
+                {
+                    for (int x = 0; x < w; ++x)
+                    {
+                        const uint32_t packed = px[size_t(y) * packed_w + (x >> t.bits)] >> 8 & 0xFF;
+                        const uint32_t index  = packed >> ((x & ((1 << t.bits) - 1)) * bits_per_px) & mask;
+                        out[size_t(y) * w + x] = t.data[index];
+                    }
+                }
+                px = std::move(out);
+                break;
+            }
+        }
+    }
+
+    BitReader m_br;
+};
+
+static uint32_t get_le32(const uint8_t* p)
+{
+    return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+}
+
+Result<capture_result_t> decode_webp(std::span<const uint8_t> data)
+{
+    if (data.size() < 20 || std::memcmp(data.data(), "RIFF", 4) != 0 || std::memcmp(data.data() + 8, "WEBP", 4) != 0)
+        return Err("Not a WebP image");
+
+    // Walk the chunks for the VP8L one, the extended format (VP8X) may have others around it
+    for (size_t pos = 12; pos + 8 <= data.size();)
+    {
+        const uint8_t* chunk = data.data() + pos;
+        const size_t   size  = get_le32(chunk + 4);
+        if (size > data.size() - pos - 8)
+            return Err("Truncated WebP chunk");
+
+        if (std::memcmp(chunk, "VP8L", 4) == 0)
+            return Vp8lDecoder(chunk + 8, size).Decode();
+        if (std::memcmp(chunk, "VP8 ", 4) == 0)
+            return Err("Lossy WebP images are not supported");
+        if (std::memcmp(chunk, "ANIM", 4) == 0)
+            return Err("Animated WebP images are not supported");
+
+        pos += 8 + size + (size & 1);
+    }
+    return Err("No image data in WebP file");
+}